@@ -0,0 +1,38 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.const import CONF_OUTPUT_ID
+
+from esphome.components import light
+
+DEPENDENCIES = ["xenopixel_light"]
+
+xenopixel_group_ns = cg.esphome_ns.namespace("xenopixel_group")
+XenopixelGroup = xenopixel_group_ns.class_(
+    "XenopixelGroup", light.LightOutput, cg.Component
+)
+
+CONF_LIGHTS = "lights"
+
+# Must match XenopixelGroup::MAX_MEMBERS (XenopixelLight::MAX_LIGHTS)
+MAX_MEMBERS = 8
+
+CONFIG_SCHEMA = light.RGB_LIGHT_SCHEMA.extend(
+    {
+        cv.GenerateID(CONF_OUTPUT_ID): cv.declare_id(XenopixelGroup),
+        # xenopixel_light entities only; others are ignored at runtime
+        cv.Required(CONF_LIGHTS): cv.All(
+            cv.ensure_list(cv.use_id(light.LightState)),
+            cv.Length(min=2, max=MAX_MEMBERS),
+        ),
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_OUTPUT_ID])
+    await cg.register_component(var, config)
+    await light.register_light(var, config)
+
+    for light_id in config[CONF_LIGHTS]:
+        member = await cg.get_variable(light_id)
+        cg.add(var.add_member(member))
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "esphome/core/component.h"
+#include "esphome/components/light/light_output.h"
+#include "esphome/components/xenopixel_light/xenopixel_light.h"
+
+// One light entity driving several sabers at once.
+//
+// write_state() stages the group's state on every member: the values are
+// set on the member's own LightState with an immediate call, so its entity
+// shows them and its next write_state() starts from them; then the member
+// is held in the BleWriteScheduler, runs its own write_state() (shadow,
+// dead-band and all), and flushes the result into its TX queue on its next
+// loop(). The group's transition runs on the group entity, so members are
+// only published once it has reached its target. Once no member has anything left to flush, or after
+// STAGE_TIMEOUT_MS, the group releases them all; the scheduler lets them go
+// in the same interval, power frames first, so the sabers ignite together
+// instead of one write_state() apart.
+//
+// The skew is the spread of the members' first write after a release, as
+// handed to the BLE stack. The air time still depends on each connection
+// event, which the realtime connection interval keeps short.
+
+namespace esphome {
+namespace xenopixel_group {
+
+using xenopixel_light::XenopixelLight;
+
+class XenopixelGroup : public light::LightOutput, public Component {
+ public:
+  static constexpr size_t MAX_MEMBERS = XenopixelLight::MAX_LIGHTS;
+  static constexpr uint32_t STAGE_TIMEOUT_MS = 100;
+  // Members that have not written by then are left out of the skew
+  static constexpr uint32_t SKEW_TIMEOUT_MS = 500;
+
+  struct Stats {
+    uint32_t releases{0};
+    uint32_t stage_timeouts{0};  // released with commands still unflushed
+    uint32_t last_skew_us{0};
+    uint32_t max_skew_us{0};
+    uint8_t last_members{0};  // members that wrote in the last release
+  };
+
+  // Resolved lazily: a member's LightState only knows its output once
+  // setup_state() has run
+  void add_member(light::LightState *state) {
+    if (member_count_ >= MAX_MEMBERS) {
+      ESP_LOGW("xenopixel", "Group full (%u sabers)", (unsigned)MAX_MEMBERS);
+      return;
+    }
+    member_states_[member_count_++] = state;
+  }
+  size_t member_count() const { return member_count_; }
+
+  light::LightTraits get_traits() override {
+    auto traits = light::LightTraits();
+    traits.set_supported_color_modes({light::ColorMode::RGB});
+    return traits;
+  }
+
+  void write_state(light::LightState *state) override {
+    const light::LightColorValues &v = state->current_values;
+    bool settled = v == state->remote_values;
+    for (size_t i = 0; i < member_count_; i++) {
+      XenopixelLight *m = member_(i);
+      if (m == nullptr) continue;
+      light::LightState *ms = member_states_[i];
+      ms->make_call()
+          .set_state(v.is_on())
+          .set_brightness(v.get_brightness())
+          .set_rgb(v.get_red(), v.get_green(), v.get_blue())
+          .set_transition_length(0)
+          .set_publish(settled)
+          .set_save(settled)
+          .perform();
+      m->hold_writes();
+      m->write_state(ms);
+    }
+    if (staging_) return;
+    staging_ = true;
+    stage_ms_ = millis();
+  }
+
+  void loop() override {
+    uint32_t now = millis();
+    if (staging_) release_if_staged_(now);
+    if (measuring_) measure_skew_(now);
+  }
+
+  bool is_staging() const { return staging_; }
+  const Stats &get_stats() const { return stats_; }
+  // NAN until a release has had two members writing, for a template sensor
+  float get_last_skew_ms() const {
+    if (stats_.last_members < 2) return NAN;
+    return stats_.last_skew_us / 1000.0f;
+  }
+
+ protected:
+  XenopixelLight *member_(size_t i) {
+    if (members_[i] == nullptr)
+      members_[i] = XenopixelLight::for_state(member_states_[i]);
+    return members_[i];
+  }
+
+  void release_if_staged_(uint32_t now) {
+    bool flushed = true;
+    for (size_t i = 0; i < member_count_; i++) {
+      XenopixelLight *m = member_(i);
+      if (m != nullptr && m->has_unflushed_commands()) flushed = false;
+    }
+    if (!flushed) {
+      if (now - stage_ms_ < STAGE_TIMEOUT_MS) return;
+      stats_.stage_timeouts++;
+    }
+    for (size_t i = 0; i < member_count_; i++) {
+      XenopixelLight *m = member_(i);
+      if (m != nullptr) m->release_writes();
+    }
+    staging_ = false;
+    stats_.releases++;
+    measuring_ = true;
+    release_ms_ = now;
+  }
+
+  void measure_skew_(uint32_t now) {
+    uint32_t first = 0, last = 0;
+    uint8_t wrote = 0;
+    for (size_t i = 0; i < member_count_; i++) {
+      XenopixelLight *m = member_(i);
+      if (m == nullptr) continue;
+      if (m->awaiting_group_write()) {
+        if (now - release_ms_ < SKEW_TIMEOUT_MS) return;
+        continue;
+      }
+      uint32_t us;
+      if (!m->group_write_us(us)) continue;
+      if (wrote == 0 || (int32_t)(us - first) < 0) first = us;
+      if (wrote == 0 || (int32_t)(us - last) > 0) last = us;
+      wrote++;
+    }
+    measuring_ = false;
+    stats_.last_members = wrote;
+    if (wrote < 2) return;
+    stats_.last_skew_us = last - first;
+    if (stats_.last_skew_us > stats_.max_skew_us)
+      stats_.max_skew_us = stats_.last_skew_us;
+    ESP_LOGD("xenopixel", "Group of %u released, skew %uus", (unsigned)wrote,
+             (unsigned)stats_.last_skew_us);
+  }
+
+  light::LightState *member_states_[MAX_MEMBERS] = {};
+  XenopixelLight *members_[MAX_MEMBERS] = {};
+  size_t member_count_{0};
+  bool staging_{false};
+  uint32_t stage_ms_{0};
+  bool measuring_{false};
+  uint32_t release_ms_{0};
+  Stats stats_;
+};
+
+}  // namespace xenopixel_group
+}  // namespace esphome
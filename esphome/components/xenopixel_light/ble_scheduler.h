@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Shared write budget for every saber connection.
+//
+// Each XenopixelLight registers as a BleWriteClient. Time is split into
+// INTERVAL_MS scheduling intervals, about one BLE connection event; each
+// interval allows at most MAX_WRITES_PER_INTERVAL writes in total and
+// MAX_WRITES_PER_CONN per connection, so more sabers share the same budget
+// instead of all bursting into the controller at once.
+//
+// Within an interval, clients are served by priority — effects, then
+// control (power), then streaming (brightness/color) — ranked by the most
+// urgent frame each one has queued. A client's frames still go out in
+// order, so a power frame queued behind a color frame lifts that color
+// frame to control priority too. Clients of the same priority take turns
+// by deficit round robin: each visit credits a
+// client QUANTUM_BYTES and writes at most one frame, which costs its length,
+// so sabers sending long combined frames get fewer turns than those sending
+// short ones.
+//
+// Every light's loop() calls service(); whichever runs first in an interval
+// does the writes for all of them.
+//
+// A client can be held: it is not served until release(), which takes
+// effect at the start of the next interval. Clients released together
+// (a XenopixelGroup) so start in the same interval with its whole budget,
+// whichever light's loop() opens it.
+
+namespace esphome {
+namespace xenopixel_light {
+
+enum BlePriority : uint8_t {
+  BLE_PRIORITY_EFFECT = 0,
+  BLE_PRIORITY_CONTROL = 1,
+  BLE_PRIORITY_STREAM = 2,
+};
+
+class BleWriteClient {
+ public:
+  // len is that of the frame write_next() sends; priority is that of the
+  // most urgent frame queued, which may be further back
+  struct NextWrite {
+    size_t len{0};
+    BlePriority priority{BLE_PRIORITY_STREAM};
+  };
+
+  virtual ~BleWriteClient() = default;
+  // False when nothing can be written right now
+  virtual bool peek_write(NextWrite &next) = 0;
+  // Writes the frame peek_write() described. False when the write failed;
+  // the client is then skipped for the rest of this service() call.
+  virtual bool write_next() = 0;
+};
+
+class BleWriteScheduler {
+ public:
+  static constexpr size_t MAX_CLIENTS = 8;
+  static constexpr uint32_t INTERVAL_MS = 10;
+  static constexpr uint8_t MAX_WRITES_PER_INTERVAL = 8;
+  static constexpr uint8_t MAX_WRITES_PER_CONN = 4;
+  // About one single-key frame per visit; longer frames take several.
+  // Unused credit carries over up to one full frame.
+  static constexpr uint32_t QUANTUM_BYTES = 32;
+  static constexpr uint32_t MAX_DEFICIT_BYTES = 96;
+
+  struct Stats {
+    uint32_t writes{0};
+    uint32_t failed{0};
+    uint32_t budget_exhausted{0};  // intervals that ran out with work left
+  };
+
+  static BleWriteScheduler &instance() {
+    static BleWriteScheduler scheduler;
+    return scheduler;
+  }
+
+  bool add_client(BleWriteClient *client) {
+    if (find_(client) >= 0) return true;
+    if (count_ >= MAX_CLIENTS) return false;
+    clients_[count_++] = Client{client};
+    return true;
+  }
+
+  void remove_client(BleWriteClient *client) {
+    int i = find_(client);
+    if (i < 0) return;
+    for (size_t j = i; j + 1 < count_; j++) clients_[j] = clients_[j + 1];
+    count_--;
+    for (size_t p = 0; p < PRIORITIES; p++)
+      if (cursor_[p] >= count_) cursor_[p] = 0;
+  }
+
+  size_t client_count() const { return count_; }
+
+  void hold(const BleWriteClient *client) {
+    int i = find_(client);
+    if (i >= 0) clients_[i].held = true;
+  }
+  // A hold() before the next interval does not cancel the release
+  void release(const BleWriteClient *client) {
+    int i = find_(client);
+    if (i >= 0 && clients_[i].held) clients_[i].releasing = true;
+  }
+  bool held(const BleWriteClient *client) const {
+    int i = find_(client);
+    return i >= 0 && clients_[i].held;
+  }
+
+  void service(uint32_t now) {
+    if (!has_interval_ || now - interval_start_ms_ >= INTERVAL_MS) {
+      has_interval_ = true;
+      interval_start_ms_ = now;
+      interval_writes_ = 0;
+      exhausted_ = false;
+      for (size_t i = 0; i < count_; i++) {
+        Client &c = clients_[i];
+        c.writes = 0;
+        if (c.releasing) c.held = c.releasing = false;
+      }
+    }
+    for (size_t i = 0; i < count_; i++) clients_[i].failed = false;
+
+    for (size_t p = 0; p < PRIORITIES; p++) {
+      while (serve_round_((BlePriority)p)) {
+      }
+    }
+
+    if (!exhausted_ && interval_writes_ >= MAX_WRITES_PER_INTERVAL &&
+        any_pending_()) {
+      exhausted_ = true;
+      stats_.budget_exhausted++;
+    }
+  }
+
+  // Writes left in the current interval for this client
+  uint8_t writes_left(const BleWriteClient *client) const {
+    int i = find_(client);
+    if (i < 0) return 0;
+    uint8_t conn = MAX_WRITES_PER_CONN - clients_[i].writes;
+    uint8_t total = MAX_WRITES_PER_INTERVAL - interval_writes_;
+    return conn < total ? conn : total;
+  }
+
+  // True when service() at now could write for this client: it is
+  // registered, not held and has budget left in the interval, or a new
+  // interval with all of it is due
+  bool has_budget(const BleWriteClient *client, uint32_t now) const {
+    int i = find_(client);
+    if (i < 0) return false;
+    const Client &c = clients_[i];
+    if (!has_interval_ || now - interval_start_ms_ >= INTERVAL_MS)
+      return !c.held || c.releasing;
+    return !c.held && writes_left(client) > 0;
+  }
+
+  const Stats &get_stats() const { return stats_; }
+
+  void reset() {
+    count_ = 0;
+    has_interval_ = false;
+    interval_writes_ = 0;
+    exhausted_ = false;
+    for (size_t p = 0; p < PRIORITIES; p++) cursor_[p] = 0;
+    stats_ = Stats();
+  }
+
+ protected:
+  static constexpr size_t PRIORITIES = 3;
+
+  struct Client {
+    BleWriteClient *client{nullptr};
+    uint32_t deficit{0};
+    uint8_t writes{0};
+    bool failed{false};
+    bool held{false};
+    bool releasing{false};
+  };
+
+  int find_(const BleWriteClient *client) const {
+    for (size_t i = 0; i < count_; i++)
+      if (clients_[i].client == client) return (int)i;
+    return -1;
+  }
+
+  bool eligible_(const Client &c) const {
+    return !c.failed && !c.held && c.writes < MAX_WRITES_PER_CONN;
+  }
+
+  bool any_pending_() {
+    BleWriteClient::NextWrite next;
+    for (size_t i = 0; i < count_; i++)
+      if (eligible_(clients_[i]) && clients_[i].client->peek_write(next))
+        return true;
+    return false;
+  }
+
+  // One DRR round over the clients whose next frame has priority p.
+  // Returns true while any of them still has a frame waiting, so the caller
+  // runs another round; credit grows every round, budgets bound the writes.
+  bool serve_round_(BlePriority p) {
+    bool pending = false;
+    size_t start = cursor_[p];
+    for (size_t n = 0; n < count_; n++) {
+      if (interval_writes_ >= MAX_WRITES_PER_INTERVAL) return false;
+      size_t i = (start + n) % count_;
+      Client &c = clients_[i];
+      BleWriteClient::NextWrite next;
+      if (!eligible_(c) || !c.client->peek_write(next) ||
+          next.priority != p) {
+        // Nothing of this priority waiting: no credit carries over
+        c.deficit = 0;
+        continue;
+      }
+      pending = true;
+      c.deficit += QUANTUM_BYTES;
+      if (c.deficit > MAX_DEFICIT_BYTES) c.deficit = MAX_DEFICIT_BYTES;
+      cursor_[p] = (i + 1) % count_;
+      if (next.len > c.deficit) continue;
+      if (!c.client->write_next()) {
+        c.failed = true;
+        stats_.failed++;
+        continue;
+      }
+      c.deficit -= next.len;
+      c.writes++;
+      interval_writes_++;
+      stats_.writes++;
+    }
+    return pending;
+  }
+
+  Client clients_[MAX_CLIENTS];
+  size_t count_{0};
+  size_t cursor_[PRIORITIES] = {};
+  uint32_t interval_start_ms_{0};
+  bool has_interval_{false};
+  uint8_t interval_writes_{0};
+  bool exhausted_{false};
+  Stats stats_;
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
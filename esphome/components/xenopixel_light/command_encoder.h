@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Encoder for outgoing Xenopixel command frames ([2,{"Key":value,...}]).
+//
+// Every key is a CommandKey built at compile time, holding the literal
+// `[2,{"Key":` — a single-key frame starts with one memcpy of it, and later
+// fields of a combined frame reuse its `"Key":` tail. Integers go through a
+// small hand-rolled formatter instead of snprintf.
+//
+// CommandFrame::write() computes the exact frame length first and writes
+// nothing when it does not fit, so it can encode straight into a TX queue
+// slot that already holds an older frame (see TxQueue::emplace()).
+
+namespace esphome {
+namespace xenopixel_light {
+
+// Length of "[2,{" — the `"Key":` field starts right after it
+static constexpr size_t CMD_FIELD_OFFSET = 4;
+
+template<size_t N> struct CommandKey {
+  // "[2,{" + '"' + name + '"' + ':'
+  static constexpr size_t PREFIX_LEN = CMD_FIELD_OFFSET + (N - 1) + 3;
+
+  constexpr explicit CommandKey(const char (&name)[N]) : prefix{} {
+    const char head[] = "[2,{\"";
+    for (size_t i = 0; i < 5; i++) prefix[i] = head[i];
+    for (size_t i = 0; i < N - 1; i++) prefix[5 + i] = name[i];
+    prefix[PREFIX_LEN - 2] = '"';
+    prefix[PREFIX_LEN - 1] = ':';
+  }
+
+  char prefix[PREFIX_LEN];
+};
+
+template<size_t N> constexpr CommandKey<N> command_key(const char (&name)[N]) {
+  return CommandKey<N>(name);
+}
+
+// Keys the component sends
+static constexpr auto CMD_POWER_ON = command_key("PowerOn");
+static constexpr auto CMD_BRIGHTNESS = command_key("Brightness");
+static constexpr auto CMD_BACKGROUND_COLOR = command_key("BackgroundColor");
+static constexpr auto CMD_VOLUME = command_key("Volume");
+static constexpr auto CMD_SOUND_FONT = command_key("CurrentSoundPackageNo");
+static constexpr auto CMD_LIGHT_EFFECT = command_key("CurrentLightEffect");
+static constexpr auto CMD_CLASH = command_key("Clash");
+static constexpr auto CMD_BLASTER = command_key("Blaster");
+static constexpr auto CMD_FORCE = command_key("Force");
+static constexpr auto CMD_LOCKUP = command_key("Lockup");
+static constexpr auto CMD_DRAG = command_key("Drag");
+
+// Up to MAX_FIELDS keys, written in the order they were added
+class CommandFrame {
+ public:
+  static constexpr size_t MAX_FIELDS = 4;
+
+  template<size_t N> CommandFrame &add(const CommandKey<N> &key, bool v) {
+    Field *f = next_(key);
+    if (f != nullptr) {
+      f->type = BOOL;
+      f->v[0] = v;
+    }
+    return *this;
+  }
+
+  template<size_t N> CommandFrame &add(const CommandKey<N> &key, int v) {
+    Field *f = next_(key);
+    if (f != nullptr) {
+      f->type = INT;
+      f->v[0] = v;
+    }
+    return *this;
+  }
+
+  template<size_t N>
+  CommandFrame &add(const CommandKey<N> &key, int r, int g, int b) {
+    Field *f = next_(key);
+    if (f != nullptr) {
+      f->type = TRIPLET;
+      f->v[0] = r;
+      f->v[1] = g;
+      f->v[2] = b;
+    }
+    return *this;
+  }
+
+  size_t count() const { return count_; }
+
+  size_t size() const {
+    if (count_ == 0) return 0;
+    size_t len = 2;  // "}]"
+    for (size_t i = 0; i < count_; i++) {
+      const Field &f = fields_[i];
+      len += i == 0 ? f.prefix_len : 1 + f.prefix_len - CMD_FIELD_OFFSET;
+      len += value_len_(f);
+    }
+    return len;
+  }
+
+  // Returns the frame length, or 0 without touching buf if it does not fit
+  size_t write(char *buf, size_t cap) const {
+    size_t len = size();
+    if (len == 0 || len > cap) return 0;
+    char *p = buf;
+    for (size_t i = 0; i < count_; i++) {
+      const Field &f = fields_[i];
+      if (i == 0) {
+        p = put_(p, f.prefix, f.prefix_len);
+      } else {
+        *p++ = ',';
+        p = put_(p, f.prefix + CMD_FIELD_OFFSET,
+                 f.prefix_len - CMD_FIELD_OFFSET);
+      }
+      p = put_value_(p, f);
+    }
+    *p++ = '}';
+    *p++ = ']';
+    return p - buf;
+  }
+
+  static size_t int_len(int v) {
+    uint32_t u = v < 0 ? 0u - (uint32_t)v : (uint32_t)v;
+    size_t n = v < 0 ? 2 : 1;
+    while (u >= 10) {
+      u /= 10;
+      n++;
+    }
+    return n;
+  }
+
+  // Writes v without a terminator, returns the end of the digits
+  static char *put_int(char *p, int v) {
+    uint32_t u = v < 0 ? 0u - (uint32_t)v : (uint32_t)v;
+    if (v < 0) *p++ = '-';
+    char digits[10];
+    size_t n = 0;
+    do {
+      digits[n++] = (char)('0' + u % 10);
+      u /= 10;
+    } while (u != 0);
+    while (n > 0) *p++ = digits[--n];
+    return p;
+  }
+
+ protected:
+  enum Type : uint8_t { BOOL, INT, TRIPLET };
+
+  struct Field {
+    const char *prefix;
+    uint8_t prefix_len;
+    Type type;
+    int v[3];
+  };
+
+  template<size_t N> Field *next_(const CommandKey<N> &key) {
+    static_assert(CommandKey<N>::PREFIX_LEN < 256, "key too long");
+    if (count_ >= MAX_FIELDS) return nullptr;
+    Field *f = &fields_[count_++];
+    f->prefix = key.prefix;
+    f->prefix_len = (uint8_t)CommandKey<N>::PREFIX_LEN;
+    return f;
+  }
+
+  static size_t value_len_(const Field &f) {
+    switch (f.type) {
+      case BOOL:
+        return f.v[0] ? 4 : 5;
+      case INT:
+        return int_len(f.v[0]);
+      default:
+        return 4 + int_len(f.v[0]) + int_len(f.v[1]) + int_len(f.v[2]);
+    }
+  }
+
+  static char *put_(char *p, const char *s, size_t n) {
+    memcpy(p, s, n);
+    return p + n;
+  }
+
+  static char *put_value_(char *p, const Field &f) {
+    switch (f.type) {
+      case BOOL:
+        return f.v[0] ? put_(p, "true", 4) : put_(p, "false", 5);
+      case INT:
+        return put_int(p, f.v[0]);
+      default:
+        *p++ = '[';
+        p = put_int(p, f.v[0]);
+        *p++ = ',';
+        p = put_int(p, f.v[1]);
+        *p++ = ',';
+        p = put_int(p, f.v[2]);
+        *p++ = ']';
+        return p;
+    }
+  }
+
+  Field fields_[MAX_FIELDS];
+  size_t count_{0};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
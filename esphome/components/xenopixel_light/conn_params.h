@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+
+// BLE connection parameter profiles, one per link mode.
+//
+// The connection interval bounds how often the controller can put a write on
+// the air: at most a few frames per connection event, one event per interval.
+// WLED sync wants the shortest interval the peer allows and no slave
+// latency; a lit blade driven from Home Assistant is fine at a few tens of
+// milliseconds; a dark blade that only sees keepalives can sleep between
+// longer intervals and skip events.
+//
+// Units follow esp_ble_conn_update_params_t: intervals in 1.25ms steps,
+// supervision timeout in 10ms steps, latency in connection events.
+
+namespace esphome {
+namespace xenopixel_light {
+
+// Ordered slowest to fastest
+enum class BleLinkMode : uint8_t { IDLE, ACTIVE, REALTIME };
+
+struct BleConnParams {
+  uint16_t min_int;
+  uint16_t max_int;
+  uint16_t latency;
+  uint16_t timeout;
+
+  // Core spec: timeout > (1 + latency) * max interval * 2
+  constexpr bool valid() const {
+    return min_int >= 6 && min_int <= max_int &&
+           (uint32_t)timeout * 10 * 4 > (1u + latency) * max_int * 5 * 2;
+  }
+};
+
+static constexpr BleConnParams CONN_PARAMS_REALTIME{6, 12, 0, 200};  // 7.5-15ms
+static constexpr BleConnParams CONN_PARAMS_ACTIVE{24, 40, 0, 400};   // 30-50ms
+static constexpr BleConnParams CONN_PARAMS_IDLE{80, 160, 4, 600};    // 100-200ms
+static_assert(CONN_PARAMS_REALTIME.valid(), "realtime conn params");
+static_assert(CONN_PARAMS_ACTIVE.valid(), "active conn params");
+static_assert(CONN_PARAMS_IDLE.valid(), "idle conn params");
+
+constexpr BleConnParams conn_params_for(BleLinkMode mode) {
+  return mode == BleLinkMode::REALTIME ? CONN_PARAMS_REALTIME
+         : mode == BleLinkMode::ACTIVE ? CONN_PARAMS_ACTIVE
+                                       : CONN_PARAMS_IDLE;
+}
+
+inline const char *link_mode_name(BleLinkMode mode) {
+  switch (mode) {
+    case BleLinkMode::REALTIME:
+      return "realtime";
+    case BleLinkMode::ACTIVE:
+      return "active";
+    default:
+      return "idle";
+  }
+}
+
+// ATT MTU. The BLE client runs the exchange on every connect; a write
+// without response then carries up to mtu - ATT_HEADER_BYTES, which is
+// what the command batcher packs frames against. Until the exchange
+// completes the caller decides.
+static constexpr uint16_t ATT_MTU_DEFAULT = 23;
+static constexpr uint16_t ATT_HEADER_BYTES = 3;
+
+constexpr uint16_t att_payload(uint16_t mtu) {
+  return mtu > ATT_HEADER_BYTES ? mtu - ATT_HEADER_BYTES : 0;
+}
+
+// Parameters the link is actually running with, from the last
+// ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT
+struct BleConnReport {
+  bool valid{false};
+  uint16_t interval{0};
+  uint16_t latency{0};
+  uint16_t timeout{0};
+
+  float interval_ms() const { return interval * 1.25f; }
+  // Connection events per second, the ceiling on write bursts
+  uint32_t events_per_second() const {
+    return interval == 0 ? 0 : 800u / interval;
+  }
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
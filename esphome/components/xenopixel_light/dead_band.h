@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+
+// Perceptual dead-band for brightness and color, one per command type.
+//
+// A value within the band of what the saber has (the shadow state) is not
+// worth a BLE write: rounding flips such as 127/128 from recover_rgb_(), or
+// sensor and WLED noise. Such a value is held instead and sent exactly once
+// it has not changed for SETTLE_MS, so the end of a fade still lands on its
+// final value. A value outside the band is sent at once and drops whatever
+// was held.
+//
+// The band is measured from the value last sent rather than from a fixed
+// grid. That is the hysteresis: a value that hovers around any boundary
+// stays within the band of the side it was sent on, so it never toggles.
+//
+// - LEVEL: absolute difference, brightness in percent
+// - REDMEAN_RGB: the "redmean" weighted RGB distance, a cheap delta-E
+//   approximation that weighs green most and red or blue by how red the
+//   pair is. One step on one channel is 1.4-2, one step on all three
+//   about 3.
+
+namespace esphome {
+namespace xenopixel_light {
+
+enum class DeadBandMetric : uint8_t { LEVEL, REDMEAN_RGB };
+
+class DeadBand {
+ public:
+  static constexpr uint32_t SETTLE_MS = 250;
+
+  explicit DeadBand(DeadBandMetric metric) : metric_(metric) {}
+
+  // 0 turns the band off
+  void set_threshold(uint16_t threshold) {
+    threshold_ = threshold;
+    if (threshold == 0) held_ = false;
+  }
+  uint16_t threshold() const { return threshold_; }
+
+  // v is about to be written and ref is what the saber has. True when v
+  // should go out now, false when it is held.
+  bool pass(bool ref_known, int32_t ref, int32_t v, uint32_t now) {
+    if (threshold_ == 0 || !ref_known || v == ref ||
+        distance_sq(metric_, ref, v) > (uint32_t)threshold_ * threshold_) {
+      held_ = false;
+      return true;
+    }
+    if (!held_ || v != held_value_) {
+      held_value_ = v;
+      held_since_ms_ = now;
+      held_ = true;
+    }
+    return false;
+  }
+
+  // The held value, once it has been steady for SETTLE_MS
+  bool take_settled(uint32_t now, int32_t &v) {
+    if (!held_ || now - held_since_ms_ < SETTLE_MS) return false;
+    held_ = false;
+    v = held_value_;
+    return true;
+  }
+
+  bool holding() const { return held_; }
+  void clear() { held_ = false; }
+
+  // Squared, so the hot path needs no sqrt. Colors are packed 0xRRGGBB.
+  static uint32_t distance_sq(DeadBandMetric metric, int32_t a, int32_t b) {
+    if (metric == DeadBandMetric::LEVEL) {
+      int32_t d = a - b;
+      return (uint32_t)(d * d);
+    }
+    int32_t r1 = (a >> 16) & 0xFF, g1 = (a >> 8) & 0xFF, b1 = a & 0xFF;
+    int32_t r2 = (b >> 16) & 0xFF, g2 = (b >> 8) & 0xFF, b2 = b & 0xFF;
+    int32_t rmean = (r1 + r2) / 2;
+    int32_t dr = r1 - r2, dg = g1 - g2, db = b1 - b2;
+    return (uint32_t)((((512 + rmean) * dr * dr) >> 8) + 4 * dg * dg +
+                      (((767 - rmean) * db * db) >> 8));
+  }
+
+ protected:
+  DeadBandMetric metric_;
+  uint16_t threshold_{0};
+  bool held_{false};
+  int32_t held_value_{0};
+  uint32_t held_since_ms_{0};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
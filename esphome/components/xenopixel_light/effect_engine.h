@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Color animations rendered on the proxy, one engine per saber.
+//
+// ESPHome light effects (xenopixel_effect.h) only start and stop the
+// engine; XenopixelLight samples render() from loop() once per color rate
+// limiter interval, the same cadence as the WLED smoother, so the animation
+// is sent as the keyframes the BLE link can take and no faster. The shadow
+// state drops any sample equal to what the saber already shows.
+//
+// All math is 8-bit fixed point over a quarter-wave sine table: a phase is
+// the position in the effect's period scaled to 0-255, and levels are
+// 0-255 fractions applied to the base brightness (percent, as the saber
+// takes it) and the base color that write_state() last set.
+//
+// - BREATHE: brightness dips by depth and back, a sine over period_ms
+// - RAINBOW: hue cycles once per period_ms at the base brightness
+// - FLICKER: each sample drops brightness by a random amount up to depth
+// - PULSE: holds the base until pulse() is called, then flashes toward
+//   full white and decays back over period_ms (pulse-on-clash)
+
+namespace esphome {
+namespace xenopixel_light {
+
+enum class EffectKind : uint8_t { NONE, BREATHE, RAINBOW, FLICKER, PULSE };
+
+struct EffectParams {
+  static constexpr uint32_t MIN_PERIOD_MS = 100;
+  static constexpr uint32_t MAX_PERIOD_MS = 600000;
+
+  EffectKind kind{EffectKind::NONE};
+  uint32_t period_ms{4000};
+  // BREATHE and FLICKER: how far brightness drops, 255 = to the 1% floor
+  uint8_t depth{180};
+};
+
+class EffectEngine {
+ public:
+  struct Frame {
+    uint8_t brightness{0};  // percent
+    uint8_t r{0}, g{0}, b{0};
+  };
+
+  void start(const EffectParams &params, uint32_t now) {
+    params_ = params;
+    if (params_.period_ms < EffectParams::MIN_PERIOD_MS)
+      params_.period_ms = EffectParams::MIN_PERIOD_MS;
+    if (params_.period_ms > EffectParams::MAX_PERIOD_MS)
+      params_.period_ms = EffectParams::MAX_PERIOD_MS;
+    start_ms_ = now;
+    pulsing_ = false;
+  }
+
+  void stop() {
+    params_.kind = EffectKind::NONE;
+    pulsing_ = false;
+  }
+
+  bool active() const { return params_.kind != EffectKind::NONE; }
+  EffectKind kind() const { return params_.kind; }
+
+  void set_base(uint8_t brightness, uint8_t r, uint8_t g, uint8_t b) {
+    base_.brightness = brightness > 100 ? 100 : brightness;
+    base_.r = r;
+    base_.g = g;
+    base_.b = b;
+  }
+  const Frame &base() const { return base_; }
+
+  // Restarts the flash of a running PULSE; ignored by the other effects
+  void pulse(uint32_t now) {
+    if (params_.kind != EffectKind::PULSE) return;
+    pulse_ms_ = now;
+    pulsing_ = true;
+  }
+
+  // The frame to show at now; false when no effect is running
+  bool render(uint32_t now, Frame &out) {
+    out = base_;
+    switch (params_.kind) {
+      case EffectKind::NONE:
+        return false;
+      case EffectKind::BREATHE:
+        out.brightness = dim_(base_.brightness,
+                              scale_(params_.depth, wave(phase_(now))));
+        return true;
+      case EffectKind::RAINBOW:
+        hue_to_rgb(phase_(now), out.r, out.g, out.b);
+        return true;
+      case EffectKind::FLICKER:
+        out.brightness =
+            dim_(base_.brightness, scale_(params_.depth, random8_()));
+        return true;
+      case EffectKind::PULSE:
+        render_pulse_(now, out);
+        return true;
+    }
+    return false;
+  }
+
+  // sin(pi * phase / 256): 0 at phase 0, 255 at 128, back to 0 at 256
+  static uint8_t wave(uint8_t phase) {
+    uint8_t q = phase < 128 ? phase : (uint8_t)(256 - phase);
+    uint8_t i = q >> 1;
+    if ((q & 1) == 0) return SINE_QUARTER[i];
+    return (uint8_t)((SINE_QUARTER[i] + SINE_QUARTER[i + 1] + 1) >> 1);
+  }
+
+  // Fully saturated color wheel: red at 0, green at 85, blue at 170
+  static void hue_to_rgb(uint8_t hue, uint8_t &r, uint8_t &g, uint8_t &b) {
+    uint8_t f = (uint8_t)((hue % 85) * 3);
+    switch (hue / 85) {
+      case 0:
+      case 3:  // hue 255, red again
+        r = (uint8_t)(255 - f);
+        g = f;
+        b = 0;
+        break;
+      case 1:
+        r = 0;
+        g = (uint8_t)(255 - f);
+        b = f;
+        break;
+      case 2:
+        r = f;
+        g = 0;
+        b = (uint8_t)(255 - f);
+        break;
+    }
+  }
+
+ protected:
+  // round(255 * sin(i * pi / 128)) for i = 0..64
+  static constexpr uint8_t SINE_QUARTER[65] = {
+      0,   6,   13,  19,  25,  31,  37,  44,  50,  56,  62,  68,  74,
+      80,  86,  92,  98,  103, 109, 115, 120, 126, 131, 136, 142, 147,
+      152, 157, 162, 167, 171, 176, 180, 185, 189, 193, 197, 201, 205,
+      208, 212, 215, 219, 222, 225, 228, 231, 233, 236, 238, 240, 242,
+      244, 246, 247, 249, 250, 251, 252, 253, 254, 254, 255, 255, 255,
+  };
+
+  static uint8_t scale_(uint8_t a, uint8_t b) {
+    return (uint8_t)(((uint16_t)a * b + 127) / 255);
+  }
+
+  // Lowers a percent brightness by drop/255 of itself, never below 1%
+  static uint8_t dim_(uint8_t brightness, uint8_t drop) {
+    if (brightness == 0) return 0;
+    uint8_t out = (uint8_t)(((uint16_t)brightness * (255 - drop) + 127) / 255);
+    return out > 0 ? out : 1;
+  }
+
+  static uint8_t lerp_(uint8_t from, uint8_t to, uint8_t k) {
+    int step = ((int)to - from) * k;
+    return (uint8_t)(from + (step + (step >= 0 ? 127 : -127)) / 255);
+  }
+
+  uint8_t phase_(uint32_t now) const {
+    uint32_t t = (now - start_ms_) % params_.period_ms;
+    return (uint8_t)((t * 256) / params_.period_ms);
+  }
+
+  // Quadratic decay from the flash back to the base
+  void render_pulse_(uint32_t now, Frame &out) {
+    if (!pulsing_) return;
+    uint32_t dt = now - pulse_ms_;
+    if (dt >= params_.period_ms) {
+      pulsing_ = false;
+      return;
+    }
+    uint8_t rest = (uint8_t)(255 - (dt * 255) / params_.period_ms);
+    uint8_t k = scale_(rest, rest);
+    out.brightness = lerp_(base_.brightness, 100, k);
+    out.r = lerp_(base_.r, 255, k);
+    out.g = lerp_(base_.g, 255, k);
+    out.b = lerp_(base_.b, 255, k);
+  }
+
+  // xorshift32; deterministic so a flicker can be tested
+  uint8_t random8_() {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return (uint8_t)(rng_ >> 24);
+  }
+
+  EffectParams params_;
+  Frame base_;
+  uint32_t start_ms_{0};
+  uint32_t pulse_ms_{0};
+  bool pulsing_{false};
+  uint32_t rng_{0x2545F491};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
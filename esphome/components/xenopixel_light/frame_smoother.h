@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Playout buffer for WLED frames, one per saber.
+//
+// Frames are stored with their arrival time. The output is rendered
+// delay_ms behind the newest arrival by interpolating linearly between the
+// two frames around that render time, so arrival jitter and single dropped
+// packets turn into a smooth fade instead of a step or a freeze. Once the
+// render time passes the newest frame the output holds it (settled()).
+//
+// The caller decides how often to sample; XenopixelLight samples at the
+// color rate limiter's interval, i.e. as fast as the BLE link drains.
+
+namespace esphome {
+namespace xenopixel_light {
+
+class FrameSmoother {
+ public:
+  // The longest delay the history covers at WLED's default 42 fps: a frame
+  // older than the render time plus every frame since. Faster streams
+  // render from the oldest frame kept until the delay is shortened.
+  static constexpr uint32_t MAX_DELAY_MS = 200;
+  static constexpr uint32_t FRAME_INTERVAL_MS = 24;
+  static constexpr size_t HISTORY =
+      (MAX_DELAY_MS + FRAME_INTERVAL_MS - 1) / FRAME_INTERVAL_MS + 2;
+
+  struct Frame {
+    uint32_t t{0};
+    uint8_t bri{0};
+    uint8_t r{0}, g{0}, b{0};
+  };
+
+  void set_delay_ms(uint32_t delay_ms) {
+    delay_ms_ = delay_ms < MAX_DELAY_MS ? delay_ms : MAX_DELAY_MS;
+  }
+  uint32_t delay_ms() const { return delay_ms_; }
+  bool enabled() const { return delay_ms_ > 0; }
+
+  void push(uint32_t now, uint8_t bri, uint8_t r, uint8_t g, uint8_t b) {
+    Frame f;
+    f.t = now;
+    f.bri = bri;
+    if (bri == 0 && count_ > 0) {
+      // A black frame has no hue; fade brightness only
+      const Frame &last = at_(count_ - 1);
+      f.r = last.r;
+      f.g = last.g;
+      f.b = last.b;
+    } else {
+      f.r = r;
+      f.g = g;
+      f.b = b;
+    }
+    frames_[(first_ + count_) % HISTORY] = f;
+    if (count_ < HISTORY)
+      count_++;
+    else
+      first_ = (first_ + 1) % HISTORY;
+  }
+
+  void reset() {
+    first_ = 0;
+    count_ = 0;
+  }
+
+  bool empty() const { return count_ == 0; }
+
+  // Interpolated frame at now - delay_ms. False when nothing was pushed.
+  bool sample(uint32_t now, Frame &out) const {
+    if (count_ == 0) return false;
+    uint32_t render = now - delay_ms_;
+    if (count_ == 1 || before_(render, at_(0).t)) {
+      out = at_(0);
+      return true;
+    }
+    for (size_t i = 1; i < count_; i++) {
+      const Frame &b = at_(i);
+      if (!before_(render, b.t)) continue;
+      const Frame &a = at_(i - 1);
+      uint32_t span = b.t - a.t;
+      uint32_t pos = render - a.t;
+      out.t = render;
+      out.bri = lerp_(a.bri, b.bri, pos, span);
+      out.r = lerp_(a.r, b.r, pos, span);
+      out.g = lerp_(a.g, b.g, pos, span);
+      out.b = lerp_(a.b, b.b, pos, span);
+      return true;
+    }
+    out = at_(count_ - 1);
+    return true;
+  }
+
+  // The render time has reached the newest frame, so sampling again returns
+  // the same value until the next push()
+  bool settled(uint32_t now) const {
+    return count_ == 0 || !before_(now - delay_ms_, at_(count_ - 1).t);
+  }
+
+ protected:
+  const Frame &at_(size_t i) const { return frames_[(first_ + i) % HISTORY]; }
+
+  // Wrap-safe a < b for millis() timestamps
+  static bool before_(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+  static uint8_t lerp_(uint8_t a, uint8_t b, uint32_t pos, uint32_t span) {
+    if (span == 0) return b;
+    return (uint8_t)(a + ((int32_t)b - a) * (int32_t)pos / (int32_t)span);
+  }
+
+  uint32_t delay_ms_{0};
+  Frame frames_[HISTORY];
+  size_t first_{0};
+  size_t count_{0};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
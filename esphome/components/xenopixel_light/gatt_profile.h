@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef UNIT_TEST
+#include <esp_gattc_api.h>  // cppcheck-suppress missingInclude
+#endif
+
+// GATT handles of each saber, resolved once and kept across reconnects.
+//
+// The Xenopixel GATT table is fixed (PROTOCOL.md: 0x2A05 at 8 with its CCCD
+// at 9, DAE1 at 12/13, 3AB1 at 16/17), so after the first discovery a
+// reconnect only needs one get_db() lookup confirming that the cached
+// 0x2A05 handle still holds that characteristic. Entries are keyed by MAC
+// and dropped on a Service Changed event, when verification fails, or when
+// the saber rejects a write with ESP_GATT_INVALID_HANDLE; the next
+// connection then discovers again.
+//
+// All lookups read the ESP-IDF GATTC cache of the current connection; none
+// of them go over the air.
+
+namespace esphome {
+namespace xenopixel_light {
+
+static constexpr uint16_t GATT_UUID_GENERIC_ATTRIBUTE = 0x1801;
+static constexpr uint16_t GATT_UUID_SERVICE_CHANGED = 0x2A05;
+static constexpr uint16_t GATT_UUID_DAE0 = 0xDAE0;
+static constexpr uint16_t GATT_UUID_DAE1 = 0xDAE1;
+static constexpr uint16_t GATT_UUID_3AB0 = 0x3AB0;
+static constexpr uint16_t GATT_UUID_3AB1 = 0x3AB1;
+
+struct SaberGattHandles {
+  uint16_t service_changed{0};
+  uint16_t service_changed_cccd{0};
+  uint16_t dae1{0};
+  uint16_t dae1_cccd{0};
+  uint16_t ab1{0};
+  uint16_t ab1_cccd{0};
+
+  // Enough to run the handshake; DAE1/3AB1 also resolve through ESPHome
+  bool usable() const {
+    return service_changed != 0 && service_changed_cccd != 0;
+  }
+};
+
+class SaberGattProfile {
+ public:
+  static constexpr size_t MAX_SABERS = 8;
+
+  static SaberGattProfile &instance() {
+    static SaberGattProfile profile;
+    return profile;
+  }
+
+  static uint64_t mac_key(const uint8_t *bda) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < 6; i++) key = (key << 8) | bda[i];
+    return key;
+  }
+
+  const SaberGattHandles *find(uint64_t mac) const {
+    for (size_t i = 0; i < count_; i++)
+      if (entries_[i].mac == mac) return &entries_[i].handles;
+    return nullptr;
+  }
+
+  // Replaces an existing entry; when full, entries are reused in turn
+  void store(uint64_t mac, const SaberGattHandles &handles) {
+    Entry *e = find_(mac);
+    if (e == nullptr) {
+      if (count_ < MAX_SABERS) {
+        e = &entries_[count_++];
+      } else {
+        e = &entries_[next_evict_];
+        next_evict_ = (next_evict_ + 1) % MAX_SABERS;
+      }
+      e->mac = mac;
+    }
+    e->handles = handles;
+  }
+
+  void invalidate(uint64_t mac) {
+    Entry *e = find_(mac);
+    if (e == nullptr) return;
+    *e = entries_[--count_];
+    if (next_evict_ >= count_) next_evict_ = 0;
+  }
+
+  size_t size() const { return count_; }
+  uint32_t discoveries() const { return discoveries_; }
+
+  void clear() {
+    count_ = 0;
+    next_evict_ = 0;
+    discoveries_ = 0;
+  }
+
+  // Cached handles for this connection. A cached entry is verified when
+  // `verify` is set and rediscovered if that fails. nullptr when the GATTC
+  // cache does not hold the Service Changed characteristic at all.
+  const SaberGattHandles *acquire(esp_gatt_if_t gattc_if, uint16_t conn_id,
+                                  const uint8_t *bda, bool verify) {
+    uint64_t mac = mac_key(bda);
+    const SaberGattHandles *cached = find(mac);
+    if (cached != nullptr && (!verify || verify_(gattc_if, conn_id, *cached)))
+      return cached;
+    if (cached != nullptr) invalidate(mac);
+
+    SaberGattHandles handles;
+    discoveries_++;
+    if (!discover(gattc_if, conn_id, handles)) return nullptr;
+    store(mac, handles);
+    return find(mac);
+  }
+
+  // Full lookup in the GATTC cache. DAE1/3AB1 are filled in when found but
+  // only the Service Changed pair is required.
+  static bool discover(esp_gatt_if_t gattc_if, uint16_t conn_id,
+                       SaberGattHandles &out) {
+    find_char_(gattc_if, conn_id, GATT_UUID_GENERIC_ATTRIBUTE,
+               GATT_UUID_SERVICE_CHANGED, out.service_changed,
+               out.service_changed_cccd);
+    find_char_(gattc_if, conn_id, GATT_UUID_DAE0, GATT_UUID_DAE1, out.dae1,
+               out.dae1_cccd);
+    find_char_(gattc_if, conn_id, GATT_UUID_3AB0, GATT_UUID_3AB1, out.ab1,
+               out.ab1_cccd);
+    return out.usable();
+  }
+
+ protected:
+  struct Entry {
+    uint64_t mac{0};
+    SaberGattHandles handles;
+  };
+
+  Entry *find_(uint64_t mac) {
+    for (size_t i = 0; i < count_; i++)
+      if (entries_[i].mac == mac) return &entries_[i];
+    return nullptr;
+  }
+
+  static esp_bt_uuid_t uuid16_(uint16_t uuid) {
+    esp_bt_uuid_t u;
+    u.len = ESP_UUID_LEN_16;
+    u.uuid.uuid16 = uuid;
+    return u;
+  }
+
+  // One attribute read: is there still a 0x2A05 characteristic at the
+  // cached handle?
+  static bool verify_(esp_gatt_if_t gattc_if, uint16_t conn_id,
+                      const SaberGattHandles &h) {
+    esp_gattc_db_elem_t elem;
+    uint16_t count = 1;
+    auto status = esp_ble_gattc_get_db(gattc_if, conn_id, h.service_changed,
+                                       h.service_changed, &elem, &count);
+    return status == ESP_GATT_OK && count == 1 &&
+           elem.type == ESP_GATT_DB_CHARACTERISTIC &&
+           elem.uuid.len == ESP_UUID_LEN_16 &&
+           elem.uuid.uuid.uuid16 == GATT_UUID_SERVICE_CHANGED;
+  }
+
+  static void find_char_(esp_gatt_if_t gattc_if, uint16_t conn_id,
+                         uint16_t service, uint16_t characteristic,
+                         uint16_t &value_handle, uint16_t &cccd_handle) {
+    esp_bt_uuid_t svc_uuid = uuid16_(service);
+    esp_gattc_service_elem_t svc;
+    uint16_t count = 1;
+    auto status = esp_ble_gattc_get_service(gattc_if, conn_id, &svc_uuid, &svc,
+                                            &count, 0);
+    if (status != ESP_GATT_OK || count == 0) return;
+
+    esp_gattc_char_elem_t chr;
+    count = 1;
+    status = esp_ble_gattc_get_char_by_uuid(gattc_if, conn_id, svc.start_handle,
+                                            svc.end_handle,
+                                            uuid16_(characteristic), &chr,
+                                            &count);
+    if (status != ESP_GATT_OK || count == 0) return;
+    value_handle = chr.char_handle;
+
+    esp_gattc_descr_elem_t descr;
+    count = 1;
+    status = esp_ble_gattc_get_descr_by_char_handle(
+        gattc_if, conn_id, chr.char_handle,
+        uuid16_(ESP_GATT_UUID_CHAR_CLIENT_CONFIG), &descr, &count);
+    if (status == ESP_GATT_OK && count > 0) cccd_handle = descr.handle;
+  }
+
+  Entry entries_[MAX_SABERS];
+  size_t count_{0};
+  size_t next_evict_{0};
+  uint32_t discoveries_{0};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
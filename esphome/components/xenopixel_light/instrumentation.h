@@ -0,0 +1,258 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+#ifndef UNIT_TEST
+#include "esphome/core/defines.h"  // cppcheck-suppress missingInclude
+#endif
+
+// Hot-path latency instrumentation for the WLED-to-BLE path, shared by all
+// sabers.
+//
+// A packet is stamped when the receiver publishes it, when the hub decodes
+// it, when a frame built from it enters a saber's TX queue and when that
+// frame is handed to the BLE stack. The gaps land in fixed log2 histograms
+// (bucket i counts latencies below 2^(i+1) µs), next to counters for
+// packets received, superseded within one socket drain, colors debounced by
+// the rate limiter, frames coalesced in the TX queue and failed writes.
+//
+// Timestamps come from micros() (esp_timer), not the CPU cycle counter: the
+// receive task runs on the other core, and each core has its own CCOUNT.
+//
+// Only built with USE_XENOPIXEL_INSTRUMENTATION (`instrumentation: true` on
+// any light). Otherwise every call is an empty inline function, LatencyTrace
+// is empty and the accessors report nothing.
+
+namespace esphome {
+namespace xenopixel_light {
+
+enum class LatencyStage : uint8_t {
+  RX_TO_DECODE,
+  DECODE_TO_ENQUEUE,
+  ENQUEUE_TO_TX,
+  RX_TO_TX,
+};
+
+static constexpr size_t LATENCY_STAGE_COUNT = 4;
+
+inline const char *latency_stage_name(LatencyStage stage) {
+  switch (stage) {
+    case LatencyStage::RX_TO_DECODE:
+      return "rx-decode";
+    case LatencyStage::DECODE_TO_ENQUEUE:
+      return "decode-enqueue";
+    case LatencyStage::ENQUEUE_TO_TX:
+      return "enqueue-tx";
+    default:
+      return "rx-tx";
+  }
+}
+
+class LatencyHistogram {
+ public:
+  // The last bucket also holds everything from 2^19 µs (~0.5s) up
+  static constexpr size_t BUCKETS = 20;
+
+  static size_t bucket_for(uint32_t us) {
+    size_t i = 0;
+    while (us > 1 && i + 1 < BUCKETS) {
+      us >>= 1;
+      i++;
+    }
+    return i;
+  }
+  static uint32_t bucket_upper_us(size_t i) { return 2u << i; }
+
+  void record(uint32_t us) {
+    buckets_[bucket_for(us)]++;
+    count_++;
+    if (us > max_us_) max_us_ = us;
+  }
+
+  uint32_t count() const { return count_; }
+  uint32_t bucket(size_t i) const { return i < BUCKETS ? buckets_[i] : 0; }
+  uint32_t max_us() const { return max_us_; }
+
+  // Upper edge of the bucket holding the p-th fraction of samples, capped at
+  // the largest sample (the overflow bucket has no edge); 0 when empty
+  uint32_t percentile_us(float p) const {
+    if (count_ == 0) return 0;
+    uint32_t rank = (uint32_t)ceilf(p * (float)count_);
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      seen += buckets_[i];
+      if (seen < rank) continue;
+      if (i + 1 == BUCKETS) break;
+      uint32_t upper = bucket_upper_us(i);
+      return upper < max_us_ ? upper : max_us_;
+    }
+    return max_us_;
+  }
+
+  void clear() {
+    for (auto &b : buckets_) b = 0;
+    count_ = 0;
+    max_us_ = 0;
+  }
+
+ protected:
+  uint32_t buckets_[BUCKETS]{};
+  uint32_t count_{0};
+  uint32_t max_us_{0};
+};
+
+#ifdef USE_XENOPIXEL_INSTRUMENTATION
+
+// Timestamps carried with a packet's target and the frames built from it
+struct LatencyTrace {
+  uint32_t rx_us{0};
+  uint32_t decode_us{0};
+  uint32_t enqueue_us{0};
+  bool valid{false};
+};
+
+class Instrumentation {
+ public:
+  static constexpr bool ENABLED = true;
+
+  static Instrumentation &instance() {
+    static Instrumentation instr;
+    return instr;
+  }
+
+  static uint32_t now_us() { return micros(); }
+
+  // Receiver side, possibly on the receive task: one socket drain read n
+  // valid datagrams, of which only the last is published
+  void count_drain(uint32_t n) {
+    if (n == 0) return;
+    received_.fetch_add(n, std::memory_order_relaxed);
+    superseded_.fetch_add(n - 1, std::memory_order_relaxed);
+  }
+
+  // Everything below runs in loop()
+  LatencyTrace decoded(uint32_t rx_us) {
+    LatencyTrace t;
+    t.rx_us = rx_us;
+    t.decode_us = now_us();
+    t.valid = true;
+    record_(LatencyStage::RX_TO_DECODE, t.decode_us - t.rx_us);
+    return t;
+  }
+
+  void enqueued(LatencyTrace &t) {
+    if (!t.valid) return;
+    t.enqueue_us = now_us();
+    record_(LatencyStage::DECODE_TO_ENQUEUE, t.enqueue_us - t.decode_us);
+  }
+
+  void transmitted(const LatencyTrace &t) {
+    if (!t.valid) return;
+    uint32_t now = now_us();
+    record_(LatencyStage::ENQUEUE_TO_TX, now - t.enqueue_us);
+    record_(LatencyStage::RX_TO_TX, now - t.rx_us);
+  }
+
+  void count_debounced() { debounced_++; }
+  void count_coalesced() { coalesced_++; }
+  void count_failed() { failed_++; }
+
+  const LatencyHistogram &histogram(LatencyStage stage) const {
+    return histograms_[(size_t)stage];
+  }
+  // NAN until the stage has a sample, for a template sensor
+  float percentile_ms(LatencyStage stage, float p) const {
+    const LatencyHistogram &h = histogram(stage);
+    return h.count() == 0 ? NAN : h.percentile_us(p) / 1000.0f;
+  }
+
+  uint32_t received() const {
+    return received_.load(std::memory_order_relaxed);
+  }
+  uint32_t superseded() const {
+    return superseded_.load(std::memory_order_relaxed);
+  }
+  uint32_t debounced() const { return debounced_; }
+  uint32_t coalesced() const { return coalesced_; }
+  uint32_t failed() const { return failed_; }
+
+  // One line per stage and one for the counters
+  void dump() const {
+    for (size_t i = 0; i < LATENCY_STAGE_COUNT; i++) {
+      [[maybe_unused]] const LatencyHistogram &h = histograms_[i];
+      ESP_LOGI("xenopixel",
+               "latency %-14s n=%u p50=%uus p90=%uus p99=%uus max=%uus",
+               latency_stage_name((LatencyStage)i), (unsigned)h.count(),
+               (unsigned)h.percentile_us(0.5f), (unsigned)h.percentile_us(0.9f),
+               (unsigned)h.percentile_us(0.99f), (unsigned)h.max_us());
+    }
+    ESP_LOGI("xenopixel",
+             "packets rx=%u superseded=%u debounced=%u coalesced=%u failed=%u",
+             (unsigned)received(), (unsigned)superseded(),
+             (unsigned)debounced_, (unsigned)coalesced_, (unsigned)failed_);
+  }
+
+  void reset() {
+    for (auto &h : histograms_) h.clear();
+    received_.store(0, std::memory_order_relaxed);
+    superseded_.store(0, std::memory_order_relaxed);
+    debounced_ = 0;
+    coalesced_ = 0;
+    failed_ = 0;
+  }
+
+ protected:
+  void record_(LatencyStage stage, uint32_t us) {
+    histograms_[(size_t)stage].record(us);
+  }
+
+  LatencyHistogram histograms_[LATENCY_STAGE_COUNT];
+  std::atomic<uint32_t> received_{0};
+  std::atomic<uint32_t> superseded_{0};
+  uint32_t debounced_{0};
+  uint32_t coalesced_{0};
+  uint32_t failed_{0};
+};
+
+#else
+
+struct LatencyTrace {};
+
+class Instrumentation {
+ public:
+  static constexpr bool ENABLED = false;
+
+  static Instrumentation &instance() {
+    static Instrumentation instr;
+    return instr;
+  }
+
+  static uint32_t now_us() { return 0; }
+  void count_drain(uint32_t) {}
+  LatencyTrace decoded(uint32_t) { return {}; }
+  void enqueued(LatencyTrace &) {}
+  void transmitted(const LatencyTrace &) {}
+  void count_debounced() {}
+  void count_coalesced() {}
+  void count_failed() {}
+  float percentile_ms(LatencyStage, float) const { return NAN; }
+  uint32_t received() const { return 0; }
+  uint32_t superseded() const { return 0; }
+  uint32_t debounced() const { return 0; }
+  uint32_t coalesced() const { return 0; }
+  uint32_t failed() const { return 0; }
+  void dump() const {}
+  void reset() {}
+};
+
+#endif
+
+}  // namespace xenopixel_light
+}  // namespace esphome
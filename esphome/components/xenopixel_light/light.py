@@ -1,9 +1,11 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components.globals import GlobalsComponent
-from esphome.const import CONF_OUTPUT_ID
+from esphome.const import CONF_NAME, CONF_OUTPUT_ID
 
 from esphome.components import ble_client, light
+from esphome.components.light.effects import register_rgb_effect
+from esphome.components.light.types import LightEffect
 
 DEPENDENCIES = ["ble_client", "wifi"]
 
@@ -11,19 +13,179 @@ xenopixel_light_ns = cg.esphome_ns.namespace("xenopixel_light")
 XenopixelLightOutput = xenopixel_light_ns.class_(
     "XenopixelLight", light.LightOutput, cg.Component
 )
+XenopixelEffect = xenopixel_light_ns.class_("XenopixelEffect", LightEffect)
+EffectKind = xenopixel_light_ns.enum("EffectKind", is_class=True)
+TransitionMode = xenopixel_light_ns.enum("TransitionMode", is_class=True)
 
 CONF_BLE_CLIENT_ID = "ble_client_id"
 CONF_AUTHORIZED_ID = "authorized_id"
 CONF_SYNCING_ID = "syncing_id"
+CONF_COMBINE_COMMANDS = "combine_commands"
+CONF_MIN_COLOR_INTERVAL = "min_color_interval"
+CONF_MAX_COLOR_INTERVAL = "max_color_interval"
+CONF_BRIGHTNESS_TRANSITION = "brightness_transition"
+CONF_COLOR_TRANSITION = "color_transition"
+CONF_TRANSITION_KEYFRAMES = "transition_keyframes"
+CONF_BRIGHTNESS_DEAD_BAND = "brightness_dead_band"
+CONF_COLOR_DEAD_BAND = "color_dead_band"
+CONF_WLED_RECEIVE_TASK = "wled_receive_task"
+CONF_WLED_PIXEL = "wled_pixel"
+CONF_WLED_PIXEL_COUNT = "wled_pixel_count"
+CONF_WLED_SMOOTHING = "wled_smoothing"
+CONF_WLED_PORT = "wled_port"
+CONF_WLED_MULTICAST_GROUP = "wled_multicast_group"
+CONF_WLED_ALLOWED_SOURCES = "wled_allowed_sources"
+CONF_INSTRUMENTATION = "instrumentation"
+CONF_PERIOD = "period"
+CONF_DEPTH = "depth"
 
-CONFIG_SCHEMA = light.RGB_LIGHT_SCHEMA.extend(
+# Must match WLED_MAX_SOURCES in wled_receiver.h
+MAX_WLED_SOURCES = 4
+# Must match FrameSmoother::MAX_DELAY_MS in frame_smoother.h
+MAX_WLED_SMOOTHING_MS = 200
+
+# What write_state() sends during an ESPHome transition, see
+# transition_planner.h
+TRANSITION_MODES = {
+    "all": TransitionMode.ALL,
+    "target": TransitionMode.TARGET,
+    "keyframes": TransitionMode.KEYFRAMES,
+}
+
+
+def validate_color_interval(config):
+    min_ms = config[CONF_MIN_COLOR_INTERVAL].total_milliseconds
+    if min_ms > config[CONF_MAX_COLOR_INTERVAL].total_milliseconds:
+        raise cv.Invalid(
+            f"{CONF_MIN_COLOR_INTERVAL} must not exceed {CONF_MAX_COLOR_INTERVAL}"
+        )
+    return config
+
+
+def ipv4_multicast(value):
+    value = cv.ipv4address(value)
+    first = int(str(value).split(".")[0])
+    if not 224 <= first <= 239:
+        raise cv.Invalid(f"{value} is not a multicast address (224.0.0.0/4)")
+    return value
+
+
+def ipv4_octets(value):
+    return [int(octet) for octet in str(value).split(".")]
+
+
+# Must match EffectParams::MIN_PERIOD_MS/MAX_PERIOD_MS in effect_engine.h
+EFFECT_PERIOD = cv.All(
+    cv.positive_time_period_milliseconds,
+    cv.Range(min=cv.TimePeriod(milliseconds=100), max=cv.TimePeriod(seconds=600)),
+)
+
+
+# Rendered by the light itself (effect_engine.h), so these only work on
+# xenopixel_light; elsewhere they log a warning and do nothing
+async def xenopixel_effect_to_code(config, effect_id, kind):
+    effect = cg.new_Pvariable(effect_id, config[CONF_NAME], kind)
+    if CONF_PERIOD in config:
+        cg.add(effect.set_period(config[CONF_PERIOD].total_milliseconds))
+    if CONF_DEPTH in config:
+        cg.add(effect.set_depth(config[CONF_DEPTH]))
+    return effect
+
+
+@register_rgb_effect(
+    "xenopixel_breathe",
+    XenopixelEffect,
+    "Breathe",
     {
-        cv.GenerateID(CONF_OUTPUT_ID): cv.declare_id(XenopixelLightOutput),
-        cv.Required(CONF_BLE_CLIENT_ID): cv.use_id(ble_client.BLEClient),
-        cv.Required(CONF_AUTHORIZED_ID): cv.use_id(GlobalsComponent),
-        cv.Required(CONF_SYNCING_ID): cv.use_id(GlobalsComponent),
-    }
-).extend(cv.COMPONENT_SCHEMA)
+        cv.Optional(CONF_PERIOD, default="4s"): EFFECT_PERIOD,
+        cv.Optional(CONF_DEPTH, default="70%"): cv.percentage,
+    },
+)
+async def xenopixel_breathe_effect_to_code(config, effect_id):
+    return await xenopixel_effect_to_code(config, effect_id, EffectKind.BREATHE)
+
+
+@register_rgb_effect(
+    "xenopixel_rainbow",
+    XenopixelEffect,
+    "Rainbow",
+    {cv.Optional(CONF_PERIOD, default="10s"): EFFECT_PERIOD},
+)
+async def xenopixel_rainbow_effect_to_code(config, effect_id):
+    return await xenopixel_effect_to_code(config, effect_id, EffectKind.RAINBOW)
+
+
+@register_rgb_effect(
+    "xenopixel_flicker",
+    XenopixelEffect,
+    "Flicker",
+    {cv.Optional(CONF_DEPTH, default="30%"): cv.percentage},
+)
+async def xenopixel_flicker_effect_to_code(config, effect_id):
+    return await xenopixel_effect_to_code(config, effect_id, EffectKind.FLICKER)
+
+
+@register_rgb_effect(
+    "xenopixel_pulse",
+    XenopixelEffect,
+    "Pulse on Clash",
+    {cv.Optional(CONF_PERIOD, default="600ms"): EFFECT_PERIOD},
+)
+async def xenopixel_pulse_effect_to_code(config, effect_id):
+    return await xenopixel_effect_to_code(config, effect_id, EffectKind.PULSE)
+
+
+CONFIG_SCHEMA = cv.All(
+    light.RGB_LIGHT_SCHEMA.extend(
+        {
+            cv.GenerateID(CONF_OUTPUT_ID): cv.declare_id(XenopixelLightOutput),
+            cv.Required(CONF_BLE_CLIENT_ID): cv.use_id(ble_client.BLEClient),
+            cv.Required(CONF_AUTHORIZED_ID): cv.use_id(GlobalsComponent),
+            cv.Required(CONF_SYNCING_ID): cv.use_id(GlobalsComponent),
+            cv.Optional(CONF_COMBINE_COMMANDS, default=True): cv.boolean,
+            cv.Optional(
+                CONF_MIN_COLOR_INTERVAL, default="25ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(
+                CONF_MAX_COLOR_INTERVAL, default="500ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_BRIGHTNESS_TRANSITION, default="keyframes"): cv.enum(
+                TRANSITION_MODES, lower=True
+            ),
+            cv.Optional(CONF_COLOR_TRANSITION, default="keyframes"): cv.enum(
+                TRANSITION_MODES, lower=True
+            ),
+            # Must match TransitionPlanner::MAX_KEYFRAMES
+            cv.Optional(CONF_TRANSITION_KEYFRAMES, default=4): cv.int_range(
+                min=1, max=20
+            ),
+            # Percent and redmean RGB distance, 0 = off (dead_band.h)
+            cv.Optional(CONF_BRIGHTNESS_DEAD_BAND, default=1): cv.int_range(
+                min=0, max=20
+            ),
+            cv.Optional(CONF_COLOR_DEAD_BAND, default=3): cv.int_range(
+                min=0, max=100
+            ),
+            cv.Optional(CONF_WLED_RECEIVE_TASK, default=False): cv.boolean,
+            cv.Optional(CONF_WLED_PIXEL, default=0): cv.int_range(min=0, max=65535),
+            cv.Optional(CONF_WLED_PIXEL_COUNT, default=1): cv.int_range(
+                min=1, max=490
+            ),
+            cv.Optional(CONF_WLED_SMOOTHING, default="0ms"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(max=cv.TimePeriod(milliseconds=MAX_WLED_SMOOTHING_MS)),
+            ),
+            cv.Optional(CONF_WLED_PORT): cv.port,
+            cv.Optional(CONF_WLED_MULTICAST_GROUP): ipv4_multicast,
+            cv.Optional(CONF_WLED_ALLOWED_SOURCES): cv.All(
+                cv.ensure_list(cv.ipv4address),
+                cv.Length(max=MAX_WLED_SOURCES),
+            ),
+            cv.Optional(CONF_INSTRUMENTATION, default=False): cv.boolean,
+        }
+    ).extend(cv.COMPONENT_SCHEMA),
+    validate_color_interval,
+)
 
 
 async def to_code(config):
@@ -39,3 +201,38 @@ async def to_code(config):
 
     sync = await cg.get_variable(config[CONF_SYNCING_ID])
     cg.add(var.set_syncing_global(sync))
+
+    cg.add(var.set_combine_commands(config[CONF_COMBINE_COMMANDS]))
+    cg.add(
+        var.set_color_interval_bounds(
+            config[CONF_MIN_COLOR_INTERVAL].total_milliseconds,
+            config[CONF_MAX_COLOR_INTERVAL].total_milliseconds,
+        )
+    )
+    cg.add(var.set_brightness_transition(config[CONF_BRIGHTNESS_TRANSITION]))
+    cg.add(var.set_color_transition(config[CONF_COLOR_TRANSITION]))
+    cg.add(var.set_transition_keyframes(config[CONF_TRANSITION_KEYFRAMES]))
+    cg.add(var.set_brightness_dead_band(config[CONF_BRIGHTNESS_DEAD_BAND]))
+    cg.add(var.set_color_dead_band(config[CONF_COLOR_DEAD_BAND]))
+    cg.add(var.set_wled_receive_task(config[CONF_WLED_RECEIVE_TASK]))
+    cg.add(
+        var.set_wled_pixel_window(
+            config[CONF_WLED_PIXEL], config[CONF_WLED_PIXEL_COUNT]
+        )
+    )
+    cg.add(
+        var.set_wled_smoothing(config[CONF_WLED_SMOOTHING].total_milliseconds)
+    )
+    if CONF_WLED_PORT in config:
+        cg.add(var.set_wled_port(config[CONF_WLED_PORT]))
+    if CONF_WLED_MULTICAST_GROUP in config:
+        cg.add(
+            var.set_wled_multicast_group(
+                *ipv4_octets(config[CONF_WLED_MULTICAST_GROUP])
+            )
+        )
+    for source in config.get(CONF_WLED_ALLOWED_SOURCES, []):
+        cg.add(var.add_wled_allowed_source(*ipv4_octets(source)))
+    # Shared by all lights, see instrumentation.h; compiled out otherwise
+    if config[CONF_INSTRUMENTATION]:
+        cg.add_define("USE_XENOPIXEL_INSTRUMENTATION")
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Outcome bookkeeping for one saber's BLE writes.
+//
+// The last WINDOW write attempts are kept as a bitmask, so the success ratio
+// over that sliding window costs one popcount. Failures are also counted
+// per error code (the esp_err_t returned by esp_ble_gattc_write_char) in a
+// small fixed table; codes beyond MAX_ERROR_CODES share one overflow count.
+//
+// retry_backoff_ms() is the delay before the next attempt after a run of
+// consecutive failures: doubling from TX_RETRY_BASE_MS, capped at
+// TX_RETRY_MAX_MS so a saber that recovers is picked up again quickly.
+
+namespace esphome {
+namespace xenopixel_light {
+
+static constexpr uint32_t TX_RETRY_BASE_MS = 20;
+static constexpr uint32_t TX_RETRY_MAX_MS = 1000;
+
+// 0 before any failure
+constexpr uint32_t retry_backoff_ms(uint32_t failures) {
+  if (failures == 0) return 0;
+  uint32_t ms = TX_RETRY_BASE_MS;
+  for (uint32_t i = 1; i < failures && ms < TX_RETRY_MAX_MS; i++) ms <<= 1;
+  return ms < TX_RETRY_MAX_MS ? ms : TX_RETRY_MAX_MS;
+}
+
+class BleLinkHealth {
+ public:
+  static constexpr size_t WINDOW = 64;
+  static constexpr size_t MAX_ERROR_CODES = 6;
+
+  struct ErrorCount {
+    int code{0};
+    uint32_t count{0};
+  };
+
+  void record_success() {
+    push_(true);
+    successes_++;
+    streak_ = 0;
+  }
+
+  void record_failure(int code) {
+    push_(false);
+    failures_++;
+    streak_++;
+    for (size_t i = 0; i < num_codes_; i++) {
+      if (codes_[i].code != code) continue;
+      codes_[i].count++;
+      return;
+    }
+    if (num_codes_ < MAX_ERROR_CODES) {
+      codes_[num_codes_].code = code;
+      codes_[num_codes_].count = 1;
+      num_codes_++;
+      return;
+    }
+    other_errors_++;
+  }
+
+  // Share of successful writes among the last WINDOW attempts; NAN before
+  // the first attempt
+  float success_ratio() const {
+    if (filled_ == 0) return NAN;
+    return (float)__builtin_popcountll(window_) / (float)filled_;
+  }
+  size_t window_size() const { return filled_; }
+
+  // Consecutive failures since the last success
+  uint32_t failure_streak() const { return streak_; }
+  uint32_t successes() const { return successes_; }
+  uint32_t failures() const { return failures_; }
+
+  size_t error_code_count() const { return num_codes_; }
+  const ErrorCount &error(size_t i) const { return codes_[i]; }
+  uint32_t error_count(int code) const {
+    for (size_t i = 0; i < num_codes_; i++)
+      if (codes_[i].code == code) return codes_[i].count;
+    return 0;
+  }
+  uint32_t other_errors() const { return other_errors_; }
+
+  // "code:count" pairs, e.g. "-1:3 259:1", or "none"; truncated to cap
+  size_t format_errors(char *buf, size_t cap) const {
+    if (cap == 0) return 0;
+    size_t n = 0;
+    buf[0] = '\0';
+    for (size_t i = 0; i < num_codes_; i++)
+      n = append_(buf, cap, n, "%s%d:%u", n == 0 ? "" : " ", codes_[i].code,
+                  (unsigned)codes_[i].count);
+    if (other_errors_ > 0)
+      n = append_(buf, cap, n, "%sother:%u", n == 0 ? "" : " ",
+                  (unsigned)other_errors_);
+    if (n == 0) n = append_(buf, cap, n, "%s", "none");
+    return n;
+  }
+
+  // The window and streak describe the current link; counters are kept
+  void reset_window() {
+    window_ = 0;
+    filled_ = 0;
+    streak_ = 0;
+  }
+
+ protected:
+  // Newest attempt in bit 0
+  void push_(bool ok) {
+    window_ = (window_ << 1) | (ok ? 1u : 0u);
+    if (filled_ < WINDOW) filled_++;
+  }
+
+  template<typename... Args>
+  static size_t append_(char *buf, size_t cap, size_t n, const char *fmt,
+                        Args... args) {
+    if (n >= cap - 1) return n;
+    int w = snprintf(buf + n, cap - n, fmt, args...);
+    if (w < 0) return n;
+    n += (size_t)w;
+    return n < cap ? n : cap - 1;
+  }
+
+  uint64_t window_{0};
+  size_t filled_{0};
+  uint32_t streak_{0};
+  uint32_t successes_{0};
+  uint32_t failures_{0};
+  ErrorCount codes_[MAX_ERROR_CODES];
+  size_t num_codes_{0};
+  uint32_t other_errors_{0};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
@@ -0,0 +1,422 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Single-pass parser for Xenopixel notifications ([3,{...}] on DAE1/3AB1).
+//
+// The buffer is scanned once, left to right. Every quoted string followed by
+// ':' is a key; known keys have their value decoded in place and passed to a
+// typed handler callback, everything else is skipped. String values are
+// consumed as whole tokens, so their contents are never mistaken for keys.
+// Nothing is copied or allocated — string callbacks get a pointer into the
+// notification buffer and its length.
+//
+// The handler is a template parameter, so dispatch is static. Derive from
+// XenopixelNotificationHandler and override only the callbacks you need:
+//
+//   struct Handler : xenopixel_light::XenopixelNotificationHandler {
+//     void on_volume(int v) { ... }
+//   } h;
+//   xenopixel_light::XenopixelNotificationParser::parse(x.data(), x.size(), h);
+//
+// XenopixelNotificationStream is the resumable form for dumps longer than
+// one notification (the full status is ~600 bytes against an ATT payload of
+// 20 at the default MTU). It is fed every notification of a characteristic
+// in turn and keeps its place across them: a key or value cut by a
+// notification boundary is completed by the next one. Only the key being
+// read and the value of a known key are buffered, each bounded; values of
+// unknown keys are skipped as they stream past.
+
+namespace esphome {
+namespace xenopixel_light {
+
+struct XenopixelNotificationHandler {
+  void on_power_on(bool) {}
+  void on_battery(int) {}  // "Power", percent
+  void on_brightness(int) {}
+  void on_background_color(int, int, int) {}
+  void on_volume(int) {}
+  void on_sound_font(int) {}    // "CurrentSoundPackageNo"
+  void on_light_effect(int) {}  // "CurrentLightEffect"
+  void on_hardware_version(const char *, size_t) {}
+  void on_software_version(const char *, size_t) {}
+  void on_authorize(const char *, size_t) {}
+};
+
+class XenopixelNotificationParser {
+ public:
+  // Returns the number of known keys dispatched
+  template<typename H> static int parse(const char *data, size_t len, H &h) {
+    Cursor c{data, data + len};
+    int dispatched = 0;
+    while (c.p < c.end) {
+      if (*c.p != '"') {
+        c.p++;
+        continue;
+      }
+      const char *key;
+      size_t key_len;
+      if (!read_string_(c, key, key_len)) break;
+      skip_ws_(c);
+      if (c.p >= c.end || *c.p != ':') continue;
+      c.p++;
+      skip_ws_(c);
+      if (dispatch_(c, match_key_(key, key_len), h)) dispatched++;
+    }
+    return dispatched;
+  }
+
+  template<typename H>
+  static int parse(const uint8_t *data, size_t len, H &h) {
+    return parse(reinterpret_cast<const char *>(data), len, h);
+  }
+
+ protected:
+  enum class Key : uint8_t {
+    UNKNOWN,
+    POWER_ON,
+    POWER,
+    BRIGHTNESS,
+    BACKGROUND_COLOR,
+    VOLUME,
+    SOUND_FONT,
+    LIGHT_EFFECT,
+    HARDWARE_VERSION,
+    SOFTWARE_VERSION,
+    AUTHORIZE,
+  };
+
+  struct Cursor {
+    const char *p;
+    const char *end;
+  };
+
+  static Key match_key_(const char *key, size_t len) {
+    struct Entry {
+      const char *name;
+      Key key;
+    };
+    static constexpr Entry KEYS[] = {
+        {"PowerOn", Key::POWER_ON},
+        {"Power", Key::POWER},
+        {"Brightness", Key::BRIGHTNESS},
+        {"BackgroundColor", Key::BACKGROUND_COLOR},
+        {"Volume", Key::VOLUME},
+        {"CurrentSoundPackageNo", Key::SOUND_FONT},
+        {"CurrentLightEffect", Key::LIGHT_EFFECT},
+        {"HardwareVersion", Key::HARDWARE_VERSION},
+        {"SoftwareVersion", Key::SOFTWARE_VERSION},
+        {"Authorize", Key::AUTHORIZE},
+    };
+    for (const Entry &e : KEYS) {
+      if (strlen(e.name) == len && memcmp(e.name, key, len) == 0) return e.key;
+    }
+    return Key::UNKNOWN;
+  }
+
+  // Decodes the value at c for a known key. Leaves c untouched for unknown
+  // keys and mismatched types; the main loop then skips the value.
+  template<typename H> static bool dispatch_(Cursor &c, Key key, H &h) {
+    int v;
+    bool on;
+    int rgb[3];
+    const char *s;
+    size_t n;
+    switch (key) {
+      case Key::POWER_ON:
+        if (!read_bool_(c, on)) return false;
+        h.on_power_on(on);
+        return true;
+      case Key::POWER:
+        if (!read_int_(c, v)) return false;
+        h.on_battery(v);
+        return true;
+      case Key::BRIGHTNESS:
+        if (!read_int_(c, v)) return false;
+        h.on_brightness(v);
+        return true;
+      case Key::BACKGROUND_COLOR:
+        if (!read_triplet_(c, rgb)) return false;
+        h.on_background_color(rgb[0], rgb[1], rgb[2]);
+        return true;
+      case Key::VOLUME:
+        if (!read_int_(c, v)) return false;
+        h.on_volume(v);
+        return true;
+      case Key::SOUND_FONT:
+        if (!read_int_(c, v)) return false;
+        h.on_sound_font(v);
+        return true;
+      case Key::LIGHT_EFFECT:
+        if (!read_int_(c, v)) return false;
+        h.on_light_effect(v);
+        return true;
+      case Key::HARDWARE_VERSION:
+        if (!read_quoted_(c, s, n)) return false;
+        h.on_hardware_version(s, n);
+        return true;
+      case Key::SOFTWARE_VERSION:
+        if (!read_quoted_(c, s, n)) return false;
+        h.on_software_version(s, n);
+        return true;
+      case Key::AUTHORIZE:
+        if (!read_quoted_(c, s, n)) return false;
+        h.on_authorize(s, n);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  static void skip_ws_(Cursor &c) {
+    while (c.p < c.end &&
+           (*c.p == ' ' || *c.p == '\t' || *c.p == '\r' || *c.p == '\n'))
+      c.p++;
+  }
+
+  // c.p is at the opening quote. Escapes are skipped, not decoded.
+  static bool read_string_(Cursor &c, const char *&s, size_t &n) {
+    const char *start = ++c.p;
+    while (c.p < c.end && *c.p != '"') {
+      if (*c.p == '\\' && c.p + 1 < c.end) c.p++;
+      c.p++;
+    }
+    if (c.p >= c.end) return false;
+    s = start;
+    n = c.p - start;
+    c.p++;
+    return true;
+  }
+
+  static bool read_quoted_(Cursor &c, const char *&s, size_t &n) {
+    if (c.p >= c.end || *c.p != '"') return false;
+    return read_string_(c, s, n);
+  }
+
+  static bool read_int_(Cursor &c, int &out) {
+    const char *p = c.p;
+    bool neg = p < c.end && *p == '-';
+    if (neg) p++;
+    if (p >= c.end || *p < '0' || *p > '9') return false;
+    int v = 0;
+    while (p < c.end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+    out = neg ? -v : v;
+    c.p = p;
+    return true;
+  }
+
+  static bool read_bool_(Cursor &c, bool &out) {
+    size_t left = c.end - c.p;
+    if (left >= 4 && memcmp(c.p, "true", 4) == 0) {
+      out = true;
+      c.p += 4;
+      return true;
+    }
+    if (left >= 5 && memcmp(c.p, "false", 5) == 0) {
+      out = false;
+      c.p += 5;
+      return true;
+    }
+    return false;
+  }
+
+  static bool read_triplet_(Cursor &c, int (&out)[3]) {
+    Cursor t = c;
+    if (t.p >= t.end || *t.p != '[') return false;
+    t.p++;
+    for (int i = 0; i < 3; i++) {
+      skip_ws_(t);
+      if (!read_int_(t, out[i])) return false;
+      skip_ws_(t);
+      char expect = i < 2 ? ',' : ']';
+      if (t.p >= t.end || *t.p != expect) return false;
+      t.p++;
+    }
+    c = t;
+    return true;
+  }
+};
+
+class XenopixelNotificationStream : protected XenopixelNotificationParser {
+ public:
+  // The longest known key is CurrentSoundPackageNo; longer keys are unknown
+  static constexpr size_t KEY_MAX = 24;
+  // Fits a version string or "[255, 255, 255]"; a longer value is dropped
+  static constexpr size_t VALUE_MAX = 48;
+
+  // Returns the number of known keys dispatched from this chunk. A chunk
+  // that opens a new message ("[3,{") drops whatever the last one left
+  // unfinished, so a lost notification costs at most the keys it cut.
+  template<typename H> int feed(const char *data, size_t len, H &h) {
+    if (starts_message_(data, len)) {
+      if (state_ != State::SCAN) resyncs_++;
+      state_ = State::SCAN;
+    }
+    int dispatched = 0;
+    for (size_t i = 0; i < len; i++) {
+      // A char that ends a token without being part of it is read again
+      while (!step_(data[i], h, dispatched)) {
+      }
+    }
+    return dispatched;
+  }
+
+  template<typename H> int feed(const uint8_t *data, size_t len, H &h) {
+    return feed(reinterpret_cast<const char *>(data), len, h);
+  }
+
+  // On disconnect: the next notification starts a new dump
+  void reset() { state_ = State::SCAN; }
+
+  // Between tokens, i.e. nothing held over from the last chunk
+  bool idle() const { return state_ == State::SCAN; }
+  uint32_t overflows() const { return overflows_; }
+  uint32_t resyncs() const { return resyncs_; }
+
+ protected:
+  enum class State : uint8_t {
+    SCAN,
+    STRING,
+    STRING_ESCAPE,
+    AFTER_STRING,
+    BEFORE_VALUE,
+    VALUE_STRING,
+    VALUE_STRING_ESCAPE,
+    VALUE_ARRAY,
+    VALUE_SCALAR,
+  };
+
+  static bool starts_message_(const char *p, size_t len) {
+    return len >= 4 && p[0] == '[' && p[1] >= '0' && p[1] <= '9' &&
+           p[2] == ',' && p[3] == '{';
+  }
+
+  static bool is_ws_(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+  }
+
+  static bool is_scalar_(char ch) {
+    return ch == '-' || (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z');
+  }
+
+  // Returns false when ch must be stepped again in the new state
+  template<typename H> bool step_(char ch, H &h, int &dispatched) {
+    switch (state_) {
+      case State::SCAN:
+        if (ch == '"') {
+          key_len_ = 0;
+          key_over_ = false;
+          state_ = State::STRING;
+        }
+        return true;
+      case State::STRING:
+        if (ch == '"') {
+          state_ = State::AFTER_STRING;
+          return true;
+        }
+        if (ch == '\\') state_ = State::STRING_ESCAPE;
+        push_key_(ch);
+        return true;
+      case State::STRING_ESCAPE:
+        push_key_(ch);
+        state_ = State::STRING;
+        return true;
+      case State::AFTER_STRING:
+        if (is_ws_(ch)) return true;
+        if (ch != ':') {
+          // A string value, not a key
+          state_ = State::SCAN;
+          return false;
+        }
+        key_ = key_over_ ? Key::UNKNOWN : match_key_(key_buf_, key_len_);
+        if (key_ == Key::UNKNOWN) {
+          state_ = State::SCAN;
+          return true;
+        }
+        value_len_ = 0;
+        value_over_ = false;
+        state_ = State::BEFORE_VALUE;
+        return true;
+      case State::BEFORE_VALUE:
+        if (is_ws_(ch)) return true;
+        if (ch == '"') {
+          state_ = State::VALUE_STRING;
+        } else if (ch == '[') {
+          state_ = State::VALUE_ARRAY;
+        } else if (is_scalar_(ch)) {
+          state_ = State::VALUE_SCALAR;
+        } else {
+          state_ = State::SCAN;
+          return false;
+        }
+        push_value_(ch);
+        return true;
+      case State::VALUE_STRING:
+        push_value_(ch);
+        if (ch == '\\') state_ = State::VALUE_STRING_ESCAPE;
+        if (ch == '"') finish_value_(h, dispatched);
+        return true;
+      case State::VALUE_STRING_ESCAPE:
+        push_value_(ch);
+        state_ = State::VALUE_STRING;
+        return true;
+      case State::VALUE_ARRAY:
+        if (ch == '{' || ch == '}' || ch == '"') {
+          // Not a triplet; let the scan take it from here
+          state_ = State::SCAN;
+          return false;
+        }
+        push_value_(ch);
+        if (ch == ']') finish_value_(h, dispatched);
+        return true;
+      case State::VALUE_SCALAR:
+        if (is_scalar_(ch)) {
+          push_value_(ch);
+          return true;
+        }
+        finish_value_(h, dispatched);
+        return false;
+    }
+    return true;
+  }
+
+  void push_key_(char ch) {
+    if (key_len_ < KEY_MAX)
+      key_buf_[key_len_++] = ch;
+    else
+      key_over_ = true;
+  }
+
+  void push_value_(char ch) {
+    if (value_len_ < VALUE_MAX)
+      value_buf_[value_len_++] = ch;
+    else
+      value_over_ = true;
+  }
+
+  template<typename H> void finish_value_(H &h, int &dispatched) {
+    state_ = State::SCAN;
+    if (value_over_) {
+      overflows_++;
+      return;
+    }
+    Cursor c{value_buf_, value_buf_ + value_len_};
+    if (dispatch_(c, key_, h)) dispatched++;
+  }
+
+  State state_{State::SCAN};
+  Key key_{Key::UNKNOWN};
+  bool key_over_{false};
+  bool value_over_{false};
+  uint8_t key_len_{0};
+  uint8_t value_len_{0};
+  char key_buf_[KEY_MAX];
+  char value_buf_[VALUE_MAX];
+  uint32_t overflows_{0};
+  uint32_t resyncs_{0};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
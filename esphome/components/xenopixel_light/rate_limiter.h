@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+// Adaptive send-interval controller for streamed values (blade color).
+//
+// AIMD on the interval: every completed write shortens it by 1/8, every
+// failed write or congestion event doubles it, always within
+// [min_interval, max_interval]. The interval also never drops below
+// LATENCY_MULTIPLIER times the smoothed write latency, so a slow link is not
+// fed faster than it drains. The caller keeps the latest value and sends it
+// once ready() — the limiter only decides when, never drops the final value.
+
+namespace esphome {
+namespace xenopixel_light {
+
+class AdaptiveRateLimiter {
+ public:
+  static constexpr uint32_t DEFAULT_INTERVAL_MS = 100;
+  static constexpr uint32_t LATENCY_MULTIPLIER = 2;
+
+  void set_bounds(uint32_t min_ms, uint32_t max_ms) {
+    if (max_ms < min_ms) max_ms = min_ms;
+    min_interval_ms_ = min_ms;
+    max_interval_ms_ = max_ms;
+    interval_ms_ = clamp_(DEFAULT_INTERVAL_MS);
+  }
+
+  bool ready(uint32_t now) const {
+    return !has_sent_ || now - last_send_ms_ >= interval_ms_;
+  }
+
+  void mark_sent(uint32_t now) {
+    last_send_ms_ = now;
+    has_sent_ = true;
+  }
+
+  // The stack finished a write after latency_ms
+  void on_write_complete(uint32_t latency_ms) {
+    // EWMA with 1/8 gain, same shape as TCP's SRTT
+    if (latency_ms_ == 0)
+      latency_ms_ = latency_ms;
+    else
+      latency_ms_ = latency_ms_ - latency_ms_ / 8 + latency_ms / 8;
+    uint32_t step = interval_ms_ / 8;
+    interval_ms_ = clamp_(interval_ms_ - (step > 0 ? step : 1));
+  }
+
+  // A write was rejected or the stack reported congestion
+  void on_write_failed() { interval_ms_ = clamp_(interval_ms_ * 2); }
+
+  uint32_t interval_ms() const { return interval_ms_; }
+  uint32_t latency_ms() const { return latency_ms_; }
+
+ protected:
+  uint32_t clamp_(uint32_t v) const {
+    uint32_t floor = latency_ms_ * LATENCY_MULTIPLIER;
+    if (floor < min_interval_ms_) floor = min_interval_ms_;
+    if (floor > max_interval_ms_) floor = max_interval_ms_;
+    if (v < floor) return floor;
+    if (v > max_interval_ms_) return max_interval_ms_;
+    return v;
+  }
+
+  uint32_t min_interval_ms_{25};
+  uint32_t max_interval_ms_{500};
+  uint32_t interval_ms_{DEFAULT_INTERVAL_MS};
+  uint32_t latency_ms_{0};
+  uint32_t last_send_ms_{0};
+  bool has_sent_{false};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstdint>
+
+// Connection handshake as a state machine driven by GATT events.
+//
+// PROTOCOL.md: after service discovery the client enables indications on
+// 0x2A05 (CCCD write with response), writes the HandShake to DAE1 (write
+// with response), then the Authorize command to 3AB1 (write without
+// response); the saber answers with AccessAllowed on 3AB1. Each step starts
+// as soon as the previous one is acknowledged instead of after a fixed delay.
+//
+// Every step has its own timeout. An unanswered or failed step is retried
+// up to MAX_RETRIES times (failed writes after RETRY_DELAY_MS); after that
+// the session gives up and the owner drops the connection, so the next
+// connection starts over.
+//
+// The session only decides what to send next; the owner performs the
+// returned SessionAction and reports the result back.
+
+namespace esphome {
+namespace xenopixel_light {
+
+static constexpr char SESSION_HANDSHAKE_FRAME[] =
+    "[2,{\"HandShake\":\"HelloDamien\"}]";
+static constexpr char SESSION_AUTHORIZE_FRAME[] =
+    "[2,{\"Authorize\":\"SaberOfDamien\"}]";
+
+enum class SessionState : uint8_t {
+  DISCONNECTED,
+  DISCOVERING,  // connected, waiting for service discovery
+  ENABLING_INDICATIONS,
+  HANDSHAKE,
+  AUTHORIZING,
+  AUTHORIZED,
+  FAILED,
+};
+
+enum class SessionAction : uint8_t {
+  NONE,
+  ENABLE_INDICATIONS,
+  SEND_HANDSHAKE,
+  SEND_AUTHORIZE,
+  GIVE_UP,
+};
+
+inline const char *session_state_name(SessionState state) {
+  switch (state) {
+    case SessionState::DISCOVERING:
+      return "discovering";
+    case SessionState::ENABLING_INDICATIONS:
+      return "enabling indications";
+    case SessionState::HANDSHAKE:
+      return "handshake";
+    case SessionState::AUTHORIZING:
+      return "authorizing";
+    case SessionState::AUTHORIZED:
+      return "authorized";
+    case SessionState::FAILED:
+      return "failed";
+    default:
+      return "disconnected";
+  }
+}
+
+class SaberSession {
+ public:
+  static constexpr uint32_t DISCOVERY_TIMEOUT_MS = 5000;
+  static constexpr uint32_t INDICATIONS_TIMEOUT_MS = 1000;
+  static constexpr uint32_t HANDSHAKE_TIMEOUT_MS = 1000;
+  // The saber dumps its full status on DAE1 before AccessAllowed
+  static constexpr uint32_t AUTHORIZE_TIMEOUT_MS = 1500;
+  static constexpr uint32_t RETRY_DELAY_MS = 100;
+  static constexpr uint8_t MAX_RETRIES = 2;
+
+  struct Stats {
+    uint32_t sessions{0};
+    uint32_t authorized{0};
+    uint32_t retries{0};
+    uint32_t timeouts{0};
+    uint32_t failures{0};
+  };
+
+  // Link is up; time-to-authorized is measured from here
+  void connected(uint32_t now) {
+    connected_ms_ = now;
+    enter_(SessionState::DISCOVERING, now);
+    stats_.sessions++;
+  }
+
+  // GATTC cache is populated. Also starts a session whose connect was missed.
+  SessionAction services_ready(uint32_t now) {
+    if (state_ == SessionState::DISCONNECTED) connected(now);
+    if (state_ != SessionState::DISCOVERING) return SessionAction::NONE;
+    return enter_(SessionState::ENABLING_INDICATIONS, now);
+  }
+
+  // Result of the 0x2A05 CCCD write: false when it could not be issued or
+  // the saber rejected it
+  SessionAction indications_enabled(bool ok, uint32_t now) {
+    if (state_ != SessionState::ENABLING_INDICATIONS) return SessionAction::NONE;
+    return ok ? enter_(SessionState::HANDSHAKE, now) : fail_step_(now);
+  }
+
+  SessionAction handshake_written(bool ok, uint32_t now) {
+    if (state_ != SessionState::HANDSHAKE) return SessionAction::NONE;
+    return ok ? enter_(SessionState::AUTHORIZING, now) : fail_step_(now);
+  }
+
+  // Authorize is written without response, so only a failure to issue it
+  // is reported; success is the AccessAllowed notification
+  SessionAction authorize_failed(uint32_t now) {
+    if (state_ != SessionState::AUTHORIZING) return SessionAction::NONE;
+    return fail_step_(now);
+  }
+
+  // AccessAllowed. Accepted in any connected state: the saber may still
+  // consider an earlier connection authorized.
+  void access_allowed(uint32_t now) {
+    if (state_ == SessionState::DISCONNECTED ||
+        state_ == SessionState::AUTHORIZED)
+      return;
+    state_ = SessionState::AUTHORIZED;
+    time_to_authorized_ms_ = now - connected_ms_;
+    has_time_to_authorized_ = true;
+    stats_.authorized++;
+  }
+
+  // Retries and timeouts; called every loop()
+  SessionAction poll(uint32_t now) {
+    if (!waiting_()) return SessionAction::NONE;
+    if (now - step_start_ms_ < step_wait_ms_) return SessionAction::NONE;
+    if (retry_pending_) {
+      retry_pending_ = false;
+      return resend_(now);
+    }
+    stats_.timeouts++;
+    if (state_ == SessionState::DISCOVERING) return give_up_();
+    return retry_(now);
+  }
+
+  void disconnected() {
+    state_ = SessionState::DISCONNECTED;
+    retry_pending_ = false;
+  }
+
+  SessionState state() const { return state_; }
+  bool is_authorized() const { return state_ == SessionState::AUTHORIZED; }
+  // Retries spent on the current step
+  uint8_t retries() const { return retries_; }
+  // Connection to AccessAllowed of the last authorized session
+  bool has_time_to_authorized() const { return has_time_to_authorized_; }
+  uint32_t time_to_authorized_ms() const { return time_to_authorized_ms_; }
+  const Stats &get_stats() const { return stats_; }
+
+ protected:
+  bool waiting_() const {
+    return state_ == SessionState::DISCOVERING ||
+           state_ == SessionState::ENABLING_INDICATIONS ||
+           state_ == SessionState::HANDSHAKE ||
+           state_ == SessionState::AUTHORIZING;
+  }
+
+  static uint32_t timeout_for_(SessionState state) {
+    switch (state) {
+      case SessionState::DISCOVERING:
+        return DISCOVERY_TIMEOUT_MS;
+      case SessionState::ENABLING_INDICATIONS:
+        return INDICATIONS_TIMEOUT_MS;
+      case SessionState::HANDSHAKE:
+        return HANDSHAKE_TIMEOUT_MS;
+      default:
+        return AUTHORIZE_TIMEOUT_MS;
+    }
+  }
+
+  SessionAction enter_(SessionState state, uint32_t now) {
+    state_ = state;
+    retries_ = 0;
+    retry_pending_ = false;
+    step_start_ms_ = now;
+    step_wait_ms_ = timeout_for_(state);
+    return action_for_(state);
+  }
+
+  static SessionAction action_for_(SessionState state) {
+    switch (state) {
+      case SessionState::ENABLING_INDICATIONS:
+        return SessionAction::ENABLE_INDICATIONS;
+      case SessionState::HANDSHAKE:
+        return SessionAction::SEND_HANDSHAKE;
+      case SessionState::AUTHORIZING:
+        return SessionAction::SEND_AUTHORIZE;
+      default:
+        return SessionAction::NONE;
+    }
+  }
+
+  SessionAction resend_(uint32_t now) {
+    step_start_ms_ = now;
+    step_wait_ms_ = timeout_for_(state_);
+    return action_for_(state_);
+  }
+
+  // A step that timed out is resent at once
+  SessionAction retry_(uint32_t now) {
+    if (retries_ >= MAX_RETRIES) return give_up_();
+    retries_++;
+    stats_.retries++;
+    return resend_(now);
+  }
+
+  // A step that failed outright is resent after RETRY_DELAY_MS
+  SessionAction fail_step_(uint32_t now) {
+    if (retries_ >= MAX_RETRIES) return give_up_();
+    retries_++;
+    stats_.retries++;
+    retry_pending_ = true;
+    step_start_ms_ = now;
+    step_wait_ms_ = RETRY_DELAY_MS;
+    return SessionAction::NONE;
+  }
+
+  SessionAction give_up_() {
+    state_ = SessionState::FAILED;
+    retry_pending_ = false;
+    stats_.failures++;
+    return SessionAction::GIVE_UP;
+  }
+
+  SessionState state_{SessionState::DISCONNECTED};
+  uint32_t connected_ms_{0};
+  uint32_t step_start_ms_{0};
+  uint32_t step_wait_ms_{0};
+  uint8_t retries_{0};
+  bool retry_pending_{false};
+  bool has_time_to_authorized_{false};
+  uint32_t time_to_authorized_ms_{0};
+  Stats stats_;
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
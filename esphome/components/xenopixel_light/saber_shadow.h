@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Shadow copy of the saber's settings, one field per documented key.
+//
+// Each field keeps the value the saber last reported (DAE1 status, 3AB1
+// brightness echo) and the value we last asked for. A write is only needed
+// when a wanted value differs from what the saber has or is about to have,
+// so re-applying a value that just came in from a notification — the echo
+// of an entity update — costs nothing.
+//
+// A report always wins over an outstanding request: the saber may have been
+// changed with its buttons, and following it keeps Home Assistant and the
+// saber from fighting. An older report arriving just before the echo of our
+// write only costs one extra entity update.
+
+namespace esphome {
+namespace xenopixel_light {
+
+enum class ShadowKey : uint8_t {
+  POWER_ON,
+  BRIGHTNESS,
+  BACKGROUND_COLOR,  // packed 0xRRGGBB
+  VOLUME,
+  SOUND_FONT,    // CurrentSoundPackageNo
+  LIGHT_EFFECT,  // CurrentLightEffect
+};
+
+static constexpr size_t SHADOW_KEY_COUNT = 6;
+
+class SaberShadowState {
+ public:
+  static constexpr int32_t pack_rgb(int r, int g, int b) {
+    return ((r & 0xFF) << 16) | ((g & 0xFF) << 8) | (b & 0xFF);
+  }
+  static constexpr int unpack_r(int32_t rgb) { return (rgb >> 16) & 0xFF; }
+  static constexpr int unpack_g(int32_t rgb) { return (rgb >> 8) & 0xFF; }
+  static constexpr int unpack_b(int32_t rgb) { return rgb & 0xFF; }
+
+  // The value the saber has once outstanding writes land
+  bool known(ShadowKey k) const {
+    const Field &f = field_(k);
+    return f.desired_known || f.confirmed_known;
+  }
+  int32_t value(ShadowKey k) const {
+    const Field &f = field_(k);
+    return f.desired_known ? f.desired : f.confirmed;
+  }
+  bool matches(ShadowKey k, int32_t v) const {
+    return known(k) && value(k) == v;
+  }
+
+  // Records a wanted value. True when it is a change that has to be written.
+  bool want(ShadowKey k, int32_t v) {
+    if (matches(k, v)) return false;
+    Field &f = field_(k);
+    f.desired = v;
+    f.desired_known = true;
+    return true;
+  }
+
+  // The saber reported v. True when this changes value(k), i.e. the
+  // entity showing this key is out of date.
+  bool confirm(ShadowKey k, int32_t v) {
+    bool changed = !matches(k, v);
+    Field &f = field_(k);
+    f.confirmed = v;
+    f.confirmed_known = true;
+    f.desired_known = false;
+    return changed;
+  }
+
+  bool has_confirmed(ShadowKey k) const { return field_(k).confirmed_known; }
+  int32_t confirmed(ShadowKey k) const { return field_(k).confirmed; }
+
+  // Asked for but not reported back yet
+  bool pending(ShadowKey k) const {
+    const Field &f = field_(k);
+    return f.desired_known && (!f.confirmed_known || f.desired != f.confirmed);
+  }
+  size_t pending_count() const {
+    size_t n = 0;
+    for (size_t i = 0; i < SHADOW_KEY_COUNT; i++)
+      n += pending((ShadowKey)i) ? 1 : 0;
+    return n;
+  }
+
+  // After a disconnect nothing is known: the saber may have changed while
+  // out of range, and it reports everything again once authorized
+  void clear() {
+    for (auto &f : fields_) f = Field();
+  }
+
+ protected:
+  struct Field {
+    int32_t confirmed{0};
+    int32_t desired{0};
+    bool confirmed_known{false};
+    bool desired_known{false};
+  };
+
+  Field &field_(ShadowKey k) { return fields_[(size_t)k]; }
+  const Field &field_(ShadowKey k) const { return fields_[(size_t)k]; }
+
+  Field fields_[SHADOW_KEY_COUNT];
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// Thins out the write_state() calls ESPHome makes during a transition.
+//
+// While a transition runs, ESPHome calls write_state() every loop with
+// current_values interpolated towards remote_values. XenopixelLight feeds
+// each call's current and target value through one planner per command
+// type (brightness, color), which decides what, if anything, to send:
+//
+// - ALL: every interpolated step, as without a planner
+// - TARGET: the target once, as soon as the transition starts
+// - KEYFRAMES: at most keyframes() values per fade, evenly spaced between
+//   the value the fade started from and the target. The last keyframe is
+//   the target itself, sent when the fade gets there.
+//
+// Progress is measured along the channel that moves furthest, so the
+// spacing follows ESPHome's easing rather than wall time. A new target
+// mid-fade starts a new fade from the current value.
+
+namespace esphome {
+namespace xenopixel_light {
+
+enum class TransitionMode : uint8_t { ALL, TARGET, KEYFRAMES };
+
+template<size_t N> class TransitionPlanner {
+ public:
+  static constexpr uint8_t DEFAULT_KEYFRAMES = 4;
+  static constexpr uint8_t MAX_KEYFRAMES = 20;
+
+  void set_mode(TransitionMode mode) { mode_ = mode; }
+  TransitionMode mode() const { return mode_; }
+  void set_keyframes(uint8_t keyframes) {
+    if (keyframes < 1) keyframes = 1;
+    if (keyframes > MAX_KEYFRAMES) keyframes = MAX_KEYFRAMES;
+    keyframes_ = keyframes;
+  }
+  uint8_t keyframes() const { return keyframes_; }
+
+  // One write_state() call during a transition. Returns true with the
+  // value to send in out, false when this step is skipped.
+  bool step(const int (&current)[N], const int (&target)[N], int (&out)[N]) {
+    if (!fading_ || !same_(target, to_)) begin_(current, target);
+    switch (mode_) {
+      case TransitionMode::ALL:
+        copy_(current, out);
+        return true;
+      case TransitionMode::TARGET:
+        if (sent_ > 0) return false;
+        sent_ = 1;
+        copy_(to_, out);
+        return true;
+      case TransitionMode::KEYFRAMES:
+        return keyframe_(current, out);
+    }
+    return false;
+  }
+
+  // The transition ended; the next step() starts a new fade
+  void reset() { fading_ = false; }
+  bool fading() const { return fading_; }
+
+ protected:
+  void begin_(const int (&current)[N], const int (&target)[N]) {
+    copy_(current, from_);
+    copy_(target, to_);
+    sent_ = 0;
+    fading_ = true;
+    lead_ = 0;
+    int dist = 0;
+    for (size_t i = 0; i < N; i++) {
+      int d = abs(to_[i] - from_[i]);
+      if (d <= dist) continue;
+      dist = d;
+      lead_ = i;
+    }
+    dist_ = dist;
+  }
+
+  bool keyframe_(const int (&current)[N], int (&out)[N]) {
+    if (dist_ == 0) return false;
+    int moved = current[lead_] - from_[lead_];
+    if ((to_[lead_] - from_[lead_] < 0) != (moved < 0)) moved = 0;
+    int k = (abs(moved) * keyframes_) / dist_;
+    if (k > keyframes_) k = keyframes_;
+    if (k <= sent_) return false;
+    sent_ = (uint8_t)k;
+    for (size_t i = 0; i < N; i++)
+      out[i] = from_[i] + ((to_[i] - from_[i]) * k) / keyframes_;
+    return true;
+  }
+
+  static bool same_(const int (&a)[N], const int (&b)[N]) {
+    for (size_t i = 0; i < N; i++)
+      if (a[i] != b[i]) return false;
+    return true;
+  }
+
+  static void copy_(const int (&from)[N], int (&to)[N]) {
+    for (size_t i = 0; i < N; i++) to[i] = from[i];
+  }
+
+  TransitionMode mode_{TransitionMode::KEYFRAMES};
+  uint8_t keyframes_{DEFAULT_KEYFRAMES};
+  bool fading_{false};
+  uint8_t sent_{0};
+  size_t lead_{0};
+  int dist_{0};
+  int from_[N]{};
+  int to_[N]{};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
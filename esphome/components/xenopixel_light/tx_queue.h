@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Fixed-capacity single-producer/single-consumer queue of BLE command frames.
+//
+// Each frame carries a key (a bitmask of the Xenopixel fields it sets). A new
+// frame whose key matches the newest frame still waiting in the queue
+// overwrites that frame in place instead of taking a new slot, so a stream of
+// color updates occupies one slot no matter how fast it arrives. Only the
+// newest frame is coalesced into: with another key queued behind it, the new
+// frame is appended, so frames always go out in the order they were queued.
+//
+// Slots are preallocated. Producer and consumer only hand slots to each other
+// through a per-slot state word, so neither side ever blocks:
+//   FREE → QUEUED           producer appends at head
+//   QUEUED → WRITING → QUEUED  producer coalesces into the newest slot
+//   QUEUED → CLAIMED        consumer takes the front slot to transmit it
+//   CLAIMED → FREE          consumer pops after a successful write
+//   CLAIMED → QUEUED        consumer gives the slot back to retry later
+// A CLAIMED slot is never overwritten — the producer appends a fresh slot.
+//
+// Trace is opaque per-frame metadata (instrumentation.h's LatencyTrace)
+// stored with the frame and replaced along with it on coalescing.
+
+namespace esphome {
+namespace xenopixel_light {
+
+struct TxNoTrace {};
+
+template<size_t N, size_t FRAME_SIZE, typename Trace = TxNoTrace>
+class TxQueue {
+ public:
+  enum class Push : uint8_t { ENQUEUED, COALESCED, DROPPED };
+
+  struct Slot {
+    uint16_t key{0};
+    uint16_t len{0};
+    uint8_t retries{0};
+    Trace trace;
+    char data[FRAME_SIZE];
+  };
+
+  // Producer side
+  Push push(uint16_t key, const char *data, size_t len,
+            const Trace &trace = Trace()) {
+    if (len > FRAME_SIZE) return Push::DROPPED;
+    return emplace(
+        key,
+        [data, len](char *buf, size_t) {
+          memcpy(buf, data, len);
+          return len;
+        },
+        trace);
+  }
+
+  // Producer side. encode(char *buf, size_t cap) writes the frame straight
+  // into the slot and returns its length, or returns 0 having written
+  // nothing when it does not fit — the slot keeps its previous frame.
+  template<typename F>
+  Push emplace(uint16_t key, F &&encode, const Trace &trace = Trace()) {
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head != tail) {
+      Entry &e = entries_[(head - 1) % N];
+      uint8_t expected = QUEUED;
+      if (e.slot.key == key &&
+          e.state.compare_exchange_strong(expected, WRITING,
+                                          std::memory_order_acquire)) {
+        bool ok = fill_(e.slot, key, encode, trace);
+        e.state.store(QUEUED, std::memory_order_release);
+        return ok ? Push::COALESCED : Push::DROPPED;
+      }
+    }
+
+    if (head - tail >= N) return Push::DROPPED;
+    Entry &e = entries_[head % N];
+    if (!fill_(e.slot, key, encode, trace)) return Push::DROPPED;
+    e.state.store(QUEUED, std::memory_order_release);
+    head_.store(head + 1, std::memory_order_release);
+    return Push::ENQUEUED;
+  }
+
+  // Consumer side. Returns the front slot, or nullptr when the queue is empty
+  // or the producer is mid-overwrite of the front slot.
+  Slot *claim() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return nullptr;
+    Entry &e = entries_[tail % N];
+    uint8_t expected = QUEUED;
+    if (!e.state.compare_exchange_strong(expected, CLAIMED,
+                                         std::memory_order_acquire))
+      return nullptr;
+    return &e.slot;
+  }
+
+  // Pop the claimed front slot after it was written to the stack
+  void pop() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    entries_[tail % N].state.store(FREE, std::memory_order_release);
+    tail_.store(tail + 1, std::memory_order_release);
+  }
+
+  // Hand the claimed front slot back so it is retried on the next drain
+  void unclaim() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    entries_[tail % N].state.store(QUEUED, std::memory_order_release);
+  }
+
+  // Consumer side. Discards every waiting frame and returns how many.
+  size_t clear() {
+    size_t n = 0;
+    while (claim() != nullptr) {
+      pop();
+      n++;
+    }
+    return n;
+  }
+
+  // Consumer side. True when a waiting frame's key has any bit of mask.
+  bool any_key(uint16_t mask) const {
+    size_t head = head_.load(std::memory_order_acquire);
+    for (size_t i = tail_.load(std::memory_order_relaxed); i != head; i++)
+      if (entries_[i % N].slot.key & mask) return true;
+    return false;
+  }
+
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) -
+           tail_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  static constexpr size_t capacity() { return N; }
+
+ protected:
+  enum State : uint8_t { FREE, QUEUED, WRITING, CLAIMED };
+
+  struct Entry {
+    std::atomic<uint8_t> state{FREE};
+    Slot slot;
+  };
+
+  template<typename F>
+  static bool fill_(Slot &slot, uint16_t key, F &encode, const Trace &trace) {
+    size_t len = encode(slot.data, FRAME_SIZE);
+    if (len == 0 || len > FRAME_SIZE) return false;
+    slot.key = key;
+    slot.len = (uint16_t)len;
+    slot.retries = 0;
+    slot.trace = trace;
+    return true;
+  }
+
+  Entry entries_[N];
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
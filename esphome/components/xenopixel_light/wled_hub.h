@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "instrumentation.h"
+#include "wled_protocol.h"
+#include "wled_receiver.h"
+
+// Fan-out of WLED packets to every saber with WLED sync enabled.
+//
+// Sabers subscribe with their pixel window. Each new packet generation is
+// decoded once, in a single pass covering every subscriber's window
+// (WledDecoder::decode_multi()), into a compact per-subscriber target. Only
+// a subscriber whose target differs from the last one it was given is
+// marked dirty.
+//
+// Every service() delivers each dirty target whose subscriber is ready for
+// it (wled_ready(): the saber has BLE write budget left). Pacing the writes
+// across connections is left to BleWriteScheduler; a saber that is not ready
+// keeps its target dirty, and a newer packet replaces it in place.
+//
+// A new subscriber is marked as needing the current target: the latest
+// packet is decoded again for it alone, without counting as a new packet
+// or restarting realtime mode, and the others keep their generation.
+//
+// The hub also owns WLED realtime mode: a realtime packet's timeout byte
+// (255 = never) suppresses notifier packets for every saber until it
+// expires, whether or not the frame changed any saber's target.
+//
+// Each pending target keeps the LatencyTrace of the packet it came from;
+// delivery_trace() returns it while on_wled_target() runs.
+
+namespace esphome {
+namespace xenopixel_light {
+
+class WledSubscriber {
+ public:
+  virtual ~WledSubscriber() = default;
+  virtual void on_wled_target(const WledTarget &target) = 0;
+  // False while a target could not be written; it stays pending
+  virtual bool wled_ready() { return true; }
+};
+
+class WledHub {
+ public:
+  static constexpr size_t MAX_SUBSCRIBERS = WledDecoder::MAX_WINDOWS;
+
+  static WledHub &instance() {
+    static WledHub hub;
+    return hub;
+  }
+
+  // Returns false when the registry is full. Subscribing again updates the
+  // window. The subscriber gets the current WLED state on the next
+  // service(); others are not affected.
+  bool subscribe(WledSubscriber *sub, const WledPixelWindow &window) {
+    Subscription *s = find_(sub);
+    if (s == nullptr) {
+      if (count_ >= MAX_SUBSCRIBERS) return false;
+      s = &subs_[count_++];
+      s->sub = sub;
+    }
+    windows_[s - subs_] = window;
+    s->last = WledTarget();
+    s->dirty = false;
+    s->needs_current = true;
+    return true;
+  }
+
+  void unsubscribe(WledSubscriber *sub) {
+    Subscription *s = find_(sub);
+    if (s == nullptr) return;
+    size_t i = s - subs_;
+    for (; i + 1 < count_; i++) {
+      subs_[i] = subs_[i + 1];
+      windows_[i] = windows_[i + 1];
+    }
+    count_--;
+  }
+
+  size_t subscriber_count() const { return count_; }
+
+  // Called from every light's loop(); the first call after a new packet
+  // decodes it, every call delivers the dirty targets of ready subscribers.
+  void service(uint32_t now) {
+    if (count_ > 0) ingest_(now);
+    deliver_();
+  }
+
+  // True when a packet with these bytes should be applied now. Realtime
+  // packets (re)start realtime mode; notifier packets are refused while it
+  // is active.
+  bool admit(const uint8_t *data, size_t len, uint32_t now) {
+    bool realtime = WledDecoder::is_realtime(data, len);
+    return admit_(realtime, realtime ? data[1] : 0, now);
+  }
+
+  bool is_realtime(uint32_t now) const {
+    if (!realtime_active_) return false;
+    if (realtime_forever_) return true;
+    return now - realtime_last_ms_ < realtime_timeout_ms_;
+  }
+
+  // Leave realtime mode and drop undelivered targets
+  void reset() {
+    realtime_active_ = false;
+    for (size_t i = 0; i < count_; i++) subs_[i].dirty = false;
+  }
+
+  // Trace of the target being delivered; only valid inside on_wled_target()
+  const LatencyTrace &delivery_trace() const { return delivery_trace_; }
+
+  uint32_t packets_decoded() const { return packets_decoded_; }
+  uint32_t deliveries() const { return deliveries_; }
+
+ protected:
+  struct Subscription {
+    WledSubscriber *sub{nullptr};
+    WledTarget last;
+    WledTarget pending;
+    LatencyTrace trace;
+    bool dirty{false};
+    bool needs_current{false};
+  };
+
+  bool admit_(bool realtime, uint8_t timeout_s, uint32_t now) {
+    if (realtime) {
+      realtime_active_ = true;
+      realtime_forever_ = timeout_s == WLED_TIMEOUT_FOREVER;
+      realtime_timeout_ms_ = (uint32_t)timeout_s * 1000;
+      realtime_last_ms_ = now;
+      return true;
+    }
+    if (is_realtime(now)) return false;
+    realtime_active_ = false;
+    return true;
+  }
+
+  Subscription *find_(WledSubscriber *sub) {
+    for (size_t i = 0; i < count_; i++)
+      if (subs_[i].sub == sub) return &subs_[i];
+    return nullptr;
+  }
+
+  void ingest_(uint32_t now) {
+    // The visitor may run more than once, so it only fills locals
+    WledTarget targets[MAX_SUBSCRIBERS];
+    bool realtime = false;
+    uint8_t timeout_s = 0;
+    uint32_t rx_us = 0;
+    WledReceiver &rx = WledReceiver::instance();
+    auto decode = [&](const uint8_t *data, size_t len) {
+      WledDecoder::decode_multi(data, len, windows_, targets, count_);
+      realtime = WledDecoder::is_realtime(data, len);
+      timeout_s = realtime ? data[1] : 0;
+      rx_us = rx.latest_rx_us();
+    };
+    if (rx.visit_if_newer(last_gen_, decode)) {
+      packets_decoded_++;
+      LatencyTrace trace = Instrumentation::instance().decoded(rx_us);
+      if (admit_(realtime, timeout_s, now)) mark_(targets, trace, false);
+      for (size_t i = 0; i < count_; i++) subs_[i].needs_current = false;
+      return;
+    }
+    if (!any_need_current_()) return;
+
+    // Catch new subscribers up on the packet everyone else already has. It
+    // is applied only if it would be admitted now; realtime state is left
+    // as it is.
+    uint32_t gen = 0;
+    if (rx.visit_if_newer(gen, decode) && realtime == is_realtime(now))
+      mark_(targets, LatencyTrace(), true);
+    for (size_t i = 0; i < count_; i++) subs_[i].needs_current = false;
+  }
+
+  bool any_need_current_() const {
+    for (size_t i = 0; i < count_; i++)
+      if (subs_[i].needs_current) return true;
+    return false;
+  }
+
+  void mark_(const WledTarget *targets, const LatencyTrace &trace,
+             bool only_new) {
+    for (size_t i = 0; i < count_; i++) {
+      Subscription &s = subs_[i];
+      if (only_new && !s.needs_current) continue;
+      if (targets[i].kind == WledTarget::NONE) continue;
+      if (targets[i].same_output(s.last)) {
+        // Back to what the saber already has
+        s.dirty = false;
+        continue;
+      }
+      s.pending = targets[i];
+      s.trace = trace;
+      s.dirty = true;
+    }
+  }
+
+  void deliver_() {
+    for (size_t i = 0; i < count_; i++) {
+      Subscription &s = subs_[i];
+      if (!s.dirty || !s.sub->wled_ready()) continue;
+      s.dirty = false;
+      s.last = s.pending;
+      deliveries_++;
+      delivery_trace_ = s.trace;
+      s.sub->on_wled_target(s.pending);
+      delivery_trace_ = LatencyTrace();
+    }
+  }
+
+  Subscription subs_[MAX_SUBSCRIBERS];
+  WledPixelWindow windows_[MAX_SUBSCRIBERS];
+  size_t count_{0};
+  uint32_t last_gen_{0};
+  bool realtime_active_{false};
+  bool realtime_forever_{false};
+  uint32_t realtime_timeout_ms_{0};
+  uint32_t realtime_last_ms_{0};
+  uint32_t packets_decoded_{0};
+  uint32_t deliveries_{0};
+  LatencyTrace delivery_trace_;
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
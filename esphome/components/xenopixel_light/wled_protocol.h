@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decoder for the WLED UDP formats a saber can follow.
+//
+// Notifier (byte 0 = 0): WLED's sync packet. Byte 2 is master brightness,
+// bytes 3-5 the primary color.
+//
+// Realtime (byte 0 = 1..4): per-LED frames streamed at the effect frame rate.
+// Byte 1 is the realtime timeout in seconds (255 = never time out).
+//   WARLS (1): [index, r, g, b] repeated, up to 255 LEDs
+//   DRGB  (2): [r, g, b] repeated from LED 0
+//   DRGBW (3): [r, g, b, w] repeated from LED 0 (white is ignored)
+//   DNRGB (4): start index (u16 big-endian), then [r, g, b] repeated
+//
+// A saber is one color, so realtime frames are reduced to the average of a
+// configurable pixel window, then split into brightness (the brightest
+// channel) and a full-scale color — the same split recover_rgb_() does for
+// ESPHome values. Decoding reads the datagram in place and never allocates.
+
+namespace esphome {
+namespace xenopixel_light {
+
+enum WledProtocol : uint8_t {
+  WLED_PROTO_NOTIFIER = 0,
+  WLED_PROTO_WARLS = 1,
+  WLED_PROTO_DRGB = 2,
+  WLED_PROTO_DRGBW = 3,
+  WLED_PROTO_DNRGB = 4,
+};
+
+static constexpr size_t WLED_NOTIFIER_MIN_LEN = 6;
+static constexpr uint8_t WLED_TIMEOUT_FOREVER = 255;
+
+// Pixels of a realtime frame that drive one saber
+struct WledPixelWindow {
+  uint16_t start{0};
+  uint16_t count{1};
+
+  bool contains(uint32_t index) const {
+    return index >= start && index < (uint32_t)start + count;
+  }
+};
+
+struct WledTarget {
+  enum Kind : uint8_t { NONE, NOTIFIER, REALTIME };
+
+  Kind kind{NONE};
+  uint8_t bri{0};  // 0-255
+  uint8_t r{0}, g{0}, b{0};
+  uint8_t timeout_s{0};  // realtime only
+
+  // Same blade output; the timeout is not part of it
+  bool same_output(const WledTarget &o) const {
+    return kind == o.kind && bri == o.bri && r == o.r && g == o.g && b == o.b;
+  }
+};
+
+class WledDecoder {
+ public:
+  // Windows decoded together in one pass by decode_multi()
+  static constexpr size_t MAX_WINDOWS = 8;
+
+  static WledTarget decode(const uint8_t *data, size_t len,
+                           const WledPixelWindow &window) {
+    WledTarget t;
+    decode_multi(data, len, &window, &t, 1);
+    return t;
+  }
+
+  // Decodes the packet once for n windows, writing one target per window.
+  // Realtime records are walked a single time regardless of n.
+  static void decode_multi(const uint8_t *data, size_t len,
+                           const WledPixelWindow *windows, WledTarget *out,
+                           size_t n) {
+    if (n > MAX_WINDOWS) n = MAX_WINDOWS;
+    for (size_t i = 0; i < n; i++) out[i] = WledTarget();
+    if (len < 2) return;
+    switch (data[0]) {
+      case WLED_PROTO_NOTIFIER:
+        if (len < WLED_NOTIFIER_MIN_LEN) return;
+        for (size_t i = 0; i < n; i++) {
+          out[i].kind = WledTarget::NOTIFIER;
+          out[i].bri = data[2];
+          out[i].r = data[3];
+          out[i].g = data[4];
+          out[i].b = data[5];
+        }
+        return;
+      case WLED_PROTO_WARLS:
+        return realtime_(data, len, windows, out, n, 2, 4, 1, -1);
+      case WLED_PROTO_DRGB:
+        return realtime_(data, len, windows, out, n, 2, 3, 0, 0);
+      case WLED_PROTO_DRGBW:
+        return realtime_(data, len, windows, out, n, 2, 4, 0, 0);
+      case WLED_PROTO_DNRGB:
+        if (len < 4) return;
+        return realtime_(data, len, windows, out, n, 4, 3, 0,
+                         ((int32_t)data[2] << 8) | data[3]);
+      default:
+        return;
+    }
+  }
+
+  static bool is_realtime(const uint8_t *data, size_t len) {
+    return len >= 2 && data[0] >= WLED_PROTO_WARLS &&
+           data[0] <= WLED_PROTO_DNRGB;
+  }
+
+ protected:
+  // Average each window's pixels. Each record is `stride` bytes starting at
+  // `offset`, with RGB at `rgb_at` within the record. first_index >= 0 gives
+  // the LED index of the first record; -1 means each record's first byte is
+  // its own index (WARLS).
+  static void realtime_(const uint8_t *data, size_t len,
+                        const WledPixelWindow *windows, WledTarget *out,
+                        size_t n, size_t offset, size_t stride, size_t rgb_at,
+                        int32_t first_index) {
+    uint32_t sum_r[MAX_WINDOWS] = {}, sum_g[MAX_WINDOWS] = {},
+             sum_b[MAX_WINDOWS] = {}, count[MAX_WINDOWS] = {};
+    uint32_t index = first_index < 0 ? 0 : (uint32_t)first_index;
+    for (size_t pos = offset; pos + stride <= len; pos += stride, index++) {
+      if (first_index < 0) index = data[pos];
+      const uint8_t *px = data + pos + rgb_at;
+      for (size_t i = 0; i < n; i++) {
+        if (!windows[i].contains(index)) continue;
+        sum_r[i] += px[0];
+        sum_g[i] += px[1];
+        sum_b[i] += px[2];
+        count[i]++;
+      }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      if (count[i] == 0) continue;
+      uint8_t r = sum_r[i] / count[i], g = sum_g[i] / count[i],
+              b = sum_b[i] / count[i];
+      uint8_t peak = r > g ? (r > b ? r : b) : (g > b ? g : b);
+      WledTarget &t = out[i];
+      t.kind = WledTarget::REALTIME;
+      t.timeout_s = data[1];
+      t.bri = peak;
+      if (peak > 0) {
+        t.r = (uint8_t)((r * 255u) / peak);
+        t.g = (uint8_t)((g * 255u) / peak);
+        t.b = (uint8_t)((b * 255u) / peak);
+      }
+    }
+  }
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "instrumentation.h"
+#include "wled_protocol.h"
+#include "wled_socket.h"
+
+#ifndef UNIT_TEST
+#include "esphome/core/log.h"                         // cppcheck-suppress missingInclude
+#include <freertos/FreeRTOS.h>                        // cppcheck-suppress missingInclude
+#include <freertos/task.h>                            // cppcheck-suppress missingInclude
+#endif
+
+// Shared WLED UDP listener for all XenopixelLight instances.
+//
+// The latest valid datagram is published through a seqlock: the writer bumps
+// seq_ to an odd value, copies the packet, then bumps it back to even. The
+// packet generation is seq_ / 2, so readers detect new data with one atomic
+// load and take a consistent WledPacket snapshot without locking, or decode
+// the packet in place with visit_if_newer().
+//
+// Two receive modes:
+// - Polling (default): every instance's loop() calls poll(), the first call
+//   per iteration drains the non-blocking socket.
+// - Receive task: a FreeRTOS task pinned to the core not running the BLE
+//   controller blocks in lwip_recv() and publishes as packets arrive. loop()
+//   then costs one atomic load per instance and no syscall.
+//
+// Datagrams come from a WledSocket (wled_socket.h): the LWIP socket on the
+// device, whatever set_socket() installed on the host, where polling is the
+// only mode.
+//
+// Socket options are shared by every instance: the first configured port
+// wins, a multicast group is joined over IGMP, and the allowed source list
+// is the union of all instances' sources (empty = accept any sender).
+// A datagram from a disallowed sender is dropped in drain_() before it is
+// published, so no instance decodes or forwards it.
+
+namespace esphome {
+namespace xenopixel_light {
+
+// Largest UDP payload in a 1500-byte MTU; a full 490-LED DRGB frame
+static constexpr size_t WLED_PACKET_MAX = 1472;
+// Protocol byte plus timeout byte — anything shorter is not WLED
+static constexpr size_t WLED_PACKET_MIN = 2;
+static constexpr uint16_t WLED_DEFAULT_PORT = 21324;
+static constexpr size_t WLED_MAX_SOURCES = 4;
+
+// One received WLED datagram. Trivially copyable so a snapshot can be taken
+// by plain assignment.
+struct WledPacket {
+  uint16_t len{0};
+  uint8_t data[WLED_PACKET_MAX];
+};
+static_assert(std::is_trivially_copyable<WledPacket>::value,
+              "WledPacket must stay trivially copyable");
+
+class WledReceiver {
+ public:
+  // Reader gives up after this many torn reads and retries next loop()
+  static constexpr int MAX_READ_ATTEMPTS = 4;
+
+  static WledReceiver &instance() {
+    static WledReceiver rx;
+    return rx;
+  }
+
+  // Writer side: the polling loop or the receive task, never both
+  void publish(const uint8_t *data, size_t len) {
+    if (len > WLED_PACKET_MAX) len = WLED_PACKET_MAX;
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(latest_.data, data, len);
+    latest_.len = (uint16_t)len;
+    latest_rx_us_ = Instrumentation::now_us();
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  uint32_t generation() const {
+    return seq_.load(std::memory_order_acquire) >> 1;
+  }
+
+  // Reader side. Copies the latest packet into out if its generation differs
+  // from last_gen, and updates last_gen. Returns false when there is nothing
+  // new or the writer kept overwriting the packet mid-read.
+  bool read_if_newer(uint32_t &last_gen, WledPacket &out) const {
+    for (int i = 0; i < MAX_READ_ATTEMPTS; i++) {
+      uint32_t seq = seq_.load(std::memory_order_acquire);
+      if (seq >> 1 == last_gen) return false;
+      if (seq & 1) continue;
+      out.len = latest_.len;
+      memcpy(out.data, latest_.data, out.len);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) != seq) continue;
+      last_gen = seq >> 1;
+      return true;
+    }
+    return false;
+  }
+
+  // Reader side without the copy. Calls fn(data, len) on the latest packet
+  // in place; fn may run more than once and must only write to its own
+  // locals, because a read is discarded if the writer overwrote the packet
+  // meanwhile. Returns true once fn has seen a consistent packet.
+  template<typename F> bool visit_if_newer(uint32_t &last_gen, F &&fn) const {
+    for (int i = 0; i < MAX_READ_ATTEMPTS; i++) {
+      uint32_t seq = seq_.load(std::memory_order_acquire);
+      if (seq >> 1 == last_gen) return false;
+      if (seq & 1) continue;
+      size_t len = latest_.len;
+      if (len > WLED_PACKET_MAX) len = WLED_PACKET_MAX;
+      fn(latest_.data, len);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) != seq) continue;
+      last_gen = seq >> 1;
+      return true;
+    }
+    return false;
+  }
+
+  // When the latest packet was published (instrumentation.h). Only
+  // consistent with the packet when read from inside a visit_if_newer() fn.
+  uint32_t latest_rx_us() const { return latest_rx_us_; }
+
+  // Any instance asking for the task enables it for all of them
+  void request_task() { use_task_ = true; }
+  bool is_task_requested() const { return use_task_; }
+
+  // Only takes effect before the socket is opened; later calls are ignored
+  void set_port(uint16_t port) {
+    if (port_configured_) return;
+    port_ = port;
+    port_configured_ = true;
+  }
+  uint16_t port() const { return port_; }
+
+  // Addresses are stored in network byte order, as lwip delivers them
+  void set_multicast_group(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    multicast_group_ = ipv4_(a, b, c, d);
+  }
+  uint32_t multicast_group() const { return multicast_group_; }
+
+  bool add_allowed_source(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    uint32_t addr = ipv4_(a, b, c, d);
+    if (is_listed_source_(addr)) return true;
+    if (num_sources_ >= WLED_MAX_SOURCES) return false;
+    sources_[num_sources_++] = addr;
+    return true;
+  }
+
+  bool is_source_allowed(uint32_t addr) const {
+    return num_sources_ == 0 || is_listed_source_(addr);
+  }
+
+  // Datagrams dropped because of their sender
+  uint32_t rejected_count() const {
+    return rejected_.load(std::memory_order_relaxed);
+  }
+
+  // Replaces the transport; the next poll() opens it. Host tests use this
+  // to inject datagrams, the device keeps the LWIP socket.
+  void set_socket(WledSocket *socket) {
+    socket_ = socket;
+    open_ = false;
+  }
+
+  // Called from every instance's loop(). Opens the socket once it can (on
+  // the device, once WiFi is connected); in polling mode also drains it.
+  void poll() {
+    if (!ensure_open_()) return;
+#ifndef UNIT_TEST
+    if (task_ != nullptr) return;
+    if (use_task_ && start_task_()) return;
+#endif
+    drain_(false);
+  }
+
+ protected:
+  bool ensure_open_() {
+    if (open_) return true;
+    if (socket_ == nullptr || !socket_->open(port_, multicast_group_))
+      return false;
+    open_ = true;
+    return true;
+  }
+
+  // Receive into the spare scratch buffer; a valid packet from an allowed
+  // sender becomes the latest by flipping the index. The first recv blocks
+  // when asked to (the receive task), the rest of the burst never blocks.
+  // Returns false only if nothing was read at all.
+  bool drain_(bool block_first) {
+    bool read_any = false;
+    uint32_t received = 0;
+    bool block = block_first;
+    for (;;) {
+      uint32_t from = 0;
+      int n = socket_->recv(scratch_[spare_].data, WLED_PACKET_MAX, block, from);
+      if (n <= 0) break;
+      read_any = true;
+      block = false;
+      if (n < (int)WLED_PACKET_MIN) continue;
+      if (!is_source_allowed(from)) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      scratch_[spare_].len = (uint16_t)n;
+      spare_ ^= 1;
+      received++;
+    }
+    if (received == 0) return read_any;
+    Instrumentation::instance().count_drain(received);
+
+    const WledPacket &pkt = scratch_[spare_ ^ 1];
+    publish(pkt.data, pkt.len);
+    ESP_LOGV("xenopixel", "WLED UDP packet: %d bytes, proto=%d timeout=%d",
+             pkt.len, pkt.data[0], pkt.data[1]);
+    return true;
+  }
+
+#ifndef UNIT_TEST
+  bool start_task_() {
+    BaseType_t ok = xTaskCreatePinnedToCore(task_entry_, "wled_rx",
+                                            TASK_STACK_SIZE, this,
+                                            TASK_PRIORITY, &task_, rx_core_());
+    if (ok != pdPASS) {
+      task_ = nullptr;
+      use_task_ = false;
+      ESP_LOGE("xenopixel", "Failed to start WLED receive task, polling");
+      return false;
+    }
+    ESP_LOGI("xenopixel", "WLED receive task started on core %d", rx_core_());
+    return true;
+  }
+
+  static void task_entry_(void *arg) {
+    auto *rx = static_cast<WledReceiver *>(arg);
+    for (;;) {
+      // A blocking recv only comes back empty on a socket error
+      if (!rx->drain_(true)) vTaskDelay(pdMS_TO_TICKS(100));
+    }
+  }
+
+  // The core opposite the BLE controller
+  static BaseType_t rx_core_() {
+#if portNUM_PROCESSORS == 1
+    return 0;
+#elif defined(CONFIG_BT_CTRL_PINNED_TO_CORE)
+    return CONFIG_BT_CTRL_PINNED_TO_CORE == 0 ? 1 : 0;
+#elif defined(CONFIG_BTDM_CTRL_PINNED_TO_CORE)
+    return CONFIG_BTDM_CTRL_PINNED_TO_CORE == 0 ? 1 : 0;
+#else
+    return 1;
+#endif
+  }
+
+  static constexpr uint32_t TASK_STACK_SIZE = 3072;
+  static constexpr UBaseType_t TASK_PRIORITY = 5;
+
+  LwipWledSocket lwip_;
+  TaskHandle_t task_{nullptr};
+#endif
+
+ protected:
+  static uint32_t ipv4_(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    const uint8_t octets[4] = {a, b, c, d};
+    uint32_t addr;
+    memcpy(&addr, octets, sizeof(addr));
+    return addr;
+  }
+
+  bool is_listed_source_(uint32_t addr) const {
+    for (size_t i = 0; i < num_sources_; i++)
+      if (sources_[i] == addr) return true;
+    return false;
+  }
+
+  static WledSocket *default_socket_(WledReceiver *rx) {
+#ifdef UNIT_TEST
+    (void)rx;
+    return nullptr;
+#else
+    return &rx->lwip_;
+#endif
+  }
+
+  WledSocket *socket_{default_socket_(this)};
+  bool open_{false};
+  WledPacket scratch_[2];
+  uint8_t spare_{0};
+  std::atomic<uint32_t> seq_{0};
+  WledPacket latest_;
+  uint32_t latest_rx_us_{0};
+  bool use_task_{false};
+  uint16_t port_{WLED_DEFAULT_PORT};
+  bool port_configured_{false};
+  uint32_t multicast_group_{0};
+  uint32_t sources_[WLED_MAX_SOURCES]{};
+  size_t num_sources_{0};
+  std::atomic<uint32_t> rejected_{0};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef UNIT_TEST
+#include "esphome/core/log.h"                         // cppcheck-suppress missingInclude
+#include "esphome/components/wifi/wifi_component.h"   // cppcheck-suppress missingInclude
+#include <lwip/sockets.h>                             // cppcheck-suppress missingInclude
+#endif
+
+// Datagram transport under WledReceiver (wled_receiver.h).
+//
+// The receiver only needs to open a bound UDP socket and read datagrams with
+// their sender, so that is all this interface offers. On the device it is
+// LwipWledSocket; the host build has no default socket and tests install
+// their own (tests/cpp/mocks/wled_socket_mock.h) to inject packets into
+// the same drain and fan-out path the device runs.
+
+namespace esphome {
+namespace xenopixel_light {
+
+class WledSocket {
+ public:
+  virtual ~WledSocket() = default;
+
+  // Binds port and joins multicast_group (network byte order, 0 for none).
+  // Returns false while the socket cannot be opened yet; the receiver tries
+  // again on its next poll.
+  virtual bool open(uint16_t port, uint32_t multicast_group) = 0;
+
+  // Reads one datagram of at most cap bytes into buf and returns its length,
+  // with the sender's address in network byte order in from. Returns 0 or
+  // less when nothing is waiting (block false) or on a socket error.
+  virtual int recv(uint8_t *buf, size_t cap, bool block, uint32_t &from) = 0;
+};
+
+#ifndef UNIT_TEST
+// Raw LWIP socket with SO_BROADCAST, for ESP32/ESP32-S3 compatibility.
+// Opens once WiFi is connected. Multicast membership needs LWIP_IGMP, which
+// ESP-IDF enables by default.
+class LwipWledSocket : public WledSocket {
+ public:
+  bool open(uint16_t port, uint32_t multicast_group) override {
+    if (fd_ >= 0) return true;
+    if (wifi::global_wifi_component == nullptr ||
+        !wifi::global_wifi_component->is_connected())
+      return false;
+
+    fd_ = lwip_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd_ < 0) {
+      ESP_LOGE("xenopixel", "Failed to create UDP socket");
+      return false;
+    }
+
+    int broadcast = 1;
+    lwip_setsockopt(fd_, SOL_SOCKET, SO_BROADCAST, &broadcast,
+                    sizeof(broadcast));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    if (lwip_bind(fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      ESP_LOGE("xenopixel", "Failed to bind UDP port %d", port);
+      lwip_close(fd_);
+      fd_ = -1;
+      return false;
+    }
+
+    if (multicast_group != 0) {
+      struct ip_mreq mreq = {};
+      mreq.imr_multiaddr.s_addr = multicast_group;
+      mreq.imr_interface.s_addr = INADDR_ANY;
+      if (lwip_setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq,
+                          sizeof(mreq)) < 0) {
+        ESP_LOGW("xenopixel", "Failed to join WLED multicast group");
+      }
+    }
+
+    ESP_LOGI("xenopixel", "WLED UDP listener started on port %d", port);
+    return true;
+  }
+
+  int recv(uint8_t *buf, size_t cap, bool block, uint32_t &from) override {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int n = lwip_recvfrom(fd_, buf, cap, block ? 0 : MSG_DONTWAIT,
+                          (struct sockaddr *)&addr, &addr_len);
+    if (n > 0) from = addr.sin_addr.s_addr;
+    return n;
+  }
+
+ protected:
+  int fd_{-1};
+};
+#endif
+
+}  // namespace xenopixel_light
+}  // namespace esphome
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esphome/components/light/light_effect.h"
+#include "effect_engine.h"
+#include "xenopixel_light.h"
+
+// ESPHome light effects rendered by the saber's own EffectEngine
+// (effect_engine.h) instead of stepping write_state() from apply().
+//
+// start() finds the XenopixelLight behind the LightState and hands it the
+// parameters; apply() does nothing because the light samples the engine
+// from its loop(), paced by the BLE link. On any other light the effect
+// logs a warning and stays idle.
+
+namespace esphome {
+namespace xenopixel_light {
+
+class XenopixelEffect : public light::LightEffect {
+ public:
+  XenopixelEffect(const char *name, EffectKind kind) : LightEffect(name) {
+    params_.kind = kind;
+  }
+
+  void set_period(uint32_t period_ms) { params_.period_ms = period_ms; }
+  // Fraction 0-1 of the brightness to drop at the deepest point
+  void set_depth(float depth) {
+    if (depth < 0.0f) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+    params_.depth = (uint8_t)(depth * 255.0f + 0.5f);
+  }
+  const EffectParams &get_params() const { return params_; }
+
+  void start() override {
+    light_ = XenopixelLight::for_state(state_);
+    if (light_ == nullptr) {
+      ESP_LOGW("xenopixel", "Xenopixel effects only run on xenopixel_light");
+      return;
+    }
+    light_->start_effect(params_);
+  }
+
+  void stop() override {
+    if (light_ != nullptr) light_->stop_effect();
+    light_ = nullptr;
+  }
+
+  void apply() override {}
+
+ protected:
+  EffectParams params_;
+  XenopixelLight *light_{nullptr};
+};
+
+}  // namespace xenopixel_light
+}  // namespace esphome
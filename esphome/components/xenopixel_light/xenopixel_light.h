@@ -1,30 +1,113 @@
 #pragma once
 
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
 #include "esphome/core/component.h"
 #include "esphome/components/ble_client/ble_client.h"
+#include "esphome/components/esp32_ble/ble.h"
 #include "esphome/components/globals/globals_component.h"
 #include "esphome/components/light/light_output.h"
-
-#ifndef UNIT_TEST
-#include "esphome/components/wifi/wifi_component.h"   // cppcheck-suppress missingInclude
-#include <lwip/sockets.h>                             // cppcheck-suppress missingInclude
-#endif
+#include "ble_scheduler.h"
+#include "command_encoder.h"
+#include "conn_params.h"
+#include "dead_band.h"
+#include "effect_engine.h"
+#include "frame_smoother.h"
+#include "gatt_profile.h"
+#include "instrumentation.h"
+#include "link_health.h"
+#include "notification_parser.h"
+#include "rate_limiter.h"
+#include "saber_session.h"
+#include "saber_shadow.h"
+#include "transition_planner.h"
+#include "tx_queue.h"
+#include "wled_hub.h"
+#include "wled_protocol.h"
+#include "wled_receiver.h"
 
 // Custom light output for Xenopixel sabers.
-// Sends separate BLE commands for power, color, and brightness
-// instead of the combined values that ESPHome's built-in RGB light uses.
+// Sends power, color, and brightness as Xenopixel JSON keys instead of the
+// combined values that ESPHome's built-in RGB light uses.
+//
+// The light owns the per-saber glue: write_state(), WLED targets, effects
+// and combat effects only mark fields dirty or queue frames, and loop()
+// flushes dirty fields as one combined frame — probed once against the 3AB1
+// brightness echo, with a fallback to single-key writes — packed to the
+// negotiated ATT MTU. It also routes GATTC events to the handshake, TX queue
+// and notification streams, and sends the keepalive once the link has been
+// idle for its interval.
 //
-// WLED UDP sync: A single static UDP socket is shared across all instances.
-// Each instance's loop() participates — the first to run each iteration reads
-// packets, and every instance with wled_active_ applies the latest packet.
-// A generation counter ensures each instance processes each packet exactly once.
+// Everything else lives in its own module: command_encoder.h (frames),
+// tx_queue.h and ble_scheduler.h (queueing and the shared write budget),
+// rate_limiter.h, dead_band.h and transition_planner.h (what is worth
+// sending), saber_shadow.h (redundancy checks), saber_session.h
+// (handshake), gatt_profile.h (handle cache), conn_params.h (link modes,
+// MTU), link_health.h (retry backoff), notification_parser.h (status
+// streams), wled_receiver.h, wled_hub.h, wled_protocol.h and
+// frame_smoother.h (WLED sync), effect_engine.h and xenopixel_effect.h
+// (light effects) and instrumentation.h (latency traces).
 
 namespace esphome {
 namespace xenopixel_light {
 
-class XenopixelLight : public Component, public light::LightOutput {
+// Field bitmask used as the TX queue coalescing key
+enum TxKey : uint16_t {
+  TX_KEY_POWER = 1 << 0,
+  TX_KEY_BRIGHTNESS = 1 << 1,
+  TX_KEY_COLOR = 1 << 2,
+  TX_KEY_VOLUME = 1 << 3,
+  TX_KEY_SOUND_FONT = 1 << 4,
+  TX_KEY_LIGHT_EFFECT = 1 << 5,
+};
+
+// Served ahead of brightness/color by the write scheduler
+static constexpr uint16_t TX_KEYS_CONTROL =
+    TX_KEY_POWER | TX_KEY_SOUND_FONT | TX_KEY_LIGHT_EFFECT;
+
+// Combat effects, sent through their own lane ahead of everything else.
+// Clash, Blaster and Force are one-shots; Lockup and Drag are toggled.
+enum class CombatEffect : uint8_t { CLASH, BLASTER, FORCE, LOCKUP, DRAG };
+
+class XenopixelLight : public Component,
+                       public light::LightOutput,
+                       public WledSubscriber,
+                       public BleWriteClient,
+                       public esp32_ble::GAPEventHandler {
  public:
-  void set_ble_client(ble_client::BLEClient *client) { ble_client_ = client; }
+  // Lights findable from their LightState, for the effects
+  static constexpr size_t MAX_LIGHTS = 8;
+
+  ~XenopixelLight() override {
+    for (XenopixelLight *&l : lights_())
+      if (l == this) l = nullptr;
+    WledHub::instance().unsubscribe(this);
+    BleWriteScheduler::instance().remove_client(this);
+  }
+
+  struct TxStats {
+    uint32_t enqueued{0};
+    uint32_t coalesced{0};
+    uint32_t dropped{0};
+    uint32_t retried{0};
+    uint32_t requeued{0};
+    uint32_t keepalives{0};
+    uint32_t split{0};  // combined frames split to fit the ATT MTU
+  };
+
+  void set_ble_client(ble_client::BLEClient *client) {
+    ble_client_ = client;
+    if (client == nullptr) return;
+    client->register_ble_node(&gattc_forwarder_);
+    if (!BleWriteScheduler::instance().add_client(this)) {
+      ESP_LOGW("xenopixel", "BLE write scheduler full (%u sabers)",
+               (unsigned)BleWriteScheduler::MAX_CLIENTS);
+    }
+  }
   void set_authorized_global(globals::GlobalsComponent<bool> *g) {
     authorized_global_ = g;
   }
@@ -32,21 +115,290 @@ class XenopixelLight : public Component, public light::LightOutput {
     syncing_global_ = g;
   }
 
+  void set_combine_commands(bool combine) { combine_commands_ = combine; }
+  void set_wled_receive_task(bool enable) {
+    if (enable) WledReceiver::instance().request_task();
+  }
+  void set_color_interval_bounds(uint32_t min_ms, uint32_t max_ms) {
+    color_limiter_.set_bounds(min_ms, max_ms);
+  }
+  // What write_state() sends while an ESPHome transition runs, see
+  // transition_planner.h
+  void set_brightness_transition(TransitionMode mode) {
+    brightness_fade_.set_mode(mode);
+  }
+  void set_color_transition(TransitionMode mode) { color_fade_.set_mode(mode); }
+  void set_transition_keyframes(uint8_t keyframes) {
+    brightness_fade_.set_keyframes(keyframes);
+    color_fade_.set_keyframes(keyframes);
+  }
+  // Percent and redmean distance, 0 = off; see dead_band.h
+  void set_brightness_dead_band(uint16_t percent) {
+    brightness_band_.set_threshold(percent);
+  }
+  void set_color_dead_band(uint16_t distance) {
+    color_band_.set_threshold(distance);
+  }
+  // Socket options are shared by all lights, see wled_receiver.h
+  void set_wled_port(uint16_t port) {
+    WledReceiver::instance().set_port(port);
+  }
+  void set_wled_multicast_group(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    WledReceiver::instance().set_multicast_group(a, b, c, d);
+  }
+  void add_wled_allowed_source(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    WledReceiver::instance().add_allowed_source(a, b, c, d);
+  }
+  // 0 disables the keepalive
+  void set_keepalive_interval(uint32_t interval_ms) {
+    keepalive_interval_ms_ = interval_ms;
+  }
+  uint32_t get_keepalive_interval_ms() const { return keepalive_interval_ms_; }
+  void set_wled_smoothing(uint32_t delay_ms) {
+    smoother_.set_delay_ms(delay_ms);
+  }
+  void set_wled_pixel_window(uint16_t start, uint16_t count) {
+    wled_window_.start = start;
+    wled_window_.count = count > 0 ? count : 1;
+    if (wled_active_) subscribe_wled_();
+  }
+
+  void setup() override {
+    if (esp32_ble::global_ble != nullptr)
+      esp32_ble::global_ble->register_gap_event_handler(this);
+  }
+
   void loop() override {
-#ifndef UNIT_TEST
-    static int udp_fd = -1;
-    static std::vector<uint8_t> latest_packet;
-    static uint32_t packet_gen = 0;
+    WledReceiver::instance().poll();
+    WledHub::instance().service(millis());
+    emit_smoothed_();
+    emit_effect_();
+    check_combine_probe_();
+    release_dead_band_();
+    release_color_();
+    flush_pending_();
+    send_keepalive_if_idle_();
+    BleWriteScheduler::instance().service(millis());
+    update_conn_params_();
+    run_session_(session_.poll(millis()));
+  }
 
-    if (!ensure_udp_started_(udp_fd)) return;
-    drain_udp_packets_(udp_fd, latest_packet, packet_gen);
+  void gattc_event_handler(esp_gattc_cb_event_t event,
+                           esp_ble_gattc_cb_param_t *param) {
+    switch (event) {
+      case ESP_GATTC_CONGEST_EVT:
+        if (ble_client_ == nullptr ||
+            param->congest.conn_id != ble_client_->get_conn_id())
+          break;
+        tx_congested_ = param->congest.congested;
+        if (tx_congested_) color_limiter_.on_write_failed();
+        ESP_LOGD("xenopixel", "BLE TX %s",
+                 tx_congested_ ? "congested" : "resumed");
+        break;
+      case ESP_GATTC_OPEN_EVT:
+        if (ble_client_ == nullptr || param->open.status != ESP_GATT_OK ||
+            memcmp(param->open.remote_bda, ble_client_->get_remote_bda(),
+                   sizeof(esp_bd_addr_t)) != 0)
+          break;
+        session_.connected(millis());
+        break;
+      case ESP_GATTC_CFG_MTU_EVT:
+        if (ble_client_ == nullptr ||
+            param->cfg_mtu.conn_id != ble_client_->get_conn_id())
+          break;
+        // The client runs the exchange and keeps its last good MTU (the
+        // default 23 if none succeeded), so a failed one still counts
+        if (param->cfg_mtu.status != ESP_GATT_OK) {
+          ESP_LOGW("xenopixel", "MTU exchange failed: %d",
+                   (int)param->cfg_mtu.status);
+        }
+        att_mtu_ = ble_client_->get_mtu();
+        ESP_LOGI("xenopixel", "ATT MTU %u, %u bytes per write",
+                 (unsigned)att_mtu_, (unsigned)att_payload(att_mtu_));
+        break;
+      case ESP_GATTC_SEARCH_CMPL_EVT:
+        if (ble_client_ == nullptr ||
+            param->search_cmpl.conn_id != ble_client_->get_conn_id())
+          break;
+        run_session_(session_.services_ready(millis()));
+        break;
+      case ESP_GATTC_WRITE_DESCR_EVT:
+        if (ble_client_ == nullptr ||
+            param->write.conn_id != ble_client_->get_conn_id() ||
+            param->write.handle != indications_cccd_)
+          break;
+        if (param->write.status != ESP_GATT_OK) {
+          ESP_LOGW("xenopixel", "Service Changed CCCD write failed: %d",
+                   (int)param->write.status);
+        }
+        run_session_(session_.indications_enabled(
+            param->write.status == ESP_GATT_OK, millis()));
+        break;
+      case ESP_GATTC_WRITE_CHAR_EVT:
+        if (ble_client_ == nullptr ||
+            param->write.conn_id != ble_client_->get_conn_id())
+          break;
+        if (param->write.status == ESP_GATT_OK) last_tx_ms_ = millis();
+        if (handshake_handle_ != 0 && param->write.handle == handshake_handle_) {
+          if (param->write.status != ESP_GATT_OK) {
+            ESP_LOGW("xenopixel", "HandShake write failed: %d",
+                     (int)param->write.status);
+          }
+          run_session_(session_.handshake_written(
+              param->write.status == ESP_GATT_OK, millis()));
+          break;
+        }
+        if (param->write.handle != char_handle_) break;
+        if (param->write.status == ESP_GATT_INVALID_HANDLE) forget_gatt_();
+        if (!color_write_in_flight_) break;
+        color_write_in_flight_ = false;
+        if (param->write.status == ESP_GATT_OK)
+          color_limiter_.on_write_complete(millis() - color_write_ms_);
+        else
+          color_limiter_.on_write_failed();
+        break;
+      case ESP_GATTC_DISCONNECT_EVT:
+        tx_congested_ = false;
+        color_write_in_flight_ = false;
+        tx_stats_.dropped += tx_queue_.clear();
+        tx_stats_.dropped += effect_queue_.clear();
+        att_mtu_ = 0;
+        status_stream_.reset();
+        reply_stream_.reset();
+        conn_params_requested_ = false;
+        conn_report_ = BleConnReport();
+        gatt_verified_ = false;
+        tx_retry_wait_ms_ = 0;
+        link_health_.reset_window();
+        session_.disconnected();
+        shadow_.clear();
+        brightness_band_.clear();
+        color_band_.clear();
+        if (authorized_global_ != nullptr) authorized_global_->value() = false;
+        break;
+      case ESP_GATTC_SRVC_CHG_EVT:
+        if (ble_client_ == nullptr ||
+            memcmp(param->srvc_chg.remote_bda, ble_client_->get_remote_bda(),
+                   sizeof(esp_bd_addr_t)) != 0)
+          break;
+        ESP_LOGI("xenopixel", "Service Changed, dropping cached GATT handles");
+        forget_gatt_();
+        break;
+      default:
+        break;
+    }
+  }
 
-    if (wled_active_ && packet_gen != last_seen_gen_ &&
-        latest_packet.size() >= 6) {
-      apply_wled_packet(latest_packet);
-      last_seen_gen_ = packet_gen;
+  // Updates are reported for every connection; only this saber's are kept,
+  // whether we asked for them or the peer did
+  void gap_event_handler(esp_gap_ble_cb_event_t event,
+                         esp_ble_gap_cb_param_t *param) override {
+    if (event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT || ble_client_ == nullptr)
+      return;
+    const auto &u = param->update_conn_params;
+    if (memcmp(u.bda, ble_client_->get_remote_bda(), sizeof(esp_bd_addr_t)) != 0)
+      return;
+    if (u.status != ESP_BT_STATUS_SUCCESS) {
+      ESP_LOGW("xenopixel", "Connection parameter update failed: %d",
+               (int)u.status);
+      return;
     }
-#endif
+    conn_report_.valid = true;
+    conn_report_.interval = u.conn_int;
+    conn_report_.latency = u.latency;
+    conn_report_.timeout = u.timeout;
+    ESP_LOGI("xenopixel",
+             "Connection interval %.2fms, latency %u, timeout %ums "
+             "(%u events/s)",
+             conn_report_.interval_ms(), (unsigned)u.latency,
+             (unsigned)u.timeout * 10,
+             (unsigned)conn_report_.events_per_second());
+  }
+
+  const BleConnReport &get_conn_report() const { return conn_report_; }
+  // NAN until the peer has reported parameters, for a template sensor
+  float get_conn_interval_ms() const {
+    return conn_report_.valid ? conn_report_.interval_ms() : NAN;
+  }
+
+  // 0 until the MTU exchange of this connection has completed
+  uint16_t get_att_mtu() const { return att_mtu_; }
+
+  const TxStats &get_tx_stats() const { return tx_stats_; }
+  const BleLinkHealth &get_link_health() const { return link_health_; }
+  // Successful share of the last writes in percent; NAN before the first
+  // write of a connection, for a template sensor
+  float get_link_health_percent() const {
+    return link_health_.success_ratio() * 100.0f;
+  }
+  bool is_tx_congested() const { return tx_congested_; }
+  uint32_t get_color_interval_ms() const { return color_limiter_.interval_ms(); }
+
+  void setup_state(light::LightState *state) override {
+    state_ = state;
+    for (XenopixelLight *l : lights_())
+      if (l == this) return;
+    for (XenopixelLight *&l : lights_()) {
+      if (l != nullptr) continue;
+      l = this;
+      return;
+    }
+    ESP_LOGW("xenopixel", "More than %u lights, effects unavailable",
+             (unsigned)MAX_LIGHTS);
+  }
+
+  static XenopixelLight *for_state(light::LightState *state) {
+    if (state == nullptr) return nullptr;
+    for (XenopixelLight *l : lights_())
+      if (l != nullptr && l->state_ == state) return l;
+    return nullptr;
+  }
+
+  // XenopixelGroup: frames are held back from the scheduler until
+  // release_writes(), which lets every member go in the same interval
+  void hold_writes() { BleWriteScheduler::instance().hold(this); }
+  void release_writes() {
+    BleWriteScheduler::instance().release(this);
+    group_stamp_pending_ = !tx_queue_.empty();
+    group_wrote_ = false;
+  }
+  // Anything write_state() asked for that is not in the TX queue yet
+  bool has_unflushed_commands() const {
+    return pending_.any() || color_waiting_;
+  }
+  // Waiting for the first write since release_writes()
+  bool awaiting_group_write() const { return group_stamp_pending_; }
+  // micros() of that write; false when nothing was queued at the release
+  bool group_write_us(uint32_t &us) const {
+    if (!group_wrote_) return false;
+    us = group_write_us_;
+    return true;
+  }
+
+  // Called by XenopixelEffect; the first frame goes out on the next loop()
+  void start_effect(const EffectParams &params) {
+    effect_.start(params, millis());
+    effect_has_emitted_ = false;
+  }
+
+  // Puts the blade back on the base brightness and color
+  void stop_effect() {
+    if (!effect_.active()) return;
+    effect_.stop();
+    if (!is_ready_for_commands_() || !is_on_()) return;
+    const EffectEngine::Frame &base = effect_.base();
+    send_brightness_if_changed_(base.brightness);
+    send_color_if_changed_(base.r, base.g, base.b);
+  }
+
+  bool is_effect_running() const { return effect_.active(); }
+  EffectKind get_effect_kind() const { return effect_.kind(); }
+
+  // Flashes the blade if the pulse effect is running, e.g. on a clash
+  void pulse_effect() {
+    if (effect_.kind() != EffectKind::PULSE) return;
+    effect_.pulse(millis());
+    effect_has_emitted_ = false;
   }
 
   light::LightTraits get_traits() override {
@@ -56,26 +408,46 @@ class XenopixelLight : public Component, public light::LightOutput {
   }
 
   void apply_wled_packet(const std::vector<uint8_t> &data) {
-    if (data.size() < 6 || data[0] != 0) return;
+    apply_wled_packet(data.data(), data.size());
+  }
 
-    // Only check authorization, not syncing — WLED packets should not be
-    // blocked by the syncing_from_notification flag (that's for HA feedback)
-    if (authorized_global_ == nullptr || !authorized_global_->value()) return;
+  // Applies one packet to this saber only, bypassing the hub's fan-out
+  void apply_wled_packet(const uint8_t *data, size_t len) {
+    if (!WledHub::instance().admit(data, len, millis())) return;
+    uint32_t rx_us = Instrumentation::now_us();
+    WledTarget target = WledDecoder::decode(data, len, wled_window_);
+    wled_trace_ = Instrumentation::instance().decoded(rx_us);
+    apply_wled_target_(target);
+  }
 
-    uint8_t wled_bri = data[2];
-    uint8_t r = data[3], g = data[4], b = data[5];
+  void on_wled_target(const WledTarget &target) override {
+    if (!wled_active_) return;
+    wled_trace_ = WledHub::instance().delivery_trace();
+    apply_wled_target_(target);
+  }
 
-    bool power_on = (wled_bri > 0);
-    send_power_if_changed_(power_on);
-    if (!power_on) return;
+  // The hub holds a saber's target until its connection has write budget
+  bool wled_ready() override {
+    return BleWriteScheduler::instance().has_budget(this, millis());
+  }
 
-    send_brightness_if_changed_((wled_bri * 100) / 255);
-    send_color_if_changed_(r, g, b);
+  // True while a realtime stream's timeout has not expired (shared by all
+  // sabers)
+  bool is_wled_realtime() const {
+    return WledHub::instance().is_realtime(millis());
   }
 
   void set_wled_active(bool active) {
     wled_active_ = active;
+    if (active) {
+      subscribe_wled_();
+    } else {
+      WledHub::instance().unsubscribe(this);
+      smoother_.reset();
+      smoothing_ = false;
+    }
     ESP_LOGI("xenopixel", "WLED sync %s", active ? "enabled" : "disabled");
+    update_conn_params_();
   }
 
   bool is_wled_active() const { return wled_active_; }
@@ -84,86 +456,521 @@ class XenopixelLight : public Component, public light::LightOutput {
     if (!is_ready_for_commands_()) return;
     if (wled_active_) return;
 
-    bool is_on = state->current_values.is_on();
-    float brightness = state->current_values.get_brightness();
-    float r, g, b;
-    state->current_values.as_rgb(&r, &g, &b);
-    recover_rgb_(&r, &g, &b, brightness, is_on);
+    bool is_on, to_on;
+    int brightness, to_brightness;
+    int rgb[3], to_rgb[3];
+    read_values_(state->current_values, &is_on, &brightness, rgb);
+    read_values_(state->remote_values, &to_on, &to_brightness, to_rgb);
+    if (is_on == to_on && brightness == to_brightness && rgb[0] == to_rgb[0] &&
+        rgb[1] == to_rgb[1] && rgb[2] == to_rgb[2]) {
+      brightness_fade_.reset();
+      color_fade_.reset();
+      send_power_if_changed_(is_on);
+      if (!is_on) return;
+      effect_.set_base((uint8_t)brightness, (uint8_t)rgb[0], (uint8_t)rgb[1],
+                       (uint8_t)rgb[2]);
+      if (effect_.active()) return;
+      send_brightness_banded_(brightness);
+      send_color_banded_(rgb[0], rgb[1], rgb[2]);
+      return;
+    }
+    write_transition_step_(is_on, brightness, rgb, to_on, to_brightness,
+                           to_rgb);
+  }
 
-    send_power_if_changed_(is_on);
-    if (!is_on) return;
+  // Registers for and enables Service Changed indications, which the saber
+  // requires before it answers the handshake. Cached handles are verified on
+  // the first call of each connection. The session reports the write
+  // response with ESP_GATTC_WRITE_DESCR_EVT.
+  bool enable_service_changed_indications() {
+    if (ble_client_ == nullptr) return false;
+    auto gattc_if = ble_client_->get_gattc_if();
+    auto conn_id = ble_client_->get_conn_id();
+    const SaberGattHandles *h = SaberGattProfile::instance().acquire(
+        gattc_if, conn_id, ble_client_->get_remote_bda(), !gatt_verified_);
+    if (h == nullptr) {
+      ESP_LOGE("xenopixel", "Could not find 0x2A05 and its CCCD");
+      return false;
+    }
+    gatt_verified_ = true;
+    ESP_LOGD("xenopixel", "0x2A05 at handle %u, CCCD at %u",
+             (unsigned)h->service_changed, (unsigned)h->service_changed_cccd);
+
+    esp_ble_gattc_register_for_notify(gattc_if, ble_client_->get_remote_bda(),
+                                      h->service_changed);
+    indications_cccd_ = h->service_changed_cccd;
+    uint8_t indicate_val[] = {0x02, 0x00};
+    esp_err_t err = esp_ble_gattc_write_char_descr(
+        gattc_if, conn_id, h->service_changed_cccd, sizeof(indicate_val),
+        indicate_val, ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE);
+    if (err != ESP_OK) {
+      ESP_LOGE("xenopixel", "Failed to write CCCD: %d", err);
+      forget_gatt_();
+      return false;
+    }
+    return true;
+  }
+
+  // Called from the 3AB1 notification handler on AccessAllowed
+  void confirm_authorized() {
+    bool was_authorized = session_.is_authorized();
+    session_.access_allowed(millis());
+    if (authorized_global_ != nullptr) authorized_global_->value() = true;
+    // The handshake counts as activity
+    last_tx_ms_ = millis();
+    if (!was_authorized && session_.is_authorized()) {
+      ESP_LOGI("xenopixel", "Authorized %ums after connecting",
+               (unsigned)session_.time_to_authorized_ms());
+    }
+  }
 
-    send_brightness_if_changed_((int)(brightness * 100.0f));
-    send_color_if_changed_((int)(r * 255.0f), (int)(g * 255.0f),
-                           (int)(b * 255.0f));
+  const SaberSession &get_session() const { return session_; }
+  // NAN until a session has been authorized, for a template sensor
+  float get_time_to_authorized_ms() const {
+    return session_.has_time_to_authorized()
+               ? (float)session_.time_to_authorized_ms()
+               : NAN;
   }
 
-  void reset_handle() { char_handle_ = 0; }
+  // Handles for this saber are known from an earlier connection
+  bool has_gatt_profile() const {
+    return ble_client_ != nullptr &&
+           SaberGattProfile::instance().find(SaberGattProfile::mac_key(
+               ble_client_->get_remote_bda())) != nullptr;
+  }
 
-  // Update cached power state from notification handler to prevent
-  // write_state() from echoing the same command back to the saber.
-  void update_cached_power(bool on) { last_on_ = on; }
+  void reset_handle() {
+    char_handle_ = 0;
+    handshake_handle_ = 0;
+    // A disconnect mid-probe says nothing about combined-frame support
+    if (combine_state_ == CombineState::PROBING)
+      combine_state_ = CombineState::UNVERIFIED;
+  }
 
- protected:
-#ifndef UNIT_TEST
-  // Start the shared UDP listener once WiFi is connected.
-  // Uses raw LWIP sockets with SO_BROADCAST for ESP32/ESP32-S3 compatibility.
-  static bool ensure_udp_started_(int &fd) {
-    if (fd >= 0) return true;
-    if (wifi::global_wifi_component == nullptr ||
-        !wifi::global_wifi_component->is_connected())
-      return false;
+  // Values reported by the saber, from the DAE1 notification handler. Call
+  // these before updating the entity, so that the write_state() or
+  // set_action it triggers finds nothing to send. Each returns true when
+  // the value differs from what the shadow held.
+  bool update_cached_power(bool on) {
+    return shadow_.confirm(ShadowKey::POWER_ON, on);
+  }
+  bool update_cached_brightness(int val) {
+    return shadow_.confirm(ShadowKey::BRIGHTNESS, val);
+  }
+  bool update_cached_color(int r, int g, int b) {
+    return shadow_.confirm(ShadowKey::BACKGROUND_COLOR,
+                           SaberShadowState::pack_rgb(r, g, b));
+  }
+  bool update_cached_volume(int val) {
+    return shadow_.confirm(ShadowKey::VOLUME, val);
+  }
+  bool update_cached_sound_font(int val) {
+    return shadow_.confirm(ShadowKey::SOUND_FONT, val);
+  }
+  bool update_cached_light_effect(int val) {
+    return shadow_.confirm(ShadowKey::LIGHT_EFFECT, val);
+  }
+
+  // Settings from the number entities. Queued only once authorized and
+  // only when the saber does not already have the value; true when a
+  // frame was queued.
+  bool send_volume(int val) {
+    return send_setting_(ShadowKey::VOLUME, val, TX_KEY_VOLUME, [val] {
+      return CommandFrame().add(CMD_VOLUME, val);
+    });
+  }
+  bool send_sound_font(int val) {
+    return send_setting_(ShadowKey::SOUND_FONT, val, TX_KEY_SOUND_FONT, [val] {
+      return CommandFrame().add(CMD_SOUND_FONT, val);
+    });
+  }
+  bool send_light_effect(int val) {
+    return send_setting_(ShadowKey::LIGHT_EFFECT, val, TX_KEY_LIGHT_EFFECT,
+                         [val] { return CommandFrame().add(CMD_LIGHT_EFFECT, val); });
+  }
 
-    fd = lwip_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (fd < 0) {
-      ESP_LOGE("xenopixel", "Failed to create UDP socket");
+  // Combat effects from the buttons and switches; on only matters for
+  // Lockup and Drag. They skip the TX queue for a lane of their own that
+  // the scheduler serves before power, brightness and color, and are
+  // written at once when the interval's budget allows, so a clash never
+  // waits behind a color stream. Repeats of an effect not yet written
+  // coalesce. True when queued.
+  bool trigger_effect(CombatEffect effect, bool on = true) {
+    if (authorized_global_ == nullptr || !authorized_global_->value())
+      return false;
+    if (ble_client_ == nullptr) return false;
+    CommandFrame frame = combat_frame_(effect, on);
+    auto encode = [&frame](char *buf, size_t cap) {
+      return frame.write(buf, cap);
+    };
+    EffectTrace trace;
+    trace.press_us = micros();
+    if (effect_queue_.emplace((uint16_t)(1u << (uint8_t)effect), encode,
+                              trace) == EffectTxQueue::Push::DROPPED) {
+      tx_stats_.dropped++;
       return false;
     }
+    if (effect == CombatEffect::CLASH) pulse_effect();
+    BleWriteScheduler::instance().service(millis());
+    return true;
+  }
 
-    int broadcast = 1;
-    lwip_setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &broadcast,
-                    sizeof(broadcast));
+  // trigger_effect() to the write reaching the BLE stack
+  const LatencyHistogram &get_effect_latency() const { return effect_latency_; }
+  float get_effect_latency_ms() const {
+    return last_effect_latency_us_ / 1000.0f;
+  }
 
-    // Non-blocking so drain loop doesn't stall the main loop
-    int flags = lwip_fcntl(fd, F_GETFL, 0);
-    lwip_fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  const SaberShadowState &get_shadow() const { return shadow_; }
 
-    struct sockaddr_in addr = {};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(21324);
-    addr.sin_addr.s_addr = INADDR_ANY;
-    if (lwip_bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-      ESP_LOGE("xenopixel", "Failed to bind UDP port 21324");
-      lwip_close(fd);
-      fd = -1;
-      return false;
+  // Notification parsers for the DAE1 status dumps and the 3AB1 replies, so
+  // a dump split across notifications is put back together. Reset on
+  // disconnect.
+  XenopixelNotificationStream &get_status_stream() { return status_stream_; }
+  XenopixelNotificationStream &get_reply_stream() { return reply_stream_; }
+
+  // Called from the 3AB1 notification handler with each brightness
+  // confirmation. Settles an outstanding combined-frame probe.
+  void confirm_brightness(int val) {
+    shadow_.confirm(ShadowKey::BRIGHTNESS, val);
+    if (combine_state_ == CombineState::PROBING && val == probe_brightness_) {
+      combine_state_ = CombineState::CONFIRMED;
+      ESP_LOGI("xenopixel", "Saber accepts combined command frames");
+    }
+  }
+
+  bool is_combining_commands() const {
+    return combine_commands_ && combine_state_ != CombineState::REJECTED;
+  }
+
+ protected:
+  static constexpr uint32_t COMBINE_PROBE_TIMEOUT_MS = 1500;
+  // A slower link mode must hold this long before it is requested, so a
+  // quick off/on does not cost two parameter updates
+  static constexpr uint32_t CONN_PARAMS_SETTLE_MS = 2000;
+
+  static constexpr uint32_t DEFAULT_KEEPALIVE_INTERVAL_MS = 30000;
+
+  static constexpr size_t TX_QUEUE_SIZE = 8;
+  static constexpr size_t TX_FRAME_SIZE = 96;
+  static constexpr uint8_t MAX_TX_RETRIES = 3;
+
+  using LightTxQueue = TxQueue<TX_QUEUE_SIZE, TX_FRAME_SIZE, LatencyTrace>;
+
+  // One slot per CombatEffect is enough; [2,{"Lockup":false}] is the
+  // longest frame
+  static constexpr size_t EFFECT_QUEUE_SIZE = 8;
+  static constexpr size_t EFFECT_FRAME_SIZE = 24;
+  struct EffectTrace {
+    uint32_t press_us{0};
+  };
+  using EffectTxQueue =
+      TxQueue<EFFECT_QUEUE_SIZE, EFFECT_FRAME_SIZE, EffectTrace>;
+
+  static CommandFrame combat_frame_(CombatEffect effect, bool on) {
+    switch (effect) {
+      case CombatEffect::CLASH:
+        return CommandFrame().add(CMD_CLASH, true);
+      case CombatEffect::BLASTER:
+        return CommandFrame().add(CMD_BLASTER, true);
+      case CombatEffect::FORCE:
+        return CommandFrame().add(CMD_FORCE, true);
+      case CombatEffect::LOCKUP:
+        return CommandFrame().add(CMD_LOCKUP, on);
+      case CombatEffect::DRAG:
+        break;
+    }
+    return CommandFrame().add(CMD_DRAG, on);
+  }
+
+  enum class CombineState : uint8_t { UNVERIFIED, PROBING, CONFIRMED, REJECTED };
+
+  // BLEClient also calls loop() on its nodes, so the light registers this
+  // forwarder instead of itself to receive GATTC events.
+  class GattcForwarder : public ble_client::BLEClientNode {
+   public:
+    explicit GattcForwarder(XenopixelLight *light) : light_(light) {}
+    void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t,
+                             esp_ble_gattc_cb_param_t *param) override {
+      light_->gattc_event_handler(event, param);
+    }
+
+   protected:
+    XenopixelLight *light_;
+  };
+
+  // Dirty fields collected since the last loop() tick
+  struct PendingCommand {
+    bool power{false};
+    bool brightness{false};
+    bool color{false};
+    bool on{false};
+    int brightness_val{0};
+    int r{0}, g{0}, b{0};
+
+    bool any() const { return power || brightness || color; }
+    int count() const { return (int)power + (int)brightness + (int)color; }
+    uint16_t key() const {
+      return (power ? TX_KEY_POWER : 0) | (brightness ? TX_KEY_BRIGHTNESS : 0) |
+             (color ? TX_KEY_COLOR : 0);
+    }
+  };
+
+  BleLinkMode wanted_link_mode_() const {
+    if (wled_active_) return BleLinkMode::REALTIME;
+    return is_on_() ? BleLinkMode::ACTIVE : BleLinkMode::IDLE;
+  }
+
+  void update_conn_params_() {
+    uint32_t now = millis();
+    BleLinkMode mode = wanted_link_mode_();
+    if (mode != link_mode_) {
+      link_mode_ = mode;
+      link_mode_since_ms_ = now;
+    }
+    if (ble_client_ == nullptr || authorized_global_ == nullptr ||
+        !authorized_global_->value())
+      return;
+    if (conn_params_requested_) {
+      if (mode == requested_mode_) return;
+      if (mode < requested_mode_ &&
+          now - link_mode_since_ms_ < CONN_PARAMS_SETTLE_MS)
+        return;
+    }
+
+    BleConnParams p = conn_params_for(mode);
+    esp_ble_conn_update_params_t req{};
+    memcpy(req.bda, ble_client_->get_remote_bda(), sizeof(esp_bd_addr_t));
+    req.min_int = p.min_int;
+    req.max_int = p.max_int;
+    req.latency = p.latency;
+    req.timeout = p.timeout;
+    // Not retried on failure; the next mode change asks again
+    conn_params_requested_ = true;
+    requested_mode_ = mode;
+    esp_err_t err = esp_ble_gap_update_conn_params(&req);
+    if (err != ESP_OK) {
+      ESP_LOGW("xenopixel", "Connection parameter request failed: %d", err);
+      return;
+    }
+    ESP_LOGD("xenopixel", "Requested %s connection interval %.2f-%.2fms",
+             link_mode_name(mode), p.min_int * 1.25f, p.max_int * 1.25f);
+  }
+
+  void run_session_(SessionAction action) {
+    if (action == SessionAction::NONE || ble_client_ == nullptr) return;
+    uint32_t now = millis();
+    switch (action) {
+      case SessionAction::ENABLE_INDICATIONS:
+        ESP_LOGD("xenopixel", "Enabling Service Changed indications");
+        if (!enable_service_changed_indications())
+          run_session_(session_.indications_enabled(false, now));
+        break;
+      case SessionAction::SEND_HANDSHAKE:
+        ESP_LOGD("xenopixel", "Sending HandShake to DAE1");
+        if (!write_handshake_())
+          run_session_(session_.handshake_written(false, now));
+        break;
+      case SessionAction::SEND_AUTHORIZE:
+        ESP_LOGD("xenopixel", "Sending Authorize to 3AB1");
+        if (!write_authorize_()) run_session_(session_.authorize_failed(now));
+        break;
+      case SessionAction::GIVE_UP:
+        ESP_LOGW("xenopixel", "Handshake failed, disconnecting");
+        ble_client_->disconnect();
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Write request: the response arrives as ESP_GATTC_WRITE_CHAR_EVT on the
+  // DAE1 handle
+  bool write_handshake_() {
+    if (handshake_handle_ == 0) {
+      const SaberGattHandles *h = SaberGattProfile::instance().find(
+          SaberGattProfile::mac_key(ble_client_->get_remote_bda()));
+      if (h != nullptr && h->dae1 != 0) {
+        handshake_handle_ = h->dae1;
+      } else {
+        auto chr = ble_client_->get_characteristic(
+            esp32_ble_tracker::ESPBTUUID::from_raw(
+                "0000dae0-0000-1000-8000-00805f9b34fb"),
+            esp32_ble_tracker::ESPBTUUID::from_raw(
+                "0000dae1-0000-1000-8000-00805f9b34fb"));
+        if (chr == nullptr) {
+          ESP_LOGW("xenopixel", "DAE1 characteristic not found");
+          return false;
+        }
+        handshake_handle_ = chr->handle;
+      }
     }
+    auto status = esp_ble_gattc_write_char(
+        ble_client_->get_gattc_if(), ble_client_->get_conn_id(),
+        handshake_handle_, sizeof(SESSION_HANDSHAKE_FRAME) - 1,
+        (uint8_t *)SESSION_HANDSHAKE_FRAME, ESP_GATT_WRITE_TYPE_RSP,
+        ESP_GATT_AUTH_REQ_NONE);
+    return status == ESP_OK;
+  }
 
-    ESP_LOGI("xenopixel", "WLED UDP listener started on port 21324");
+  bool write_authorize_() {
+    if (!resolve_char_handle_()) return false;
+    auto status = esp_ble_gattc_write_char(
+        ble_client_->get_gattc_if(), ble_client_->get_conn_id(), char_handle_,
+        sizeof(SESSION_AUTHORIZE_FRAME) - 1, (uint8_t *)SESSION_AUTHORIZE_FRAME,
+        ESP_GATT_WRITE_TYPE_NO_RSP, ESP_GATT_AUTH_REQ_NONE);
+    return status == ESP_OK;
+  }
+
+  // Nothing is sent while real traffic is queued; that traffic resets the
+  // idle timer itself once it is written
+  void send_keepalive_if_idle_() {
+    if (keepalive_interval_ms_ == 0 || ble_client_ == nullptr) return;
+    if (authorized_global_ == nullptr || !authorized_global_->value()) return;
+    if (pending_.any() || color_waiting_ || !tx_queue_.empty() ||
+        !effect_queue_.empty())
+      return;
+    uint32_t now = millis();
+    if (now - last_tx_ms_ < keepalive_interval_ms_) return;
+
+    CommandFrame frame;
+    uint16_t key = keepalive_frame_(frame);
+    if (key == 0) return;
+    // Counted as activity right away so a slow write is not doubled up
+    last_tx_ms_ = now;
+    tx_stats_.keepalives++;
+    send_frame_(frame, key);
+  }
+
+  // Shortest idempotent frame for the known state: the current brightness,
+  // or PowerOn:false for a dark blade. PowerOn:true is never re-sent, since
+  // it would replay the ignition. Returns the frame's TX key, or 0 when
+  // nothing is known yet.
+  uint16_t keepalive_frame_(CommandFrame &out) const {
+    CommandFrame brightness, power_off;
+    if (shadow_.known(ShadowKey::BRIGHTNESS))
+      brightness.add(CMD_BRIGHTNESS, (int)shadow_.value(ShadowKey::BRIGHTNESS));
+    if (!is_on_()) power_off.add(CMD_POWER_ON, false);
+    bool use_power = power_off.size() != 0 &&
+                     (brightness.size() == 0 ||
+                      power_off.size() < brightness.size());
+    if (use_power) {
+      out = power_off;
+      return TX_KEY_POWER;
+    }
+    if (brightness.size() == 0) return 0;
+    out = brightness;
+    return TX_KEY_BRIGHTNESS;
+  }
+
+  // A blade the saber never reported is taken as off
+  bool is_on_() const { return shadow_.value(ShadowKey::POWER_ON) != 0; }
+
+  template<typename F>
+  bool send_setting_(ShadowKey key, int val, uint16_t tx_key, F frame) {
+    if (authorized_global_ == nullptr || !authorized_global_->value())
+      return false;
+    if (!shadow_.want(key, val)) return false;
+    send_frame_(frame(), tx_key);
     return true;
   }
 
-  // Drain all queued UDP packets, keeping only the latest valid one.
-  static void drain_udp_packets_(int fd,
-                                 std::vector<uint8_t> &latest_packet,
-                                 uint32_t &packet_gen) {
-    uint8_t buf[256];
-    int latest_len = 0;
-    int n;
-    while ((n = lwip_recv(fd, buf, sizeof(buf), 0)) > 0) {
-      if (n >= 6)
-        latest_len = n;
+  void subscribe_wled_() {
+    if (!WledHub::instance().subscribe(this, wled_window_)) {
+      ESP_LOGW("xenopixel", "WLED hub full (%u sabers), sync not started",
+               (unsigned)WledHub::MAX_SUBSCRIBERS);
+    }
+  }
+
+  // Realtime admission is done by the hub before a target gets here
+  void apply_wled_target_(const WledTarget &t) {
+    if (t.kind == WledTarget::NONE) return;
+
+    // Only check authorization, not syncing — WLED packets should not be
+    // blocked by the syncing_from_notification flag (that's for HA feedback)
+    if (authorized_global_ == nullptr || !authorized_global_->value()) return;
+
+    if (t.kind == WledTarget::REALTIME) {
+      if (t.bri > 0) send_power_if_changed_(true);
+      if (!is_on_()) return;
+      apply_wled_level_(t);
+      return;
     }
-    if (latest_len > 0) {
-      latest_packet.assign(buf, buf + latest_len);
-      packet_gen++;
-      ESP_LOGD("xenopixel",
-               "WLED UDP packet: %d bytes, proto=%d bri=%d rgb=[%d,%d,%d]",
-               latest_len, latest_packet[0], latest_packet[2],
-               latest_packet[3], latest_packet[4], latest_packet[5]);
+
+    // A notifier target queued before a realtime stream started
+    if (is_wled_realtime()) return;
+
+    bool power_on = (t.bri > 0);
+    send_power_if_changed_(power_on);
+    if (!power_on) {
+      smoother_.reset();
+      return;
     }
+    apply_wled_level_(t);
+  }
+
+  // Power is never smoothed; brightness and color go through the smoother
+  // when it is enabled
+  void apply_wled_level_(const WledTarget &t) {
+    if (smoother_.enabled()) {
+      smoother_.push(millis(), t.bri, t.r, t.g, t.b);
+      smoothing_ = true;
+      return;
+    }
+    send_wled_level_(t.bri, t.r, t.g, t.b);
+  }
+
+  void send_wled_level_(uint8_t bri, uint8_t r, uint8_t g, uint8_t b) {
+    send_brightness_banded_((bri * 100) / 255);
+    if (bri > 0) send_color_banded_(r, g, b);
+  }
+
+  // Sample the smoother once per color interval. While frames are still
+  // queued or the stack is congested the sample is skipped — the next one
+  // supersedes it anyway.
+  void emit_smoothed_() {
+    if (!smoothing_) return;
+    if (!is_on_()) {
+      smoothing_ = false;
+      return;
+    }
+    uint32_t now = millis();
+    if (smooth_has_emitted_ &&
+        now - smooth_emit_ms_ < color_limiter_.interval_ms())
+      return;
+    if (tx_congested_ || !tx_queue_.empty()) return;
+
+    FrameSmoother::Frame f;
+    if (!smoother_.sample(now, f)) return;
+    smooth_emit_ms_ = now;
+    smooth_has_emitted_ = true;
+    send_wled_level_(f.bri, f.r, f.g, f.b);
+    if (smoother_.settled(now)) smoothing_ = false;
+  }
+
+  // Sample the effect once per color interval, on the same terms as the
+  // smoother. Equal samples are dropped by the shadow.
+  void emit_effect_() {
+    if (!effect_.active() || wled_active_) return;
+    if (!is_on_() || !is_ready_for_commands_()) return;
+    uint32_t now = millis();
+    if (effect_has_emitted_ &&
+        now - effect_emit_ms_ < color_limiter_.interval_ms())
+      return;
+    if (tx_congested_ || !tx_queue_.empty()) return;
+
+    EffectEngine::Frame f;
+    if (!effect_.render(now, f)) return;
+    effect_emit_ms_ = now;
+    effect_has_emitted_ = true;
+    send_brightness_if_changed_(f.brightness);
+    send_color_if_changed_(f.r, f.g, f.b);
+  }
+
+  static XenopixelLight *(&lights_())[MAX_LIGHTS] {
+    static XenopixelLight *lights[MAX_LIGHTS] = {};
+    return lights;
   }
-#endif
 
   bool is_ready_for_commands_() {
     if (syncing_global_ != nullptr && syncing_global_->value()) return false;
@@ -172,6 +979,46 @@ class XenopixelLight : public Component, public light::LightOutput {
     return true;
   }
 
+  // Power, brightness percent and raw 0-255 color of one LightColorValues
+  static void read_values_(const light::LightColorValues &values, bool *is_on,
+                           int *brightness, int *rgb) {
+    *is_on = values.is_on();
+    float level = values.get_brightness();
+    float r, g, b;
+    values.as_rgb(&r, &g, &b);
+    recover_rgb_(&r, &g, &b, level, *is_on);
+    *brightness = (int)(level * 100.0f);
+    rgb[0] = (int)(r * 255.0f);
+    rgb[1] = (int)(g * 255.0f);
+    rgb[2] = (int)(b * 255.0f);
+  }
+
+  // One interpolated write_state() of a transition; the planners pick what
+  // to send. The last call, with current_values at the target, takes the
+  // plain path and sends the target whatever was skipped. A fade to off
+  // sends power off right away when brightness jumps to the target, and
+  // never sends a 0% keyframe otherwise.
+  void write_transition_step_(bool is_on, int brightness, const int (&rgb)[3],
+                              bool to_on, int to_brightness,
+                              const int (&to_rgb)[3]) {
+    bool power = brightness_fade_.mode() == TransitionMode::TARGET ? to_on
+                                                                   : is_on;
+    send_power_if_changed_(power);
+    if (!power) return;
+
+    effect_.set_base((uint8_t)brightness, (uint8_t)rgb[0], (uint8_t)rgb[1],
+                     (uint8_t)rgb[2]);
+    if (effect_.active()) return;
+    const int from_level[1] = {is_on ? brightness : 0};
+    const int to_level[1] = {to_on ? to_brightness : 0};
+    int level[1];
+    if (brightness_fade_.step(from_level, to_level, level) && level[0] > 0)
+      send_brightness_if_changed_(level[0]);
+    int color[3];
+    if (color_fade_.step(rgb, to_rgb, color))
+      send_color_if_changed_(color[0], color[1], color[2]);
+  }
+
   // as_rgb() bakes brightness in; recover raw color by dividing it out
   static void recover_rgb_(float *r, float *g, float *b, float brightness,
                            bool is_on) {
@@ -190,79 +1037,491 @@ class XenopixelLight : public Component, public light::LightOutput {
   }
 
   void send_power_if_changed_(bool is_on) {
-    if (is_on != last_on_) {
-      static const char on_cmd[] = "[2,{\"PowerOn\":true}]";
-      static const char off_cmd[] = "[2,{\"PowerOn\":false}]";
-      if (is_on)
-        send_command_(on_cmd, sizeof(on_cmd) - 1);
-      else
-        send_command_(off_cmd, sizeof(off_cmd) - 1);
-      last_on_ = is_on;
+    // A color still waiting for the limiter is moot once the blade is off
+    if (!is_on) {
+      color_waiting_ = false;
+      brightness_band_.clear();
+      color_band_.clear();
     }
+    if (is_on == is_on_()) return;
+    shadow_.want(ShadowKey::POWER_ON, is_on);
+    pending_.power = true;
+    pending_.on = is_on;
   }
 
   void send_brightness_if_changed_(int br_val) {
-    if (br_val != last_brightness_) {
-      char cmd[48];
-      int len = snprintf(cmd, sizeof(cmd), "[2,{\"Brightness\":%d}]", br_val);
-      send_command_(cmd, len);
-      last_brightness_ = br_val;
+    if (!shadow_.want(ShadowKey::BRIGHTNESS, br_val)) return;
+    pending_.brightness = true;
+    pending_.brightness_val = br_val;
+  }
+
+  // Brightness and color from write_state() and WLED go through the
+  // dead-band against what the saber has; effects and keyframes are sent
+  // as rendered
+  void send_brightness_banded_(int br_val) {
+    if (!brightness_band_.pass(shadow_.known(ShadowKey::BRIGHTNESS),
+                               shadow_.value(ShadowKey::BRIGHTNESS), br_val,
+                               millis()))
+      return;
+    send_brightness_if_changed_(br_val);
+  }
+
+  void send_color_banded_(int r, int g, int b) {
+    if (color_band_.pass(shadow_.known(ShadowKey::BACKGROUND_COLOR),
+                         shadow_.value(ShadowKey::BACKGROUND_COLOR),
+                         SaberShadowState::pack_rgb(r, g, b), millis())) {
+      send_color_if_changed_(r, g, b);
+      return;
+    }
+    // Back near what the saber has; a color still waiting is outdated
+    color_waiting_ = false;
+  }
+
+  // Values held by the dead-band go out exactly once they settle
+  void release_dead_band_() {
+    if (!brightness_band_.holding() && !color_band_.holding()) return;
+    if (!is_on_() || !is_ready_for_commands_()) {
+      brightness_band_.clear();
+      color_band_.clear();
+      return;
     }
+    uint32_t now = millis();
+    int32_t v;
+    if (brightness_band_.take_settled(now, v)) send_brightness_if_changed_(v);
+    if (color_band_.take_settled(now, v))
+      send_color_if_changed_(SaberShadowState::unpack_r(v),
+                             SaberShadowState::unpack_g(v),
+                             SaberShadowState::unpack_b(v));
   }
 
+  // Record the target color; release_color_() sends it when the limiter
+  // allows, so a suppressed update is delayed rather than lost.
   void send_color_if_changed_(int r, int g, int b) {
-    if (r == last_r_ && g == last_g_ && b == last_b_) return;
+    if (shadow_.matches(ShadowKey::BACKGROUND_COLOR,
+                        SaberShadowState::pack_rgb(r, g, b))) {
+      color_waiting_ = false;
+      return;
+    }
+    if (color_waiting_ && (r != want_r_ || g != want_g_ || b != want_b_))
+      Instrumentation::instance().count_debounced();
+    color_waiting_ = true;
+    want_r_ = r;
+    want_g_ = g;
+    want_b_ = b;
+  }
+
+  void release_color_() {
+    if (!color_waiting_) return;
     uint32_t now = millis();
-    if (now - last_color_send_ms_ < 100) return;
-    char cmd[64];
-    int len = snprintf(cmd, sizeof(cmd),
-                       "[2,{\"BackgroundColor\":[%d,%d,%d]}]", r, g, b);
-    send_command_(cmd, len);
-    last_r_ = r;
-    last_g_ = g;
-    last_b_ = b;
-    last_color_send_ms_ = now;
-  }
-
-  void send_command_(const char *cmd, int len) {
-    if (ble_client_ == nullptr) return;
+    if (!color_limiter_.ready(now)) return;
+    pending_.color = true;
+    pending_.r = want_r_;
+    pending_.g = want_g_;
+    pending_.b = want_b_;
+    shadow_.want(ShadowKey::BACKGROUND_COLOR,
+                 SaberShadowState::pack_rgb(want_r_, want_g_, want_b_));
+    color_waiting_ = false;
+    color_limiter_.mark_sent(now);
+  }
+
+  // Write everything collected since the last tick — one combined frame when
+  // the saber is known (or being probed) to accept it, otherwise one write
+  // per key in power, brightness, color order.
+  void flush_pending_() {
+    if (!pending_.any()) return;
+    PendingCommand p = pending_;
+    pending_ = {};
+    // A color still held by the limiter takes the trace along later
+    LatencyTrace trace = wled_trace_;
+    if (!color_waiting_) wled_trace_ = LatencyTrace();
+
+    if (p.count() > 1 && should_combine_(p)) {
+      if (!send_packed_(p, trace)) return;
+      if (combine_state_ == CombineState::UNVERIFIED) {
+        combine_state_ = CombineState::PROBING;
+        probe_ = p;
+        probe_brightness_ = p.brightness_val;
+        probe_start_ms_ = millis();
+      }
+      return;
+    }
+
+    if (p.power) send_power_cmd_(p.on, trace);
+    if (p.brightness) send_brightness_cmd_(p.brightness_val, trace);
+    if (p.color) send_color_cmd_(p.r, p.g, p.b, trace);
+  }
+
+  // Only a frame carrying brightness can be verified, since brightness is
+  // the key the saber confirms on 3AB1. One probe is outstanding at a time.
+  bool should_combine_(const PendingCommand &p) const {
+    if (!combine_commands_) return false;
+    switch (combine_state_) {
+      case CombineState::CONFIRMED:
+        return true;
+      case CombineState::UNVERIFIED:
+        return p.brightness;
+      default:
+        return false;
+    }
+  }
+
+  // Probe went unanswered: stop combining and requeue the probed fields
+  // (with their current values) as single-key writes.
+  void check_combine_probe_() {
+    if (combine_state_ != CombineState::PROBING) return;
+    if (millis() - probe_start_ms_ < COMBINE_PROBE_TIMEOUT_MS) return;
+    combine_state_ = CombineState::REJECTED;
+    ESP_LOGW("xenopixel",
+             "Combined frame unconfirmed, falling back to single-key writes");
+    if (probe_.power && !pending_.power) {
+      pending_.power = true;
+      pending_.on = is_on_();
+    }
+    if (probe_.brightness && !pending_.brightness) {
+      pending_.brightness = true;
+      pending_.brightness_val = shadow_.value(ShadowKey::BRIGHTNESS);
+    }
+    if (probe_.color && !pending_.color) {
+      int32_t rgb = shadow_.value(ShadowKey::BACKGROUND_COLOR);
+      pending_.color = true;
+      pending_.r = SaberShadowState::unpack_r(rgb);
+      pending_.g = SaberShadowState::unpack_g(rgb);
+      pending_.b = SaberShadowState::unpack_b(rgb);
+    }
+  }
 
-    // Cache the characteristic handle for performance
-    if (char_handle_ == 0) {
-      auto chr = ble_client_->get_characteristic(
-          esp32_ble_tracker::ESPBTUUID::from_raw(
-              "00003ab0-0000-1000-8000-00805f9b34fb"),
-          esp32_ble_tracker::ESPBTUUID::from_raw(
-              "00003ab1-0000-1000-8000-00805f9b34fb"));
-      if (chr == nullptr) {
-        ESP_LOGW("xenopixel", "BLE characteristic not found");
+  // Packs the fields, in power, brightness, color order, into as few
+  // frames as fit one write each at the negotiated MTU. A field too long
+  // for any write still goes out on its own. True when a frame carried more
+  // than one key, i.e. the saber has to parse a combined frame.
+  bool send_packed_(const PendingCommand &p, const LatencyTrace &trace) {
+    size_t cap = frame_budget_();
+    CommandFrame frame;
+    uint16_t key = 0;
+    bool combined = false;
+    auto pack = [&](uint16_t field, auto add) {
+      CommandFrame grown = frame;
+      add(grown);
+      if (key == 0 || grown.size() <= cap) {
+        frame = grown;
+        key |= field;
         return;
       }
-      char_handle_ = chr->handle;
+      combined |= frame.count() > 1;
+      send_frame_(frame, key, trace);
+      tx_stats_.split++;
+      frame = CommandFrame();
+      add(frame);
+      key = field;
+    };
+    if (p.power)
+      pack(TX_KEY_POWER, [&p](CommandFrame &f) { f.add(CMD_POWER_ON, p.on); });
+    if (p.brightness)
+      pack(TX_KEY_BRIGHTNESS, [&p](CommandFrame &f) {
+        f.add(CMD_BRIGHTNESS, p.brightness_val);
+      });
+    if (p.color)
+      pack(TX_KEY_COLOR, [&p](CommandFrame &f) {
+        f.add(CMD_BACKGROUND_COLOR, p.r, p.g, p.b);
+      });
+    combined |= frame.count() > 1;
+    send_frame_(frame, key, trace);
+    return combined;
+  }
+
+  // Bytes one write can carry; the link runs at the default MTU until an
+  // exchange has completed
+  size_t frame_budget_() const {
+    size_t payload = att_payload(att_mtu_ != 0 ? att_mtu_ : ATT_MTU_DEFAULT);
+    return payload < TX_FRAME_SIZE ? payload : TX_FRAME_SIZE;
+  }
+
+  void send_power_cmd_(bool is_on, const LatencyTrace &trace) {
+    send_frame_(CommandFrame().add(CMD_POWER_ON, is_on), TX_KEY_POWER, trace);
+  }
+
+  void send_brightness_cmd_(int br_val, const LatencyTrace &trace) {
+    send_frame_(CommandFrame().add(CMD_BRIGHTNESS, br_val), TX_KEY_BRIGHTNESS,
+                trace);
+  }
+
+  void send_color_cmd_(int r, int g, int b, const LatencyTrace &trace) {
+    send_frame_(CommandFrame().add(CMD_BACKGROUND_COLOR, r, g, b),
+                TX_KEY_COLOR, trace);
+  }
+
+  // Encodes straight into the TX slot
+  void send_frame_(const CommandFrame &frame, uint16_t key,
+                   LatencyTrace trace = LatencyTrace()) {
+    if (ble_client_ == nullptr) return;
+    auto encode = [&frame](char *buf, size_t cap) {
+      return frame.write(buf, cap);
+    };
+    Instrumentation::instance().enqueued(trace);
+    switch (tx_queue_.emplace(key, encode, trace)) {
+      case LightTxQueue::Push::ENQUEUED:
+        tx_stats_.enqueued++;
+        break;
+      case LightTxQueue::Push::COALESCED:
+        tx_stats_.coalesced++;
+        Instrumentation::instance().count_coalesced();
+        break;
+      case LightTxQueue::Push::DROPPED:
+        tx_stats_.dropped++;
+        ESP_LOGW("xenopixel", "TX queue full, dropped frame (key 0x%x)", key);
+        break;
+    }
+  }
+
+  // BleWriteClient: the scheduler peeks at the front frame to charge and
+  // prioritize it, then asks for one write at a time. Frames that cannot be
+  // written at all (no client, characteristic not found) are dropped here.
+  bool peek_write(NextWrite &next) override {
+    if (tx_congested_) return false;
+    if (tx_retry_wait_ms_ != 0 &&
+        millis() - tx_retry_from_ms_ < tx_retry_wait_ms_)
+      return false;
+    // Combat effects go first, at the scheduler's top priority
+    while (auto *slot = effect_queue_.claim()) {
+      if (ble_client_ == nullptr || !resolve_char_handle_()) {
+        effect_queue_.pop();
+        tx_stats_.dropped++;
+        continue;
+      }
+      next.len = slot->len;
+      next.priority = BLE_PRIORITY_EFFECT;
+      effect_queue_.unclaim();
+      return true;
     }
+    for (;;) {
+      auto *slot = tx_queue_.claim();
+      if (slot == nullptr) return false;
+      if (ble_client_ == nullptr || !resolve_char_handle_()) {
+        tx_queue_.pop();
+        tx_stats_.dropped++;
+        continue;
+      }
+      // Ranked by the most urgent frame waiting, since frames behind the
+      // front one only go out after it
+      next.len = slot->len;
+      next.priority = tx_queue_.any_key(TX_KEYS_CONTROL) ? BLE_PRIORITY_CONTROL
+                                                         : BLE_PRIORITY_STREAM;
+      tx_queue_.unclaim();
+      return true;
+    }
+  }
+
+  bool write_next() override {
+    if (!effect_queue_.empty()) return write_effect_();
+    auto *slot = tx_queue_.claim();
+    if (slot == nullptr) return false;
+
+    ESP_LOGV("xenopixel", "Light cmd: %.*s", slot->len, slot->data);
+    auto status = esp_ble_gattc_write_char(
+        ble_client_->get_gattc_if(), ble_client_->get_conn_id(), char_handle_,
+        slot->len, (uint8_t *)slot->data, ESP_GATT_WRITE_TYPE_NO_RSP,
+        ESP_GATT_AUTH_REQ_NONE);
+    if (status == ESP_OK) {
+      last_tx_ms_ = millis();
+      if (group_stamp_pending_) {
+        group_write_us_ = micros();
+        group_stamp_pending_ = false;
+        group_wrote_ = true;
+      }
+      link_health_.record_success();
+      tx_retry_wait_ms_ = 0;
+      Instrumentation::instance().transmitted(slot->trace);
+      if (slot->key & TX_KEY_COLOR) {
+        color_write_in_flight_ = true;
+        color_write_ms_ = millis();
+      }
+      tx_queue_.pop();
+      return true;
+    }
+
+    on_write_failed_(status);
+    if (slot->key & TX_KEY_COLOR) color_limiter_.on_write_failed();
+    if (slot->retries >= MAX_TX_RETRIES) {
+      uint16_t key = slot->key;
+      tx_queue_.pop();
+      tx_stats_.requeued++;
+      mark_dirty_(key);
+    } else {
+      slot->retries++;
+      tx_stats_.retried++;
+      tx_queue_.unclaim();
+    }
+    return false;
+  }
 
-    ESP_LOGI("xenopixel", "Light cmd: %s", cmd);
+  // An effect that keeps failing is dropped rather than sent late
+  bool write_effect_() {
+    auto *slot = effect_queue_.claim();
+    if (slot == nullptr) return false;
+
+    ESP_LOGD("xenopixel", "Effect cmd: %.*s", slot->len, slot->data);
     auto status = esp_ble_gattc_write_char(
         ble_client_->get_gattc_if(), ble_client_->get_conn_id(), char_handle_,
-        len, (uint8_t *)cmd, ESP_GATT_WRITE_TYPE_NO_RSP,
+        slot->len, (uint8_t *)slot->data, ESP_GATT_WRITE_TYPE_NO_RSP,
         ESP_GATT_AUTH_REQ_NONE);
-    if (status != ESP_OK) {
-      ESP_LOGW("xenopixel", "BLE write failed: %d", status);
+    if (status == ESP_OK) {
+      last_tx_ms_ = millis();
+      link_health_.record_success();
+      tx_retry_wait_ms_ = 0;
+      last_effect_latency_us_ = micros() - slot->trace.press_us;
+      effect_latency_.record(last_effect_latency_us_);
+      effect_queue_.pop();
+      return true;
+    }
+
+    on_write_failed_(status);
+    if (slot->retries >= MAX_TX_RETRIES) {
+      effect_queue_.pop();
+      tx_stats_.dropped++;
+    } else {
+      slot->retries++;
+      tx_stats_.retried++;
+      effect_queue_.unclaim();
+    }
+    return false;
+  }
+
+  void on_write_failed_(esp_err_t status) {
+    link_health_.record_failure(status);
+    tx_retry_from_ms_ = millis();
+    tx_retry_wait_ms_ = retry_backoff_ms(link_health_.failure_streak());
+    ESP_LOGW("xenopixel", "BLE write failed: %d, retrying in %ums", status,
+             (unsigned)tx_retry_wait_ms_);
+    Instrumentation::instance().count_failed();
+  }
+
+  // A frame that kept failing left the queue; its fields are sent again
+  // from the shadow, unless the saber has reported them since
+  void mark_dirty_(uint16_t key) {
+    if ((key & TX_KEY_POWER) && shadow_.pending(ShadowKey::POWER_ON) &&
+        !pending_.power) {
+      pending_.power = true;
+      pending_.on = is_on_();
+    }
+    if ((key & TX_KEY_BRIGHTNESS) && shadow_.pending(ShadowKey::BRIGHTNESS) &&
+        !pending_.brightness) {
+      pending_.brightness = true;
+      pending_.brightness_val = shadow_.value(ShadowKey::BRIGHTNESS);
+    }
+    if ((key & TX_KEY_COLOR) && shadow_.pending(ShadowKey::BACKGROUND_COLOR) &&
+        !pending_.color && !color_waiting_) {
+      int32_t rgb = shadow_.value(ShadowKey::BACKGROUND_COLOR);
+      pending_.color = true;
+      pending_.r = SaberShadowState::unpack_r(rgb);
+      pending_.g = SaberShadowState::unpack_g(rgb);
+      pending_.b = SaberShadowState::unpack_b(rgb);
     }
+    if ((key & TX_KEY_VOLUME) && shadow_.pending(ShadowKey::VOLUME))
+      send_frame_(CommandFrame().add(
+                      CMD_VOLUME, (int)shadow_.value(ShadowKey::VOLUME)),
+                  TX_KEY_VOLUME);
+    if ((key & TX_KEY_SOUND_FONT) && shadow_.pending(ShadowKey::SOUND_FONT))
+      send_frame_(CommandFrame().add(
+                      CMD_SOUND_FONT, (int)shadow_.value(ShadowKey::SOUND_FONT)),
+                  TX_KEY_SOUND_FONT);
+    if ((key & TX_KEY_LIGHT_EFFECT) && shadow_.pending(ShadowKey::LIGHT_EFFECT))
+      send_frame_(CommandFrame().add(CMD_LIGHT_EFFECT,
+                                     (int)shadow_.value(ShadowKey::LIGHT_EFFECT)),
+                  TX_KEY_LIGHT_EFFECT);
+  }
+
+  // Drops the cached handles for this saber's MAC, so the next connect
+  // rediscovers them
+  void forget_gatt_() {
+    char_handle_ = 0;
+    handshake_handle_ = 0;
+    gatt_verified_ = false;
+    if (ble_client_ != nullptr)
+      SaberGattProfile::instance().invalidate(
+          SaberGattProfile::mac_key(ble_client_->get_remote_bda()));
+  }
+
+  bool resolve_char_handle_() {
+    if (char_handle_ != 0) return true;
+    const SaberGattHandles *h = SaberGattProfile::instance().find(
+        SaberGattProfile::mac_key(ble_client_->get_remote_bda()));
+    if (h != nullptr && h->ab1 != 0) {
+      char_handle_ = h->ab1;
+      return true;
+    }
+    auto chr = ble_client_->get_characteristic(
+        esp32_ble_tracker::ESPBTUUID::from_raw(
+            "00003ab0-0000-1000-8000-00805f9b34fb"),
+        esp32_ble_tracker::ESPBTUUID::from_raw(
+            "00003ab1-0000-1000-8000-00805f9b34fb"));
+    if (chr == nullptr) {
+      ESP_LOGW("xenopixel", "BLE characteristic not found");
+      return false;
+    }
+    char_handle_ = chr->handle;
+    return true;
   }
 
   ble_client::BLEClient *ble_client_{nullptr};
   globals::GlobalsComponent<bool> *authorized_global_{nullptr};
   globals::GlobalsComponent<bool> *syncing_global_{nullptr};
   uint16_t char_handle_{0};
-  bool last_on_{false};
-  int last_r_{-1};
-  int last_g_{-1};
-  int last_b_{-1};
-  int last_brightness_{-1};
-  uint32_t last_color_send_ms_{0};
+  SaberShadowState shadow_;
+  bool color_waiting_{false};
+  int want_r_{0};
+  int want_g_{0};
+  int want_b_{0};
+  AdaptiveRateLimiter color_limiter_;
+  bool color_write_in_flight_{false};
+  uint32_t color_write_ms_{0};
   bool wled_active_{false};
-  uint32_t last_seen_gen_{0};
+  WledPixelWindow wled_window_;
+  BleLinkMode link_mode_{BleLinkMode::IDLE};
+  uint32_t link_mode_since_ms_{0};
+  bool conn_params_requested_{false};
+  BleLinkMode requested_mode_{BleLinkMode::IDLE};
+  BleConnReport conn_report_;
+  bool gatt_verified_{false};
+  uint16_t indications_cccd_{0};
+  uint16_t handshake_handle_{0};
+  SaberSession session_;
+  uint32_t keepalive_interval_ms_{DEFAULT_KEEPALIVE_INTERVAL_MS};
+  uint32_t last_tx_ms_{0};
+  LatencyTrace wled_trace_;
+  FrameSmoother smoother_;
+  bool smoothing_{false};
+  bool smooth_has_emitted_{false};
+  uint32_t smooth_emit_ms_{0};
+  light::LightState *state_{nullptr};
+  EffectEngine effect_;
+  TransitionPlanner<1> brightness_fade_;
+  TransitionPlanner<3> color_fade_;
+  DeadBand brightness_band_{DeadBandMetric::LEVEL};
+  DeadBand color_band_{DeadBandMetric::REDMEAN_RGB};
+  bool group_stamp_pending_{false};
+  bool group_wrote_{false};
+  uint32_t group_write_us_{0};
+  bool effect_has_emitted_{false};
+  uint32_t effect_emit_ms_{0};
+  bool combine_commands_{true};
+  CombineState combine_state_{CombineState::UNVERIFIED};
+  PendingCommand pending_;
+  PendingCommand probe_;
+  int probe_brightness_{-1};
+  uint32_t probe_start_ms_{0};
+  GattcForwarder gattc_forwarder_{this};
+  LightTxQueue tx_queue_;
+  EffectTxQueue effect_queue_;
+  LatencyHistogram effect_latency_;
+  uint32_t last_effect_latency_us_{0};
+  uint16_t att_mtu_{0};
+  XenopixelNotificationStream status_stream_;
+  XenopixelNotificationStream reply_stream_;
+  TxStats tx_stats_;
+  bool tx_congested_{false};
+  BleLinkHealth link_health_;
+  uint32_t tx_retry_from_ms_{0};
+  uint32_t tx_retry_wait_ms_{0};
 };
 
 }  // namespace xenopixel_light
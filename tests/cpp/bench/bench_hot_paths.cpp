@@ -0,0 +1,632 @@
+// Microbenchmarks for the XenopixelLight hot paths, on the same mocks as the
+// unit tests. Built at -O2 without coverage as xenopixel_bench.
+//
+// Every benchmark reports allocs/op, counted by the global operator new
+// below. Paths documented as allocation-free declare a budget of 0; main()
+// fails when any benchmark exceeds its budget, so the ctest smoke run
+// catches a regression without looking at timings.
+#include "esphome_mock.h"
+
+#include "ble_link_sim.h"
+#include "wled_socket_mock.h"
+#include "xenopixel_light/xenopixel_light.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace esphome;
+using namespace esphome::xenopixel_light;
+
+// ── Allocation counting ─────────────────────────────────────────────────────
+
+namespace {
+std::atomic<uint64_t> g_allocs{0};
+}  // namespace
+
+void *operator new(size_t size) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+// The replaced operator new above allocates with malloc, so free is the
+// matching release; GCC only sees a new/free pair
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+bool g_budget_exceeded = false;
+
+// Counts allocations between construction and finish(); finish() reports
+// allocs/op and flags the run when more than max_per_op were made
+class AllocScope {
+ public:
+  AllocScope() : start_(g_allocs.load(std::memory_order_relaxed)) {}
+
+  void finish(benchmark::State &state, double max_per_op) {
+    uint64_t allocs = g_allocs.load(std::memory_order_relaxed) - start_;
+    double per_op = state.iterations() == 0
+                        ? 0.0
+                        : (double)allocs / (double)state.iterations();
+    state.counters["allocs/op"] = per_op;
+    if (per_op > max_per_op) {
+      g_budget_exceeded = true;
+      state.SkipWithError("allocation budget exceeded");
+    }
+  }
+
+ protected:
+  uint64_t start_;
+};
+
+// Captured from a Xenopixel V3 (PROTOCOL.md, Example Full Status)
+const char kFullStatus[] =
+    "[3,{\"HardwareVersion\":\"XENOA04525CW13907\",\"SoftwareVersion\":"
+    "\"DMN_XENO_B_SV1.4.0\",\"PowerOn\":false,\"CurrentSoundPackageNo\":0,"
+    "\"TotalSoundPackage\":34,\"CurrentLightEffect\":0,\"TotalLightEffect\":8,"
+    "\"CurrentLockup\":0,\"TotalLockup\":1,\"CurrentDrag\":0,\"TotalDrag\":1,"
+    "\"CurrentBlaster\":0,\"TotalBlaster\":3,\"CurrentClash\":0,"
+    "\"TotalClash\":3,\"CurrentForce\":0,\"TotalForce\":2,\"CurrentPostOff\":0,"
+    "\"TotalPostOff\":0,\"CurrentMode\":0,\"TotalMode\":8,\"PreonTime\":0,"
+    "\"Power\":100,\"Volume\":10,\"BackgroundColor\":[255,230,103]}]";
+
+// Everything the benchmarks need to drive one authorized saber
+class BenchLight : public XenopixelLight {
+ public:
+  using XenopixelLight::recover_rgb_;
+  using XenopixelLight::TX_FRAME_SIZE;
+};
+
+struct Rig {
+  Rig() {
+    mock_record_ble_writes() = false;
+    mock_ble_write_status() = ESP_OK;
+    mock_millis_value() = 1000;
+    WledHub::instance().reset();
+    BleWriteScheduler::instance().reset();
+
+    chr.handle = 42;
+    client.set_mock_characteristic(&chr);
+    client.set_gattc_if(1);
+    client.set_conn_id(2);
+    light.set_ble_client(&client);
+    light.set_authorized_global(&authorized);
+    light.set_syncing_global(&syncing);
+    light.set_keepalive_interval(0);
+    state.current_values.set_state(true);
+    state.current_values.set_brightness(1.0f);
+    state.current_values.set_rgb(1.0f, 1.0f, 1.0f);
+  }
+  ~Rig() { mock_record_ble_writes() = true; }
+
+  // Outside a transition ESPHome's target is the current value
+  void write_state() {
+    state.remote_values = state.current_values;
+    light.write_state(&state);
+  }
+
+  // Far enough for the write budget and the color limiter to be ready
+  void tick() {
+    mock_millis_value() += 1000;
+    light.loop();
+  }
+
+  BenchLight light;
+  ble_client::BLEClient client;
+  ble_client::BLECharacteristic chr;
+  globals::GlobalsComponent<bool> authorized{true};
+  globals::GlobalsComponent<bool> syncing{false};
+  light::LightState state;
+};
+
+struct NullHandler : XenopixelNotificationHandler {
+  void on_volume(int v) { sum += v; }
+  void on_background_color(int r, int g, int b) { sum += r + g + b; }
+  void on_hardware_version(const char *, size_t n) { sum += (int)n; }
+  int sum{0};
+};
+
+}  // namespace
+
+// ── write_state ─────────────────────────────────────────────────────────────
+
+// Changed brightness and color every call, through to the BLE write
+static void BM_WriteStateAndFlush(benchmark::State &state) {
+  Rig rig;
+  rig.write_state();
+  rig.tick();
+  float level = 0.5f;
+  uint32_t writes = mock_ble_write_count();
+  AllocScope allocs;
+  for (auto _ : state) {
+    level = level > 0.9f ? 0.1f : level + 0.01f;
+    rig.state.current_values.set_brightness(level);
+    rig.state.current_values.set_rgb(level, 1.0f - level, 0.5f);
+    rig.write_state();
+    rig.tick();
+  }
+  allocs.finish(state, 0);
+  state.counters["writes/op"] = benchmark::Counter(
+      (double)(mock_ble_write_count() - writes),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_WriteStateAndFlush);
+
+// The same stream with combined frames confirmed, packed against the ATT
+// MTU given as the argument: writes per update at each link size
+static void BM_WriteStatePacked(benchmark::State &state) {
+  Rig rig;
+  esp_ble_gattc_cb_param_t param{};
+  param.cfg_mtu.status = ESP_GATT_OK;
+  param.cfg_mtu.conn_id = 2;
+  param.cfg_mtu.mtu = (uint16_t)state.range(0);
+  rig.client.dispatch_gattc_event(ESP_GATTC_CFG_MTU_EVT, &param);
+  rig.write_state();
+  rig.tick();
+  rig.light.confirm_brightness(100);
+  float level = 0.5f;
+  uint32_t writes = mock_ble_write_count();
+  AllocScope allocs;
+  for (auto _ : state) {
+    level = level > 0.9f ? 0.1f : level + 0.01f;
+    rig.state.current_values.set_brightness(level);
+    rig.state.current_values.set_rgb(level, 1.0f - level, 0.5f);
+    rig.write_state();
+    rig.tick();
+  }
+  allocs.finish(state, 0);
+  state.counters["writes/op"] = benchmark::Counter(
+      (double)(mock_ble_write_count() - writes),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_WriteStatePacked)->Arg(23)->Arg(64)->Arg(247);
+
+// The echo of a notification: nothing differs, nothing is queued
+static void BM_WriteStateRedundant(benchmark::State &state) {
+  Rig rig;
+  rig.write_state();
+  rig.tick();
+  AllocScope allocs;
+  for (auto _ : state) {
+    rig.write_state();
+    rig.light.loop();
+  }
+  allocs.finish(state, 0);
+}
+BENCHMARK(BM_WriteStateRedundant);
+
+// A 2s ESPHome transition at a 16ms loop: 125 interpolated write_state()
+// calls per fade, of which the keyframe planner lets a handful through
+static void BM_WriteStateTransition(benchmark::State &state) {
+  Rig rig;
+  rig.write_state();
+  rig.tick();
+  constexpr int STEPS = 125;
+  bool up = true;
+  uint32_t writes = mock_ble_write_count();
+  AllocScope allocs;
+  for (auto _ : state) {
+    float from = up ? 0.2f : 1.0f;
+    float to = up ? 1.0f : 0.2f;
+    rig.state.remote_values.set_state(true);
+    rig.state.remote_values.set_brightness(to);
+    rig.state.remote_values.set_rgb(1.0f, 1.0f, 1.0f);
+    for (int i = 1; i <= STEPS; i++) {
+      rig.state.current_values.set_brightness(from + (to - from) * i / STEPS);
+      rig.light.write_state(&rig.state);
+      mock_millis_value() += 16;
+      rig.light.loop();
+    }
+    rig.tick();
+    up = !up;
+  }
+  allocs.finish(state, 0);
+  state.counters["writes/fade"] = benchmark::Counter(
+      (double)(mock_ble_write_count() - writes),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_WriteStateTransition);
+
+// Sensor noise: brightness and color flip by one step every call. With the
+// default dead-band nothing but the settled value is written.
+static void BM_WriteStateNoise(benchmark::State &state) {
+  Rig rig;
+  rig.light.set_brightness_dead_band(1);
+  rig.light.set_color_dead_band(3);
+  rig.state.current_values.set_brightness(0.5f);
+  rig.state.current_values.set_rgb(0.5f, 0.5f, 0.5f);
+  rig.write_state();
+  rig.tick();
+  bool flip = false;
+  uint32_t writes = mock_ble_write_count();
+  AllocScope allocs;
+  for (auto _ : state) {
+    flip = !flip;
+    rig.state.current_values.set_brightness(flip ? 0.51f : 0.5f);
+    rig.state.current_values.set_rgb(flip ? 0.503f : 0.5f, 0.5f, 0.5f);
+    rig.write_state();
+    mock_millis_value() += 16;
+    rig.light.loop();
+  }
+  allocs.finish(state, 0);
+  state.counters["writes/op"] = benchmark::Counter(
+      (double)(mock_ble_write_count() - writes),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_WriteStateNoise);
+
+static void BM_RecoverRgb(benchmark::State &state) {
+  float brightness = 0.37f;
+  AllocScope allocs;
+  for (auto _ : state) {
+    float r = 0.2f, g = 0.3f, b = 0.4f;
+    benchmark::DoNotOptimize(brightness);
+    BenchLight::recover_rgb_(&r, &g, &b, brightness, true);
+    benchmark::DoNotOptimize(r);
+    benchmark::DoNotOptimize(g);
+    benchmark::DoNotOptimize(b);
+  }
+  allocs.finish(state, 0);
+}
+BENCHMARK(BM_RecoverRgb);
+
+// ── WLED ────────────────────────────────────────────────────────────────────
+
+// One saber applying notifier packets directly
+static void BM_ApplyWledPacket(benchmark::State &state) {
+  Rig rig;
+  uint8_t pkt[] = {0x00, 0x00, 200, 255, 0, 0};
+  // The first packet changes the link mode; the mock records that request
+  rig.light.apply_wled_packet(pkt, sizeof(pkt));
+  rig.tick();
+  AllocScope allocs;
+  for (auto _ : state) {
+    pkt[3]++;
+    rig.light.apply_wled_packet(pkt, sizeof(pkt));
+    rig.tick();
+  }
+  allocs.finish(state, 0);
+}
+BENCHMARK(BM_ApplyWledPacket);
+
+// A clash on top of a WLED color stream: the effect lane and the queued
+// color go out in the same loop, the clash first
+static void BM_ClashDuringWledStream(benchmark::State &state) {
+  Rig rig;
+  uint8_t pkt[] = {0x00, 0x00, 200, 255, 0, 0};
+  rig.light.apply_wled_packet(pkt, sizeof(pkt));
+  rig.tick();
+  uint32_t writes = mock_ble_write_count();
+  AllocScope allocs;
+  for (auto _ : state) {
+    pkt[3]++;
+    rig.light.apply_wled_packet(pkt, sizeof(pkt));
+    rig.light.trigger_effect(CombatEffect::CLASH);
+    rig.tick();
+  }
+  allocs.finish(state, 0);
+  state.counters["writes/op"] = benchmark::Counter(
+      (double)(mock_ble_write_count() - writes),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ClashDuringWledStream);
+
+// A full 490-LED DRGB frame through the receiver and hub, per packet
+static void BM_WledHubDrgb(benchmark::State &state) {
+  Rig rig;
+  rig.light.set_wled_active(true);
+  uint8_t pkt[2 + 490 * 3];
+  pkt[0] = 2;  // DRGB
+  pkt[1] = 2;
+  for (size_t i = 2; i < sizeof(pkt); i++) pkt[i] = (uint8_t)i;
+  WledReceiver::instance().publish(pkt, sizeof(pkt));
+  rig.tick();
+  AllocScope allocs;
+  for (auto _ : state) {
+    pkt[2]++;
+    WledReceiver::instance().publish(pkt, sizeof(pkt));
+    rig.tick();
+  }
+  allocs.finish(state, 0);
+  rig.light.set_wled_active(false);
+}
+BENCHMARK(BM_WledHubDrgb);
+
+// ── Multi-instance fan-out ──────────────────────────────────────────────────
+
+namespace {
+
+// Counts hub deliveries and when the last one arrived
+class FanOutLight : public XenopixelLight {
+ public:
+  void on_wled_target(const WledTarget &target) override {
+    deliveries++;
+    XenopixelLight::on_wled_target(target);
+  }
+  uint32_t deliveries{0};
+};
+
+}  // namespace
+
+// N sabers polling one shared socket, each on its own 30-pixel window of a
+// 490-LED DRGB frame. One iteration injects a frame that changes every
+// window and runs ESPHome loop iterations (every light's loop(), then
+// LOOP_MS of simulated time) until every subscribed saber has its target.
+// Time per iteration is the CPU cost of one packet across all N instances;
+// fanout_ms is the worst simulated time from the packet to the last saber.
+// Each subscribed saber must get each frame exactly once; the hub takes at
+// most WledHub::MAX_SUBSCRIBERS, so larger N reports how many subscribed.
+static void BM_WledFanOut(benchmark::State &state) {
+  constexpr uint32_t LOOP_MS = 16;
+  constexpr uint16_t WINDOW = 30;
+  constexpr int MAX_LOOPS = 64;
+  const int n = (int)state.range(0);
+  mock_record_ble_writes() = false;
+  mock_ble_write_status() = ESP_OK;
+  mock_millis_value() = 1000;
+  WledHub::instance().reset();
+  BleWriteScheduler::instance().reset();
+  MockWledSocket sock;
+  WledReceiver::instance().set_socket(&sock);
+
+  std::vector<FanOutLight> lights(n);
+  std::vector<ble_client::BLEClient> clients(n);
+  ble_client::BLECharacteristic chr;
+  globals::GlobalsComponent<bool> authorized{true};
+  chr.handle = 42;
+  for (int i = 0; i < n; i++) {
+    clients[i].set_mock_characteristic(&chr);
+    clients[i].set_conn_id((uint16_t)(i + 1));
+    lights[i].set_ble_client(&clients[i]);
+    lights[i].set_authorized_global(&authorized);
+    lights[i].set_keepalive_interval(0);
+    lights[i].set_wled_pixel_window((uint16_t)(i * WINDOW), WINDOW);
+    lights[i].set_wled_active(true);
+  }
+  size_t subscribed = WledHub::instance().subscriber_count();
+
+  // Two frames that differ in every window
+  uint8_t frames[2][2 + 490 * 3];
+  for (int f = 0; f < 2; f++) {
+    frames[f][0] = 2;  // DRGB
+    frames[f][1] = 2;
+    for (size_t i = 2; i < sizeof(frames[f]); i++)
+      frames[f][i] = (uint8_t)(f == 0 ? i : 255 - i);
+  }
+
+  uint32_t sent = 0;
+  uint32_t worst_loops = 0;
+  bool exact = true;
+  auto fan_out = [&] {
+    sock.inject(frames[sent & 1], sizeof(frames[0]));
+    sent++;
+    int loops = 0;
+    size_t done = 0;
+    while (done < subscribed && loops < MAX_LOOPS) {
+      for (auto &l : lights) l.loop();
+      mock_millis_value() += LOOP_MS;
+      loops++;
+      done = 0;
+      for (auto &l : lights) done += l.deliveries == sent;
+    }
+    if ((uint32_t)loops > worst_loops) worst_loops = (uint32_t)loops;
+    for (size_t i = 0; i < subscribed; i++)
+      if (lights[i].deliveries != sent) exact = false;
+    for (size_t i = subscribed; i < lights.size(); i++)
+      if (lights[i].deliveries != 0) exact = false;
+  };
+  fan_out();  // link mode change and first color per saber
+  fan_out();
+
+  AllocScope allocs;
+  for (auto _ : state) fan_out();
+  allocs.finish(state, 0);
+
+  if (!exact) state.SkipWithError("a saber missed or repeated a frame");
+  state.counters["subscribed"] = (double)subscribed;
+  state.counters["fanout_ms"] = (double)(worst_loops * LOOP_MS);
+  state.counters["per_saber"] = benchmark::Counter(
+      (double)n, benchmark::Counter::kIsIterationInvariantRate |
+                     benchmark::Counter::kInvert);
+  for (auto &l : lights) l.set_wled_active(false);
+  WledReceiver::instance().set_socket(nullptr);
+  mock_record_ble_writes() = true;
+}
+BENCHMARK(BM_WledFanOut)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16);
+
+// ── Scheduler over a simulated link ─────────────────────────────────────────
+
+// Four sabers streaming 50 Hz WLED colors over a 15 ms, 2-frames-per-event
+// link each; one iteration is one simulated second. Reports what the
+// shared scheduler and TX queues get through.
+static void BM_FourSabersSimLink(benchmark::State &state) {
+  constexpr int SABERS = 4;
+  mock_record_ble_writes() = false;
+  WledHub::instance().reset();
+  BleWriteScheduler::instance().reset();
+  BleLinkSim sim(1);
+  BleLinkParams p;
+  p.interval_us = 15000;
+  p.writes_per_event = 2;
+  p.buffer_depth = 4;
+  p.congest_clear = 2;
+  p.loss_rate = 0.05f;
+
+  XenopixelLight lights[SABERS];
+  ble_client::BLEClient clients[SABERS];
+  ble_client::BLECharacteristic chr;
+  globals::GlobalsComponent<bool> authorized{true};
+  chr.handle = 42;
+  for (int i = 0; i < SABERS; i++) {
+    clients[i].set_mock_characteristic(&chr);
+    clients[i].set_conn_id((uint16_t)(i + 1));
+    lights[i].set_ble_client(&clients[i]);
+    lights[i].set_authorized_global(&authorized);
+    lights[i].set_keepalive_interval(0);
+    lights[i].update_cached_power(true);
+    sim.add_link(&clients[i], p);
+  }
+  sim.install();
+  sim.set_now_us(1000000);
+
+  uint8_t step = 0;
+  auto one_second = [&] {
+    for (int ms = 0; ms < 1000; ms += 4) {
+      if (ms % 20 == 0) {
+        step++;
+        for (int i = 0; i < SABERS; i++) {
+          uint8_t pkt[] = {0x00, 0x00, 255, step, (uint8_t)(i * 60),
+                           (uint8_t)(255 - step)};
+          lights[i].apply_wled_packet(pkt, sizeof(pkt));
+        }
+      }
+      for (auto &l : lights) l.loop();
+      sim.advance_ms(4);
+    }
+  };
+  one_second();  // past the combined-frame probe
+
+  uint32_t delivered = 0;
+  for (int i = 0; i < SABERS; i++) delivered += sim.stats(i + 1)->delivered;
+  AllocScope allocs;
+  for (auto _ : state) one_second();
+  allocs.finish(state, 0);
+
+  uint32_t total = 0, lowest = UINT32_MAX, highest = 0;
+  for (int i = 0; i < SABERS; i++) {
+    uint32_t d = sim.stats(i + 1)->delivered;
+    total += d;
+    lowest = d < lowest ? d : lowest;
+    highest = d > highest ? d : highest;
+  }
+  state.counters["frames/s"] = benchmark::Counter(
+      (double)(total - delivered), benchmark::Counter::kAvgIterations);
+  // 1.0 when every saber got the same share of the radio
+  state.counters["fairness"] = highest == 0 ? 0.0 : (double)lowest / highest;
+  sim.uninstall();
+  mock_record_ble_writes() = true;
+}
+BENCHMARK(BM_FourSabersSimLink);
+
+// ── Effect engine ───────────────────────────────────────────────────────────
+
+// One sample per effect kind, as emit_effect_() takes it
+static void BM_EffectRender(benchmark::State &state) {
+  EffectEngine engines[4];
+  const EffectKind kinds[4] = {EffectKind::BREATHE, EffectKind::RAINBOW,
+                               EffectKind::FLICKER, EffectKind::PULSE};
+  for (int i = 0; i < 4; i++) {
+    EffectParams p;
+    p.kind = kinds[i];
+    p.period_ms = 1000;
+    engines[i].set_base(80, 0, 128, 255);
+    engines[i].start(p, 0);
+  }
+  engines[3].pulse(0);
+  uint32_t now = 0;
+  uint32_t sum = 0;
+  AllocScope allocs;
+  for (auto _ : state) {
+    now += 7;
+    for (auto &e : engines) {
+      EffectEngine::Frame f;
+      e.render(now % 1000, f);
+      sum += f.brightness + f.r + f.g + f.b;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  allocs.finish(state, 0);
+}
+BENCHMARK(BM_EffectRender);
+
+// ── Encoding and parsing ────────────────────────────────────────────────────
+
+static void BM_EncodeSingleKey(benchmark::State &state) {
+  char buf[BenchLight::TX_FRAME_SIZE];
+  int v = 0;
+  AllocScope allocs;
+  for (auto _ : state) {
+    size_t n = CommandFrame().add(CMD_BRIGHTNESS, v++).write(buf, sizeof(buf));
+    benchmark::DoNotOptimize(n);
+    benchmark::DoNotOptimize(buf);
+  }
+  allocs.finish(state, 0);
+}
+BENCHMARK(BM_EncodeSingleKey);
+
+static void BM_EncodeCombined(benchmark::State &state) {
+  char buf[BenchLight::TX_FRAME_SIZE];
+  int v = 0;
+  AllocScope allocs;
+  for (auto _ : state) {
+    v = (v + 1) & 0xFF;
+    size_t n = CommandFrame()
+                   .add(CMD_POWER_ON, true)
+                   .add(CMD_BRIGHTNESS, v % 101)
+                   .add(CMD_BACKGROUND_COLOR, v, 255 - v, 128)
+                   .write(buf, sizeof(buf));
+    benchmark::DoNotOptimize(n);
+    benchmark::DoNotOptimize(buf);
+  }
+  allocs.finish(state, 0);
+}
+BENCHMARK(BM_EncodeCombined);
+
+static void BM_ParseFullStatus(benchmark::State &state) {
+  NullHandler h;
+  AllocScope allocs;
+  for (auto _ : state) {
+    int n = XenopixelNotificationParser::parse(kFullStatus,
+                                                sizeof(kFullStatus) - 1, h);
+    benchmark::DoNotOptimize(n);
+  }
+  allocs.finish(state, 0);
+  state.SetBytesProcessed((int64_t)state.iterations() *
+                          (int64_t)(sizeof(kFullStatus) - 1));
+  benchmark::DoNotOptimize(h.sum);
+}
+BENCHMARK(BM_ParseFullStatus);
+
+// The same dump in 20-byte notifications, as it arrives at the default MTU
+static void BM_StreamFullStatus(benchmark::State &state) {
+  NullHandler h;
+  XenopixelNotificationStream stream;
+  const size_t len = sizeof(kFullStatus) - 1;
+  AllocScope allocs;
+  for (auto _ : state) {
+    int n = 0;
+    for (size_t i = 0; i < len; i += 20)
+      n += stream.feed(kFullStatus + i, len - i < 20 ? len - i : 20, h);
+    benchmark::DoNotOptimize(n);
+  }
+  allocs.finish(state, 0);
+  state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)len);
+  benchmark::DoNotOptimize(h.sum);
+}
+BENCHMARK(BM_StreamFullStatus);
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  if (g_budget_exceeded) {
+    std::fprintf(stderr, "A hot path allocated more than its budget\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,276 @@
+#pragma once
+// Deterministic BLE link simulator behind the mock esp_ble_gattc_write_char.
+//
+// Each simulated connection has a controller buffer of buffer_depth frames.
+// A write goes into the buffer; connection events every interval_us send up
+// to writes_per_event frames from it, in order. Each send is lost with
+// probability loss_rate — the link layer retransmits it in the next slot,
+// so loss costs throughput and latency, not data. A delivered frame raises
+// ESP_GATTC_WRITE_CHAR_EVT at that connection event.
+//
+// When the buffer fills the connection reports ESP_GATTC_CONGEST_EVT
+// (congested) and further writes fail with ESP_FAIL until there is room;
+// congestion clears once the buffer has drained to congest_clear frames.
+// write_fail_rate makes a write fail outright (ESP_FAIL) even with room,
+// like a transient stack error.
+//
+// Everything random comes from one splitmix64 stream seeded at
+// construction, so a run is reproducible. Time only moves through
+// advance_ms()/run_until(), which also set mock_millis_value() and
+// mock_micros_value() to the time of each event as it is delivered.
+// Nothing allocates unless record_deliveries() is on.
+//
+//   BleLinkSim sim(42);
+//   sim.add_link(&client, params);
+//   sim.install();
+//   for (...) { light.loop(); sim.advance_ms(1); }
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "esphome_mock.h"
+
+struct BleLinkParams {
+  uint32_t interval_us{7500};
+  uint8_t writes_per_event{4};
+  uint8_t buffer_depth{8};
+  uint8_t congest_clear{4};
+  float loss_rate{0.0f};
+  float write_fail_rate{0.0f};
+};
+
+class BleLinkSim : public MockBleLink {
+ public:
+  static constexpr size_t MAX_LINKS = 8;
+  static constexpr size_t MAX_DEPTH = 32;
+  static constexpr size_t MAX_FRAME = 512;  // ATT value limit
+  static constexpr size_t MAX_DEFERRED = 16;
+
+  struct LinkStats {
+    uint32_t accepted{0};
+    uint32_t rejected{0};  // buffer full
+    uint32_t failed{0};    // write_fail_rate
+    uint32_t delivered{0};
+    uint32_t lost{0};      // retransmitted sends
+    uint32_t congestions{0};
+    uint32_t max_queued{0};
+    uint64_t latency_us_total{0};
+    uint32_t latency_us_max{0};
+
+    uint32_t latency_us_avg() const {
+      return delivered == 0 ? 0 : (uint32_t)(latency_us_total / delivered);
+    }
+  };
+
+  struct Delivery {
+    uint64_t t_us;
+    uint16_t conn_id;
+    uint16_t handle;
+    std::vector<uint8_t> data;
+  };
+
+  explicit BleLinkSim(uint64_t seed = 1) : rng_(seed) {}
+  ~BleLinkSim() override { uninstall(); }
+
+  void install() { mock_ble_link() = this; }
+  void uninstall() {
+    if (mock_ble_link() == this) mock_ble_link() = nullptr;
+  }
+
+  // Keyed by the client's conn id; events go to the client's nodes. The
+  // first connection event is one interval from now.
+  bool add_link(esphome::ble_client::BLEClient *client,
+                const BleLinkParams &params = BleLinkParams()) {
+    if (count_ >= MAX_LINKS) return false;
+    Link &l = links_[count_++];
+    l = Link();
+    l.client = client;
+    l.conn_id = client->get_conn_id();
+    l.params = params;
+    if (l.params.buffer_depth == 0) l.params.buffer_depth = 1;
+    if (l.params.buffer_depth > MAX_DEPTH) l.params.buffer_depth = MAX_DEPTH;
+    if (l.params.congest_clear >= l.params.buffer_depth)
+      l.params.congest_clear = l.params.buffer_depth - 1;
+    if (l.params.interval_us == 0) l.params.interval_us = 1;
+    l.next_event_us = now_us_ + l.params.interval_us;
+    return true;
+  }
+
+  esp_err_t write(uint16_t conn_id, uint16_t handle, uint16_t len,
+                  const uint8_t *data) override {
+    Link *l = find_(conn_id);
+    if (l == nullptr) return ESP_OK;
+    if (l->params.write_fail_rate > 0.0f &&
+        uniform_() < l->params.write_fail_rate) {
+      l->stats.failed++;
+      return ESP_FAIL;
+    }
+    if (l->queued >= l->params.buffer_depth) {
+      l->stats.rejected++;
+      return ESP_FAIL;
+    }
+    Frame &f = l->frames[(l->head + l->queued) % MAX_DEPTH];
+    f.handle = handle;
+    f.len = len < MAX_FRAME ? len : MAX_FRAME;
+    memcpy(f.data, data, f.len);
+    f.queued_us = now_us_;
+    l->queued++;
+    l->stats.accepted++;
+    if (l->queued > l->stats.max_queued) l->stats.max_queued = l->queued;
+    if (l->queued >= l->params.buffer_depth && !l->congested) {
+      // Reported asynchronously, as the stack does
+      l->congested = true;
+      l->stats.congestions++;
+      defer_congest_(l, true);
+    }
+    return ESP_OK;
+  }
+
+  // Runs every connection event up to now_us, in time order across links
+  void run_until(uint64_t now_us) {
+    flush_deferred_();
+    for (;;) {
+      Link *next = nullptr;
+      for (size_t i = 0; i < count_; i++)
+        if (next == nullptr || links_[i].next_event_us < next->next_event_us)
+          next = &links_[i];
+      if (next == nullptr || next->next_event_us > now_us) break;
+      set_clock_(next->next_event_us);
+      connection_event_(*next);
+      next->next_event_us += next->params.interval_us;
+    }
+    set_clock_(now_us);
+  }
+
+  void advance_ms(uint32_t ms) { run_until(now_us_ + (uint64_t)ms * 1000); }
+  void advance_us(uint32_t us) { run_until(now_us_ + us); }
+
+  uint64_t now_us() const { return now_us_; }
+  // Starting time for a test; only before the first add_link()
+  void set_now_us(uint64_t t_us) { set_clock_(t_us); }
+
+  const LinkStats *stats(uint16_t conn_id) const {
+    const Link *l = find_(conn_id);
+    return l == nullptr ? nullptr : &l->stats;
+  }
+  size_t queued(uint16_t conn_id) const {
+    const Link *l = find_(conn_id);
+    return l == nullptr ? 0 : l->queued;
+  }
+  bool congested(uint16_t conn_id) const {
+    const Link *l = find_(conn_id);
+    return l != nullptr && l->congested;
+  }
+
+  void record_deliveries(bool on) { record_ = on; }
+  const std::vector<Delivery> &deliveries() const { return deliveries_; }
+
+ protected:
+  struct Frame {
+    uint16_t handle{0};
+    uint16_t len{0};
+    uint64_t queued_us{0};
+    uint8_t data[MAX_FRAME];
+  };
+
+  struct Link {
+    esphome::ble_client::BLEClient *client{nullptr};
+    uint16_t conn_id{0};
+    BleLinkParams params;
+    Frame frames[MAX_DEPTH];
+    size_t head{0};
+    size_t queued{0};
+    bool congested{false};
+    uint64_t next_event_us{0};
+    LinkStats stats;
+  };
+
+  struct Deferred {
+    Link *link;
+    bool congested;
+  };
+
+  Link *find_(uint16_t conn_id) {
+    for (size_t i = 0; i < count_; i++)
+      if (links_[i].conn_id == conn_id) return &links_[i];
+    return nullptr;
+  }
+  const Link *find_(uint16_t conn_id) const {
+    for (size_t i = 0; i < count_; i++)
+      if (links_[i].conn_id == conn_id) return &links_[i];
+    return nullptr;
+  }
+
+  void set_clock_(uint64_t t_us) {
+    now_us_ = t_us;
+    mock_millis_value() = (uint32_t)(t_us / 1000);
+    mock_micros_value() = (uint32_t)t_us;
+  }
+
+  void connection_event_(Link &l) {
+    for (uint8_t slot = 0; slot < l.params.writes_per_event && l.queued > 0;
+         slot++) {
+      if (l.params.loss_rate > 0.0f && uniform_() < l.params.loss_rate) {
+        l.stats.lost++;
+        continue;
+      }
+      Frame &f = l.frames[l.head];
+      l.head = (l.head + 1) % MAX_DEPTH;
+      l.queued--;
+      uint32_t latency = (uint32_t)(now_us_ - f.queued_us);
+      l.stats.delivered++;
+      l.stats.latency_us_total += latency;
+      if (latency > l.stats.latency_us_max) l.stats.latency_us_max = latency;
+      if (record_)
+        deliveries_.push_back(Delivery{now_us_, l.conn_id, f.handle,
+                                       std::vector<uint8_t>(f.data, f.data + f.len)});
+      esp_ble_gattc_cb_param_t param{};
+      param.write.status = ESP_GATT_OK;
+      param.write.conn_id = l.conn_id;
+      param.write.handle = f.handle;
+      l.client->dispatch_gattc_event(ESP_GATTC_WRITE_CHAR_EVT, &param);
+    }
+    if (l.congested && l.queued <= l.params.congest_clear) {
+      l.congested = false;
+      dispatch_congest_(l, false);
+    }
+  }
+
+  void defer_congest_(Link *l, bool congested) {
+    if (deferred_count_ < MAX_DEFERRED)
+      deferred_[deferred_count_++] = Deferred{l, congested};
+  }
+
+  void flush_deferred_() {
+    for (size_t i = 0; i < deferred_count_; i++)
+      dispatch_congest_(*deferred_[i].link, deferred_[i].congested);
+    deferred_count_ = 0;
+  }
+
+  static void dispatch_congest_(Link &l, bool congested) {
+    esp_ble_gattc_cb_param_t param{};
+    param.congest.conn_id = l.conn_id;
+    param.congest.congested = congested;
+    l.client->dispatch_gattc_event(ESP_GATTC_CONGEST_EVT, &param);
+  }
+
+  // splitmix64; the top 24 bits as a float in [0, 1)
+  float uniform_() {
+    uint64_t z = (rng_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (float)(z >> 40) * (1.0f / 16777216.0f);
+  }
+
+  Link links_[MAX_LINKS];
+  size_t count_{0};
+  Deferred deferred_[MAX_DEFERRED];
+  size_t deferred_count_{0};
+  uint64_t rng_;
+  uint64_t now_us_{0};
+  bool record_{false};
+  std::vector<Delivery> deliveries_;
+};
@@ -0,0 +1,2 @@
+#pragma once
+// Stub — real types provided by esphome_mock.h
@@ -0,0 +1,3 @@
+#pragma once
+// Stub — forwards to the real component under esphome/components
+#include "xenopixel_light/xenopixel_light.h"
@@ -0,0 +1,3 @@
+#pragma once
+// Stub — micros() and the log macros come from esphome_mock.h
+#include "esphome_mock.h"
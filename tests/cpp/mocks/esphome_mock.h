@@ -15,10 +15,295 @@ using esp_gatt_write_type_t = int;
 using esp_gatt_auth_req_t = int;
 
 constexpr esp_err_t ESP_OK = 0;
+constexpr esp_err_t ESP_FAIL = -1;
+constexpr esp_err_t ESP_ERR_INVALID_STATE = 0x103;
 constexpr int ESP_GATT_WRITE_TYPE_NO_RSP = 1;
 constexpr int ESP_GATT_AUTH_REQ_NONE = 0;
 
+enum esp_gatt_status_t {
+  ESP_GATT_OK = 0,
+  ESP_GATT_INVALID_HANDLE = 0x01,
+  ESP_GATT_NOT_FOUND = 0x0A,
+  ESP_GATT_ERROR = 0x85,
+};
+
+enum esp_gattc_cb_event_t {
+  ESP_GATTC_OPEN_EVT = 2,
+  ESP_GATTC_WRITE_CHAR_EVT = 4,
+  ESP_GATTC_SEARCH_CMPL_EVT = 6,
+  ESP_GATTC_WRITE_DESCR_EVT = 9,
+  ESP_GATTC_CFG_MTU_EVT = 18,
+  ESP_GATTC_DISCONNECT_EVT = 41,
+  ESP_GATTC_CONGEST_EVT = 42,
+  ESP_GATTC_SRVC_CHG_EVT = 43,
+};
+
+using esp_bd_addr_t = uint8_t[6];
+
+// Only the members xenopixel_light.h reads. The real type is a union.
+struct esp_ble_gattc_cb_param_t {
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    esp_bd_addr_t remote_bda;
+  } open;
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+  } search_cmpl;
+  struct {
+    uint16_t conn_id;
+    bool congested;
+  } congest;
+  struct {
+    uint16_t conn_id;
+  } disconnect;
+  // Shared by WRITE_CHAR and WRITE_DESCR, as in ESP-IDF
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    uint16_t handle;
+  } write;
+  struct {
+    esp_bd_addr_t remote_bda;
+  } srvc_chg;
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    uint16_t mtu;
+  } cfg_mtu;
+};
+
+constexpr uint16_t ESP_GATT_DEF_BLE_MTU_SIZE = 23;
+constexpr uint16_t ESP_GATT_MAX_MTU_SIZE = 517;
+
+// ── GATTC attribute cache ───────────────────────────────────────────────────
+constexpr uint8_t ESP_UUID_LEN_16 = 2;
+constexpr uint16_t ESP_GATT_UUID_CHAR_CLIENT_CONFIG = 0x2902;
+constexpr int ESP_GATT_WRITE_TYPE_RSP = 2;
+
+struct esp_bt_uuid_t {
+  uint16_t len;
+  union {
+    uint16_t uuid16;
+    uint32_t uuid32;
+    uint8_t uuid128[16];
+  } uuid;
+};
+
+enum esp_gatt_db_attr_type_t {
+  ESP_GATT_DB_PRIMARY_SERVICE,
+  ESP_GATT_DB_SECONDARY_SERVICE,
+  ESP_GATT_DB_CHARACTERISTIC,
+  ESP_GATT_DB_DESCRIPTOR,
+};
+
+struct esp_gattc_service_elem_t {
+  bool is_primary;
+  uint16_t start_handle;
+  uint16_t end_handle;
+  esp_bt_uuid_t uuid;
+};
+
+struct esp_gattc_char_elem_t {
+  uint16_t char_handle;
+  uint8_t properties;
+  esp_bt_uuid_t uuid;
+};
+
+struct esp_gattc_descr_elem_t {
+  uint16_t handle;
+  esp_bt_uuid_t uuid;
+};
+
+struct esp_gattc_db_elem_t {
+  esp_gatt_db_attr_type_t type;
+  uint16_t attribute_handle;
+  uint16_t start_handle;
+  uint16_t end_handle;
+  uint8_t properties;
+  esp_bt_uuid_t uuid;
+};
+
+// Fake GATTC cache: 16-bit UUID attributes. For services `end` is the last
+// handle, for descriptors `owner` is the characteristic's value handle.
+struct MockGattAttr {
+  esp_gatt_db_attr_type_t type;
+  uint16_t handle;
+  uint16_t uuid;
+  uint16_t end;
+  uint16_t owner;
+};
+
+inline std::vector<MockGattAttr> &mock_gatt_db() {
+  static std::vector<MockGattAttr> db;
+  return db;
+}
+
+// Number of esp_ble_gattc_get_* calls, to check what the cache saves
+inline int &mock_gatt_lookups() {
+  static int n = 0;
+  return n;
+}
+
+// The table from PROTOCOL.md
+inline void mock_install_xenopixel_gatt_db() {
+  mock_gatt_db() = {
+      {ESP_GATT_DB_PRIMARY_SERVICE, 6, 0x1801, 9, 0},
+      {ESP_GATT_DB_CHARACTERISTIC, 8, 0x2A05, 0, 0},
+      {ESP_GATT_DB_DESCRIPTOR, 9, 0x2902, 0, 8},
+      {ESP_GATT_DB_PRIMARY_SERVICE, 10, 0xDAE0, 13, 0},
+      {ESP_GATT_DB_CHARACTERISTIC, 12, 0xDAE1, 0, 0},
+      {ESP_GATT_DB_DESCRIPTOR, 13, 0x2902, 0, 12},
+      {ESP_GATT_DB_PRIMARY_SERVICE, 14, 0x3AB0, 17, 0},
+      {ESP_GATT_DB_CHARACTERISTIC, 16, 0x3AB1, 0, 0},
+      {ESP_GATT_DB_DESCRIPTOR, 17, 0x2902, 0, 16},
+  };
+}
+
+inline esp_bt_uuid_t mock_uuid16(uint16_t v) {
+  esp_bt_uuid_t u{};
+  u.len = ESP_UUID_LEN_16;
+  u.uuid.uuid16 = v;
+  return u;
+}
+
+inline esp_gatt_status_t esp_ble_gattc_get_service(
+    esp_gatt_if_t, uint16_t, esp_bt_uuid_t *svc_uuid,
+    esp_gattc_service_elem_t *result, uint16_t *count, uint16_t) {
+  mock_gatt_lookups()++;
+  for (const auto &a : mock_gatt_db()) {
+    if (a.type != ESP_GATT_DB_PRIMARY_SERVICE || a.uuid != svc_uuid->uuid.uuid16)
+      continue;
+    *result = {true, a.handle, a.end, mock_uuid16(a.uuid)};
+    *count = 1;
+    return ESP_GATT_OK;
+  }
+  *count = 0;
+  return ESP_GATT_NOT_FOUND;
+}
+
+inline esp_gatt_status_t esp_ble_gattc_get_char_by_uuid(
+    esp_gatt_if_t, uint16_t, uint16_t start_handle, uint16_t end_handle,
+    esp_bt_uuid_t char_uuid, esp_gattc_char_elem_t *result, uint16_t *count) {
+  mock_gatt_lookups()++;
+  for (const auto &a : mock_gatt_db()) {
+    if (a.type != ESP_GATT_DB_CHARACTERISTIC || a.uuid != char_uuid.uuid.uuid16 ||
+        a.handle < start_handle || a.handle > end_handle)
+      continue;
+    *result = {a.handle, 0, mock_uuid16(a.uuid)};
+    *count = 1;
+    return ESP_GATT_OK;
+  }
+  *count = 0;
+  return ESP_GATT_NOT_FOUND;
+}
+
+inline esp_gatt_status_t esp_ble_gattc_get_descr_by_char_handle(
+    esp_gatt_if_t, uint16_t, uint16_t char_handle, esp_bt_uuid_t descr_uuid,
+    esp_gattc_descr_elem_t *result, uint16_t *count) {
+  mock_gatt_lookups()++;
+  for (const auto &a : mock_gatt_db()) {
+    if (a.type != ESP_GATT_DB_DESCRIPTOR || a.owner != char_handle ||
+        a.uuid != descr_uuid.uuid.uuid16)
+      continue;
+    *result = {a.handle, mock_uuid16(a.uuid)};
+    *count = 1;
+    return ESP_GATT_OK;
+  }
+  *count = 0;
+  return ESP_GATT_NOT_FOUND;
+}
+
+inline esp_gatt_status_t esp_ble_gattc_get_db(esp_gatt_if_t, uint16_t,
+                                              uint16_t start_handle,
+                                              uint16_t end_handle,
+                                              esp_gattc_db_elem_t *db,
+                                              uint16_t *count) {
+  mock_gatt_lookups()++;
+  uint16_t n = 0;
+  for (const auto &a : mock_gatt_db()) {
+    if (n >= *count) break;
+    if (a.handle < start_handle || a.handle > end_handle) continue;
+    db[n++] = {a.type, a.handle, a.handle, a.end, 0, mock_uuid16(a.uuid)};
+  }
+  *count = n;
+  return n > 0 ? ESP_GATT_OK : ESP_GATT_NOT_FOUND;
+}
+
+struct MockDescrWrite {
+  uint16_t handle;
+  std::vector<uint8_t> value;
+};
+
+inline std::vector<MockDescrWrite> &g_descr_writes() {
+  static std::vector<MockDescrWrite> writes;
+  return writes;
+}
+
+inline std::vector<uint16_t> &g_notify_registrations() {
+  static std::vector<uint16_t> handles;
+  return handles;
+}
+
+inline esp_err_t esp_ble_gattc_register_for_notify(esp_gatt_if_t,
+                                                   uint8_t *, uint16_t handle) {
+  g_notify_registrations().push_back(handle);
+  return ESP_OK;
+}
+
+inline esp_err_t esp_ble_gattc_write_char_descr(esp_gatt_if_t, uint16_t,
+                                                uint16_t handle,
+                                                uint16_t value_len,
+                                                uint8_t *value,
+                                                esp_gatt_write_type_t,
+                                                esp_gatt_auth_req_t) {
+  g_descr_writes().push_back({handle, std::vector<uint8_t>(value, value + value_len)});
+  return ESP_OK;
+}
+
+enum esp_gap_ble_cb_event_t {
+  ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT = 20,
+};
+
+using esp_bt_status_t = int;
+constexpr esp_bt_status_t ESP_BT_STATUS_SUCCESS = 0;
+
+// Only the members xenopixel_light.h reads. The real type is a union.
+struct esp_ble_gap_cb_param_t {
+  struct {
+    esp_bt_status_t status;
+    esp_bd_addr_t bda;
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t conn_int;
+    uint16_t timeout;
+  } update_conn_params;
+};
+
+struct esp_ble_conn_update_params_t {
+  esp_bd_addr_t bda;
+  uint16_t min_int;
+  uint16_t max_int;
+  uint16_t latency;
+  uint16_t timeout;
+};
+
+// Every esp_ble_gap_update_conn_params() request, in order
+inline std::vector<esp_ble_conn_update_params_t> &g_conn_param_requests() {
+  static std::vector<esp_ble_conn_update_params_t> requests;
+  return requests;
+}
+
+inline esp_err_t esp_ble_gap_update_conn_params(
+    esp_ble_conn_update_params_t *params) {
+  g_conn_param_requests().push_back(*params);
+  return ESP_OK;
+}
+
 // ── Logging macros (no-op) ──────────────────────────────────────────────────
+#define ESP_LOGV(tag, fmt, ...)
 #define ESP_LOGD(tag, fmt, ...)
 #define ESP_LOGI(tag, fmt, ...)
 #define ESP_LOGW(tag, fmt, ...)
@@ -31,6 +316,13 @@ inline uint32_t &mock_millis_value() {
 }
 inline uint32_t millis() { return mock_millis_value(); }
 
+// ── Controllable micros() ───────────────────────────────────────────────────
+inline uint32_t &mock_micros_value() {
+  static uint32_t val = 0;
+  return val;
+}
+inline uint32_t micros() { return mock_micros_value(); }
+
 // ── BLE write capture ───────────────────────────────────────────────────────
 struct BLEWriteRecord {
   uint16_t handle;
@@ -42,11 +334,50 @@ inline std::vector<BLEWriteRecord> &g_ble_writes() {
   return writes;
 }
 
+// Status returned by the next esp_ble_gattc_write_char calls. Failed writes
+// are not recorded in g_ble_writes().
+inline esp_err_t &mock_ble_write_status() {
+  static esp_err_t status = ESP_OK;
+  return status;
+}
+
+// The benchmarks turn recording off so the mock does not allocate; writes
+// are then only counted
+inline bool &mock_record_ble_writes() {
+  static bool record = true;
+  return record;
+}
+inline uint32_t &mock_ble_write_count() {
+  static uint32_t count = 0;
+  return count;
+}
+
+// A simulated link behind esp_ble_gattc_write_char (ble_link_sim.h). With
+// none installed every write is accepted at once.
+class MockBleLink {
+ public:
+  virtual ~MockBleLink() = default;
+  virtual esp_err_t write(uint16_t conn_id, uint16_t handle, uint16_t len,
+                          const uint8_t *data) = 0;
+};
+
+inline MockBleLink *&mock_ble_link() {
+  static MockBleLink *link = nullptr;
+  return link;
+}
+
 inline esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t, uint16_t conn_id,
                                            uint16_t handle, uint16_t len,
                                            uint8_t *data,
                                            esp_gatt_write_type_t,
                                            esp_gatt_auth_req_t) {
+  if (mock_ble_write_status() != ESP_OK) return mock_ble_write_status();
+  if (mock_ble_link() != nullptr) {
+    esp_err_t err = mock_ble_link()->write(conn_id, handle, len, data);
+    if (err != ESP_OK) return err;
+  }
+  mock_ble_write_count()++;
+  if (!mock_record_ble_writes()) return ESP_OK;
   g_ble_writes().push_back(
       {handle, std::string(reinterpret_cast<char *>(data), len)});
   return ESP_OK;
@@ -67,6 +398,27 @@ class Component {
   virtual float get_setup_priority() const { return 0.0f; }
 };
 
+namespace esp32_ble {
+
+class GAPEventHandler {
+ public:
+  virtual ~GAPEventHandler() = default;
+  virtual void gap_event_handler(esp_gap_ble_cb_event_t event,
+                                 esp_ble_gap_cb_param_t *param) = 0;
+};
+
+class ESP32BLE {
+ public:
+  void register_gap_event_handler(GAPEventHandler *handler) {
+    gap_handlers.push_back(handler);
+  }
+  std::vector<GAPEventHandler *> gap_handlers;
+};
+
+inline ESP32BLE *global_ble = nullptr;
+
+}  // namespace esp32_ble
+
 namespace esp32_ble_tracker {
 
 class ESPBTUUID {
@@ -82,11 +434,43 @@ struct BLECharacteristic {
   uint16_t handle{0};
 };
 
+class BLEClient;
+
+class BLEClientNode {
+ public:
+  virtual ~BLEClientNode() = default;
+  virtual void gattc_event_handler(esp_gattc_cb_event_t event,
+                                   esp_gatt_if_t gattc_if,
+                                   esp_ble_gattc_cb_param_t *param) = 0;
+  virtual void loop() {}
+  void set_ble_client_parent(BLEClient *parent) { parent_ = parent; }
+  BLEClient *parent() { return parent_; }
+
+ protected:
+  BLEClient *parent_{nullptr};
+};
+
 class BLEClient {
  public:
+  void register_ble_node(BLEClientNode *node) {
+    node->set_ble_client_parent(this);
+    nodes_.push_back(node);
+  }
+
+  // Test helper: deliver a GATTC event to every registered node. Like
+  // BLEClientBase, the client takes the MTU of a successful exchange first.
+  void dispatch_gattc_event(esp_gattc_cb_event_t event,
+                            esp_ble_gattc_cb_param_t *param) {
+    if (event == ESP_GATTC_CFG_MTU_EVT && param->cfg_mtu.conn_id == conn_id_ &&
+        param->cfg_mtu.status == ESP_GATT_OK)
+      mtu_ = param->cfg_mtu.mtu;
+    for (auto *node : nodes_) node->gattc_event_handler(event, gattc_if_, param);
+  }
+
   void set_mock_characteristic(BLECharacteristic *chr) { mock_chr_ = chr; }
   void set_gattc_if(esp_gatt_if_t gattc_if) { gattc_if_ = gattc_if; }
   void set_conn_id(uint16_t conn_id) { conn_id_ = conn_id; }
+  void set_remote_bda(const uint8_t (&bda)[6]) { memcpy(remote_bda_, bda, 6); }
 
   BLECharacteristic *get_characteristic(esp32_ble_tracker::ESPBTUUID,
                                          esp32_ble_tracker::ESPBTUUID) {
@@ -95,11 +479,20 @@ class BLEClient {
 
   esp_gatt_if_t get_gattc_if() { return gattc_if_; }
   uint16_t get_conn_id() { return conn_id_; }
+  uint8_t *get_remote_bda() { return remote_bda_; }
+  uint16_t get_mtu() const { return mtu_; }
+
+  void disconnect() { disconnects_++; }
+  int disconnect_count() const { return disconnects_; }
 
  private:
+  std::vector<BLEClientNode *> nodes_;
   BLECharacteristic *mock_chr_{nullptr};
   esp_gatt_if_t gattc_if_{0};
   uint16_t conn_id_{0};
+  esp_bd_addr_t remote_bda_{};
+  uint16_t mtu_{ESP_GATT_DEF_BLE_MTU_SIZE};
+  int disconnects_{0};
 };
 
 }  // namespace ble_client
@@ -139,6 +532,15 @@ class LightColorValues {
  public:
   bool is_on() const { return is_on_; }
   float get_brightness() const { return brightness_; }
+  float get_red() const { return r_; }
+  float get_green() const { return g_; }
+  float get_blue() const { return b_; }
+
+  bool operator==(const LightColorValues &o) const {
+    return is_on_ == o.is_on_ && brightness_ == o.brightness_ && r_ == o.r_ &&
+           g_ == o.g_ && b_ == o.b_;
+  }
+  bool operator!=(const LightColorValues &o) const { return !(*this == o); }
 
   // ESPHome's as_rgb bakes brightness into the values
   void as_rgb(float *r, float *g, float *b) const {
@@ -162,18 +564,94 @@ class LightColorValues {
   float r_{1.0f}, g_{1.0f}, b_{1.0f};
 };
 
+class LightState;
+
+// Only immediate calls: perform() sets the target as both the remote and
+// the current values, as a zero-length transition does
+class LightCall {
+ public:
+  explicit LightCall(LightState *state) : state_(state) {}
+  LightCall &set_state(bool on) {
+    values_.set_state(on);
+    return *this;
+  }
+  LightCall &set_brightness(float v) {
+    values_.set_brightness(v);
+    return *this;
+  }
+  LightCall &set_rgb(float r, float g, float b) {
+    values_.set_rgb(r, g, b);
+    return *this;
+  }
+  LightCall &set_transition_length(uint32_t ms) {
+    transition_ms_ = ms;
+    return *this;
+  }
+  LightCall &set_publish(bool publish) {
+    publish_ = publish;
+    return *this;
+  }
+  LightCall &set_save(bool save) {
+    save_ = save;
+    return *this;
+  }
+  inline void perform();
+
+ private:
+  LightState *state_;
+  LightColorValues values_;
+  uint32_t transition_ms_{0};
+  bool publish_{true};
+  bool save_{true};
+};
+
+// remote_values is the target of a running transition; equal to
+// current_values when none runs
 class LightState {
  public:
   LightColorValues current_values;
+  LightColorValues remote_values;
+
+  LightCall make_call() { return LightCall(this); }
+  void publish_state() { publishes++; }
+
+  // Test helper: publish_state() calls so far
+  int publishes{0};
 };
 
+inline void LightCall::perform() {
+  state_->remote_values = values_;
+  state_->current_values = values_;
+  if (publish_) state_->publish_state();
+}
+
 class LightOutput {
  public:
   virtual ~LightOutput() = default;
   virtual LightTraits get_traits() = 0;
+  virtual void setup_state(LightState *state) { (void)state; }
   virtual void write_state(LightState *state) = 0;
 };
 
+class LightEffect {
+ public:
+  explicit LightEffect(const char *name) : name_(name) {}
+  virtual ~LightEffect() = default;
+  virtual void start() {}
+  virtual void stop() {}
+  virtual void apply() = 0;
+  virtual void init() {}
+  void init_internal(LightState *state) {
+    state_ = state;
+    init();
+  }
+  const std::string &get_name() const { return name_; }
+
+ protected:
+  LightState *state_{nullptr};
+  std::string name_;
+};
+
 }  // namespace light
 }  // namespace esphome
 
@@ -183,3 +661,4 @@ class LightOutput {
 #define ESPHOME_COMPONENTS_BLE_CLIENT_BLE_CLIENT_H_
 #define ESPHOME_COMPONENTS_GLOBALS_GLOBALS_COMPONENT_H_
 #define ESPHOME_COMPONENTS_LIGHT_LIGHT_OUTPUT_H_
+#define ESPHOME_COMPONENTS_LIGHT_LIGHT_EFFECT_H_
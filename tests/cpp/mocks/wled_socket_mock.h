@@ -0,0 +1,95 @@
+#pragma once
+// Injectable WledSocket for host tests and benchmarks.
+//
+// Datagrams queued with inject() come out of recv() in order, as from a
+// real UDP socket, so the receiver's drain, source filtering and the hub's
+// fan-out all run unmodified. The queue is a fixed ring; nothing allocates.
+//
+//   MockWledSocket sock;
+//   WledReceiver::instance().set_socket(&sock);
+//   sock.inject(pkt, sizeof(pkt));
+//   light.loop();  // polls the receiver, which drains sock
+//   WledReceiver::instance().set_socket(nullptr);
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "esphome_mock.h"
+#include "xenopixel_light/wled_receiver.h"
+
+class MockWledSocket : public esphome::xenopixel_light::WledSocket {
+ public:
+  static constexpr size_t MAX_QUEUED = 16;
+
+  // Network byte order, as the receiver compares it
+  static uint32_t addr(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    const uint8_t octets[4] = {a, b, c, d};
+    uint32_t out;
+    memcpy(&out, octets, sizeof(out));
+    return out;
+  }
+
+  bool open(uint16_t port, uint32_t multicast_group) override {
+    open_calls_++;
+    if (!openable_) return false;
+    port_ = port;
+    multicast_group_ = multicast_group;
+    return true;
+  }
+
+  int recv(uint8_t *buf, size_t cap, bool block, uint32_t &from) override {
+    (void)block;
+    recv_calls_++;
+    if (count_ == 0) return 0;
+    Datagram &d = queue_[head_];
+    head_ = (head_ + 1) % MAX_QUEUED;
+    count_--;
+    size_t n = d.len < cap ? d.len : cap;
+    memcpy(buf, d.data, n);
+    from = d.from;
+    return (int)n;
+  }
+
+  // False when the queue is full, like a datagram dropped by the stack
+  bool inject(const uint8_t *data, size_t len,
+              uint32_t from = addr(192, 168, 1, 50)) {
+    if (count_ >= MAX_QUEUED) return false;
+    Datagram &d = queue_[(head_ + count_) % MAX_QUEUED];
+    d.len = len < sizeof(d.data) ? len : sizeof(d.data);
+    memcpy(d.data, data, d.len);
+    d.from = from;
+    count_++;
+    return true;
+  }
+  bool inject(const std::vector<uint8_t> &data,
+              uint32_t from = addr(192, 168, 1, 50)) {
+    return inject(data.data(), data.size(), from);
+  }
+
+  // Emulates WiFi not being up yet
+  void set_openable(bool openable) { openable_ = openable; }
+
+  size_t pending() const { return count_; }
+  uint32_t open_calls() const { return open_calls_; }
+  uint32_t recv_calls() const { return recv_calls_; }
+  uint16_t port() const { return port_; }
+  uint32_t multicast_group() const { return multicast_group_; }
+
+ protected:
+  struct Datagram {
+    size_t len{0};
+    uint32_t from{0};
+    uint8_t data[esphome::xenopixel_light::WLED_PACKET_MAX];
+  };
+
+  Datagram queue_[MAX_QUEUED];
+  size_t head_{0};
+  size_t count_{0};
+  bool openable_{true};
+  uint32_t open_calls_{0};
+  uint32_t recv_calls_{0};
+  uint16_t port_{0};
+  uint32_t multicast_group_{0};
+};
@@ -0,0 +1,182 @@
+// xenopixel_replay: drives XenopixelLight from recorded traces on the
+// unit-test mocks and reports what it sent (replay_session.h).
+//
+//   xenopixel_replay [--wled show.pcap] [--notify btsnoop_hci.log|Log.txt]
+//                    [options]
+//
+// Exits 0 when the saber ends up showing what the trace asked for, 2 when
+// it does not, 1 on bad arguments or unreadable traces.
+#include "replay_session.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace esphome::xenopixel_light;
+using namespace esphome::xenopixel_light::replay;
+
+namespace {
+
+void usage(FILE *out) {
+  fprintf(out,
+          "usage: xenopixel_replay [--wled FILE] [--notify FILE] [options]\n"
+          "\n"
+          "  --wled FILE            pcap capture of WLED UDP traffic\n"
+          "  --port N               UDP port in the capture (default %u)\n"
+          "  --notify FILE          btsnoop_hci.log or nRF Connect log\n"
+          "  --dae1-handle N        DAE1 value handle in a btsnoop log\n"
+          "  --3ab1-handle N        3AB1 value handle in a btsnoop log\n"
+          "  --notify-offset-ms N   shift notifications against the capture\n"
+          "  --window START:COUNT   pixel window for realtime frames\n"
+          "  --smoothing-ms N       wled_smoothing delay (default 0, off)\n"
+          "  --color-interval MIN:MAX  color rate limiter bounds in ms\n"
+          "  --no-combine           single-key frames only\n"
+          "  --mtu N                ATT MTU after the exchange (default 247)\n"
+          "  --loop-ms N            main loop period (default 16)\n"
+          "  --write-latency-ms N   write to WRITE_CHAR_EVT (default 15)\n"
+          "  --echo-ms N            write to 3AB1 brightness echo, 0 for none\n"
+          "                         (default 30)\n"
+          "  --settle-ms N          run time after the last event (default "
+          "2000)\n",
+          (unsigned)WLED_DEFAULT_PORT);
+}
+
+bool parse_u32(const char *s, uint32_t &out) {
+  char *end;
+  unsigned long v = strtoul(s, &end, 0);
+  if (*s == '\0' || *end != '\0') return false;
+  out = (uint32_t)v;
+  return true;
+}
+
+bool parse_pair(const char *s, uint32_t &a, uint32_t &b) {
+  const char *colon = strchr(s, ':');
+  if (colon == nullptr) return false;
+  char first[16];
+  size_t n = (size_t)(colon - s);
+  if (n == 0 || n >= sizeof(first)) return false;
+  memcpy(first, s, n);
+  first[n] = '\0';
+  return parse_u32(first, a) && parse_u32(colon + 1, b);
+}
+
+void print_report(const ReplayReport &r) {
+  printf("Replayed %u WLED packets and %u notifications over %.1fs\n",
+         (unsigned)r.wled_packets, (unsigned)r.notifications,
+         r.duration_us / 1e6);
+  printf("BLE writes:  %u (%.1f/s average, %u in the busiest second)\n",
+         (unsigned)r.writes, r.writes_per_s(), (unsigned)r.peak_writes_per_s);
+  printf("Changes:     %u requested, %u shown, %u superseded, %u never shown\n",
+         (unsigned)r.changes, (unsigned)r.changes_shown,
+         (unsigned)r.changes_superseded, (unsigned)r.changes_unshown);
+  if (!r.lag_ms.empty())
+    printf("Lag:         p50 %ums, p90 %ums, p99 %ums, max %ums\n",
+           (unsigned)r.lag_percentile_ms(0.5f),
+           (unsigned)r.lag_percentile_ms(0.9f),
+           (unsigned)r.lag_percentile_ms(0.99f), (unsigned)r.lag_ms.back());
+  printf("TX queue:    %u enqueued, %u coalesced, %u dropped, %u keepalives\n",
+         (unsigned)r.tx.enqueued, (unsigned)r.tx.coalesced,
+         (unsigned)r.tx.dropped, (unsigned)r.tx.keepalives);
+  if (Instrumentation::ENABLED)
+    printf("Debounced:   %u colors replaced while waiting for the limiter\n",
+           (unsigned)r.debounced);
+  printf("Final state: %s (expected %s, saber shows %s)\n",
+         r.final_state_ok() ? "OK" : "MISMATCH", r.expected.describe().c_str(),
+         r.shown.describe().c_str());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ReplayOptions opts;
+  const char *wled_path = nullptr;
+  const char *notify_path = nullptr;
+  uint32_t port = WLED_DEFAULT_PORT;
+  BtsnoopReader::Handles handles;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+      usage(stdout);
+      return 0;
+    }
+    if (strcmp(arg, "--no-combine") == 0) {
+      opts.combine = false;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      fprintf(stderr, "%s needs a value\n", arg);
+      usage(stderr);
+      return 1;
+    }
+    const char *val = argv[++i];
+    uint32_t n = 0, m = 0;
+    bool ok = true;
+    if (strcmp(arg, "--wled") == 0) {
+      wled_path = val;
+    } else if (strcmp(arg, "--notify") == 0) {
+      notify_path = val;
+    } else if (strcmp(arg, "--port") == 0) {
+      ok = parse_u32(val, port) && port > 0 && port <= 0xFFFF;
+    } else if (strcmp(arg, "--dae1-handle") == 0) {
+      ok = parse_u32(val, n) && n <= 0xFFFF;
+      handles.dae1 = (uint16_t)n;
+    } else if (strcmp(arg, "--3ab1-handle") == 0) {
+      ok = parse_u32(val, n) && n <= 0xFFFF;
+      handles.ab1 = (uint16_t)n;
+    } else if (strcmp(arg, "--notify-offset-ms") == 0) {
+      char *end;
+      opts.notify_offset_ms = strtoll(val, &end, 0);
+      ok = *val != '\0' && *end == '\0';
+    } else if (strcmp(arg, "--window") == 0) {
+      ok = parse_pair(val, n, m) && n <= 0xFFFF && m > 0 && m <= 0xFFFF;
+      opts.window.start = (uint16_t)n;
+      opts.window.count = (uint16_t)m;
+    } else if (strcmp(arg, "--smoothing-ms") == 0) {
+      ok = parse_u32(val, opts.smoothing_ms);
+    } else if (strcmp(arg, "--color-interval") == 0) {
+      ok = parse_pair(val, opts.color_min_ms, opts.color_max_ms) &&
+           opts.color_min_ms <= opts.color_max_ms;
+    } else if (strcmp(arg, "--mtu") == 0) {
+      ok = parse_u32(val, n) && n >= 23 && n <= 517;
+      opts.att_mtu = (uint16_t)n;
+    } else if (strcmp(arg, "--loop-ms") == 0) {
+      ok = parse_u32(val, opts.loop_ms) && opts.loop_ms > 0;
+    } else if (strcmp(arg, "--write-latency-ms") == 0) {
+      ok = parse_u32(val, opts.write_latency_ms);
+    } else if (strcmp(arg, "--echo-ms") == 0) {
+      ok = parse_u32(val, opts.echo_ms);
+    } else if (strcmp(arg, "--settle-ms") == 0) {
+      ok = parse_u32(val, opts.settle_ms);
+    } else {
+      fprintf(stderr, "unknown option %s\n", arg);
+      usage(stderr);
+      return 1;
+    }
+    if (!ok) {
+      fprintf(stderr, "bad value for %s: %s\n", arg, val);
+      return 1;
+    }
+  }
+  if (wled_path == nullptr && notify_path == nullptr) {
+    usage(stderr);
+    return 1;
+  }
+
+  std::vector<TraceEvent> events;
+  if (wled_path != nullptr &&
+      !read_wled_capture(wled_path, (uint16_t)port, events)) {
+    fprintf(stderr, "%s: not a readable pcap capture\n", wled_path);
+    return 1;
+  }
+  if (notify_path != nullptr &&
+      !read_notification_trace(notify_path, events, handles)) {
+    fprintf(stderr, "%s: no notifications found\n", notify_path);
+    return 1;
+  }
+
+  ReplaySession session(opts);
+  ReplayReport report = session.run(std::move(events));
+  print_report(report);
+  return report.final_state_ok() ? 0 : 2;
+}
@@ -0,0 +1,447 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esphome_mock.h"
+
+#include "xenopixel_light/xenopixel_light.h"
+
+#include "trace_reader.h"
+
+// Replays recorded traces through a real XenopixelLight on the unit-test
+// mocks, on the recorded timeline.
+//
+// The simulated clock drives mock_millis_value()/mock_micros_value(). The
+// light's loop() runs every loop_ms, as ESPHome's main loop would; WLED
+// datagrams are published to the WledReceiver at their capture time, so
+// datagrams arriving between two loops supersede each other exactly as on
+// the device. Notifications go through the same calls as the saber.yaml
+// handlers.
+//
+// The saber on the other end is modelled just enough to judge the output:
+// every 3AB1 write updates a SaberModel, is acknowledged with
+// ESP_GATTC_WRITE_CHAR_EVT after write_latency_ms, and a write carrying
+// Brightness is echoed on 3AB1 after echo_ms (what the combined-frame probe
+// waits for). Recorded notifications update the model too — the saber was
+// changed with its buttons.
+//
+// Each WLED packet that changes what the blade should show opens a change.
+// A change is shown when the model first matches it; the time from its
+// packet to that write is its lag. Changes overtaken by a later one before
+// they were shown count as superseded. After the last event the light runs
+// for settle_ms more, then the model is compared with the final expected
+// state.
+
+namespace esphome {
+namespace xenopixel_light {
+namespace replay {
+
+struct ReplayOptions {
+  uint32_t loop_ms{16};
+  uint32_t write_latency_ms{15};
+  uint32_t echo_ms{30};  // 0: the saber never echoes brightness
+  uint32_t settle_ms{2000};
+  // Shifts notification events against the WLED capture
+  int64_t notify_offset_ms{0};
+  WledPixelWindow window;
+  uint32_t smoothing_ms{0};
+  bool combine{true};
+  uint16_t att_mtu{247};  // what the exchange on connect settles on
+  uint32_t color_min_ms{0};  // 0: the light's default bounds
+  uint32_t color_max_ms{0};
+};
+
+// Blade state as the saber would show it; fields never set are unknown
+struct SaberModel {
+  bool power_known{false};
+  bool on{false};
+  int brightness{-1};
+  int r{-1}, g{-1}, b{-1};
+
+  // Known fields of `want` agree with this model. Brightness and color
+  // only matter while the blade is lit, color only while it is not dark.
+  bool shows(const SaberModel &want) const {
+    if (want.power_known && (!power_known || want.on != on)) return false;
+    if (want.power_known && !want.on) return true;
+    if (want.brightness >= 0 && want.brightness != brightness) return false;
+    if (want.brightness == 0) return true;
+    if (want.r >= 0 && (want.r != r || want.g != g || want.b != b)) return false;
+    return true;
+  }
+  bool operator==(const SaberModel &o) const {
+    return power_known == o.power_known && on == o.on &&
+           brightness == o.brightness && r == o.r && g == o.g && b == o.b;
+  }
+  bool operator!=(const SaberModel &o) const { return !(*this == o); }
+
+  // "on 50 [255,0,0]", "off", "?" for unknown parts
+  std::string describe() const {
+    char buf[48];
+    if (!power_known) return "?";
+    if (!on) return "off";
+    snprintf(buf, sizeof(buf), "on %d [%d,%d,%d]", brightness, r, g, b);
+    return buf;
+  }
+};
+
+struct ReplayReport {
+  uint64_t duration_us{0};
+  uint32_t wled_packets{0};
+  uint32_t notifications{0};
+  uint32_t writes{0};
+  uint32_t peak_writes_per_s{0};
+  uint32_t changes{0};
+  uint32_t changes_shown{0};
+  uint32_t changes_superseded{0};
+  uint32_t changes_unshown{0};  // still open at the end
+  std::vector<uint32_t> lag_ms;  // one per shown change, sorted
+  XenopixelLight::TxStats tx;
+  uint32_t debounced{0};  // instrumentation builds only
+  SaberModel expected;
+  SaberModel shown;
+
+  float writes_per_s() const {
+    return duration_us == 0 ? 0.0f : writes * 1e6f / (float)duration_us;
+  }
+  uint32_t lag_percentile_ms(float p) const {
+    if (lag_ms.empty()) return 0;
+    size_t i = (size_t)(p * (float)(lag_ms.size() - 1) + 0.5f);
+    return lag_ms[std::min(i, lag_ms.size() - 1)];
+  }
+  bool final_state_ok() const { return shown.shows(expected); }
+};
+
+class ReplaySession {
+ public:
+  static constexpr uint16_t CHAR_HANDLE = 42;
+  static constexpr uint16_t CONN_ID = 2;
+  // millis() at the start of the trace; 0 reads as "never" to some timers
+  static constexpr uint32_t CLOCK_BASE_MS = 1000;
+
+  explicit ReplaySession(const ReplayOptions &opts) : opts_(opts) {}
+
+  ReplayReport run(std::vector<TraceEvent> events) {
+    reset_mocks_();
+    report_ = ReplayReport();
+    model_ = SaberModel();
+    expected_ = SaberModel();
+    open_.clear();
+    pending_.clear();
+    writes_per_s_.clear();
+    seen_writes_ = 0;
+    realtime_until_us_ = 0;
+    realtime_forever_ = false;
+    for (auto &e : events) {
+      if (e.kind == TraceEvent::WLED) continue;
+      int64_t t = (int64_t)e.t_us + opts_.notify_offset_ms * 1000;
+      e.t_us = t < 0 ? 0 : (uint64_t)t;
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const TraceEvent &a, const TraceEvent &b) {
+                       return a.t_us < b.t_us;
+                     });
+
+    XenopixelLight light;
+    ble_client::BLEClient client;
+    ble_client::BLECharacteristic chr;
+    globals::GlobalsComponent<bool> authorized{true};
+    globals::GlobalsComponent<bool> syncing{false};
+    chr.handle = CHAR_HANDLE;
+    client.set_mock_characteristic(&chr);
+    client.set_gattc_if(1);
+    client.set_conn_id(CONN_ID);
+    light.set_ble_client(&client);
+    light.set_authorized_global(&authorized);
+    light.set_syncing_global(&syncing);
+    light.set_combine_commands(opts_.combine);
+    light.set_wled_smoothing(opts_.smoothing_ms);
+    light.set_wled_pixel_window(opts_.window.start, opts_.window.count);
+    if (opts_.color_min_ms != 0 || opts_.color_max_ms != 0)
+      light.set_color_interval_bounds(opts_.color_min_ms, opts_.color_max_ms);
+    light_ = &light;
+    client_ = &client;
+    esp_ble_gattc_cb_param_t mtu{};
+    mtu.cfg_mtu.status = ESP_GATT_OK;
+    mtu.cfg_mtu.conn_id = CONN_ID;
+    mtu.cfg_mtu.mtu = opts_.att_mtu;
+    client.dispatch_gattc_event(ESP_GATTC_CFG_MTU_EVT, &mtu);
+
+    bool has_wled = false;
+    for (const auto &e : events) has_wled |= e.kind == TraceEvent::WLED;
+    set_clock_(0);
+    if (has_wled) light.set_wled_active(true);
+
+    uint64_t end_us = (events.empty() ? 0 : events.back().t_us) +
+                      (uint64_t)opts_.settle_ms * 1000;
+    uint64_t loop_us = (uint64_t)(opts_.loop_ms > 0 ? opts_.loop_ms : 1) * 1000;
+    uint64_t next_loop = 0;
+    size_t next_event = 0;
+    for (;;) {
+      uint64_t now = next_loop;
+      if (next_event < events.size()) now = std::min(now, events[next_event].t_us);
+      if (!pending_.empty()) now = std::min(now, pending_.front().t_us);
+      if (now > end_us) break;
+      set_clock_(now);
+
+      while (next_event < events.size() && events[next_event].t_us <= now)
+        apply_event_(events[next_event++]);
+      while (!pending_.empty() && pending_.front().t_us <= now) {
+        Pending p = pending_.front();
+        pending_.erase(pending_.begin());
+        run_pending_(p);
+      }
+      if (next_loop <= now) {
+        light.loop();
+        collect_writes_();
+        next_loop += loop_us;
+      }
+    }
+
+    report_.duration_us = end_us;
+    report_.changes_unshown = (uint32_t)open_.size();
+    report_.tx = light.get_tx_stats();
+    report_.debounced = Instrumentation::instance().debounced();
+    report_.expected = expected_;
+    report_.shown = model_;
+    std::sort(report_.lag_ms.begin(), report_.lag_ms.end());
+    for (uint32_t n : writes_per_s_)
+      report_.peak_writes_per_s = std::max(report_.peak_writes_per_s, n);
+
+    light_ = nullptr;
+    client_ = nullptr;
+    return report_;
+  }
+
+ protected:
+  struct Pending {
+    enum Kind : uint8_t { WRITE_DONE, ECHO };
+    uint64_t t_us;
+    Kind kind;
+    int value;
+  };
+
+  struct Change {
+    uint64_t t_us;
+    SaberModel want;
+  };
+
+  // Notification callbacks as in saber.yaml. Recorded notifications are
+  // what the saber showed; echoes of our own writes are not.
+  struct Dae1Handler : XenopixelNotificationHandler {
+    ReplaySession *s;
+    void on_power_on(bool on) {
+      s->light_->update_cached_power(on);
+      s->reported_([on](SaberModel &m) {
+        m.power_known = true;
+        m.on = on;
+      });
+    }
+    void on_brightness(int v) {
+      s->light_->update_cached_brightness(v);
+      s->reported_([v](SaberModel &m) { m.brightness = v; });
+    }
+    void on_background_color(int r, int g, int b) {
+      s->light_->update_cached_color(r, g, b);
+      s->reported_([r, g, b](SaberModel &m) {
+        m.r = r;
+        m.g = g;
+        m.b = b;
+      });
+    }
+    void on_volume(int v) { s->light_->update_cached_volume(v); }
+    void on_sound_font(int v) { s->light_->update_cached_sound_font(v); }
+    void on_light_effect(int v) { s->light_->update_cached_light_effect(v); }
+  };
+
+  struct Ab1Handler : XenopixelNotificationHandler {
+    ReplaySession *s;
+    bool echo{false};
+    void on_authorize(const char *v, size_t n) {
+      if (n == 13 && memcmp(v, "AccessAllowed", 13) == 0)
+        s->light_->confirm_authorized();
+    }
+    void on_brightness(int v) {
+      s->light_->confirm_brightness(v);
+      if (!echo) s->reported_([v](SaberModel &m) { m.brightness = v; });
+    }
+  };
+
+  // What a written frame does to the blade
+  struct FrameHandler : XenopixelNotificationHandler {
+    SaberModel *m;
+    bool brightness{false};
+    int brightness_val{0};
+    void on_power_on(bool on) {
+      m->power_known = true;
+      m->on = on;
+    }
+    void on_brightness(int v) {
+      m->brightness = v;
+      brightness = true;
+      brightness_val = v;
+    }
+    void on_background_color(int r, int g, int b) {
+      m->r = r;
+      m->g = g;
+      m->b = b;
+    }
+  };
+
+  static void reset_mocks_() {
+    g_ble_writes().clear();
+    mock_ble_write_status() = ESP_OK;
+    mock_record_ble_writes() = true;
+    WledHub::instance().reset();
+    BleWriteScheduler::instance().reset();
+    Instrumentation::instance().reset();
+  }
+
+  void set_clock_(uint64_t t_us) {
+    now_us_ = t_us;
+    mock_millis_value() = CLOCK_BASE_MS + (uint32_t)(t_us / 1000);
+    mock_micros_value() = CLOCK_BASE_MS * 1000 + (uint32_t)t_us;
+  }
+
+  void apply_event_(const TraceEvent &e) {
+    if (e.kind == TraceEvent::WLED) {
+      report_.wled_packets++;
+      WledReceiver::instance().publish(e.data.data(), e.data.size());
+      expect_wled_(e);
+      return;
+    }
+    report_.notifications++;
+    if (e.kind == TraceEvent::NOTIFY_3AB1) {
+      Ab1Handler h;
+      h.s = this;
+      light_->get_reply_stream().feed(e.data.data(), e.data.size(), h);
+      return;
+    }
+    Dae1Handler h;
+    h.s = this;
+    light_->get_status_stream().feed(e.data.data(), e.data.size(), h);
+  }
+
+  // The blade state a WLED packet asks for, following the light's rules:
+  // notifier packets are ignored while a realtime stream is active, a dark
+  // realtime frame dims the blade instead of retracting it
+  void expect_wled_(const TraceEvent &e) {
+    WledTarget t = WledDecoder::decode(e.data.data(), e.data.size(), opts_.window);
+    if (t.kind == WledTarget::NONE) return;
+    uint64_t now = e.t_us;
+    if (t.kind == WledTarget::REALTIME) {
+      realtime_forever_ = t.timeout_s == WLED_TIMEOUT_FOREVER;
+      realtime_until_us_ = now + (uint64_t)t.timeout_s * 1000000;
+    } else if (realtime_forever_ || now < realtime_until_us_) {
+      return;
+    } else {
+      realtime_forever_ = false;
+    }
+
+    SaberModel want = expected_;
+    if (t.kind == WledTarget::NOTIFIER || t.bri > 0) {
+      want.power_known = true;
+      want.on = t.bri > 0;
+    }
+    if (want.power_known && want.on) {
+      want.brightness = (t.bri * 100) / 255;
+      if (t.bri > 0) {
+        want.r = t.r;
+        want.g = t.g;
+        want.b = t.b;
+      }
+    }
+    if (want == expected_) return;
+    expected_ = want;
+    report_.changes++;
+    open_.push_back(Change{now, want});
+    settle_changes_(now);
+  }
+
+  template<typename F> void reported_(F update) {
+    update(model_);
+    update(expected_);
+    settle_changes_(now_us_);
+  }
+
+  // The newest open change the saber now shows is done; older ones were
+  // overtaken
+  void settle_changes_(uint64_t now) {
+    for (size_t i = open_.size(); i-- > 0;) {
+      if (!model_.shows(open_[i].want)) continue;
+      report_.lag_ms.push_back((uint32_t)((now - open_[i].t_us) / 1000));
+      report_.changes_shown++;
+      report_.changes_superseded += (uint32_t)i;
+      open_.erase(open_.begin(), open_.begin() + i + 1);
+      return;
+    }
+  }
+
+  void collect_writes_() {
+    auto &writes = g_ble_writes();
+    uint64_t now = now_us_;
+    for (; seen_writes_ < writes.size(); seen_writes_++) {
+      const BLEWriteRecord &w = writes[seen_writes_];
+      if (w.handle != CHAR_HANDLE) continue;
+      report_.writes++;
+      size_t second = (size_t)(now / 1000000);
+      if (writes_per_s_.size() <= second) writes_per_s_.resize(second + 1, 0);
+      writes_per_s_[second]++;
+
+      FrameHandler f;
+      f.m = &model_;
+      XenopixelNotificationParser::parse(w.data.data(), w.data.size(), f);
+      settle_changes_(now);
+      schedule_(Pending{now + opts_.write_latency_ms * 1000ull,
+                        Pending::WRITE_DONE, 0});
+      if (f.brightness && opts_.echo_ms > 0)
+        schedule_(Pending{now + opts_.echo_ms * 1000ull, Pending::ECHO,
+                          f.brightness_val});
+    }
+  }
+
+  void schedule_(const Pending &p) {
+    auto at = std::upper_bound(
+        pending_.begin(), pending_.end(), p,
+        [](const Pending &a, const Pending &b) { return a.t_us < b.t_us; });
+    pending_.insert(at, p);
+  }
+
+  void run_pending_(const Pending &p) {
+    if (p.kind == Pending::WRITE_DONE) {
+      esp_ble_gattc_cb_param_t param{};
+      param.write.status = ESP_GATT_OK;
+      param.write.conn_id = CONN_ID;
+      param.write.handle = CHAR_HANDLE;
+      client_->dispatch_gattc_event(ESP_GATTC_WRITE_CHAR_EVT, &param);
+      return;
+    }
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "[3,{\"Brightness\":%d}]", p.value);
+    Ab1Handler h;
+    h.s = this;
+    h.echo = true;
+    XenopixelNotificationParser::parse(buf, (size_t)n, h);
+  }
+
+  ReplayOptions opts_;
+  XenopixelLight *light_{nullptr};
+  ble_client::BLEClient *client_{nullptr};
+  ReplayReport report_;
+  SaberModel model_;
+  SaberModel expected_;
+  std::vector<Change> open_;
+  std::vector<Pending> pending_;
+  std::vector<uint32_t> writes_per_s_;
+  size_t seen_writes_{0};
+  uint64_t now_us_{0};
+  uint64_t realtime_until_us_{0};
+  bool realtime_forever_{false};
+};
+
+}  // namespace replay
+}  // namespace xenopixel_light
+}  // namespace esphome
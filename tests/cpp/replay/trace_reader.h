@@ -0,0 +1,477 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Readers for recorded traces, turning them into timestamped events for the
+// replay harness (replay_session.h). Host-only: they allocate freely.
+//
+// WLED traffic comes from a classic pcap capture (tcpdump -w). Ethernet,
+// Linux cooked (v1 and v2, `tcpdump -i any`), raw IPv4 and BSD loopback
+// link types are understood; only unfragmented IPv4 UDP datagrams to the
+// given port are kept.
+//
+// Saber notifications come from either
+//   - an Android btsnoop_hci.log: ATT Handle Value Notifications and
+//     Indications, reassembled from ACL fragments. DAE1 and 3AB1 are told
+//     apart by handle, learned from the HandShake and Authorize writes in
+//     the same capture unless given explicitly; or
+//   - an nRF Connect log (references/Log_*.txt): "Notification received
+//     from <uuid>, value: (0x) 5B-33-..." lines.
+//
+// Every reader returns times in µs relative to its first record, so traces
+// from different clocks start together; ReplaySession can offset them.
+
+namespace esphome {
+namespace xenopixel_light {
+namespace replay {
+
+struct TraceEvent {
+  enum Kind : uint8_t { WLED, NOTIFY_DAE1, NOTIFY_3AB1 };
+
+  uint64_t t_us{0};
+  Kind kind{WLED};
+  std::vector<uint8_t> data;
+};
+
+inline const char *trace_kind_name(TraceEvent::Kind kind) {
+  switch (kind) {
+    case TraceEvent::NOTIFY_DAE1:
+      return "dae1";
+    case TraceEvent::NOTIFY_3AB1:
+      return "3ab1";
+    default:
+      return "wled";
+  }
+}
+
+inline bool read_file(const char *path, std::vector<uint8_t> &out) {
+  FILE *f = fopen(path, "rb");
+  if (f == nullptr) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+// Bounds-checked big/little-endian reads
+class ByteView {
+ public:
+  ByteView(const uint8_t *data, size_t len) : data_(data), len_(len) {}
+
+  size_t size() const { return len_; }
+  const uint8_t *data() const { return data_; }
+  bool has(size_t off, size_t n) const { return off <= len_ && n <= len_ - off; }
+
+  uint16_t be16(size_t off) const {
+    return (uint16_t)((data_[off] << 8) | data_[off + 1]);
+  }
+  uint16_t le16(size_t off) const {
+    return (uint16_t)(data_[off] | (data_[off + 1] << 8));
+  }
+  uint32_t be32(size_t off) const {
+    return ((uint32_t)be16(off) << 16) | be16(off + 2);
+  }
+  uint32_t le32(size_t off) const {
+    return ((uint32_t)le16(off + 2) << 16) | le16(off);
+  }
+  uint64_t be64(size_t off) const {
+    return ((uint64_t)be32(off) << 32) | be32(off + 4);
+  }
+
+ protected:
+  const uint8_t *data_;
+  size_t len_;
+};
+
+// ── pcap ────────────────────────────────────────────────────────────────────
+
+class PcapReader {
+ public:
+  static constexpr uint32_t LINKTYPE_NULL = 0;
+  static constexpr uint32_t LINKTYPE_ETHERNET = 1;
+  static constexpr uint32_t LINKTYPE_RAW = 101;
+  static constexpr uint32_t LINKTYPE_LINUX_SLL = 113;
+  static constexpr uint32_t LINKTYPE_LINUX_SLL2 = 276;
+
+  // Appends one WLED event per UDP datagram to port. False when the file is
+  // not a pcap capture or uses an unsupported link type.
+  static bool parse(const uint8_t *data, size_t len, uint16_t port,
+                    std::vector<TraceEvent> &out) {
+    ByteView v(data, len);
+    if (!v.has(0, 24)) return false;
+    bool swapped, nanos;
+    switch (v.be32(0)) {
+      case 0xA1B2C3D4:
+        swapped = false;
+        nanos = false;
+        break;
+      case 0xD4C3B2A1:
+        swapped = true;
+        nanos = false;
+        break;
+      case 0xA1B23C4D:
+        swapped = false;
+        nanos = true;
+        break;
+      case 0x4D3CB2A1:
+        swapped = true;
+        nanos = true;
+        break;
+      default:
+        return false;
+    }
+    auto u32 = [&](size_t off) { return swapped ? v.le32(off) : v.be32(off); };
+    uint32_t linktype = u32(20) & 0x0FFFFFFF;
+    if (!supported_(linktype)) return false;
+
+    bool have_first = false;
+    uint64_t first_us = 0;
+    for (size_t off = 24; v.has(off, 16);) {
+      uint64_t t_us = (uint64_t)u32(off) * 1000000 +
+                      (nanos ? u32(off + 4) / 1000 : u32(off + 4));
+      uint32_t incl = u32(off + 8);
+      off += 16;
+      if (!v.has(off, incl)) break;
+      if (!have_first) {
+        first_us = t_us;
+        have_first = true;
+      }
+      const uint8_t *payload;
+      size_t payload_len;
+      if (udp_payload_(ByteView(data + off, incl), linktype, port, payload,
+                       payload_len)) {
+        TraceEvent e;
+        e.t_us = t_us - first_us;
+        e.kind = TraceEvent::WLED;
+        e.data.assign(payload, payload + payload_len);
+        out.push_back(std::move(e));
+      }
+      off += incl;
+    }
+    return true;
+  }
+
+ protected:
+  static bool supported_(uint32_t linktype) {
+    return linktype == LINKTYPE_NULL || linktype == LINKTYPE_ETHERNET ||
+           linktype == LINKTYPE_RAW || linktype == LINKTYPE_LINUX_SLL ||
+           linktype == LINKTYPE_LINUX_SLL2;
+  }
+
+  static bool udp_payload_(ByteView frame, uint32_t linktype, uint16_t port,
+                           const uint8_t *&payload, size_t &payload_len) {
+    size_t ip;
+    switch (linktype) {
+      case LINKTYPE_NULL:
+        // Host-order address family; AF_INET is 2 everywhere
+        if (!frame.has(0, 4) || (frame.le32(0) != 2 && frame.be32(0) != 2))
+          return false;
+        ip = 4;
+        break;
+      case LINKTYPE_ETHERNET: {
+        if (!frame.has(0, 14)) return false;
+        ip = 14;
+        uint16_t type = frame.be16(12);
+        while (type == 0x8100 && frame.has(ip, 4)) {  // 802.1Q
+          type = frame.be16(ip + 2);
+          ip += 4;
+        }
+        if (type != 0x0800) return false;
+        break;
+      }
+      case LINKTYPE_LINUX_SLL:
+        if (!frame.has(0, 16) || frame.be16(14) != 0x0800) return false;
+        ip = 16;
+        break;
+      case LINKTYPE_LINUX_SLL2:
+        if (!frame.has(0, 20) || frame.be16(0) != 0x0800) return false;
+        ip = 20;
+        break;
+      default:
+        ip = 0;
+        break;
+    }
+
+    if (!frame.has(ip, 20) || (frame.data()[ip] >> 4) != 4) return false;
+    size_t ihl = (size_t)(frame.data()[ip] & 0x0F) * 4;
+    uint16_t total = frame.be16(ip + 2);
+    // Fragments are not reassembled; WLED datagrams fit one frame
+    if ((frame.be16(ip + 6) & 0x3FFF) != 0) return false;
+    if (frame.data()[ip + 9] != 17 || ihl < 20 || total < ihl + 8) return false;
+    if (!frame.has(ip, total)) return false;
+    size_t udp = ip + ihl;
+    if (frame.be16(udp + 2) != port) return false;
+    uint16_t udp_len = frame.be16(udp + 4);
+    if (udp_len < 8 || udp_len > total - ihl) return false;
+    payload = frame.data() + udp + 8;
+    payload_len = udp_len - 8;
+    return true;
+  }
+};
+
+// ── btsnoop ─────────────────────────────────────────────────────────────────
+
+// Characteristic value handles; 0 means learn them from the capture
+struct BtsnoopHandles {
+  uint16_t dae1{0};
+  uint16_t ab1{0};
+};
+
+class BtsnoopReader {
+ public:
+  static constexpr uint32_t DATALINK_HCI_UART = 1002;  // H4, type byte first
+  static constexpr uint32_t DATALINK_HCI_UNENCAP = 1001;
+
+  static constexpr uint8_t ATT_WRITE_REQ = 0x12;
+  static constexpr uint8_t ATT_WRITE_CMD = 0x52;
+  static constexpr uint8_t ATT_NOTIFICATION = 0x1B;
+  static constexpr uint8_t ATT_INDICATION = 0x1D;
+
+  using Handles = BtsnoopHandles;
+
+  // Appends the saber's notifications. Notifications on handles that are
+  // neither DAE1 nor 3AB1 (other devices, Service Changed) are skipped
+  // once both handles are known; before that they count as DAE1.
+  static bool parse(const uint8_t *data, size_t len, std::vector<TraceEvent> &out,
+                    Handles handles = Handles()) {
+    ByteView v(data, len);
+    if (!v.has(0, 16) || memcmp(data, "btsnoop\0", 8) != 0) return false;
+    uint32_t datalink = v.be32(12);
+    if (datalink != DATALINK_HCI_UART && datalink != DATALINK_HCI_UNENCAP)
+      return false;
+
+    std::vector<Att> atts;
+    collect_att_(v, datalink, atts);
+    learn_handles_(atts, handles);
+
+    for (const Att &a : atts) {
+      if (!a.received || a.pdu.size() < 3) continue;
+      if (a.pdu[0] != ATT_NOTIFICATION && a.pdu[0] != ATT_INDICATION) continue;
+      uint16_t handle = (uint16_t)(a.pdu[1] | (a.pdu[2] << 8));
+      TraceEvent e;
+      e.t_us = a.t_us;
+      if (handles.ab1 != 0 && handle == handles.ab1) {
+        e.kind = TraceEvent::NOTIFY_3AB1;
+      } else if (handle == handles.dae1 ||
+                 (handles.dae1 == 0 || handles.ab1 == 0)) {
+        e.kind = TraceEvent::NOTIFY_DAE1;
+      } else {
+        continue;
+      }
+      e.data.assign(a.pdu.begin() + 3, a.pdu.end());
+      out.push_back(std::move(e));
+    }
+    return true;
+  }
+
+ protected:
+  struct Att {
+    uint64_t t_us;
+    bool received;
+    std::vector<uint8_t> pdu;
+  };
+
+  // One L2CAP reassembly buffer per ACL handle and direction
+  struct Partial {
+    uint16_t acl;
+    bool received;
+    uint64_t t_us;
+    size_t want;
+    std::vector<uint8_t> buf;
+  };
+
+  static void collect_att_(ByteView v, uint32_t datalink,
+                           std::vector<Att> &atts) {
+    std::vector<Partial> partials;
+    bool have_first = false;
+    uint64_t first_us = 0;
+    for (size_t off = 16; v.has(off, 24);) {
+      uint32_t incl = v.be32(off + 4);
+      uint32_t flags = v.be32(off + 8);
+      uint64_t ts = v.be64(off + 16);
+      off += 24;
+      if (!v.has(off, incl)) break;
+      if (!have_first) {
+        first_us = ts;
+        have_first = true;
+      }
+      ByteView pkt(v.data() + off, incl);
+      off += incl;
+
+      size_t acl = 0;
+      if (datalink == DATALINK_HCI_UART) {
+        if (!pkt.has(0, 1) || pkt.data()[0] != 0x02) continue;
+        acl = 1;
+      } else if (flags & 0x02) {
+        continue;  // command or event
+      }
+      if (!pkt.has(acl, 4)) continue;
+      uint16_t hdr = pkt.le16(acl);
+      uint16_t acl_handle = hdr & 0x0FFF;
+      uint8_t pb = (hdr >> 12) & 0x03;
+      size_t data_len = pkt.le16(acl + 2);
+      if (!pkt.has(acl + 4, data_len)) continue;
+      const uint8_t *frag = pkt.data() + acl + 4;
+      bool received = (flags & 0x01) != 0;
+
+      Partial *p = nullptr;
+      for (auto &q : partials)
+        if (q.acl == acl_handle && q.received == received) p = &q;
+      if (pb != 0x01) {
+        // Start of an L2CAP frame
+        if (data_len < 4) continue;
+        if (p == nullptr) {
+          partials.push_back(Partial{acl_handle, received, 0, 0, {}});
+          p = &partials.back();
+        }
+        p->t_us = ts - first_us;
+        p->want = (size_t)(frag[0] | (frag[1] << 8)) + 4;
+        p->buf.assign(frag, frag + data_len);
+      } else {
+        if (p == nullptr || p->buf.empty()) continue;
+        p->buf.insert(p->buf.end(), frag, frag + data_len);
+      }
+      if (p->buf.size() < p->want) continue;
+      uint16_t cid = (uint16_t)(p->buf[2] | (p->buf[3] << 8));
+      if (cid == 0x0004)  // ATT
+        atts.push_back(
+            Att{p->t_us, received,
+                std::vector<uint8_t>(p->buf.begin() + 4, p->buf.begin() + p->want)});
+      p->buf.clear();
+    }
+  }
+
+  static bool contains_(const std::vector<uint8_t> &pdu, const char *needle) {
+    size_t n = strlen(needle);
+    if (pdu.size() < n) return false;
+    for (size_t i = 0; i + n <= pdu.size(); i++)
+      if (memcmp(pdu.data() + i, needle, n) == 0) return true;
+    return false;
+  }
+
+  // HandShake goes to DAE1, Authorize to 3AB1 (PROTOCOL.md)
+  static void learn_handles_(const std::vector<Att> &atts, Handles &h) {
+    for (const Att &a : atts) {
+      if (a.received || a.pdu.size() < 3) continue;
+      if (a.pdu[0] != ATT_WRITE_REQ && a.pdu[0] != ATT_WRITE_CMD) continue;
+      uint16_t handle = (uint16_t)(a.pdu[1] | (a.pdu[2] << 8));
+      if (h.dae1 == 0 && contains_(a.pdu, "\"HandShake\"")) h.dae1 = handle;
+      if (h.ab1 == 0 && contains_(a.pdu, "\"Authorize\"")) h.ab1 = handle;
+    }
+  }
+};
+
+// ── nRF Connect log ─────────────────────────────────────────────────────────
+
+class NrfLogReader {
+ public:
+  // Appends the DAE1 and 3AB1 notifications and indications of a log. False
+  // when no line could be read as one.
+  static bool parse(const char *text, size_t len, std::vector<TraceEvent> &out) {
+    bool found = false;
+    bool have_first = false;
+    uint64_t first_us = 0, last_us = 0, day_us = 0;
+    const char *end = text + len;
+    for (const char *line = text; line < end;) {
+      const char *eol = (const char *)memchr(line, '\n', end - line);
+      if (eol == nullptr) eol = end;
+      TraceEvent e;
+      uint64_t t_us;
+      if (parse_line_(line, eol, t_us, e)) {
+        // Times of day; a log running past midnight wraps
+        if (have_first && t_us + day_us < last_us) day_us += DAY_US;
+        t_us += day_us;
+        if (!have_first) {
+          first_us = t_us;
+          have_first = true;
+        }
+        last_us = t_us;
+        e.t_us = t_us - first_us;
+        out.push_back(std::move(e));
+        found = true;
+      }
+      line = eol + 1;
+    }
+    return found;
+  }
+
+ protected:
+  static constexpr uint64_t DAY_US = 24ull * 3600 * 1000000;
+
+  // "I\t15:50:41.755\tNotification received from 0000dae1-..., value: (0x)
+  // 5B-33-2C-..., "[3,...]""
+  static bool parse_line_(const char *p, const char *end, uint64_t &t_us,
+                          TraceEvent &e) {
+    const char *tab = (const char *)memchr(p, '\t', end - p);
+    if (tab == nullptr) return false;
+    unsigned h, m, s, ms;
+    if (end - tab < 13 ||
+        sscanf(tab + 1, "%2u:%2u:%2u.%3u", &h, &m, &s, &ms) != 4)
+      return false;
+    t_us = (((uint64_t)h * 60 + m) * 60 + s) * 1000000 + (uint64_t)ms * 1000;
+
+    const char *what = find_(tab, end, " received from ");
+    if (what == nullptr) return false;
+    const char *uuid = what + 15;
+    if (end - uuid < 8) return false;
+    if (memcmp(uuid, "0000dae1", 8) == 0) {
+      e.kind = TraceEvent::NOTIFY_DAE1;
+    } else if (memcmp(uuid, "00003ab1", 8) == 0) {
+      e.kind = TraceEvent::NOTIFY_3AB1;
+    } else {
+      return false;
+    }
+
+    const char *hex = find_(uuid, end, "(0x) ");
+    if (hex == nullptr) return false;
+    for (const char *q = hex + 5; q + 1 < end; q += 3) {
+      int hi = nibble_(q[0]), lo = nibble_(q[1]);
+      if (hi < 0 || lo < 0) break;
+      e.data.push_back((uint8_t)(hi << 4 | lo));
+      if (q + 2 >= end || q[2] != '-') break;
+    }
+    return !e.data.empty();
+  }
+
+  static const char *find_(const char *p, const char *end, const char *needle) {
+    size_t n = strlen(needle);
+    for (; p + n <= end; p++)
+      if (memcmp(p, needle, n) == 0) return p;
+    return nullptr;
+  }
+
+  static int nibble_(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+  }
+};
+
+// Reads a notification trace of either kind, by its header
+inline bool read_notification_trace(const char *path, std::vector<TraceEvent> &out,
+                                    BtsnoopReader::Handles handles =
+                                        BtsnoopReader::Handles()) {
+  std::vector<uint8_t> data;
+  if (!read_file(path, data)) return false;
+  if (data.size() >= 8 && memcmp(data.data(), "btsnoop\0", 8) == 0)
+    return BtsnoopReader::parse(data.data(), data.size(), out, handles);
+  return NrfLogReader::parse((const char *)data.data(), data.size(), out);
+}
+
+inline bool read_wled_capture(const char *path, uint16_t port,
+                              std::vector<TraceEvent> &out) {
+  std::vector<uint8_t> data;
+  if (!read_file(path, data)) return false;
+  return PcapReader::parse(data.data(), data.size(), port, out);
+}
+
+}  // namespace replay
+}  // namespace xenopixel_light
+}  // namespace esphome
@@ -0,0 +1,332 @@
+// C++ unit tests for the simulated BLE link (tests/cpp/mocks/ble_link_sim.h),
+// alone and under XenopixelLight's TX queue and the shared write scheduler
+#include "esphome_mock.h"
+
+#include "ble_link_sim.h"
+#include "xenopixel_light/xenopixel_light.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::xenopixel_light;
+
+namespace {
+
+// Records the GATTC events a link raises
+class EventLog : public ble_client::BLEClientNode {
+ public:
+  void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t,
+                           esp_ble_gattc_cb_param_t *param) override {
+    if (event == ESP_GATTC_WRITE_CHAR_EVT) writes++;
+    if (event == ESP_GATTC_CONGEST_EVT) {
+      congest_events++;
+      congested = param->congest.congested;
+    }
+  }
+  int writes{0};
+  int congest_events{0};
+  bool congested{false};
+};
+
+esp_err_t raw_write(uint16_t conn_id, const char *data = "[2,{}]") {
+  return esp_ble_gattc_write_char(1, conn_id, 42, (uint16_t)strlen(data),
+                                  (uint8_t *)data, ESP_GATT_WRITE_TYPE_NO_RSP,
+                                  ESP_GATT_AUTH_REQ_NONE);
+}
+
+class BleLinkSimTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_ble_writes().clear();
+    mock_ble_write_status() = ESP_OK;
+    client_.set_conn_id(3);
+    client_.register_ble_node(&log_);
+  }
+
+  ble_client::BLEClient client_;
+  EventLog log_;
+};
+
+}  // namespace
+
+TEST_F(BleLinkSimTest, DeliversPerConnectionEvent) {
+  BleLinkSim sim;
+  BleLinkParams p;
+  p.interval_us = 7500;
+  p.writes_per_event = 2;
+  p.buffer_depth = 8;
+  sim.add_link(&client_, p);
+  sim.install();
+
+  for (int i = 0; i < 5; i++) ASSERT_EQ(raw_write(3), ESP_OK);
+  EXPECT_EQ(sim.queued(3), 5u);
+  sim.advance_us(7499);
+  EXPECT_EQ(log_.writes, 0);
+  sim.advance_us(1);
+  EXPECT_EQ(log_.writes, 2);
+  sim.advance_us(15000);
+  EXPECT_EQ(log_.writes, 5);
+  EXPECT_EQ(sim.queued(3), 0u);
+  EXPECT_EQ(sim.stats(3)->delivered, 5u);
+  // Queued at 0, the last one sent at the third event
+  EXPECT_EQ(sim.stats(3)->latency_us_max, 22500u);
+  // Accepted writes are still captured as before
+  EXPECT_EQ(g_ble_writes().size(), 5u);
+}
+
+TEST_F(BleLinkSimTest, FullBufferCongestsUntilDrained) {
+  BleLinkSim sim;
+  BleLinkParams p;
+  p.writes_per_event = 1;
+  p.buffer_depth = 3;
+  p.congest_clear = 1;
+  sim.add_link(&client_, p);
+  sim.install();
+
+  for (int i = 0; i < 3; i++) ASSERT_EQ(raw_write(3), ESP_OK);
+  EXPECT_TRUE(sim.congested(3));
+  EXPECT_EQ(raw_write(3), ESP_FAIL);
+  EXPECT_EQ(sim.stats(3)->rejected, 1u);
+  EXPECT_EQ(g_ble_writes().size(), 3u);
+
+  // The event is delivered asynchronously, before the next connection event
+  EXPECT_EQ(log_.congest_events, 0);
+  sim.advance_us(1);
+  EXPECT_EQ(log_.congest_events, 1);
+  EXPECT_TRUE(log_.congested);
+
+  sim.advance_us(7500);  // 2 left
+  EXPECT_TRUE(log_.congested);
+  sim.advance_us(7500);  // 1 left
+  EXPECT_FALSE(log_.congested);
+  EXPECT_FALSE(sim.congested(3));
+  EXPECT_EQ(log_.congest_events, 2);
+  EXPECT_EQ(sim.stats(3)->congestions, 1u);
+  EXPECT_EQ(raw_write(3), ESP_OK);
+}
+
+TEST_F(BleLinkSimTest, LossRetransmitsWithoutLosingData) {
+  BleLinkSim sim(7);
+  BleLinkParams p;
+  p.writes_per_event = 1;
+  p.buffer_depth = 32;
+  p.loss_rate = 0.5f;
+  sim.add_link(&client_, p);
+  sim.install();
+  for (int i = 0; i < 20; i++) ASSERT_EQ(raw_write(3), ESP_OK);
+  sim.advance_ms(1000);
+  const auto *s = sim.stats(3);
+  EXPECT_EQ(s->delivered, 20u);
+  EXPECT_GT(s->lost, 5u);
+  EXPECT_EQ(log_.writes, 20);
+  EXPECT_GT(s->latency_us_max, 20u * 7500u);
+}
+
+TEST_F(BleLinkSimTest, SameSeedSameRun) {
+  auto run = [this](uint64_t seed) {
+    BleLinkSim sim(seed);
+    BleLinkParams p;
+    p.loss_rate = 0.2f;
+    p.write_fail_rate = 0.1f;
+    sim.add_link(&client_, p);
+    sim.install();
+    std::vector<int> trace;
+    for (int ms = 0; ms < 500; ms++) {
+      trace.push_back(raw_write(3));
+      sim.advance_ms(1);
+    }
+    trace.push_back((int)sim.stats(3)->delivered);
+    trace.push_back((int)sim.stats(3)->lost);
+    return trace;
+  };
+  EXPECT_EQ(run(1), run(1));
+  EXPECT_NE(run(1), run(2));
+}
+
+TEST_F(BleLinkSimTest, WriteFailuresAreTransient) {
+  BleLinkSim sim(3);
+  BleLinkParams p;
+  p.buffer_depth = 32;
+  p.write_fail_rate = 0.25f;
+  sim.add_link(&client_, p);
+  sim.install();
+  int failed = 0;
+  for (int i = 0; i < 400; i++) {
+    if (raw_write(3) != ESP_OK) failed++;
+    sim.advance_ms(8);
+  }
+  EXPECT_EQ((uint32_t)failed, sim.stats(3)->failed);
+  EXPECT_GT(failed, 60);
+  EXPECT_LT(failed, 140);
+  EXPECT_EQ(sim.stats(3)->rejected, 0u);
+}
+
+TEST_F(BleLinkSimTest, UnknownConnectionsAndNoLinkAcceptEverything) {
+  {
+    BleLinkSim sim;
+    sim.add_link(&client_);
+    sim.install();
+    EXPECT_EQ(raw_write(9), ESP_OK);
+    EXPECT_EQ(sim.queued(9), 0u);
+  }
+  // Uninstalled on destruction
+  EXPECT_EQ(mock_ble_link(), nullptr);
+  EXPECT_EQ(raw_write(3), ESP_OK);
+  EXPECT_EQ(g_ble_writes().size(), 2u);
+}
+
+TEST_F(BleLinkSimTest, RecordsDeliveriesWhenAsked) {
+  BleLinkSim sim;
+  sim.add_link(&client_);
+  sim.install();
+  sim.record_deliveries(true);
+  raw_write(3, "[2,{\"Volume\":5}]");
+  sim.advance_ms(8);
+  ASSERT_EQ(sim.deliveries().size(), 1u);
+  EXPECT_EQ(sim.deliveries()[0].t_us, 7500u);
+  EXPECT_EQ(std::string(sim.deliveries()[0].data.begin(),
+                        sim.deliveries()[0].data.end()),
+            "[2,{\"Volume\":5}]");
+}
+
+// ── Under the light ─────────────────────────────────────────────────────────
+
+namespace {
+
+struct SimSaber {
+  SimSaber(uint16_t conn_id, uint8_t mac) {
+    chr.handle = 42;
+    client.set_mock_characteristic(&chr);
+    client.set_gattc_if(1);
+    client.set_conn_id(conn_id);
+    const uint8_t bda[6] = {0xB0, 0xCB, 0xD8, 0xDB, 0xE1, mac};
+    client.set_remote_bda(bda);
+    light.set_ble_client(&client);
+    light.set_authorized_global(&authorized);
+    light.set_syncing_global(&syncing);
+    light.set_keepalive_interval(0);
+    light.update_cached_power(true);
+  }
+
+  // One WLED notifier color, applied to this saber alone
+  void color(int step) {
+    uint8_t pkt[] = {0x00, 0x00, 255, (uint8_t)(step * 7), 0,
+                     (uint8_t)(255 - step)};
+    light.apply_wled_packet(pkt, sizeof(pkt));
+  }
+
+  XenopixelLight light;
+  ble_client::BLEClient client;
+  ble_client::BLECharacteristic chr;
+  globals::GlobalsComponent<bool> authorized{true};
+  globals::GlobalsComponent<bool> syncing{false};
+};
+
+class BleLinkSimLightTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_ble_writes().clear();
+    mock_ble_write_status() = ESP_OK;
+    SaberGattProfile::instance().clear();
+    const uint8_t stale[] = {0x00};
+    WledReceiver::instance().publish(stale, sizeof(stale));
+    WledHub::instance().reset();
+    BleWriteScheduler::instance().reset();
+    sim_.set_now_us(1000000);
+  }
+
+  BleLinkSim sim_{42};
+};
+
+// Last frame this connection got through, as text
+std::string last_delivery(const BleLinkSim &sim, uint16_t conn_id) {
+  for (auto it = sim.deliveries().rbegin(); it != sim.deliveries().rend(); ++it)
+    if (it->conn_id == conn_id) return std::string(it->data.begin(), it->data.end());
+  return "";
+}
+
+}  // namespace
+
+TEST_F(BleLinkSimLightTest, SlowLinkBackpressureKeepsTheLastColor) {
+  SimSaber saber(2, 1);
+  BleLinkParams p;
+  p.interval_us = 30000;
+  p.writes_per_event = 1;
+  p.buffer_depth = 2;
+  p.congest_clear = 0;
+  sim_.add_link(&saber.client, p);
+  sim_.install();
+  sim_.record_deliveries(true);
+
+  // 50 Hz of color changes for two seconds, loop() every 4 ms
+  for (int ms = 0; ms < 2000; ms += 4) {
+    if (ms % 20 == 0) saber.color(ms / 20);
+    saber.light.loop();
+    sim_.advance_ms(4);
+  }
+  for (int ms = 0; ms < 1000; ms += 4) {
+    saber.light.loop();
+    sim_.advance_ms(4);
+  }
+
+  const auto *s = sim_.stats(2);
+  // The link carries at most one frame per 30 ms
+  EXPECT_LE(s->delivered, 2000u / 30u + 34u);
+  EXPECT_GT(s->congestions, 0u);
+  EXPECT_EQ(saber.light.get_tx_stats().dropped, 0u);
+  EXPECT_EQ(last_delivery(sim_, 2), "[2,{\"BackgroundColor\":[181,0,156]}]");
+  EXPECT_FALSE(saber.light.is_tx_congested());
+}
+
+TEST_F(BleLinkSimLightTest, LossyLinkStillConverges) {
+  SimSaber saber(2, 1);
+  BleLinkParams p;
+  p.loss_rate = 0.3f;
+  p.write_fail_rate = 0.2f;
+  sim_.add_link(&saber.client, p);
+  sim_.install();
+  sim_.record_deliveries(true);
+
+  for (int ms = 0; ms < 1000; ms += 4) {
+    if (ms % 20 == 0) saber.color(ms / 20);
+    saber.light.loop();
+    sim_.advance_ms(4);
+  }
+  for (int ms = 0; ms < 3000; ms += 4) {
+    saber.light.loop();
+    sim_.advance_ms(4);
+  }
+  EXPECT_GT(sim_.stats(2)->failed, 0u);
+  EXPECT_GT(sim_.stats(2)->lost, 0u);
+  EXPECT_GT(saber.light.get_link_health().failures(), 0u);
+  EXPECT_EQ(last_delivery(sim_, 2), "[2,{\"BackgroundColor\":[87,0,206]}]");
+}
+
+TEST_F(BleLinkSimLightTest, SchedulerSharesTheRadioFairly) {
+  SimSaber a(2, 1), b(3, 2);
+  BleLinkParams p;
+  p.interval_us = 15000;
+  p.writes_per_event = 2;
+  p.buffer_depth = 4;
+  p.congest_clear = 2;
+  sim_.add_link(&a.client, p);
+  sim_.add_link(&b.client, p);
+  sim_.install();
+
+  for (int ms = 0; ms < 5000; ms += 4) {
+    if (ms % 20 == 0) {
+      a.color(ms / 20);
+      b.color(ms / 20 + 100);
+    }
+    a.light.loop();
+    b.light.loop();
+    sim_.advance_ms(4);
+  }
+  uint32_t da = sim_.stats(2)->delivered, db = sim_.stats(3)->delivered;
+  EXPECT_GT(da, 50u);
+  EXPECT_GT(db, 50u);
+  EXPECT_LE(da > db ? da - db : db - da, (da + db) / 10);
+}
@@ -0,0 +1,274 @@
+// C++ unit tests for BleWriteScheduler
+// (esphome/components/xenopixel_light/ble_scheduler.h)
+#include "xenopixel_light/ble_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <string>
+
+using esphome::xenopixel_light::BLE_PRIORITY_CONTROL;
+using esphome::xenopixel_light::BLE_PRIORITY_EFFECT;
+using esphome::xenopixel_light::BLE_PRIORITY_STREAM;
+using esphome::xenopixel_light::BlePriority;
+using esphome::xenopixel_light::BleWriteClient;
+using esphome::xenopixel_light::BleWriteScheduler;
+
+namespace {
+
+// Queue of (length, priority) frames; every write is appended to a shared
+// log as the client's name
+struct FakeClient : BleWriteClient {
+  FakeClient(char name, std::string &log) : name(name), log(log) {}
+
+  void queue(size_t n, size_t len = 20,
+             BlePriority priority = BLE_PRIORITY_STREAM) {
+    for (size_t i = 0; i < n; i++) frames.push_back({len, priority});
+  }
+
+  // The front frame's length at the priority of the most urgent frame
+  bool peek_write(NextWrite &next) override {
+    if (frames.empty()) return false;
+    next = frames.front();
+    for (const NextWrite &f : frames)
+      if (f.priority < next.priority) next.priority = f.priority;
+    return true;
+  }
+
+  bool write_next() override {
+    if (fail) return false;
+    log += name;
+    frames.pop_front();
+    return true;
+  }
+
+  char name;
+  std::string &log;
+  std::deque<NextWrite> frames;
+  bool fail{false};
+};
+
+size_t count(const std::string &log, char c) {
+  size_t n = 0;
+  for (char x : log) n += x == c;
+  return n;
+}
+
+}  // namespace
+
+TEST(BleSchedulerTest, CapsWritesPerConnection) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log);
+  s.add_client(&a);
+  a.queue(10);
+
+  s.service(0);
+  EXPECT_EQ(log.size(), BleWriteScheduler::MAX_WRITES_PER_CONN);
+  // Same interval: no more budget for this connection
+  s.service(BleWriteScheduler::INTERVAL_MS - 1);
+  EXPECT_EQ(log.size(), BleWriteScheduler::MAX_WRITES_PER_CONN);
+
+  s.service(BleWriteScheduler::INTERVAL_MS);
+  EXPECT_EQ(log.size(), 2u * BleWriteScheduler::MAX_WRITES_PER_CONN);
+}
+
+TEST(BleSchedulerTest, InterleavesConnections) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log), b('b', log);
+  s.add_client(&a);
+  s.add_client(&b);
+  a.queue(4);
+  b.queue(4);
+
+  s.service(0);
+  EXPECT_EQ(log, "abababab");
+}
+
+TEST(BleSchedulerTest, SharesIntervalBudgetAcrossSabers) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log), b('b', log), c('c', log);
+  s.add_client(&a);
+  s.add_client(&b);
+  s.add_client(&c);
+  a.queue(20);
+  b.queue(20);
+  c.queue(20);
+
+  for (uint32_t t = 0; t < 3 * BleWriteScheduler::INTERVAL_MS;
+       t += BleWriteScheduler::INTERVAL_MS)
+    s.service(t);
+  EXPECT_EQ(log.size(), 3u * BleWriteScheduler::MAX_WRITES_PER_INTERVAL);
+  EXPECT_EQ(count(log, 'a'), 8u);
+  EXPECT_EQ(count(log, 'b'), 8u);
+  EXPECT_EQ(count(log, 'c'), 8u);
+  EXPECT_GT(s.get_stats().budget_exhausted, 0u);
+}
+
+TEST(BleSchedulerTest, LongFramesGetFewerTurns) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log), b('b', log), c('c', log);
+  s.add_client(&a);
+  s.add_client(&b);
+  s.add_client(&c);
+  a.queue(40, 64);
+  b.queue(40, 16);
+  c.queue(40, 16);
+
+  for (uint32_t t = 0; t < 10 * BleWriteScheduler::INTERVAL_MS;
+       t += BleWriteScheduler::INTERVAL_MS)
+    s.service(t);
+  EXPECT_LT(count(log, 'a'), count(log, 'b'));
+  EXPECT_LT(count(log, 'a'), count(log, 'c'));
+}
+
+TEST(BleSchedulerTest, HigherPriorityGoesFirst) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log), b('b', log), c('c', log);
+  s.add_client(&a);
+  s.add_client(&b);
+  s.add_client(&c);
+  a.queue(2);
+  b.queue(1, 20, BLE_PRIORITY_CONTROL);
+  c.queue(1, 20, BLE_PRIORITY_EFFECT);
+
+  s.service(0);
+  EXPECT_EQ(log, "cbaa");
+}
+
+TEST(BleSchedulerTest, FailedClientSkippedUntilNextService) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log), b('b', log);
+  s.add_client(&a);
+  s.add_client(&b);
+  a.queue(2);
+  b.queue(2);
+  a.fail = true;
+
+  s.service(0);
+  EXPECT_EQ(log, "bb");
+  EXPECT_EQ(s.get_stats().failed, 1u);
+
+  a.fail = false;
+  s.service(1);
+  EXPECT_EQ(log, "bbaa");
+}
+
+TEST(BleSchedulerTest, HeldClientWaitsForTheNextInterval) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log), b('b', log), c('c', log);
+  s.add_client(&a);
+  s.add_client(&b);
+  s.add_client(&c);
+  s.hold(&a);
+  s.hold(&b);
+  a.queue(1, 20, BLE_PRIORITY_CONTROL);
+  b.queue(1, 20, BLE_PRIORITY_CONTROL);
+  c.queue(6);
+
+  s.service(0);
+  EXPECT_EQ(log, "cccc");
+  EXPECT_TRUE(s.held(&a));
+
+  // Released mid-interval: both go together once the next one opens
+  s.release(&a);
+  s.release(&b);
+  s.hold(&a);
+  s.service(5);
+  EXPECT_EQ(log, "cccc");
+  s.service(BleWriteScheduler::INTERVAL_MS);
+  EXPECT_EQ(log, "ccccabcc");
+  EXPECT_FALSE(s.held(&a));
+  EXPECT_FALSE(s.held(&b));
+}
+
+TEST(BleSchedulerTest, ReleaseWithoutHoldIsIgnored) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log);
+  s.add_client(&a);
+  s.release(&a);
+  s.hold(&a);
+  a.queue(1);
+  s.service(0);
+  s.service(BleWriteScheduler::INTERVAL_MS);
+  EXPECT_EQ(log, "");
+  EXPECT_TRUE(s.held(&a));
+}
+
+TEST(BleSchedulerTest, RemovedClientIsNotServed) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log), b('b', log);
+  s.add_client(&a);
+  s.add_client(&b);
+  s.remove_client(&a);
+  EXPECT_EQ(s.client_count(), 1u);
+  a.queue(1);
+  b.queue(1);
+
+  s.service(0);
+  EXPECT_EQ(log, "b");
+}
+
+TEST(BleSchedulerTest, RegistryIsBounded) {
+  BleWriteScheduler s;
+  std::string log;
+  std::deque<FakeClient> clients;
+  for (size_t i = 0; i <= BleWriteScheduler::MAX_CLIENTS; i++)
+    clients.emplace_back('x', log);
+  for (size_t i = 0; i < BleWriteScheduler::MAX_CLIENTS; i++)
+    EXPECT_TRUE(s.add_client(&clients[i]));
+  EXPECT_FALSE(s.add_client(&clients.back()));
+  EXPECT_TRUE(s.add_client(&clients[0]));
+}
+
+TEST(BleSchedulerTest, WritesLeftTracksBothBudgets) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log);
+  s.add_client(&a);
+  a.queue(1);
+  s.service(0);
+  EXPECT_EQ(s.writes_left(&a), BleWriteScheduler::MAX_WRITES_PER_CONN - 1);
+}
+
+TEST(BleSchedulerTest, HasBudgetUntilTheConnectionIsSpent) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log), b('b', log);
+  s.add_client(&a);
+  EXPECT_FALSE(s.has_budget(&b, 0));
+  EXPECT_TRUE(s.has_budget(&a, 0));
+
+  a.queue(BleWriteScheduler::MAX_WRITES_PER_CONN + 1);
+  s.service(0);
+  EXPECT_FALSE(s.has_budget(&a, BleWriteScheduler::INTERVAL_MS - 1));
+  // The next interval brings the budget back before service() runs
+  EXPECT_TRUE(s.has_budget(&a, BleWriteScheduler::INTERVAL_MS));
+
+  s.hold(&a);
+  EXPECT_FALSE(s.has_budget(&a, BleWriteScheduler::INTERVAL_MS));
+  s.release(&a);
+  EXPECT_TRUE(s.has_budget(&a, BleWriteScheduler::INTERVAL_MS));
+}
+
+TEST(BleSchedulerTest, ControlFrameBehindStreamFrameRanksTheClient) {
+  BleWriteScheduler s;
+  std::string log;
+  FakeClient a('a', log), b('b', log);
+  s.add_client(&b);
+  s.add_client(&a);
+  b.queue(3);
+  a.queue(1);
+  a.queue(1, 20, BLE_PRIORITY_CONTROL);
+  s.service(0);
+  // a's stream frame goes out first, ahead of b, taking the power with it
+  EXPECT_EQ(log, "aabbb");
+}
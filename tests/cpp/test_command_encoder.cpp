@@ -0,0 +1,80 @@
+// C++ unit tests for CommandFrame
+// (esphome/components/xenopixel_light/command_encoder.h)
+#include "xenopixel_light/command_encoder.h"
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <cstring>
+#include <string>
+
+using namespace esphome::xenopixel_light;
+
+static std::string frame_str(const CommandFrame &f) {
+  char buf[128];
+  size_t len = f.write(buf, sizeof(buf));
+  return std::string(buf, len);
+}
+
+TEST(CommandEncoderTest, KeyPrefixIsBuiltAtCompileTime) {
+  constexpr auto key = command_key("Volume");
+  static_assert(sizeof(key.prefix) == 13, "[2,{\"Volume\": is 13 bytes");
+  static_assert(key.prefix[5] == 'V' && key.prefix[12] == ':', "layout");
+  EXPECT_EQ(std::string(key.prefix, sizeof(key.prefix)), "[2,{\"Volume\":");
+}
+
+TEST(CommandEncoderTest, EncodesSingleKeyFrames) {
+  EXPECT_EQ(frame_str(CommandFrame().add(CMD_BRIGHTNESS, 75)),
+            "[2,{\"Brightness\":75}]");
+  EXPECT_EQ(frame_str(CommandFrame().add(CMD_POWER_ON, false)),
+            "[2,{\"PowerOn\":false}]");
+  EXPECT_EQ(frame_str(CommandFrame().add(CMD_BACKGROUND_COLOR, 255, 0, 128)),
+            "[2,{\"BackgroundColor\":[255,0,128]}]");
+  EXPECT_EQ(frame_str(CommandFrame().add(CMD_SOUND_FONT, 3)),
+            "[2,{\"CurrentSoundPackageNo\":3}]");
+}
+
+TEST(CommandEncoderTest, EncodesCombinedFrameInOrder) {
+  CommandFrame f;
+  f.add(CMD_POWER_ON, true).add(CMD_BRIGHTNESS, 50).add(CMD_BACKGROUND_COLOR,
+                                                          1, 2, 3);
+  EXPECT_EQ(frame_str(f),
+            "[2,{\"PowerOn\":true,\"Brightness\":50,"
+            "\"BackgroundColor\":[1,2,3]}]");
+  EXPECT_EQ(f.size(), frame_str(f).size());
+}
+
+TEST(CommandEncoderTest, FormatsIntegerEdgeCases) {
+  EXPECT_EQ(frame_str(CommandFrame().add(CMD_VOLUME, 0)), "[2,{\"Volume\":0}]");
+  EXPECT_EQ(frame_str(CommandFrame().add(CMD_VOLUME, -7)),
+            "[2,{\"Volume\":-7}]");
+  EXPECT_EQ(frame_str(CommandFrame().add(CMD_VOLUME, INT_MAX)),
+            "[2,{\"Volume\":2147483647}]");
+  EXPECT_EQ(frame_str(CommandFrame().add(CMD_VOLUME, INT_MIN)),
+            "[2,{\"Volume\":-2147483648}]");
+  EXPECT_EQ(CommandFrame::int_len(INT_MIN), 11u);
+  EXPECT_EQ(CommandFrame::int_len(100), 3u);
+}
+
+TEST(CommandEncoderTest, WritesNothingWhenTooSmall) {
+  char buf[21];
+  memset(buf, '#', sizeof(buf));
+  // "[2,{\"Brightness\":75}]" is 21 bytes
+  CommandFrame f = CommandFrame().add(CMD_BRIGHTNESS, 75);
+  EXPECT_EQ(f.write(buf, 20), 0u);
+  EXPECT_EQ(buf[0], '#');
+  EXPECT_EQ(f.write(buf, 21), 21u);
+}
+
+TEST(CommandEncoderTest, EmptyFrameWritesNothing) {
+  char buf[8];
+  EXPECT_EQ(CommandFrame().write(buf, sizeof(buf)), 0u);
+}
+
+TEST(CommandEncoderTest, ExtraFieldsAreIgnored) {
+  CommandFrame f;
+  for (size_t i = 0; i < CommandFrame::MAX_FIELDS + 2; i++)
+    f.add(CMD_VOLUME, (int)i);
+  EXPECT_EQ(frame_str(f),
+            "[2,{\"Volume\":0,\"Volume\":1,\"Volume\":2,\"Volume\":3}]");
+}
@@ -0,0 +1,54 @@
+// C++ unit tests for connection parameter profiles
+// (esphome/components/xenopixel_light/conn_params.h)
+#include "xenopixel_light/conn_params.h"
+
+#include <gtest/gtest.h>
+
+using esphome::xenopixel_light::ATT_HEADER_BYTES;
+using esphome::xenopixel_light::ATT_MTU_DEFAULT;
+using esphome::xenopixel_light::att_payload;
+using esphome::xenopixel_light::BleConnParams;
+using esphome::xenopixel_light::BleConnReport;
+using esphome::xenopixel_light::BleLinkMode;
+using esphome::xenopixel_light::conn_params_for;
+using esphome::xenopixel_light::CONN_PARAMS_ACTIVE;
+using esphome::xenopixel_light::CONN_PARAMS_IDLE;
+using esphome::xenopixel_light::CONN_PARAMS_REALTIME;
+
+TEST(ConnParamsTest, FasterModesHaveShorterIntervals) {
+  EXPECT_LT(CONN_PARAMS_REALTIME.max_int, CONN_PARAMS_ACTIVE.min_int);
+  EXPECT_LT(CONN_PARAMS_ACTIVE.max_int, CONN_PARAMS_IDLE.min_int);
+  EXPECT_EQ(CONN_PARAMS_REALTIME.latency, 0);
+  EXPECT_EQ(CONN_PARAMS_ACTIVE.latency, 0);
+}
+
+TEST(ConnParamsTest, ProfileForMode) {
+  EXPECT_EQ(conn_params_for(BleLinkMode::REALTIME).max_int,
+            CONN_PARAMS_REALTIME.max_int);
+  EXPECT_EQ(conn_params_for(BleLinkMode::ACTIVE).max_int,
+            CONN_PARAMS_ACTIVE.max_int);
+  EXPECT_EQ(conn_params_for(BleLinkMode::IDLE).max_int,
+            CONN_PARAMS_IDLE.max_int);
+}
+
+TEST(ConnParamsTest, ValidRejectsShortSupervisionTimeout) {
+  // 200ms max interval, 4 skipped events: needs more than 2s
+  EXPECT_FALSE((BleConnParams{80, 160, 4, 200}).valid());
+  EXPECT_FALSE((BleConnParams{5, 12, 0, 200}).valid());
+  EXPECT_TRUE((BleConnParams{80, 160, 4, 201}).valid());
+}
+
+TEST(ConnParamsTest, ReportConvertsUnits) {
+  BleConnReport r;
+  EXPECT_EQ(r.events_per_second(), 0u);
+  r.interval = 24;
+  EXPECT_FLOAT_EQ(r.interval_ms(), 30.0f);
+  EXPECT_EQ(r.events_per_second(), 33u);
+}
+
+TEST(ConnParamsTest, AttPayloadLeavesTheHeader) {
+  EXPECT_EQ(att_payload(ATT_MTU_DEFAULT), 20);
+  EXPECT_EQ(att_payload(517), 514);
+  EXPECT_EQ(att_payload(0), 0);
+  EXPECT_EQ(att_payload(ATT_HEADER_BYTES), 0);
+}
@@ -0,0 +1,109 @@
+// C++ unit tests for DeadBand
+// (esphome/components/xenopixel_light/dead_band.h)
+#include "xenopixel_light/dead_band.h"
+
+#include <gtest/gtest.h>
+
+using esphome::xenopixel_light::DeadBand;
+using esphome::xenopixel_light::DeadBandMetric;
+
+namespace {
+
+constexpr int32_t rgb(int r, int g, int b) { return (r << 16) | (g << 8) | b; }
+
+}  // namespace
+
+TEST(DeadBandTest, OffPassesEverything) {
+  DeadBand band(DeadBandMetric::LEVEL);
+  EXPECT_TRUE(band.pass(true, 50, 51, 0));
+  EXPECT_FALSE(band.holding());
+}
+
+TEST(DeadBandTest, HoldsWithinTheBand) {
+  DeadBand band(DeadBandMetric::LEVEL);
+  band.set_threshold(2);
+  EXPECT_FALSE(band.pass(true, 50, 52, 0));
+  EXPECT_FALSE(band.pass(true, 50, 48, 0));
+  EXPECT_TRUE(band.holding());
+  EXPECT_TRUE(band.pass(true, 50, 53, 0));
+  EXPECT_FALSE(band.holding());
+}
+
+TEST(DeadBandTest, UnknownOrEqualReferencePasses) {
+  DeadBand band(DeadBandMetric::LEVEL);
+  band.set_threshold(5);
+  EXPECT_TRUE(band.pass(false, 50, 51, 0));
+  EXPECT_FALSE(band.pass(true, 50, 51, 0));
+  // The saber has it already; the shadow drops it
+  EXPECT_TRUE(band.pass(true, 50, 50, 0));
+  EXPECT_FALSE(band.holding());
+}
+
+TEST(DeadBandTest, HeldValueSettlesExactly) {
+  DeadBand band(DeadBandMetric::LEVEL);
+  band.set_threshold(2);
+  int32_t v = 0;
+  ASSERT_FALSE(band.pass(true, 50, 51, 1000));
+  EXPECT_FALSE(band.take_settled(1000 + DeadBand::SETTLE_MS - 1, v));
+  EXPECT_TRUE(band.take_settled(1000 + DeadBand::SETTLE_MS, v));
+  EXPECT_EQ(v, 51);
+  EXPECT_FALSE(band.holding());
+}
+
+TEST(DeadBandTest, ChangingHeldValueRestartsTheSettle) {
+  DeadBand band(DeadBandMetric::LEVEL);
+  band.set_threshold(2);
+  int32_t v = 0;
+  band.pass(true, 50, 51, 1000);
+  band.pass(true, 50, 51, 1200);  // same value keeps its timestamp
+  band.pass(true, 50, 49, 1240);
+  EXPECT_FALSE(band.take_settled(1000 + DeadBand::SETTLE_MS, v));
+  EXPECT_TRUE(band.take_settled(1240 + DeadBand::SETTLE_MS, v));
+  EXPECT_EQ(v, 49);
+}
+
+TEST(DeadBandTest, HoveringNeverToggles) {
+  // Sent at 50; noise around 51 stays held however long it lasts
+  DeadBand band(DeadBandMetric::LEVEL);
+  band.set_threshold(1);
+  int32_t v = 0;
+  for (int i = 0; i < 100; i++) {
+    EXPECT_FALSE(band.pass(true, 50, i % 2 ? 51 : 49, (uint32_t)i * 20));
+    EXPECT_FALSE(band.take_settled((uint32_t)i * 20, v));
+  }
+}
+
+TEST(DeadBandTest, ClearDropsTheHeldValue) {
+  DeadBand band(DeadBandMetric::LEVEL);
+  band.set_threshold(2);
+  band.pass(true, 50, 51, 0);
+  band.clear();
+  int32_t v;
+  EXPECT_FALSE(band.take_settled(10000, v));
+  band.pass(true, 50, 51, 0);
+  band.set_threshold(0);
+  EXPECT_FALSE(band.holding());
+}
+
+TEST(DeadBandTest, RedmeanDistance) {
+  auto d2 = [](int32_t a, int32_t b) {
+    return DeadBand::distance_sq(DeadBandMetric::REDMEAN_RGB, a, b);
+  };
+  EXPECT_EQ(d2(rgb(10, 20, 30), rgb(10, 20, 30)), 0u);
+  // Green weighs 4, red and blue 2-3 depending on the red mean
+  EXPECT_EQ(d2(rgb(0, 127, 0), rgb(0, 128, 0)), 4u);
+  EXPECT_EQ(d2(rgb(0, 0, 0), rgb(1, 0, 0)), 2u);
+  EXPECT_EQ(d2(rgb(255, 0, 0), rgb(254, 0, 0)), 2u);
+  EXPECT_EQ(d2(rgb(0, 0, 0), rgb(0, 0, 1)), 2u);
+  EXPECT_EQ(d2(rgb(255, 0, 0), rgb(255, 0, 1)), 2u);
+  EXPECT_EQ(d2(rgb(0, 0, 0), rgb(0, 10, 0)), 400u);
+  EXPECT_EQ(d2(rgb(0, 0, 0), rgb(255, 255, 255)),
+            d2(rgb(255, 255, 255), rgb(0, 0, 0)));
+}
+
+TEST(DeadBandTest, ColorBandHoldsRoundingFlips) {
+  DeadBand band(DeadBandMetric::REDMEAN_RGB);
+  band.set_threshold(3);
+  EXPECT_FALSE(band.pass(true, rgb(127, 127, 127), rgb(128, 128, 128), 0));
+  EXPECT_TRUE(band.pass(true, rgb(127, 127, 127), rgb(127, 129, 127), 0));
+}
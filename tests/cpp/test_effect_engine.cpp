@@ -0,0 +1,197 @@
+// C++ unit tests for EffectEngine
+// (esphome/components/xenopixel_light/effect_engine.h)
+#include "xenopixel_light/effect_engine.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using esphome::xenopixel_light::EffectEngine;
+using esphome::xenopixel_light::EffectKind;
+using esphome::xenopixel_light::EffectParams;
+
+namespace {
+
+EffectParams params(EffectKind kind, uint32_t period_ms, uint8_t depth = 180) {
+  EffectParams p;
+  p.kind = kind;
+  p.period_ms = period_ms;
+  p.depth = depth;
+  return p;
+}
+
+}  // namespace
+
+TEST(EffectEngineTest, IdleRendersNothing) {
+  EffectEngine e;
+  EffectEngine::Frame f;
+  EXPECT_FALSE(e.active());
+  EXPECT_FALSE(e.render(1000, f));
+}
+
+TEST(EffectEngineTest, WaveMatchesSine) {
+  for (int p = 0; p < 256; p++) {
+    double want = 255.0 * std::sin(M_PI * p / 256.0);
+    EXPECT_NEAR(EffectEngine::wave((uint8_t)p), want, 1.0) << p;
+  }
+}
+
+TEST(EffectEngineTest, HueWheelIsSaturated) {
+  uint8_t r, g, b;
+  EffectEngine::hue_to_rgb(0, r, g, b);
+  EXPECT_EQ(r, 255);
+  EXPECT_EQ(g, 0);
+  EXPECT_EQ(b, 0);
+  EffectEngine::hue_to_rgb(85, r, g, b);
+  EXPECT_EQ(r, 0);
+  EXPECT_EQ(g, 255);
+  EffectEngine::hue_to_rgb(170, r, g, b);
+  EXPECT_EQ(g, 0);
+  EXPECT_EQ(b, 255);
+  for (int h = 0; h < 256; h++) {
+    EffectEngine::hue_to_rgb((uint8_t)h, r, g, b);
+    EXPECT_EQ(r + g + b, 255) << h;
+  }
+}
+
+TEST(EffectEngineTest, BreatheDipsByDepthAndComesBack) {
+  EffectEngine e;
+  e.set_base(80, 0, 0, 255);
+  e.start(params(EffectKind::BREATHE, 4000, 255), 1000);
+  EffectEngine::Frame f;
+  ASSERT_TRUE(e.render(1000, f));
+  EXPECT_EQ(f.brightness, 80);
+  EXPECT_EQ(f.b, 255);
+
+  // Deepest at half the period, floored at 1%
+  ASSERT_TRUE(e.render(3000, f));
+  EXPECT_EQ(f.brightness, 1);
+  ASSERT_TRUE(e.render(2000, f));
+  EXPECT_NEAR(f.brightness, 80 - 80 * 0.707, 1.5);
+  ASSERT_TRUE(e.render(5000, f));
+  EXPECT_EQ(f.brightness, 80);
+}
+
+TEST(EffectEngineTest, BreatheDepthLimitsTheDip) {
+  EffectEngine e;
+  e.set_base(100, 255, 255, 255);
+  e.start(params(EffectKind::BREATHE, 1000, 128), 0);
+  EffectEngine::Frame f;
+  ASSERT_TRUE(e.render(500, f));
+  EXPECT_EQ(f.brightness, 50);
+}
+
+TEST(EffectEngineTest, RainbowCyclesOncePerPeriod) {
+  EffectEngine e;
+  e.set_base(60, 255, 255, 255);
+  e.start(params(EffectKind::RAINBOW, 3000), 0);
+  EffectEngine::Frame f;
+  ASSERT_TRUE(e.render(0, f));
+  EXPECT_EQ(f.r, 255);
+  EXPECT_EQ(f.brightness, 60);
+  ASSERT_TRUE(e.render(1000, f));
+  EXPECT_EQ(f.g, 255);
+  ASSERT_TRUE(e.render(2000, f));
+  EXPECT_EQ(f.b, 255);
+  ASSERT_TRUE(e.render(3000, f));
+  EXPECT_EQ(f.r, 255);
+}
+
+TEST(EffectEngineTest, FlickerStaysWithinDepth) {
+  EffectEngine e;
+  e.set_base(100, 255, 128, 0);
+  e.start(params(EffectKind::FLICKER, 1000, 102), 0);
+  EffectEngine::Frame f;
+  bool varied = false;
+  for (int i = 0; i < 200; i++) {
+    ASSERT_TRUE(e.render(i * 25, f));
+    EXPECT_GE(f.brightness, 60);
+    EXPECT_LE(f.brightness, 100);
+    EXPECT_EQ(f.g, 128);
+    if (f.brightness != 100) varied = true;
+  }
+  EXPECT_TRUE(varied);
+}
+
+TEST(EffectEngineTest, FlickerIsDeterministic) {
+  EffectEngine a, b;
+  a.set_base(100, 255, 255, 255);
+  b.set_base(100, 255, 255, 255);
+  a.start(params(EffectKind::FLICKER, 1000), 0);
+  b.start(params(EffectKind::FLICKER, 1000), 0);
+  EffectEngine::Frame fa, fb;
+  for (int i = 0; i < 20; i++) {
+    a.render(i, fa);
+    b.render(i, fb);
+    EXPECT_EQ(fa.brightness, fb.brightness);
+  }
+}
+
+TEST(EffectEngineTest, PulseHoldsBaseUntilTriggered) {
+  EffectEngine e;
+  e.set_base(40, 0, 0, 255);
+  e.start(params(EffectKind::PULSE, 500), 0);
+  EffectEngine::Frame f;
+  ASSERT_TRUE(e.render(100, f));
+  EXPECT_EQ(f.brightness, 40);
+  EXPECT_EQ(f.b, 255);
+  EXPECT_EQ(f.r, 0);
+}
+
+TEST(EffectEngineTest, PulseFlashesToWhiteAndDecays) {
+  EffectEngine e;
+  e.set_base(40, 0, 0, 255);
+  e.start(params(EffectKind::PULSE, 500), 0);
+  e.pulse(1000);
+  EffectEngine::Frame f;
+  ASSERT_TRUE(e.render(1000, f));
+  EXPECT_EQ(f.brightness, 100);
+  EXPECT_EQ(f.r, 255);
+  EXPECT_EQ(f.g, 255);
+
+  // Quadratic: a quarter of the flash left at half the period
+  ASSERT_TRUE(e.render(1250, f));
+  EXPECT_NEAR(f.brightness, 40 + 60 / 4, 1);
+  EXPECT_NEAR(f.r, 255 / 4, 2);
+
+  ASSERT_TRUE(e.render(1500, f));
+  EXPECT_EQ(f.brightness, 40);
+  EXPECT_EQ(f.r, 0);
+}
+
+TEST(EffectEngineTest, PulseIgnoredByOtherEffects) {
+  EffectEngine e;
+  e.set_base(100, 255, 0, 0);
+  e.start(params(EffectKind::RAINBOW, 1000), 0);
+  e.pulse(0);
+  EffectEngine::Frame f;
+  ASSERT_TRUE(e.render(0, f));
+  EXPECT_EQ(f.g, 0);
+}
+
+TEST(EffectEngineTest, PeriodIsClamped) {
+  EffectEngine e;
+  e.set_base(100, 255, 255, 255);
+  e.start(params(EffectKind::BREATHE, 0, 255), 0);
+  EffectEngine::Frame f;
+  // MIN_PERIOD_MS: deepest at 50ms
+  ASSERT_TRUE(e.render(EffectParams::MIN_PERIOD_MS / 2, f));
+  EXPECT_EQ(f.brightness, 1);
+}
+
+TEST(EffectEngineTest, StopEndsTheEffect) {
+  EffectEngine e;
+  e.start(params(EffectKind::BREATHE, 1000), 0);
+  EXPECT_EQ(e.kind(), EffectKind::BREATHE);
+  e.stop();
+  EXPECT_FALSE(e.active());
+  EffectEngine::Frame f;
+  EXPECT_FALSE(e.render(10, f));
+}
+
+TEST(EffectEngineTest, BaseBrightnessIsPercent) {
+  EffectEngine e;
+  e.set_base(150, 1, 2, 3);
+  EXPECT_EQ(e.base().brightness, 100);
+  EXPECT_EQ(e.base().b, 3);
+}
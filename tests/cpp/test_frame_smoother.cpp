@@ -0,0 +1,123 @@
+// C++ unit tests for FrameSmoother
+// (esphome/components/xenopixel_light/frame_smoother.h)
+#include "xenopixel_light/frame_smoother.h"
+
+#include <gtest/gtest.h>
+
+using esphome::xenopixel_light::FrameSmoother;
+
+TEST(FrameSmootherTest, DisabledByDefault) {
+  FrameSmoother s;
+  EXPECT_FALSE(s.enabled());
+  FrameSmoother::Frame f;
+  EXPECT_FALSE(s.sample(1000, f));
+  EXPECT_TRUE(s.settled(1000));
+}
+
+TEST(FrameSmootherTest, SingleFrameIsHeld) {
+  FrameSmoother s;
+  s.set_delay_ms(100);
+  s.push(1000, 200, 255, 0, 0);
+  FrameSmoother::Frame f;
+  ASSERT_TRUE(s.sample(1000, f));
+  EXPECT_EQ(f.bri, 200);
+  EXPECT_EQ(f.r, 255);
+}
+
+TEST(FrameSmootherTest, InterpolatesBehindNewestFrame) {
+  FrameSmoother s;
+  s.set_delay_ms(100);
+  s.push(1000, 0, 255, 0, 0);
+  s.push(1100, 200, 0, 0, 255);
+
+  FrameSmoother::Frame f;
+  // Render time 1050 is halfway between the two frames
+  ASSERT_TRUE(s.sample(1150, f));
+  EXPECT_EQ(f.bri, 100);
+  EXPECT_EQ(f.b, 127);
+  EXPECT_FALSE(s.settled(1150));
+
+  ASSERT_TRUE(s.sample(1200, f));
+  EXPECT_EQ(f.bri, 200);
+  EXPECT_EQ(f.b, 255);
+  EXPECT_TRUE(s.settled(1200));
+}
+
+TEST(FrameSmootherTest, DroppedPacketBecomesFade) {
+  FrameSmoother s;
+  s.set_delay_ms(50);
+  s.push(1000, 100, 0, 0, 0);
+  // Frames at 1025 and 1050 were lost
+  s.push(1075, 250, 0, 0, 0);
+  FrameSmoother::Frame f;
+  ASSERT_TRUE(s.sample(1080, f));  // render 1030
+  EXPECT_EQ(f.bri, 160);
+}
+
+TEST(FrameSmootherTest, RenderBeforeHistoryUsesOldest) {
+  FrameSmoother s;
+  s.set_delay_ms(500);
+  s.push(1000, 10, 0, 0, 0);
+  s.push(1010, 20, 0, 0, 0);
+  FrameSmoother::Frame f;
+  ASSERT_TRUE(s.sample(1020, f));
+  EXPECT_EQ(f.bri, 10);
+}
+
+TEST(FrameSmootherTest, BlackFrameKeepsHue) {
+  FrameSmoother s;
+  s.set_delay_ms(100);
+  s.push(1000, 200, 0, 255, 0);
+  s.push(1100, 0, 0, 0, 0);
+  FrameSmoother::Frame f;
+  ASSERT_TRUE(s.sample(1150, f));
+  EXPECT_EQ(f.bri, 100);
+  EXPECT_EQ(f.g, 255);
+}
+
+TEST(FrameSmootherTest, HistoryOverwritesOldest) {
+  FrameSmoother s;
+  s.set_delay_ms(1);
+  for (uint32_t i = 0; i < FrameSmoother::HISTORY + 3; i++)
+    s.push(1000 + i * 10, (uint8_t)i, 0, 0, 0);
+  FrameSmoother::Frame f;
+  ASSERT_TRUE(s.sample(0, f));  // far before the history
+  EXPECT_EQ(f.bri, 3);
+}
+
+TEST(FrameSmootherTest, InterpolatesAtMaxDelay) {
+  FrameSmoother s;
+  s.set_delay_ms(FrameSmoother::MAX_DELAY_MS);
+  uint32_t step = FrameSmoother::FRAME_INTERVAL_MS;
+  for (uint32_t i = 0; i <= 20; i++)
+    s.push(i * step, (uint8_t)(i * 10), 0, 0, 0);
+  // Render time 280ms: two thirds of the way from frame 11 to frame 12
+  FrameSmoother::Frame f;
+  ASSERT_TRUE(s.sample(20 * step, f));
+  EXPECT_EQ(f.bri, 116);
+  EXPECT_FALSE(s.settled(20 * step));
+}
+
+TEST(FrameSmootherTest, DelayIsCappedAtMax) {
+  FrameSmoother s;
+  s.set_delay_ms(1000);
+  EXPECT_EQ(s.delay_ms(), FrameSmoother::MAX_DELAY_MS);
+}
+
+TEST(FrameSmootherTest, HandlesMillisWrap) {
+  FrameSmoother s;
+  s.set_delay_ms(20);
+  s.push(0xFFFFFFF0u, 0, 0, 0, 0);
+  s.push(0x00000010u, 64, 0, 0, 0);
+  FrameSmoother::Frame f;
+  ASSERT_TRUE(s.sample(0x00000010u, f));  // render 0xFFFFFFFC
+  EXPECT_EQ(f.bri, 24);
+}
+
+TEST(FrameSmootherTest, ResetEmptiesHistory) {
+  FrameSmoother s;
+  s.set_delay_ms(100);
+  s.push(1000, 10, 0, 0, 0);
+  s.reset();
+  EXPECT_TRUE(s.empty());
+}
@@ -0,0 +1,103 @@
+// C++ unit tests for SaberGattProfile
+// (esphome/components/xenopixel_light/gatt_profile.h)
+// Mock header MUST be included first for the ESP-IDF GATTC types.
+#include "esphome_mock.h"
+
+#include "xenopixel_light/gatt_profile.h"
+
+#include <gtest/gtest.h>
+
+using esphome::xenopixel_light::SaberGattHandles;
+using esphome::xenopixel_light::SaberGattProfile;
+
+namespace {
+
+const uint8_t kMac[6] = {0xAA, 0xBB, 0xCC, 0x00, 0x11, 0x22};
+
+class GattProfileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mock_install_xenopixel_gatt_db();
+    mock_gatt_lookups() = 0;
+  }
+
+  SaberGattProfile profile_;
+};
+
+}  // namespace
+
+TEST_F(GattProfileTest, DiscoverMatchesProtocolTable) {
+  SaberGattHandles h;
+  ASSERT_TRUE(SaberGattProfile::discover(1, 0, h));
+  EXPECT_EQ(h.service_changed, 8);
+  EXPECT_EQ(h.service_changed_cccd, 9);
+  EXPECT_EQ(h.dae1, 12);
+  EXPECT_EQ(h.dae1_cccd, 13);
+  EXPECT_EQ(h.ab1, 16);
+  EXPECT_EQ(h.ab1_cccd, 17);
+}
+
+TEST_F(GattProfileTest, DiscoverNeedsServiceChangedOnly) {
+  mock_gatt_db().resize(3);  // 0x1801 service only
+  SaberGattHandles h;
+  EXPECT_TRUE(SaberGattProfile::discover(1, 0, h));
+  EXPECT_EQ(h.ab1, 0);
+
+  mock_gatt_db().resize(2);  // CCCD missing
+  h = SaberGattHandles();
+  EXPECT_FALSE(SaberGattProfile::discover(1, 0, h));
+}
+
+TEST_F(GattProfileTest, MacKeyIsBigEndian) {
+  EXPECT_EQ(SaberGattProfile::mac_key(kMac), 0xAABBCC001122ull);
+}
+
+TEST_F(GattProfileTest, AcquireCachesByMac) {
+  ASSERT_NE(profile_.acquire(1, 0, kMac, true), nullptr);
+  int discovery_lookups = mock_gatt_lookups();
+  mock_gatt_lookups() = 0;
+
+  const SaberGattHandles *h = profile_.acquire(1, 0, kMac, true);
+  ASSERT_NE(h, nullptr);
+  EXPECT_EQ(h->service_changed, 8);
+  EXPECT_EQ(mock_gatt_lookups(), 1);
+  EXPECT_GT(discovery_lookups, 1);
+
+  mock_gatt_lookups() = 0;
+  profile_.acquire(1, 0, kMac, false);
+  EXPECT_EQ(mock_gatt_lookups(), 0);
+  EXPECT_EQ(profile_.discoveries(), 1u);
+}
+
+TEST_F(GattProfileTest, FailedVerificationRediscovers) {
+  profile_.acquire(1, 0, kMac, true);
+  mock_gatt_db()[1].uuid = 0x2A00;  // something else at handle 8 now
+  mock_gatt_db().push_back({ESP_GATT_DB_CHARACTERISTIC, 7, 0x2A05, 0, 0});
+  mock_gatt_db()[2].owner = 7;
+
+  const SaberGattHandles *h = profile_.acquire(1, 0, kMac, true);
+  ASSERT_NE(h, nullptr);
+  EXPECT_EQ(h->service_changed, 7);
+  EXPECT_EQ(profile_.discoveries(), 2u);
+}
+
+TEST_F(GattProfileTest, MissingServiceIsNotCached) {
+  mock_gatt_db().clear();
+  EXPECT_EQ(profile_.acquire(1, 0, kMac, true), nullptr);
+  EXPECT_EQ(profile_.size(), 0u);
+}
+
+TEST_F(GattProfileTest, InvalidateDropsEntry) {
+  profile_.acquire(1, 0, kMac, true);
+  profile_.invalidate(SaberGattProfile::mac_key(kMac));
+  EXPECT_EQ(profile_.find(SaberGattProfile::mac_key(kMac)), nullptr);
+}
+
+TEST_F(GattProfileTest, StoreIsBounded) {
+  SaberGattHandles h;
+  h.service_changed = 8;
+  for (uint64_t mac = 1; mac <= SaberGattProfile::MAX_SABERS + 2; mac++)
+    profile_.store(mac, h);
+  EXPECT_EQ(profile_.size(), SaberGattProfile::MAX_SABERS);
+  EXPECT_NE(profile_.find(SaberGattProfile::MAX_SABERS + 2), nullptr);
+}
@@ -0,0 +1,121 @@
+// C++ unit tests for LatencyHistogram and Instrumentation
+// (esphome/components/xenopixel_light/instrumentation.h). The test target
+// builds with USE_XENOPIXEL_INSTRUMENTATION.
+#include "esphome_mock.h"
+
+#include "xenopixel_light/instrumentation.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using esphome::xenopixel_light::Instrumentation;
+using esphome::xenopixel_light::LatencyHistogram;
+using esphome::xenopixel_light::LatencyStage;
+using esphome::xenopixel_light::LatencyTrace;
+
+namespace {
+
+class InstrumentationTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Instrumentation::instance().reset();
+    mock_micros_value() = 0;
+  }
+
+  Instrumentation &instr_ = Instrumentation::instance();
+};
+
+}  // namespace
+
+TEST(LatencyHistogramTest, BucketsAreLog2) {
+  EXPECT_EQ(LatencyHistogram::bucket_for(0), 0u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(1), 0u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(2), 1u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(3), 1u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(1000), 9u);
+  EXPECT_EQ(LatencyHistogram::bucket_for(1024), 10u);
+  EXPECT_EQ(LatencyHistogram::bucket_upper_us(9), 1024u);
+}
+
+TEST(LatencyHistogramTest, LastBucketHoldsOverflow) {
+  LatencyHistogram h;
+  h.record(0xFFFFFFFFu);
+  EXPECT_EQ(h.bucket(LatencyHistogram::BUCKETS - 1), 1u);
+  EXPECT_EQ(h.max_us(), 0xFFFFFFFFu);
+  EXPECT_EQ(h.percentile_us(0.99f), 0xFFFFFFFFu);
+}
+
+TEST(LatencyHistogramTest, PercentileIsBucketUpperEdge) {
+  LatencyHistogram h;
+  for (int i = 0; i < 90; i++) h.record(100);   // bucket for 64..127
+  for (int i = 0; i < 10; i++) h.record(5000);  // bucket for 4096..8191
+  EXPECT_EQ(h.count(), 100u);
+  EXPECT_EQ(h.percentile_us(0.5f), 128u);
+  EXPECT_EQ(h.percentile_us(0.9f), 128u);
+  // Capped at the largest sample rather than the bucket edge
+  EXPECT_EQ(h.percentile_us(0.99f), 5000u);
+}
+
+TEST(LatencyHistogramTest, EmptyAndClear) {
+  LatencyHistogram h;
+  EXPECT_EQ(h.percentile_us(0.5f), 0u);
+  h.record(10);
+  h.clear();
+  EXPECT_EQ(h.count(), 0u);
+  EXPECT_EQ(h.max_us(), 0u);
+  EXPECT_EQ(h.bucket(LatencyHistogram::bucket_for(10)), 0u);
+}
+
+TEST_F(InstrumentationTest, TraceRecordsEveryStage) {
+  mock_micros_value() = 1300;
+  LatencyTrace t = instr_.decoded(1000);
+  mock_micros_value() = 1500;
+  instr_.enqueued(t);
+  mock_micros_value() = 9500;
+  instr_.transmitted(t);
+
+  EXPECT_EQ(instr_.histogram(LatencyStage::RX_TO_DECODE).max_us(), 300u);
+  EXPECT_EQ(instr_.histogram(LatencyStage::DECODE_TO_ENQUEUE).max_us(), 200u);
+  EXPECT_EQ(instr_.histogram(LatencyStage::ENQUEUE_TO_TX).max_us(), 8000u);
+  EXPECT_EQ(instr_.histogram(LatencyStage::RX_TO_TX).max_us(), 8500u);
+  EXPECT_FLOAT_EQ(instr_.percentile_ms(LatencyStage::RX_TO_TX, 0.5f), 8.5f);
+}
+
+TEST_F(InstrumentationTest, InvalidTraceRecordsNothing) {
+  LatencyTrace t;
+  instr_.enqueued(t);
+  instr_.transmitted(t);
+  EXPECT_EQ(instr_.histogram(LatencyStage::DECODE_TO_ENQUEUE).count(), 0u);
+  EXPECT_EQ(instr_.histogram(LatencyStage::RX_TO_TX).count(), 0u);
+  EXPECT_TRUE(std::isnan(instr_.percentile_ms(LatencyStage::RX_TO_TX, 0.5f)));
+}
+
+TEST_F(InstrumentationTest, SurvivesMicrosWrap) {
+  mock_micros_value() = 100;
+  instr_.decoded(0xFFFFFF00u);
+  EXPECT_EQ(instr_.histogram(LatencyStage::RX_TO_DECODE).max_us(), 356u);
+}
+
+TEST_F(InstrumentationTest, DrainCountsSuperseded) {
+  instr_.count_drain(1);
+  instr_.count_drain(4);
+  instr_.count_drain(0);
+  EXPECT_EQ(instr_.received(), 5u);
+  EXPECT_EQ(instr_.superseded(), 3u);
+}
+
+TEST_F(InstrumentationTest, ResetClearsEverything) {
+  instr_.count_drain(2);
+  instr_.count_debounced();
+  instr_.count_coalesced();
+  instr_.count_failed();
+  instr_.decoded(0);
+  instr_.reset();
+  EXPECT_EQ(instr_.received(), 0u);
+  EXPECT_EQ(instr_.superseded(), 0u);
+  EXPECT_EQ(instr_.debounced(), 0u);
+  EXPECT_EQ(instr_.coalesced(), 0u);
+  EXPECT_EQ(instr_.failed(), 0u);
+  EXPECT_EQ(instr_.histogram(LatencyStage::RX_TO_DECODE).count(), 0u);
+}
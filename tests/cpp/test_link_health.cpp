@@ -0,0 +1,111 @@
+// C++ unit tests for BleLinkHealth and retry_backoff_ms()
+// (esphome/components/xenopixel_light/link_health.h)
+#include "xenopixel_light/link_health.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+
+using esphome::xenopixel_light::BleLinkHealth;
+using esphome::xenopixel_light::retry_backoff_ms;
+using esphome::xenopixel_light::TX_RETRY_BASE_MS;
+using esphome::xenopixel_light::TX_RETRY_MAX_MS;
+
+TEST(RetryBackoffTest, DoublesFromBaseAndCaps) {
+  EXPECT_EQ(retry_backoff_ms(0), 0u);
+  EXPECT_EQ(retry_backoff_ms(1), TX_RETRY_BASE_MS);
+  EXPECT_EQ(retry_backoff_ms(2), 2 * TX_RETRY_BASE_MS);
+  EXPECT_EQ(retry_backoff_ms(3), 4 * TX_RETRY_BASE_MS);
+  EXPECT_EQ(retry_backoff_ms(10), TX_RETRY_MAX_MS);
+  EXPECT_EQ(retry_backoff_ms(0xFFFFFFFFu), TX_RETRY_MAX_MS);
+}
+
+TEST(LinkHealthTest, EmptyWindowIsUnknown) {
+  BleLinkHealth h;
+  EXPECT_TRUE(std::isnan(h.success_ratio()));
+  EXPECT_EQ(h.window_size(), 0u);
+}
+
+TEST(LinkHealthTest, RatioOverPartialWindow) {
+  BleLinkHealth h;
+  h.record_success();
+  h.record_success();
+  h.record_success();
+  h.record_failure(-1);
+  EXPECT_FLOAT_EQ(h.success_ratio(), 0.75f);
+}
+
+TEST(LinkHealthTest, OldOutcomesSlideOut) {
+  BleLinkHealth h;
+  for (size_t i = 0; i < BleLinkHealth::WINDOW; i++) h.record_failure(-1);
+  EXPECT_FLOAT_EQ(h.success_ratio(), 0.0f);
+  for (size_t i = 0; i < BleLinkHealth::WINDOW / 2; i++) h.record_success();
+  EXPECT_FLOAT_EQ(h.success_ratio(), 0.5f);
+  for (size_t i = 0; i < BleLinkHealth::WINDOW / 2; i++) h.record_success();
+  EXPECT_FLOAT_EQ(h.success_ratio(), 1.0f);
+  EXPECT_EQ(h.window_size(), BleLinkHealth::WINDOW);
+  EXPECT_EQ(h.failures(), BleLinkHealth::WINDOW);
+}
+
+TEST(LinkHealthTest, StreakResetsOnSuccess) {
+  BleLinkHealth h;
+  h.record_failure(-1);
+  h.record_failure(-1);
+  EXPECT_EQ(h.failure_streak(), 2u);
+  h.record_success();
+  EXPECT_EQ(h.failure_streak(), 0u);
+}
+
+TEST(LinkHealthTest, CountsPerErrorCode) {
+  BleLinkHealth h;
+  h.record_failure(-1);
+  h.record_failure(0x103);
+  h.record_failure(-1);
+  EXPECT_EQ(h.error_code_count(), 2u);
+  EXPECT_EQ(h.error_count(-1), 2u);
+  EXPECT_EQ(h.error_count(0x103), 1u);
+  EXPECT_EQ(h.error_count(7), 0u);
+}
+
+TEST(LinkHealthTest, ExtraCodesShareOverflowCount) {
+  BleLinkHealth h;
+  for (int c = 0; c < (int)BleLinkHealth::MAX_ERROR_CODES + 2; c++)
+    h.record_failure(c + 1);
+  EXPECT_EQ(h.error_code_count(), BleLinkHealth::MAX_ERROR_CODES);
+  EXPECT_EQ(h.other_errors(), 2u);
+}
+
+TEST(LinkHealthTest, FormatsErrors) {
+  BleLinkHealth h;
+  char buf[32];
+  h.format_errors(buf, sizeof(buf));
+  EXPECT_STREQ(buf, "none");
+
+  h.record_failure(-1);
+  h.record_failure(-1);
+  h.record_failure(259);
+  size_t n = h.format_errors(buf, sizeof(buf));
+  EXPECT_STREQ(buf, "-1:2 259:1");
+  EXPECT_EQ(n, strlen(buf));
+}
+
+TEST(LinkHealthTest, FormatTruncatesToBuffer) {
+  BleLinkHealth h;
+  for (int c = 0; c < 8; c++) h.record_failure(1000 + c);
+  char buf[12];
+  size_t n = h.format_errors(buf, sizeof(buf));
+  EXPECT_EQ(n, sizeof(buf) - 1);
+  EXPECT_EQ(strlen(buf), sizeof(buf) - 1);
+}
+
+TEST(LinkHealthTest, ResetWindowKeepsCounters) {
+  BleLinkHealth h;
+  h.record_success();
+  h.record_failure(-1);
+  h.reset_window();
+  EXPECT_TRUE(std::isnan(h.success_ratio()));
+  EXPECT_EQ(h.failure_streak(), 0u);
+  EXPECT_EQ(h.successes(), 1u);
+  EXPECT_EQ(h.error_count(-1), 1u);
+}
@@ -0,0 +1,310 @@
+// C++ unit tests for XenopixelNotificationParser
+// (esphome/components/xenopixel_light/notification_parser.h)
+#include "xenopixel_light/notification_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+
+using esphome::xenopixel_light::XenopixelNotificationHandler;
+using esphome::xenopixel_light::XenopixelNotificationParser;
+using esphome::xenopixel_light::XenopixelNotificationStream;
+
+namespace {
+
+struct Recorder : XenopixelNotificationHandler {
+  int power_on{-1};
+  int battery{-1};
+  int brightness{-1};
+  int r{-1}, g{-1}, b{-1};
+  int volume{-1};
+  int font{-1};
+  int effect{-1};
+  std::string hw, sw, auth;
+  std::string order;
+
+  void on_power_on(bool on) {
+    power_on = on;
+    order += "P";
+  }
+  void on_battery(int v) {
+    battery = v;
+    order += "B";
+  }
+  void on_brightness(int v) { brightness = v; }
+  void on_background_color(int rr, int gg, int bb) {
+    r = rr;
+    g = gg;
+    b = bb;
+    order += "C";
+  }
+  void on_volume(int v) { volume = v; }
+  void on_sound_font(int v) { font = v; }
+  void on_light_effect(int v) { effect = v; }
+  void on_hardware_version(const char *s, size_t n) { hw.assign(s, n); }
+  void on_software_version(const char *s, size_t n) { sw.assign(s, n); }
+  void on_authorize(const char *s, size_t n) { auth.assign(s, n); }
+};
+
+int parse(const std::string &msg, Recorder &r) {
+  return XenopixelNotificationParser::parse(msg.data(), msg.size(), r);
+}
+
+// Everything a Recorder saw, for comparing a streamed dump with a whole one
+std::string summary(const Recorder &r) {
+  return std::to_string(r.power_on) + "/" + std::to_string(r.battery) + "/" +
+         std::to_string(r.brightness) + "/" + std::to_string(r.r) + "," +
+         std::to_string(r.g) + "," + std::to_string(r.b) + "/" +
+         std::to_string(r.volume) + "/" + std::to_string(r.font) + "/" +
+         std::to_string(r.effect) + "/" + r.hw + "/" + r.sw + "/" + r.auth +
+         "/" + r.order;
+}
+
+// PROTOCOL.md, Example Full Status, with a font and effect to tell apart
+const std::string kFullStatus =
+    "[3,{\"HardwareVersion\":\"XENOA04525CW13907\",\"SoftwareVersion\":"
+    "\"DMN_XENO_B_SV1.4.0\",\"PowerOn\":false,\"CurrentSoundPackageNo\":3,"
+    "\"TotalSoundPackage\":34,\"CurrentLightEffect\":2,\"TotalLightEffect\":8,"
+    "\"CurrentLockup\":0,\"TotalLockup\":1,\"CurrentDrag\":0,\"TotalDrag\":1,"
+    "\"CurrentBlaster\":0,\"TotalBlaster\":3,\"CurrentClash\":0,"
+    "\"TotalClash\":3,\"CurrentForce\":0,\"TotalForce\":2,\"CurrentPostOff\":0,"
+    "\"TotalPostOff\":0,\"CurrentMode\":0,\"TotalMode\":8,\"PreonTime\":0,"
+    "\"Power\":100,\"Volume\":10,\"BackgroundColor\":[255,230,103]}]";
+
+// Feeds msg in notifications of at most mtu bytes
+int stream(XenopixelNotificationStream &s, const std::string &msg, size_t mtu,
+           Recorder &r) {
+  int dispatched = 0;
+  for (size_t i = 0; i < msg.size(); i += mtu)
+    dispatched += s.feed(msg.data() + i, std::min(mtu, msg.size() - i), r);
+  return dispatched;
+}
+
+}  // namespace
+
+TEST(NotificationParserTest, ParsesStatusDump) {
+  const std::string dump =
+      "[3,{\"HardwareVersion\":\"XENOA04525CW13907\",\"SoftwareVersion\":"
+      "\"DMN_XENO_B_SV1.4.0\",\"PowerOn\":false,\"CurrentSoundPackageNo\":3,"
+      "\"TotalSoundPackage\":34,\"CurrentLightEffect\":2,\"TotalLightEffect\":"
+      "8,\"Power\":100,\"Volume\":10,\"BackgroundColor\":[255,230,103]}]";
+  Recorder r;
+  EXPECT_EQ(parse(dump, r), 8);
+  EXPECT_EQ(r.hw, "XENOA04525CW13907");
+  EXPECT_EQ(r.sw, "DMN_XENO_B_SV1.4.0");
+  EXPECT_EQ(r.power_on, 0);
+  EXPECT_EQ(r.font, 3);
+  EXPECT_EQ(r.effect, 2);
+  EXPECT_EQ(r.battery, 100);
+  EXPECT_EQ(r.volume, 10);
+  EXPECT_EQ(r.r, 255);
+  EXPECT_EQ(r.g, 230);
+  EXPECT_EQ(r.b, 103);
+  EXPECT_EQ(r.brightness, -1);
+}
+
+TEST(NotificationParserTest, DispatchesInMessageOrder) {
+  Recorder r;
+  parse("[3,{\"BackgroundColor\":[1,2,3],\"Power\":50,\"PowerOn\":true}]", r);
+  EXPECT_EQ(r.order, "CBP");
+  EXPECT_EQ(r.power_on, 1);
+}
+
+TEST(NotificationParserTest, PowerDoesNotMatchPowerOn) {
+  Recorder r;
+  parse("[3,{\"PowerOn\":true}]", r);
+  EXPECT_EQ(r.power_on, 1);
+  EXPECT_EQ(r.battery, -1);
+}
+
+TEST(NotificationParserTest, StringValuesAreNotKeys) {
+  Recorder r;
+  // A value that looks like a key must not dispatch
+  EXPECT_EQ(parse("[3,{\"Name\":\"Volume\",\"Note\":\"a\\\"Power\\\":5\"}]", r),
+            0);
+  EXPECT_EQ(r.volume, -1);
+  EXPECT_EQ(r.battery, -1);
+}
+
+TEST(NotificationParserTest, ParsesAuthorize) {
+  Recorder r;
+  EXPECT_EQ(parse("[3,{\"Authorize\":\"AccessAllowed\"}]", r), 1);
+  EXPECT_EQ(r.auth, "AccessAllowed");
+}
+
+TEST(NotificationParserTest, ToleratesWhitespace) {
+  Recorder r;
+  parse("[3, { \"Brightness\" : 75 , \"BackgroundColor\" : [ 9 , 8 , 7 ] }]",
+        r);
+  EXPECT_EQ(r.brightness, 75);
+  EXPECT_EQ(r.r, 9);
+  EXPECT_EQ(r.b, 7);
+}
+
+TEST(NotificationParserTest, SkipsMismatchedTypes) {
+  Recorder r;
+  EXPECT_EQ(parse("[3,{\"Volume\":\"loud\",\"PowerOn\":1,"
+                  "\"BackgroundColor\":[1,2]}]",
+                  r),
+            0);
+  EXPECT_EQ(r.volume, -1);
+  EXPECT_EQ(r.power_on, -1);
+  EXPECT_EQ(r.r, -1);
+}
+
+TEST(NotificationParserTest, StopsAtTruncatedBuffer) {
+  Recorder r;
+  const std::string msg = "[3,{\"Volume\":12,\"HardwareVersion\":\"XEN";
+  EXPECT_EQ(parse(msg, r), 1);
+  EXPECT_EQ(r.volume, 12);
+  EXPECT_TRUE(r.hw.empty());
+
+  // Length bounds the scan even when the buffer continues
+  Recorder r2;
+  const std::string full = "[3,{\"Volume\":12}]";
+  EXPECT_EQ(XenopixelNotificationParser::parse(full.data(), 12, r2), 0);
+}
+
+TEST(NotificationParserTest, AcceptsByteBuffer) {
+  const uint8_t msg[] = "[3,{\"Brightness\":40}]";
+  Recorder r;
+  EXPECT_EQ(XenopixelNotificationParser::parse(msg, sizeof(msg) - 1, r), 1);
+  EXPECT_EQ(r.brightness, 40);
+}
+
+TEST(NotificationParserTest, BaseHandlerIgnoresEverything) {
+  XenopixelNotificationHandler h;
+  const std::string msg = "[3,{\"Volume\":12}]";
+  EXPECT_EQ(XenopixelNotificationParser::parse(msg.data(), msg.size(), h), 1);
+}
+
+// ── Streaming ───────────────────────────────────────────────────────────────
+
+TEST(NotificationStreamTest, WholeDumpMatchesParse) {
+  Recorder whole, streamed;
+  EXPECT_EQ(parse(kFullStatus, whole), 8);
+  XenopixelNotificationStream s;
+  EXPECT_EQ(s.feed(kFullStatus.data(), kFullStatus.size(), streamed), 8);
+  EXPECT_EQ(summary(streamed), summary(whole));
+  EXPECT_TRUE(s.idle());
+}
+
+TEST(NotificationStreamTest, DefaultMtuFragments) {
+  Recorder whole, streamed;
+  parse(kFullStatus, whole);
+  XenopixelNotificationStream s;
+  EXPECT_EQ(stream(s, kFullStatus, 20, streamed), 8);
+  EXPECT_EQ(summary(streamed), summary(whole));
+  EXPECT_EQ(s.overflows(), 0u);
+  EXPECT_EQ(s.resyncs(), 0u);
+}
+
+TEST(NotificationStreamTest, SplitAtEveryOffset) {
+  Recorder whole;
+  parse(kFullStatus, whole);
+  for (size_t cut = 1; cut < kFullStatus.size(); cut++) {
+    Recorder r;
+    XenopixelNotificationStream s;
+    int n = s.feed(kFullStatus.data(), cut, r);
+    n += s.feed(kFullStatus.data() + cut, kFullStatus.size() - cut, r);
+    EXPECT_EQ(n, 8) << cut;
+    EXPECT_EQ(summary(r), summary(whole)) << cut;
+  }
+}
+
+TEST(NotificationStreamTest, ScalarWaitsForItsEnd) {
+  Recorder r;
+  XenopixelNotificationStream s;
+  EXPECT_EQ(s.feed("[3,{\"Volume\":1", 14, r), 0);
+  EXPECT_FALSE(s.idle());
+  EXPECT_EQ(r.volume, -1);
+  EXPECT_EQ(s.feed("2}]", 3, r), 1);
+  EXPECT_EQ(r.volume, 12);
+}
+
+TEST(NotificationStreamTest, StringValuesAreNotKeys) {
+  Recorder r;
+  XenopixelNotificationStream s;
+  EXPECT_EQ(stream(s, "[3,{\"Name\":\"Volume\",\"Note\":\"a\\\"Power\\\":5\"}]",
+                   3, r),
+            0);
+  EXPECT_EQ(r.volume, -1);
+  EXPECT_EQ(r.battery, -1);
+}
+
+TEST(NotificationStreamTest, SkipsMismatchedTypes) {
+  Recorder r;
+  XenopixelNotificationStream s;
+  EXPECT_EQ(stream(s,
+                   "[3,{\"Volume\":\"loud\",\"PowerOn\":1,"
+                   "\"BackgroundColor\":[1,2],\"Brightness\":40}]",
+                   5, r),
+            1);
+  EXPECT_EQ(r.volume, -1);
+  EXPECT_EQ(r.power_on, -1);
+  EXPECT_EQ(r.r, -1);
+  EXPECT_EQ(r.brightness, 40);
+}
+
+TEST(NotificationStreamTest, ToleratesWhitespace) {
+  Recorder r;
+  XenopixelNotificationStream s;
+  stream(s,
+         "[3, { \"Brightness\" : 75 , \"BackgroundColor\" : [ 9 , 8 , 7 ] }]",
+         4, r);
+  EXPECT_EQ(r.brightness, 75);
+  EXPECT_EQ(r.r, 9);
+  EXPECT_EQ(r.b, 7);
+}
+
+TEST(NotificationStreamTest, OversizedValueIsDropped) {
+  Recorder r;
+  XenopixelNotificationStream s;
+  const std::string value(XenopixelNotificationStream::VALUE_MAX, 'X');
+  const std::string msg =
+      "[3,{\"HardwareVersion\":\"" + value + "\",\"Volume\":7}]";
+  EXPECT_EQ(stream(s, msg, 20, r), 1);
+  EXPECT_TRUE(r.hw.empty());
+  EXPECT_EQ(r.volume, 7);
+  EXPECT_EQ(s.overflows(), 1u);
+}
+
+TEST(NotificationStreamTest, UnknownValuesAreNotBuffered) {
+  Recorder r;
+  XenopixelNotificationStream s;
+  const std::string msg = "[3,{\"Banner\":\"" + std::string(500, 'x') +
+                          "\",\"Volume\":7}]";
+  EXPECT_EQ(stream(s, msg, 20, r), 1);
+  EXPECT_EQ(r.volume, 7);
+  EXPECT_EQ(s.overflows(), 0u);
+}
+
+TEST(NotificationStreamTest, NewMessageResyncs) {
+  Recorder r;
+  XenopixelNotificationStream s;
+  // The notification carrying the rest of this string never arrives
+  s.feed("[3,{\"SoftwareVersion\":\"DMN_X", 25, r);
+  EXPECT_FALSE(s.idle());
+  EXPECT_EQ(s.feed("[3,{\"Brightness\":40}]", 21, r), 1);
+  EXPECT_EQ(r.brightness, 40);
+  EXPECT_TRUE(r.sw.empty());
+  EXPECT_EQ(s.resyncs(), 1u);
+}
+
+TEST(NotificationStreamTest, ResetDropsThePartialToken) {
+  Recorder r;
+  XenopixelNotificationStream s;
+  s.feed("[3,{\"Volume\":1", 14, r);
+  s.reset();
+  EXPECT_TRUE(s.idle());
+  EXPECT_EQ(s.feed("2,\"Brightness\":40}]", 19, r), 1);
+  EXPECT_EQ(r.volume, -1);
+  EXPECT_EQ(r.brightness, 40);
+}
+
+TEST(NotificationStreamTest, BoundedMemory) {
+  EXPECT_LE(sizeof(XenopixelNotificationStream),
+            XenopixelNotificationStream::KEY_MAX +
+                XenopixelNotificationStream::VALUE_MAX + 16);
+}
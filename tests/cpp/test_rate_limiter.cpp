@@ -0,0 +1,59 @@
+// C++ unit tests for AdaptiveRateLimiter
+// (esphome/components/xenopixel_light/rate_limiter.h)
+#include "xenopixel_light/rate_limiter.h"
+
+#include <gtest/gtest.h>
+
+using esphome::xenopixel_light::AdaptiveRateLimiter;
+
+TEST(RateLimiterTest, ReadyBeforeFirstSend) {
+  AdaptiveRateLimiter rl;
+  EXPECT_TRUE(rl.ready(0));
+}
+
+TEST(RateLimiterTest, WaitsForInterval) {
+  AdaptiveRateLimiter rl;
+  rl.mark_sent(1000);
+  EXPECT_FALSE(rl.ready(1099));
+  EXPECT_TRUE(rl.ready(1100));
+}
+
+TEST(RateLimiterTest, SpeedsUpOnCompletedWrites) {
+  AdaptiveRateLimiter rl;
+  rl.set_bounds(25, 500);
+  for (int i = 0; i < 50; i++) rl.on_write_complete(5);
+  // Floor is max(min_interval, 2 * latency) = 25
+  EXPECT_EQ(rl.interval_ms(), 25u);
+}
+
+TEST(RateLimiterTest, LatencyBoundsInterval) {
+  AdaptiveRateLimiter rl;
+  rl.set_bounds(10, 500);
+  for (int i = 0; i < 100; i++) rl.on_write_complete(40);
+  EXPECT_EQ(rl.latency_ms(), 40u);
+  EXPECT_EQ(rl.interval_ms(), 80u);
+}
+
+TEST(RateLimiterTest, BacksOffOnFailure) {
+  AdaptiveRateLimiter rl;
+  rl.set_bounds(25, 500);
+  rl.on_write_failed();
+  EXPECT_EQ(rl.interval_ms(), 200u);
+  for (int i = 0; i < 10; i++) rl.on_write_failed();
+  EXPECT_EQ(rl.interval_ms(), 500u);
+}
+
+TEST(RateLimiterTest, EqualBoundsGiveFixedRate) {
+  AdaptiveRateLimiter rl;
+  rl.set_bounds(50, 50);
+  EXPECT_EQ(rl.interval_ms(), 50u);
+  rl.on_write_failed();
+  rl.on_write_complete(1);
+  EXPECT_EQ(rl.interval_ms(), 50u);
+}
+
+TEST(RateLimiterTest, InvertedBoundsCollapseToMin) {
+  AdaptiveRateLimiter rl;
+  rl.set_bounds(200, 100);
+  EXPECT_EQ(rl.interval_ms(), 200u);
+}
@@ -0,0 +1,479 @@
+// C++ unit tests for the replay harness: trace readers and ReplaySession
+// (tests/cpp/replay/)
+#include "replay/replay_session.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace esphome::xenopixel_light;
+using namespace esphome::xenopixel_light::replay;
+
+namespace {
+
+void put_le16(std::vector<uint8_t> &v, uint16_t x) {
+  v.push_back(x & 0xFF);
+  v.push_back(x >> 8);
+}
+void put_le32(std::vector<uint8_t> &v, uint32_t x) {
+  put_le16(v, x & 0xFFFF);
+  put_le16(v, x >> 16);
+}
+void put_be16(std::vector<uint8_t> &v, uint16_t x) {
+  v.push_back(x >> 8);
+  v.push_back(x & 0xFF);
+}
+void put_be32(std::vector<uint8_t> &v, uint32_t x) {
+  put_be16(v, x >> 16);
+  put_be16(v, x & 0xFFFF);
+}
+
+// IPv4/UDP datagram to port, without checksums
+std::vector<uint8_t> ipv4_udp(uint16_t port, const std::vector<uint8_t> &payload,
+                              uint16_t frag = 0) {
+  std::vector<uint8_t> ip = {0x45, 0};
+  put_be16(ip, (uint16_t)(20 + 8 + payload.size()));
+  put_be16(ip, 0);
+  put_be16(ip, frag);
+  ip.push_back(64);
+  ip.push_back(17);
+  put_be16(ip, 0);
+  ip.insert(ip.end(), {192, 168, 1, 10, 239, 0, 0, 1});
+  put_be16(ip, 4444);
+  put_be16(ip, port);
+  put_be16(ip, (uint16_t)(8 + payload.size()));
+  put_be16(ip, 0);
+  ip.insert(ip.end(), payload.begin(), payload.end());
+  return ip;
+}
+
+std::vector<uint8_t> ethernet(const std::vector<uint8_t> &ip) {
+  std::vector<uint8_t> f(12, 0xAA);
+  put_be16(f, 0x0800);
+  f.insert(f.end(), ip.begin(), ip.end());
+  return f;
+}
+
+// Little-endian, microsecond pcap as tcpdump writes it on x86 and ARM
+struct PcapBuilder {
+  explicit PcapBuilder(uint32_t linktype = PcapReader::LINKTYPE_ETHERNET) {
+    put_le32(bytes, 0xA1B2C3D4);
+    put_le16(bytes, 2);
+    put_le16(bytes, 4);
+    put_le32(bytes, 0);
+    put_le32(bytes, 0);
+    put_le32(bytes, 65535);
+    put_le32(bytes, linktype);
+  }
+  void add(uint64_t t_us, const std::vector<uint8_t> &frame) {
+    put_le32(bytes, (uint32_t)(t_us / 1000000));
+    put_le32(bytes, (uint32_t)(t_us % 1000000));
+    put_le32(bytes, (uint32_t)frame.size());
+    put_le32(bytes, (uint32_t)frame.size());
+    bytes.insert(bytes.end(), frame.begin(), frame.end());
+  }
+  std::vector<uint8_t> bytes;
+};
+
+std::vector<uint8_t> notifier(uint8_t bri, uint8_t r, uint8_t g, uint8_t b) {
+  return {WLED_PROTO_NOTIFIER, 0, bri, r, g, b};
+}
+
+std::vector<uint8_t> bytes_of(const std::string &s) {
+  return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+// H4 btsnoop; ACL packets on connection handle 0x0040
+struct BtsnoopBuilder {
+  BtsnoopBuilder() {
+    const char magic[8] = {'b', 't', 's', 'n', 'o', 'o', 'p', '\0'};
+    bytes.insert(bytes.end(), magic, magic + 8);
+    put_be32(bytes, 1);
+    put_be32(bytes, BtsnoopReader::DATALINK_HCI_UART);
+  }
+  void record(uint64_t t_us, bool received, const std::vector<uint8_t> &pkt) {
+    put_be32(bytes, (uint32_t)pkt.size());
+    put_be32(bytes, (uint32_t)pkt.size());
+    put_be32(bytes, received ? 1 : 0);
+    put_be32(bytes, 0);
+    uint64_t ts = 0x00E03AB44A676000ull + t_us;
+    put_be32(bytes, (uint32_t)(ts >> 32));
+    put_be32(bytes, (uint32_t)ts);
+    bytes.insert(bytes.end(), pkt.begin(), pkt.end());
+  }
+  // One ATT PDU, split into ACL fragments of at most frag bytes
+  void att(uint64_t t_us, bool received, uint8_t opcode, uint16_t handle,
+           const std::string &value, size_t frag = 1000) {
+    std::vector<uint8_t> l2cap;
+    put_le16(l2cap, (uint16_t)(3 + value.size()));
+    put_le16(l2cap, 0x0004);
+    l2cap.push_back(opcode);
+    put_le16(l2cap, handle);
+    l2cap.insert(l2cap.end(), value.begin(), value.end());
+    for (size_t off = 0; off < l2cap.size(); off += frag) {
+      size_t n = std::min(frag, l2cap.size() - off);
+      std::vector<uint8_t> pkt = {0x02};
+      put_le16(pkt, (uint16_t)(0x0040 | ((off == 0 ? 0x2 : 0x1) << 12)));
+      put_le16(pkt, (uint16_t)n);
+      pkt.insert(pkt.end(), l2cap.begin() + off, l2cap.begin() + off + n);
+      record(t_us, received, pkt);
+    }
+  }
+  std::vector<uint8_t> bytes;
+};
+
+}  // namespace
+
+// ── PcapReader ──────────────────────────────────────────────────────────────
+
+TEST(PcapReaderTest, ReadsUdpPayloadsToPort) {
+  PcapBuilder p;
+  p.add(5000000, ethernet(ipv4_udp(21324, notifier(200, 255, 0, 0))));
+  p.add(5000000 + 2500, ethernet(ipv4_udp(21324, notifier(100, 0, 255, 0))));
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(PcapReader::parse(p.bytes.data(), p.bytes.size(), 21324, out));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].t_us, 0u);
+  EXPECT_EQ(out[1].t_us, 2500u);
+  EXPECT_EQ(out[0].kind, TraceEvent::WLED);
+  EXPECT_EQ(out[1].data, notifier(100, 0, 255, 0));
+}
+
+TEST(PcapReaderTest, SkipsOtherPortsAndFragments) {
+  PcapBuilder p;
+  p.add(0, ethernet(ipv4_udp(5353, notifier(1, 2, 3, 4))));
+  p.add(10, ethernet(ipv4_udp(21324, notifier(1, 2, 3, 4), 0x2000)));
+  p.add(20, ethernet(ipv4_udp(21324, notifier(9, 9, 9, 9))));
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(PcapReader::parse(p.bytes.data(), p.bytes.size(), 21324, out));
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].t_us, 20u);
+  EXPECT_EQ(out[0].data, notifier(9, 9, 9, 9));
+}
+
+TEST(PcapReaderTest, ReadsVlanTaggedEthernet) {
+  std::vector<uint8_t> f(12, 0xAA);
+  put_be16(f, 0x8100);
+  put_be16(f, 0x0005);
+  put_be16(f, 0x0800);
+  auto ip = ipv4_udp(21324, notifier(7, 7, 7, 7));
+  f.insert(f.end(), ip.begin(), ip.end());
+  PcapBuilder p;
+  p.add(0, f);
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(PcapReader::parse(p.bytes.data(), p.bytes.size(), 21324, out));
+  ASSERT_EQ(out.size(), 1u);
+}
+
+TEST(PcapReaderTest, ReadsLinuxCookedCaptures) {
+  auto ip = ipv4_udp(21324, notifier(5, 6, 7, 8));
+  std::vector<uint8_t> sll(14, 0);
+  put_be16(sll, 0x0800);
+  sll.insert(sll.end(), ip.begin(), ip.end());
+  std::vector<uint8_t> sll2;
+  put_be16(sll2, 0x0800);
+  sll2.resize(20, 0);
+  sll2.insert(sll2.end(), ip.begin(), ip.end());
+
+  PcapBuilder p1(PcapReader::LINKTYPE_LINUX_SLL), p2(PcapReader::LINKTYPE_LINUX_SLL2);
+  p1.add(0, sll);
+  p2.add(0, sll2);
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(PcapReader::parse(p1.bytes.data(), p1.bytes.size(), 21324, out));
+  ASSERT_TRUE(PcapReader::parse(p2.bytes.data(), p2.bytes.size(), 21324, out));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[1].data, notifier(5, 6, 7, 8));
+}
+
+TEST(PcapReaderTest, ReadsNanosecondBigEndianHeader) {
+  std::vector<uint8_t> b;
+  put_be32(b, 0xA1B23C4D);
+  put_be16(b, 2);
+  put_be16(b, 4);
+  put_be32(b, 0);
+  put_be32(b, 0);
+  put_be32(b, 65535);
+  put_be32(b, PcapReader::LINKTYPE_RAW);
+  auto ip = ipv4_udp(21324, notifier(1, 1, 1, 1));
+  for (uint32_t ns : {1000u, 1501000u}) {
+    put_be32(b, 3);
+    put_be32(b, ns);
+    put_be32(b, (uint32_t)ip.size());
+    put_be32(b, (uint32_t)ip.size());
+    b.insert(b.end(), ip.begin(), ip.end());
+  }
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(PcapReader::parse(b.data(), b.size(), 21324, out));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[1].t_us, 1500u);
+}
+
+TEST(PcapReaderTest, RejectsOtherFilesAndTruncatedRecords) {
+  std::vector<TraceEvent> out;
+  std::vector<uint8_t> junk(64, 0x42);
+  EXPECT_FALSE(PcapReader::parse(junk.data(), junk.size(), 21324, out));
+  PcapBuilder wifi(105);
+  EXPECT_FALSE(PcapReader::parse(wifi.bytes.data(), wifi.bytes.size(), 21324, out));
+
+  PcapBuilder p;
+  p.add(0, ethernet(ipv4_udp(21324, notifier(1, 1, 1, 1))));
+  p.add(1, ethernet(ipv4_udp(21324, notifier(2, 2, 2, 2))));
+  ASSERT_TRUE(PcapReader::parse(p.bytes.data(), p.bytes.size() - 3, 21324, out));
+  EXPECT_EQ(out.size(), 1u);
+}
+
+// ── BtsnoopReader ───────────────────────────────────────────────────────────
+
+TEST(BtsnoopReaderTest, LearnsHandlesFromHandshakeWrites) {
+  BtsnoopBuilder b;
+  b.att(0, false, BtsnoopReader::ATT_WRITE_REQ, 12,
+        "[2,{\"HandShake\":\"HelloDamien\"}]");
+  b.att(1000, true, BtsnoopReader::ATT_NOTIFICATION, 12, "[3,{\"Volume\":10}]");
+  b.att(2000, false, BtsnoopReader::ATT_WRITE_CMD, 16,
+        "[2,{\"Authorize\":\"SaberOfDamien\"}]");
+  b.att(3000, true, BtsnoopReader::ATT_NOTIFICATION, 16,
+        "[3,{\"Authorize\":\"AccessAllowed\"}]");
+  b.att(4000, true, BtsnoopReader::ATT_NOTIFICATION, 29, "\x01\x02");
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(BtsnoopReader::parse(b.bytes.data(), b.bytes.size(), out));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].kind, TraceEvent::NOTIFY_DAE1);
+  EXPECT_EQ(out[0].t_us, 1000u);
+  EXPECT_EQ(out[0].data, bytes_of("[3,{\"Volume\":10}]"));
+  EXPECT_EQ(out[1].kind, TraceEvent::NOTIFY_3AB1);
+}
+
+TEST(BtsnoopReaderTest, ReassemblesFragmentedNotifications) {
+  std::string status = "[3,{\"HardwareVersion\":\"XENOA04525CW13907\","
+                       "\"Volume\":10,\"BackgroundColor\":[255,230,103]}]";
+  BtsnoopBuilder b;
+  b.att(0, true, BtsnoopReader::ATT_INDICATION, 12, status, 27);
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(BtsnoopReader::parse(b.bytes.data(), b.bytes.size(), out));
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].data, bytes_of(status));
+}
+
+TEST(BtsnoopReaderTest, ExplicitHandlesWin) {
+  BtsnoopBuilder b;
+  b.att(0, true, BtsnoopReader::ATT_NOTIFICATION, 20, "[3,{\"Brightness\":5}]");
+  b.att(0, true, BtsnoopReader::ATT_NOTIFICATION, 21, "[3,{\"Volume\":5}]");
+  b.att(0, true, BtsnoopReader::ATT_NOTIFICATION, 22, "[3,{\"Volume\":6}]");
+  BtsnoopReader::Handles h;
+  h.dae1 = 21;
+  h.ab1 = 20;
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(BtsnoopReader::parse(b.bytes.data(), b.bytes.size(), out, h));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].kind, TraceEvent::NOTIFY_3AB1);
+  EXPECT_EQ(out[1].kind, TraceEvent::NOTIFY_DAE1);
+}
+
+TEST(BtsnoopReaderTest, RejectsOtherFiles) {
+  std::vector<uint8_t> junk(32, 0);
+  std::vector<TraceEvent> out;
+  EXPECT_FALSE(BtsnoopReader::parse(junk.data(), junk.size(), out));
+}
+
+// ── NrfLogReader ────────────────────────────────────────────────────────────
+
+TEST(NrfLogReaderTest, ReadsNotificationLines) {
+  std::string log =
+      "nRF Connect, 2026-01-28\n"
+      "D\t15:50:39.984\tgatt.setCharacteristicNotification(0000dae1-0000-1000-"
+      "8000-00805f9b34fb, true)\n"
+      "I\t15:50:41.755\tNotification received from 0000dae1-0000-1000-8000-"
+      "00805f9b34fb, value: (0x) 5B-33-2C-7B-22-50-6F-77-65-72-4F-6E-22-3A-66-"
+      "61-6C-73-65-7D-5D, \"[3,{\"PowerOn\":false}]\"\n"
+      "I\t15:50:42.000\tIndication received from 00003ab1-0000-1000-8000-"
+      "00805f9b34fb, value: (0x) 5B-33-5D\n"
+      "I\t15:50:43.000\tNotification received from 00002a05-0000-1000-8000-"
+      "00805f9b34fb, value: (0x) 01-02\n";
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(NrfLogReader::parse(log.data(), log.size(), out));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].kind, TraceEvent::NOTIFY_DAE1);
+  EXPECT_EQ(out[0].t_us, 0u);
+  EXPECT_EQ(out[0].data, bytes_of("[3,{\"PowerOn\":false}]"));
+  EXPECT_EQ(out[1].kind, TraceEvent::NOTIFY_3AB1);
+  EXPECT_EQ(out[1].t_us, 245000u);
+  EXPECT_EQ(out[1].data, bytes_of("[3]"));
+}
+
+TEST(NrfLogReaderTest, WrapsAtMidnight) {
+  std::string log =
+      "I\t23:59:59.500\tNotification received from 0000dae1-x, value: (0x) 5B\n"
+      "I\t00:00:00.250\tNotification received from 0000dae1-x, value: (0x) 5D\n";
+  std::vector<TraceEvent> out;
+  ASSERT_TRUE(NrfLogReader::parse(log.data(), log.size(), out));
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[1].t_us, 750000u);
+}
+
+TEST(NrfLogReaderTest, NothingFound) {
+  std::string log = "nRF Connect, 2026-01-28\nV\t15:50:39.965\tConnecting\n";
+  std::vector<TraceEvent> out;
+  EXPECT_FALSE(NrfLogReader::parse(log.data(), log.size(), out));
+}
+
+// ── SaberModel ──────────────────────────────────────────────────────────────
+
+TEST(SaberModelTest, ShowsIgnoresUnknownAndDarkFields) {
+  SaberModel m;
+  m.power_known = true;
+  m.on = true;
+  m.brightness = 50;
+  m.r = 255;
+  m.g = 0;
+  m.b = 0;
+
+  SaberModel want;
+  EXPECT_TRUE(m.shows(want));
+  want.power_known = true;
+  want.on = true;
+  want.brightness = 50;
+  EXPECT_TRUE(m.shows(want));
+  want.r = 0;
+  want.g = 255;
+  want.b = 0;
+  EXPECT_FALSE(m.shows(want));
+  want.brightness = 0;
+  m.brightness = 0;
+  EXPECT_TRUE(m.shows(want));  // color of a dark blade does not matter
+  want.on = false;
+  EXPECT_FALSE(m.shows(want));
+  m.on = false;
+  EXPECT_TRUE(m.shows(want));
+}
+
+// ── ReplaySession ───────────────────────────────────────────────────────────
+
+namespace {
+
+TraceEvent wled_at(uint64_t t_ms, const std::vector<uint8_t> &data) {
+  TraceEvent e;
+  e.t_us = t_ms * 1000;
+  e.kind = TraceEvent::WLED;
+  e.data = data;
+  return e;
+}
+
+TraceEvent dae1_at(uint64_t t_ms, const std::string &json) {
+  TraceEvent e;
+  e.t_us = t_ms * 1000;
+  e.kind = TraceEvent::NOTIFY_DAE1;
+  e.data = bytes_of(json);
+  return e;
+}
+
+}  // namespace
+
+TEST(ReplaySessionTest, NotifierCommandsReachTheSaber) {
+  ReplayOptions opts;
+  ReplaySession s(opts);
+  ReplayReport r = s.run({wled_at(0, notifier(255, 255, 0, 0)),
+                          wled_at(2000, notifier(128, 0, 0, 255))});
+  EXPECT_EQ(r.wled_packets, 2u);
+  EXPECT_EQ(r.changes, 2u);
+  EXPECT_EQ(r.changes_shown, 2u);
+  EXPECT_EQ(r.changes_unshown, 0u);
+  EXPECT_GE(r.writes, 2u);
+  ASSERT_EQ(r.lag_ms.size(), 2u);
+  EXPECT_LE(r.lag_ms.back(), 2 * opts.loop_ms);
+  EXPECT_TRUE(r.final_state_ok());
+  EXPECT_EQ(r.shown.describe(), "on 50 [0,0,255]");
+}
+
+TEST(ReplaySessionTest, BurstBetweenLoopsIsSuperseded) {
+  ReplayOptions opts;
+  ReplaySession s(opts);
+  std::vector<TraceEvent> events = {wled_at(0, notifier(255, 255, 0, 0))};
+  // Ten packets inside one loop period: only the last one is decoded
+  for (uint8_t i = 1; i <= 10; i++)
+    events.push_back(wled_at(1000, notifier(255, 0, i * 20, 0)));
+  events.back().t_us += 5000;
+  ReplayReport r = s.run(events);
+  EXPECT_EQ(r.changes, 11u);
+  EXPECT_EQ(r.changes_shown, 2u);
+  EXPECT_EQ(r.changes_superseded, 9u);
+  EXPECT_TRUE(r.final_state_ok());
+  EXPECT_EQ(r.shown.g, 200);
+}
+
+TEST(ReplaySessionTest, RapidColorsAreRateLimitedButEndRight) {
+  ReplayOptions opts;
+  ReplaySession s(opts);
+  std::vector<TraceEvent> events;
+  // A 50 Hz fade for two seconds
+  for (uint32_t i = 0; i < 100; i++)
+    events.push_back(wled_at(i * 20, notifier(255, (uint8_t)(i * 2), 0, 255)));
+  ReplayReport r = s.run(events);
+  EXPECT_EQ(r.wled_packets, 100u);
+  EXPECT_LT(r.writes, 100u);
+  EXPECT_GT(r.changes_superseded, 0u);
+  EXPECT_TRUE(r.final_state_ok());
+  EXPECT_EQ(r.shown.r, 198);
+}
+
+TEST(ReplaySessionTest, DarkRealtimeFrameDimsInsteadOfRetracting) {
+  ReplayOptions opts;
+  ReplaySession s(opts);
+  std::vector<uint8_t> lit = {WLED_PROTO_DRGB, 2, 0, 255, 0};
+  std::vector<uint8_t> dark = {WLED_PROTO_DRGB, 2, 0, 0, 0};
+  ReplayReport r = s.run({wled_at(0, lit), wled_at(500, dark),
+                          // Ignored: the realtime stream has not timed out
+                          wled_at(600, notifier(0, 0, 0, 0))});
+  EXPECT_TRUE(r.final_state_ok());
+  EXPECT_TRUE(r.shown.on);
+  EXPECT_EQ(r.shown.brightness, 0);
+}
+
+TEST(ReplaySessionTest, ButtonPressesFromNotificationsAreFollowed) {
+  ReplayOptions opts;
+  ReplaySession s(opts);
+  ReplayReport r = s.run({wled_at(0, notifier(255, 255, 0, 0)),
+                          dae1_at(1000, "[3,{\"PowerOn\":false}]")});
+  EXPECT_EQ(r.notifications, 1u);
+  EXPECT_TRUE(r.final_state_ok());
+  EXPECT_FALSE(r.shown.on);
+}
+
+TEST(ReplaySessionTest, NotificationOffsetShiftsOnlyNotifications) {
+  ReplayOptions opts;
+  opts.notify_offset_ms = 3000;
+  ReplaySession s(opts);
+  // Without the offset the packet would come last and light the blade
+  ReplayReport r = s.run({dae1_at(0, "[3,{\"PowerOn\":false}]"),
+                          wled_at(1000, notifier(255, 255, 0, 0))});
+  EXPECT_TRUE(r.final_state_ok());
+  EXPECT_FALSE(r.expected.on);
+  EXPECT_FALSE(r.shown.on);
+}
+
+TEST(ReplaySessionTest, BrightnessEchoConfirmsCombinedFrames) {
+  ReplayOptions opts;
+  ReplaySession s(opts);
+  ReplayReport with_echo = s.run({wled_at(0, notifier(255, 255, 0, 0)),
+                                  wled_at(3000, notifier(100, 0, 255, 0))});
+  opts.echo_ms = 0;
+  ReplaySession silent(opts);
+  ReplayReport no_echo = silent.run({wled_at(0, notifier(255, 255, 0, 0)),
+                                     wled_at(3000, notifier(100, 0, 255, 0))});
+  EXPECT_TRUE(with_echo.final_state_ok());
+  EXPECT_TRUE(no_echo.final_state_ok());
+  // An unconfirmed probe falls back to one write per key
+  EXPECT_GT(no_echo.writes, with_echo.writes);
+}
+
+TEST(ReplaySessionTest, RunIsRepeatable) {
+  ReplayOptions opts;
+  ReplaySession s(opts);
+  std::vector<TraceEvent> events = {wled_at(0, notifier(255, 255, 0, 0)),
+                                    wled_at(100, notifier(255, 0, 255, 0))};
+  ReplayReport a = s.run(events);
+  ReplayReport b = s.run(events);
+  EXPECT_EQ(a.writes, b.writes);
+  EXPECT_EQ(a.lag_ms, b.lag_ms);
+  EXPECT_EQ(a.shown, b.shown);
+}
@@ -0,0 +1,126 @@
+// C++ unit tests for SaberSession
+// (esphome/components/xenopixel_light/saber_session.h)
+#include "xenopixel_light/saber_session.h"
+
+#include <gtest/gtest.h>
+
+using esphome::xenopixel_light::SaberSession;
+using esphome::xenopixel_light::SessionAction;
+using esphome::xenopixel_light::SessionState;
+
+namespace {
+
+// Connected at t=0, services ready at t=100
+SaberSession discovered() {
+  SaberSession s;
+  s.connected(0);
+  s.services_ready(100);
+  return s;
+}
+
+}  // namespace
+
+TEST(SaberSessionTest, StepsFollowAcknowledgements) {
+  SaberSession s;
+  s.connected(0);
+  EXPECT_EQ(s.state(), SessionState::DISCOVERING);
+  EXPECT_EQ(s.services_ready(100), SessionAction::ENABLE_INDICATIONS);
+  EXPECT_EQ(s.indications_enabled(true, 120), SessionAction::SEND_HANDSHAKE);
+  EXPECT_EQ(s.handshake_written(true, 140), SessionAction::SEND_AUTHORIZE);
+  EXPECT_EQ(s.state(), SessionState::AUTHORIZING);
+  s.access_allowed(600);
+  EXPECT_TRUE(s.is_authorized());
+  EXPECT_TRUE(s.has_time_to_authorized());
+  EXPECT_EQ(s.time_to_authorized_ms(), 600u);
+  EXPECT_EQ(s.get_stats().authorized, 1u);
+}
+
+TEST(SaberSessionTest, EventsOutOfOrderAreIgnored) {
+  SaberSession s = discovered();
+  EXPECT_EQ(s.handshake_written(true, 110), SessionAction::NONE);
+  EXPECT_EQ(s.authorize_failed(110), SessionAction::NONE);
+  EXPECT_EQ(s.state(), SessionState::ENABLING_INDICATIONS);
+  EXPECT_EQ(s.services_ready(120), SessionAction::NONE);
+}
+
+TEST(SaberSessionTest, ServicesReadyWithoutConnectStartsSession) {
+  SaberSession s;
+  EXPECT_EQ(s.services_ready(50), SessionAction::ENABLE_INDICATIONS);
+  EXPECT_EQ(s.get_stats().sessions, 1u);
+}
+
+TEST(SaberSessionTest, TimeoutResendsStep) {
+  SaberSession s = discovered();
+  s.indications_enabled(true, 100);
+  uint32_t t = 100 + SaberSession::HANDSHAKE_TIMEOUT_MS;
+  EXPECT_EQ(s.poll(t - 1), SessionAction::NONE);
+  EXPECT_EQ(s.poll(t), SessionAction::SEND_HANDSHAKE);
+  EXPECT_EQ(s.retries(), 1);
+  EXPECT_EQ(s.get_stats().timeouts, 1u);
+  // The resend gets a full timeout of its own
+  EXPECT_EQ(s.poll(t + SaberSession::HANDSHAKE_TIMEOUT_MS - 1),
+            SessionAction::NONE);
+}
+
+TEST(SaberSessionTest, FailedWriteRetriesAfterDelay) {
+  SaberSession s = discovered();
+  EXPECT_EQ(s.indications_enabled(false, 100), SessionAction::NONE);
+  EXPECT_EQ(s.poll(100 + SaberSession::RETRY_DELAY_MS - 1),
+            SessionAction::NONE);
+  EXPECT_EQ(s.poll(100 + SaberSession::RETRY_DELAY_MS),
+            SessionAction::ENABLE_INDICATIONS);
+  EXPECT_EQ(s.get_stats().timeouts, 0u);
+}
+
+TEST(SaberSessionTest, GivesUpAfterMaxRetries) {
+  SaberSession s = discovered();
+  uint32_t t = 100;
+  for (uint8_t i = 0; i < SaberSession::MAX_RETRIES; i++) {
+    t += SaberSession::INDICATIONS_TIMEOUT_MS;
+    EXPECT_EQ(s.poll(t), SessionAction::ENABLE_INDICATIONS);
+  }
+  t += SaberSession::INDICATIONS_TIMEOUT_MS;
+  EXPECT_EQ(s.poll(t), SessionAction::GIVE_UP);
+  EXPECT_EQ(s.state(), SessionState::FAILED);
+  EXPECT_EQ(s.poll(t + 10000), SessionAction::NONE);
+  EXPECT_EQ(s.get_stats().failures, 1u);
+}
+
+TEST(SaberSessionTest, RetriesResetPerStep) {
+  SaberSession s = discovered();
+  s.poll(100 + SaberSession::INDICATIONS_TIMEOUT_MS);
+  EXPECT_EQ(s.retries(), 1);
+  s.indications_enabled(true, 1200);
+  EXPECT_EQ(s.retries(), 0);
+}
+
+TEST(SaberSessionTest, DiscoveryTimeoutGivesUp) {
+  SaberSession s;
+  s.connected(0);
+  EXPECT_EQ(s.poll(SaberSession::DISCOVERY_TIMEOUT_MS), SessionAction::GIVE_UP);
+}
+
+TEST(SaberSessionTest, AccessAllowedShortCircuitsSteps) {
+  SaberSession s = discovered();
+  s.access_allowed(300);
+  EXPECT_TRUE(s.is_authorized());
+  EXPECT_EQ(s.poll(100000), SessionAction::NONE);
+}
+
+TEST(SaberSessionTest, DisconnectStopsTimers) {
+  SaberSession s = discovered();
+  s.disconnected();
+  EXPECT_EQ(s.state(), SessionState::DISCONNECTED);
+  EXPECT_EQ(s.poll(100000), SessionAction::NONE);
+  s.access_allowed(100001);
+  EXPECT_FALSE(s.is_authorized());
+}
+
+TEST(SaberSessionTest, TimeToAuthorizedKeepsLastSession) {
+  SaberSession s = discovered();
+  s.access_allowed(800);
+  s.disconnected();
+  s.connected(5000);
+  EXPECT_TRUE(s.has_time_to_authorized());
+  EXPECT_EQ(s.time_to_authorized_ms(), 800u);
+}
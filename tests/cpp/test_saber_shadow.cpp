@@ -0,0 +1,77 @@
+// C++ unit tests for SaberShadowState
+// (esphome/components/xenopixel_light/saber_shadow.h)
+#include "xenopixel_light/saber_shadow.h"
+
+#include <gtest/gtest.h>
+
+using esphome::xenopixel_light::SaberShadowState;
+using esphome::xenopixel_light::SHADOW_KEY_COUNT;
+using esphome::xenopixel_light::ShadowKey;
+
+TEST(SaberShadowTest, UnknownUntilReportedOrWanted) {
+  SaberShadowState s;
+  for (size_t i = 0; i < SHADOW_KEY_COUNT; i++)
+    EXPECT_FALSE(s.known((ShadowKey)i));
+  EXPECT_FALSE(s.matches(ShadowKey::VOLUME, 0));
+}
+
+TEST(SaberShadowTest, WantIsADeltaAgainstReport) {
+  SaberShadowState s;
+  s.confirm(ShadowKey::BRIGHTNESS, 50);
+  EXPECT_FALSE(s.want(ShadowKey::BRIGHTNESS, 50));
+  EXPECT_TRUE(s.want(ShadowKey::BRIGHTNESS, 60));
+  EXPECT_EQ(s.value(ShadowKey::BRIGHTNESS), 60);
+  EXPECT_EQ(s.confirmed(ShadowKey::BRIGHTNESS), 50);
+  // Already asked for
+  EXPECT_FALSE(s.want(ShadowKey::BRIGHTNESS, 60));
+}
+
+TEST(SaberShadowTest, WantingReportedValueAgainIsADelta) {
+  SaberShadowState s;
+  s.confirm(ShadowKey::VOLUME, 50);
+  s.want(ShadowKey::VOLUME, 60);
+  // Going back to 50 has to undo the queued 60
+  EXPECT_TRUE(s.want(ShadowKey::VOLUME, 50));
+}
+
+TEST(SaberShadowTest, EchoSettlesPendingRequest) {
+  SaberShadowState s;
+  s.want(ShadowKey::SOUND_FONT, 3);
+  EXPECT_TRUE(s.pending(ShadowKey::SOUND_FONT));
+  EXPECT_FALSE(s.confirm(ShadowKey::SOUND_FONT, 3));
+  EXPECT_FALSE(s.pending(ShadowKey::SOUND_FONT));
+  EXPECT_EQ(s.pending_count(), 0u);
+}
+
+TEST(SaberShadowTest, ReportWinsOverPendingRequest) {
+  SaberShadowState s;
+  s.want(ShadowKey::LIGHT_EFFECT, 4);
+  EXPECT_TRUE(s.confirm(ShadowKey::LIGHT_EFFECT, 2));
+  EXPECT_EQ(s.value(ShadowKey::LIGHT_EFFECT), 2);
+  EXPECT_FALSE(s.pending(ShadowKey::LIGHT_EFFECT));
+}
+
+TEST(SaberShadowTest, ColorPacking) {
+  constexpr int32_t rgb = SaberShadowState::pack_rgb(0x12, 0x34, 0x56);
+  static_assert(rgb == 0x123456, "packed color");
+  EXPECT_EQ(SaberShadowState::unpack_r(rgb), 0x12);
+  EXPECT_EQ(SaberShadowState::unpack_g(rgb), 0x34);
+  EXPECT_EQ(SaberShadowState::unpack_b(rgb), 0x56);
+}
+
+TEST(SaberShadowTest, KeysAreIndependent) {
+  SaberShadowState s;
+  s.confirm(ShadowKey::VOLUME, 10);
+  s.want(ShadowKey::POWER_ON, 1);
+  EXPECT_FALSE(s.known(ShadowKey::BRIGHTNESS));
+  EXPECT_EQ(s.pending_count(), 1u);
+}
+
+TEST(SaberShadowTest, ClearForgetsEverything) {
+  SaberShadowState s;
+  s.confirm(ShadowKey::VOLUME, 10);
+  s.want(ShadowKey::POWER_ON, 1);
+  s.clear();
+  EXPECT_FALSE(s.known(ShadowKey::VOLUME));
+  EXPECT_EQ(s.pending_count(), 0u);
+}
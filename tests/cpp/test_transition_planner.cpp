@@ -0,0 +1,107 @@
+// C++ unit tests for TransitionPlanner
+// (esphome/components/xenopixel_light/transition_planner.h)
+#include "xenopixel_light/transition_planner.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using esphome::xenopixel_light::TransitionMode;
+using esphome::xenopixel_light::TransitionPlanner;
+
+namespace {
+
+// Runs a linear fade of one channel, first step at from, and returns what
+// the planner sent
+std::vector<int> run(TransitionPlanner<1> &p, int from, int to, int steps) {
+  std::vector<int> sent;
+  for (int i = 0; i <= steps; i++) {
+    const int cur[1] = {from + (to - from) * i / steps};
+    const int target[1] = {to};
+    int out[1];
+    if (p.step(cur, target, out)) sent.push_back(out[0]);
+  }
+  return sent;
+}
+
+}  // namespace
+
+TEST(TransitionPlannerTest, DefaultsToFourKeyframes) {
+  TransitionPlanner<1> p;
+  EXPECT_EQ(p.mode(), TransitionMode::KEYFRAMES);
+  EXPECT_EQ(run(p, 0, 100, 120), (std::vector<int>{25, 50, 75, 100}));
+}
+
+TEST(TransitionPlannerTest, KeyframesFallingFade) {
+  TransitionPlanner<1> p;
+  p.set_keyframes(2);
+  EXPECT_EQ(run(p, 90, 10, 33), (std::vector<int>{50, 10}));
+}
+
+TEST(TransitionPlannerTest, KeyframesAreClamped) {
+  TransitionPlanner<1> p;
+  p.set_keyframes(0);
+  EXPECT_EQ(p.keyframes(), 1);
+  p.set_keyframes(200);
+  EXPECT_EQ(p.keyframes(), TransitionPlanner<1>::MAX_KEYFRAMES);
+}
+
+TEST(TransitionPlannerTest, BigStepSkipsToTheFurthestKeyframe) {
+  TransitionPlanner<1> p;
+  EXPECT_EQ(run(p, 0, 100, 2), (std::vector<int>{50, 100}));
+}
+
+TEST(TransitionPlannerTest, TargetModeSendsOnce) {
+  TransitionPlanner<1> p;
+  p.set_mode(TransitionMode::TARGET);
+  EXPECT_EQ(run(p, 0, 100, 50), (std::vector<int>{100}));
+}
+
+TEST(TransitionPlannerTest, AllModeSendsEveryStep) {
+  TransitionPlanner<1> p;
+  p.set_mode(TransitionMode::ALL);
+  EXPECT_EQ(run(p, 0, 100, 50).size(), 51u);
+}
+
+TEST(TransitionPlannerTest, NewTargetStartsANewFade) {
+  TransitionPlanner<1> p;
+  const int cur[1] = {50};
+  const int up[1] = {100};
+  int out[1];
+  EXPECT_FALSE(p.step(cur, up, out));
+  EXPECT_EQ(run(p, 50, 0, 10), (std::vector<int>{38, 25, 13, 0}));
+}
+
+TEST(TransitionPlannerTest, ResetStartsANewFade) {
+  TransitionPlanner<1> p;
+  p.set_mode(TransitionMode::TARGET);
+  EXPECT_EQ(run(p, 0, 100, 10).size(), 1u);
+  EXPECT_TRUE(run(p, 0, 100, 10).empty());
+  p.reset();
+  EXPECT_FALSE(p.fading());
+  EXPECT_EQ(run(p, 0, 100, 10).size(), 1u);
+}
+
+TEST(TransitionPlannerTest, ColorFollowsTheChannelThatMovesMost) {
+  TransitionPlanner<3> p;
+  p.set_keyframes(2);
+  const int target[3] = {0, 40, 255};
+  int out[3];
+  const int start[3] = {255, 0, 0};
+  EXPECT_FALSE(p.step(start, target, out));
+  const int quarter[3] = {191, 10, 63};
+  EXPECT_FALSE(p.step(quarter, target, out));
+  const int half[3] = {127, 20, 128};
+  ASSERT_TRUE(p.step(half, target, out));
+  // Interpolated between where the fade started and the target
+  EXPECT_EQ(out[0], 128);
+  EXPECT_EQ(out[1], 20);
+  EXPECT_EQ(out[2], 127);
+}
+
+TEST(TransitionPlannerTest, NothingToFade) {
+  TransitionPlanner<1> p;
+  const int same[1] = {40};
+  int out[1];
+  EXPECT_FALSE(p.step(same, same, out));
+}
@@ -0,0 +1,183 @@
+// C++ unit tests for TxQueue (esphome/components/xenopixel_light/tx_queue.h)
+#include "xenopixel_light/tx_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+using esphome::xenopixel_light::TxQueue;
+
+using Queue = TxQueue<4, 32>;
+
+static std::string slot_str(const Queue::Slot *slot) {
+  return std::string(slot->data, slot->len);
+}
+
+TEST(TxQueueTest, PushAndClaimInOrder) {
+  Queue q;
+  EXPECT_EQ(q.push(1, "a", 1), Queue::Push::ENQUEUED);
+  EXPECT_EQ(q.push(2, "b", 1), Queue::Push::ENQUEUED);
+  EXPECT_EQ(q.size(), 2u);
+
+  auto *slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot_str(slot), "a");
+  q.pop();
+  slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot_str(slot), "b");
+  q.pop();
+  EXPECT_EQ(q.claim(), nullptr);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(TxQueueTest, SameKeyCoalescesInPlace) {
+  Queue q;
+  q.push(2, "other", 5);
+  q.push(1, "old", 3);
+  EXPECT_EQ(q.push(1, "new", 3), Queue::Push::COALESCED);
+  EXPECT_EQ(q.size(), 2u);
+
+  q.claim();
+  q.pop();
+  auto *slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot_str(slot), "new");
+}
+
+TEST(TxQueueTest, KeyBehindAnotherKeyIsAppended) {
+  Queue q;
+  q.push(1, "a1", 2);
+  q.push(2, "b", 1);
+  // Coalescing into the first slot would send a2 ahead of b
+  EXPECT_EQ(q.push(1, "a2", 2), Queue::Push::ENQUEUED);
+  EXPECT_EQ(q.size(), 3u);
+
+  for (const char *want : {"a1", "b", "a2"}) {
+    auto *slot = q.claim();
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(slot_str(slot), want);
+    q.pop();
+  }
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(TxQueueTest, ClaimedSlotIsNotOverwritten) {
+  Queue q;
+  q.push(1, "sending", 7);
+  auto *slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+
+  // Front slot is in flight — the update takes a fresh slot
+  EXPECT_EQ(q.push(1, "newer", 5), Queue::Push::ENQUEUED);
+  EXPECT_EQ(slot_str(slot), "sending");
+  q.pop();
+  slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot_str(slot), "newer");
+}
+
+TEST(TxQueueTest, UnclaimKeepsFrameAtFront) {
+  Queue q;
+  q.push(1, "a", 1);
+  q.push(2, "b", 1);
+  auto *slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+  slot->retries++;
+  q.unclaim();
+
+  slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot_str(slot), "a");
+  EXPECT_EQ(slot->retries, 1);
+}
+
+TEST(TxQueueTest, CoalesceResetsRetries) {
+  Queue q;
+  q.push(1, "a", 1);
+  auto *slot = q.claim();
+  slot->retries = 2;
+  q.unclaim();
+  q.push(1, "b", 1);
+  slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot->retries, 0);
+}
+
+TEST(TxQueueTest, DropsWhenFull) {
+  Queue q;
+  for (uint16_t k = 0; k < 4; k++) q.push(k, "x", 1);
+  EXPECT_EQ(q.push(9, "y", 1), Queue::Push::DROPPED);
+  // The newest key still coalesces when full
+  EXPECT_EQ(q.push(3, "z", 1), Queue::Push::COALESCED);
+  EXPECT_EQ(q.push(2, "z", 1), Queue::Push::DROPPED);
+  EXPECT_EQ(q.size(), 4u);
+}
+
+TEST(TxQueueTest, DropsOversizedFrame) {
+  Queue q;
+  std::string big(33, 'x');
+  EXPECT_EQ(q.push(1, big.data(), big.size()), Queue::Push::DROPPED);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(TxQueueTest, WrapsAroundCapacity) {
+  Queue q;
+  for (int round = 0; round < 10; round++) {
+    char c = (char)('a' + round);
+    ASSERT_EQ(q.push((uint16_t)round, &c, 1), Queue::Push::ENQUEUED);
+    auto *slot = q.claim();
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(slot->data[0], c);
+    q.pop();
+  }
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(TxQueueTest, ClearDiscardsEverything) {
+  Queue q;
+  q.push(1, "a", 1);
+  q.push(2, "b", 1);
+  EXPECT_EQ(q.clear(), 2u);
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(q.claim(), nullptr);
+}
+
+TEST(TxQueueTest, EmplaceEncodesIntoSlot) {
+  Queue q;
+  auto encode = [](char *buf, size_t cap) {
+    EXPECT_EQ(cap, 32u);
+    memcpy(buf, "direct", 6);
+    return (size_t)6;
+  };
+  EXPECT_EQ(q.emplace(1, encode), Queue::Push::ENQUEUED);
+  auto *slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot_str(slot), "direct");
+}
+
+TEST(TxQueueTest, FailedEmplaceKeepsWaitingFrame) {
+  Queue q;
+  q.push(1, "keep", 4);
+  auto too_big = [](char *, size_t) { return (size_t)0; };
+  EXPECT_EQ(q.emplace(1, too_big), Queue::Push::DROPPED);
+  EXPECT_EQ(q.emplace(2, too_big), Queue::Push::DROPPED);
+  EXPECT_EQ(q.size(), 1u);
+  auto *slot = q.claim();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot_str(slot), "keep");
+}
+
+TEST(TxQueueTest, AnyKeySeesEveryWaitingFrame) {
+  Queue q;
+  EXPECT_FALSE(q.any_key(0xFF));
+  q.push(1, "a", 1);
+  q.push(4, "b", 1);
+  EXPECT_TRUE(q.any_key(4));
+  EXPECT_FALSE(q.any_key(2));
+  q.claim();
+  q.pop();
+  EXPECT_TRUE(q.any_key(4));
+  EXPECT_FALSE(q.any_key(1));
+}
@@ -0,0 +1,204 @@
+// C++ unit tests for WledHub (esphome/components/xenopixel_light/wled_hub.h)
+#include "xenopixel_light/wled_hub.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using esphome::xenopixel_light::WLED_TIMEOUT_FOREVER;
+using esphome::xenopixel_light::WledHub;
+using esphome::xenopixel_light::WledPixelWindow;
+using esphome::xenopixel_light::WledReceiver;
+using esphome::xenopixel_light::WledSubscriber;
+using esphome::xenopixel_light::WledTarget;
+
+namespace {
+
+struct Recorder : WledSubscriber {
+  std::vector<WledTarget> got;
+  bool ready{true};
+  void on_wled_target(const WledTarget &t) override { got.push_back(t); }
+  bool wled_ready() override { return ready; }
+};
+
+void publish(std::initializer_list<uint8_t> bytes) {
+  std::vector<uint8_t> v(bytes);
+  WledReceiver::instance().publish(v.data(), v.size());
+}
+
+class WledHubTest : public ::testing::Test {
+ protected:
+  void SetUp() override { publish({0x00}); }
+
+  // Runs service() over a few loop ticks
+  void settle() {
+    for (int i = 0; i < 4; i++) {
+      hub_.service(now_);
+      now_ += 10;
+    }
+  }
+
+  WledHub hub_;
+  uint32_t now_{1000};
+};
+
+}  // namespace
+
+TEST_F(WledHubTest, DecodesEachGenerationOnce) {
+  Recorder a, b;
+  hub_.subscribe(&a, {});
+  hub_.subscribe(&b, {});
+  settle();
+  uint32_t decoded = hub_.packets_decoded();
+
+  publish({0, 0, 200, 255, 0, 0});
+  settle();
+  EXPECT_EQ(hub_.packets_decoded(), decoded + 1);
+  ASSERT_EQ(a.got.size(), 1u);
+  ASSERT_EQ(b.got.size(), 1u);
+  EXPECT_EQ(a.got[0].bri, 200);
+}
+
+TEST_F(WledHubTest, DeliversOnlyOnChange) {
+  Recorder a;
+  hub_.subscribe(&a, {});
+  publish({0, 0, 200, 255, 0, 0});
+  settle();
+  publish({0, 0, 200, 255, 0, 0});
+  settle();
+  EXPECT_EQ(a.got.size(), 1u);
+
+  publish({0, 0, 100, 255, 0, 0});
+  settle();
+  ASSERT_EQ(a.got.size(), 2u);
+  EXPECT_EQ(a.got[1].bri, 100);
+}
+
+TEST_F(WledHubTest, OnlyChangedWindowsAreDelivered) {
+  Recorder a, b;
+  hub_.subscribe(&a, {0, 1});
+  hub_.subscribe(&b, {1, 1});
+  publish({2, 1, 255, 0, 0, 0, 255, 0});
+  settle();
+  // Pixel 0 unchanged, pixel 1 changed
+  publish({2, 1, 255, 0, 0, 0, 0, 255});
+  settle();
+  EXPECT_EQ(a.got.size(), 1u);
+  ASSERT_EQ(b.got.size(), 2u);
+  EXPECT_EQ(b.got[1].b, 255);
+}
+
+TEST_F(WledHubTest, DeliversToEveryReadySubscriber) {
+  Recorder a, b;
+  hub_.subscribe(&a, {});
+  hub_.subscribe(&b, {});
+  settle();
+  publish({0, 0, 200, 255, 0, 0});
+
+  hub_.service(now_);
+  EXPECT_EQ(a.got.size(), 1u);
+  EXPECT_EQ(b.got.size(), 1u);
+}
+
+TEST_F(WledHubTest, HoldsTargetUntilReady) {
+  Recorder a, b;
+  hub_.subscribe(&a, {});
+  hub_.subscribe(&b, {});
+  settle();
+  b.ready = false;
+  publish({0, 0, 200, 255, 0, 0});
+  hub_.service(now_);
+  EXPECT_EQ(a.got.size(), 1u);
+  EXPECT_TRUE(b.got.empty());
+
+  // Only the newest target is delivered once b has budget again
+  publish({0, 0, 100, 255, 0, 0});
+  hub_.service(now_);
+  b.ready = true;
+  hub_.service(now_);
+  EXPECT_EQ(a.got.size(), 2u);
+  ASSERT_EQ(b.got.size(), 1u);
+  EXPECT_EQ(b.got[0].bri, 100);
+}
+
+TEST_F(WledHubTest, LateSubscriberGetsCurrentState) {
+  Recorder a, b;
+  hub_.subscribe(&a, {});
+  publish({0, 0, 200, 255, 0, 0});
+  settle();
+
+  uint32_t decoded = hub_.packets_decoded();
+  hub_.subscribe(&b, {});
+  settle();
+  EXPECT_EQ(a.got.size(), 1u);
+  ASSERT_EQ(b.got.size(), 1u);
+  EXPECT_EQ(b.got[0].bri, 200);
+  EXPECT_EQ(hub_.packets_decoded(), decoded);
+}
+
+TEST_F(WledHubTest, LateSubscriberDoesNotRestartRealtime) {
+  Recorder a, b;
+  hub_.subscribe(&a, {});
+  publish({2, 2, 255, 0, 0});
+  settle();
+  now_ += 3000;
+  ASSERT_FALSE(hub_.is_realtime(now_));
+
+  // The stale realtime frame is neither applied nor admitted again
+  hub_.subscribe(&b, {});
+  settle();
+  EXPECT_FALSE(hub_.is_realtime(now_));
+  EXPECT_TRUE(b.got.empty());
+  EXPECT_EQ(a.got.size(), 1u);
+}
+
+TEST_F(WledHubTest, RealtimeSuppressesNotifierUntilTimeout) {
+  Recorder a;
+  hub_.subscribe(&a, {});
+  publish({2, 2, 255, 0, 0});
+  settle();
+  EXPECT_TRUE(hub_.is_realtime(now_));
+
+  publish({0, 0, 200, 0, 255, 0});
+  settle();
+  ASSERT_EQ(a.got.size(), 1u);
+  EXPECT_EQ(a.got[0].kind, WledTarget::REALTIME);
+
+  now_ += 2000;
+  EXPECT_FALSE(hub_.is_realtime(now_));
+  publish({0, 0, 200, 0, 255, 0});
+  settle();
+  ASSERT_EQ(a.got.size(), 2u);
+  EXPECT_EQ(a.got[1].kind, WledTarget::NOTIFIER);
+}
+
+TEST_F(WledHubTest, RealtimeFrameOutsideWindowStillStartsRealtime) {
+  Recorder a;
+  hub_.subscribe(&a, {100, 1});
+  publish({2, WLED_TIMEOUT_FOREVER, 255, 0, 0});
+  settle();
+  EXPECT_TRUE(a.got.empty());
+  EXPECT_TRUE(hub_.is_realtime(now_ + 1000000));
+}
+
+TEST_F(WledHubTest, UnsubscribeStopsDelivery) {
+  Recorder a, b;
+  hub_.subscribe(&a, {});
+  hub_.subscribe(&b, {});
+  hub_.unsubscribe(&a);
+  EXPECT_EQ(hub_.subscriber_count(), 1u);
+
+  publish({0, 0, 200, 255, 0, 0});
+  settle();
+  EXPECT_TRUE(a.got.empty());
+  EXPECT_EQ(b.got.size(), 1u);
+}
+
+TEST_F(WledHubTest, RegistryIsBounded) {
+  Recorder subs[WledHub::MAX_SUBSCRIBERS + 1];
+  for (size_t i = 0; i < WledHub::MAX_SUBSCRIBERS; i++)
+    EXPECT_TRUE(hub_.subscribe(&subs[i], {}));
+  EXPECT_FALSE(hub_.subscribe(&subs[WledHub::MAX_SUBSCRIBERS], {}));
+  // Re-subscribing an existing saber still works
+  EXPECT_TRUE(hub_.subscribe(&subs[0], {5, 1}));
+}
@@ -0,0 +1,110 @@
+// C++ unit tests for WledDecoder
+// (esphome/components/xenopixel_light/wled_protocol.h)
+#include "xenopixel_light/wled_protocol.h"
+
+#include <gtest/gtest.h>
+
+using esphome::xenopixel_light::WledDecoder;
+using esphome::xenopixel_light::WledPixelWindow;
+using esphome::xenopixel_light::WledTarget;
+
+static WledTarget decode(const uint8_t *data, size_t len,
+                         WledPixelWindow window = {}) {
+  return WledDecoder::decode(data, len, window);
+}
+
+TEST(WledDecoderTest, NotifierCarriesBrightnessAndColor) {
+  const uint8_t pkt[] = {0, 0, 200, 255, 0, 128};
+  WledTarget t = decode(pkt, sizeof(pkt));
+  EXPECT_EQ(t.kind, WledTarget::NOTIFIER);
+  EXPECT_EQ(t.bri, 200);
+  EXPECT_EQ(t.r, 255);
+  EXPECT_EQ(t.g, 0);
+  EXPECT_EQ(t.b, 128);
+}
+
+TEST(WledDecoderTest, RejectsShortAndUnknownPackets) {
+  const uint8_t notifier[] = {0, 0, 200, 255, 0};
+  EXPECT_EQ(decode(notifier, sizeof(notifier)).kind, WledTarget::NONE);
+  const uint8_t unknown[] = {9, 0, 1, 2, 3, 4};
+  EXPECT_EQ(decode(unknown, sizeof(unknown)).kind, WledTarget::NONE);
+  EXPECT_EQ(decode(unknown, 1).kind, WledTarget::NONE);
+}
+
+TEST(WledDecoderTest, DrgbSplitsPeakIntoBrightness) {
+  const uint8_t pkt[] = {2, 5, 0, 64, 32};
+  WledTarget t = decode(pkt, sizeof(pkt));
+  EXPECT_EQ(t.kind, WledTarget::REALTIME);
+  EXPECT_EQ(t.timeout_s, 5);
+  EXPECT_EQ(t.bri, 64);
+  EXPECT_EQ(t.r, 0);
+  EXPECT_EQ(t.g, 255);
+  EXPECT_EQ(t.b, 127);
+}
+
+TEST(WledDecoderTest, DrgbAveragesWindow) {
+  const uint8_t pkt[] = {2, 1, 9, 9, 9, 200, 0, 0, 100, 0, 0, 9, 9, 9};
+  WledTarget t = decode(pkt, sizeof(pkt), {1, 2});
+  EXPECT_EQ(t.bri, 150);
+  EXPECT_EQ(t.r, 255);
+}
+
+TEST(WledDecoderTest, DrgbIgnoresTruncatedRecord) {
+  const uint8_t pkt[] = {2, 1, 10, 20};
+  EXPECT_EQ(decode(pkt, sizeof(pkt)).kind, WledTarget::NONE);
+}
+
+TEST(WledDecoderTest, DrgbwSkipsWhiteChannel) {
+  const uint8_t pkt[] = {3, 1, 0, 0, 0, 255, 50, 0, 0, 255};
+  WledTarget t = decode(pkt, sizeof(pkt), {1, 1});
+  EXPECT_EQ(t.bri, 50);
+  EXPECT_EQ(t.r, 255);
+  EXPECT_EQ(t.g, 0);
+}
+
+TEST(WledDecoderTest, WarlsMatchesRecordIndex) {
+  // Records out of order; only LED 7 is in the window
+  const uint8_t pkt[] = {1, 2, 3, 255, 0, 0, 7, 0, 0, 200};
+  WledTarget t = decode(pkt, sizeof(pkt), {7, 1});
+  EXPECT_EQ(t.kind, WledTarget::REALTIME);
+  EXPECT_EQ(t.bri, 200);
+  EXPECT_EQ(t.b, 255);
+}
+
+TEST(WledDecoderTest, DnrgbOffsetsByStartIndex) {
+  const uint8_t pkt[] = {4, 1, 0x01, 0x00, 10, 0, 0, 0, 20, 0};
+  WledTarget t = decode(pkt, sizeof(pkt), {257, 1});
+  EXPECT_EQ(t.bri, 20);
+  EXPECT_EQ(t.g, 255);
+}
+
+TEST(WledDecoderTest, DnrgbOutsideWindowIsNone) {
+  const uint8_t pkt[] = {4, 1, 0x01, 0x00, 10, 0, 0};
+  EXPECT_EQ(decode(pkt, sizeof(pkt)).kind, WledTarget::NONE);
+}
+
+TEST(WledDecoderTest, BlackFrameHasZeroBrightness) {
+  const uint8_t pkt[] = {2, 1, 0, 0, 0};
+  WledTarget t = decode(pkt, sizeof(pkt));
+  EXPECT_EQ(t.kind, WledTarget::REALTIME);
+  EXPECT_EQ(t.bri, 0);
+}
+
+TEST(WledDecoderTest, DecodeMultiSplitsWindows) {
+  const uint8_t pkt[] = {2, 1, 255, 0, 0, 0, 255, 0, 0, 0, 255};
+  const WledPixelWindow windows[] = {{0, 1}, {1, 1}, {5, 1}};
+  WledTarget out[3];
+  WledDecoder::decode_multi(pkt, sizeof(pkt), windows, out, 3);
+  EXPECT_EQ(out[0].r, 255);
+  EXPECT_EQ(out[1].g, 255);
+  EXPECT_EQ(out[2].kind, WledTarget::NONE);
+}
+
+TEST(WledDecoderTest, DecodeMultiNotifierFillsEveryWindow) {
+  const uint8_t pkt[] = {0, 0, 128, 0, 0, 255};
+  const WledPixelWindow windows[] = {{0, 1}, {9, 1}};
+  WledTarget out[2];
+  WledDecoder::decode_multi(pkt, sizeof(pkt), windows, out, 2);
+  EXPECT_TRUE(out[0].same_output(out[1]));
+  EXPECT_EQ(out[1].bri, 128);
+}
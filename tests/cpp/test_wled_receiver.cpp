@@ -0,0 +1,254 @@
+// C++ unit tests for WledReceiver
+// (esphome/components/xenopixel_light/wled_receiver.h)
+#include "wled_socket_mock.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+using esphome::xenopixel_light::WLED_DEFAULT_PORT;
+using esphome::xenopixel_light::WLED_MAX_SOURCES;
+using esphome::xenopixel_light::WLED_PACKET_MAX;
+using esphome::xenopixel_light::WledPacket;
+using esphome::xenopixel_light::WledReceiver;
+using esphome::xenopixel_light::Instrumentation;
+
+TEST(WledReceiverTest, PublishBumpsGeneration) {
+  WledReceiver rx;
+  EXPECT_EQ(rx.generation(), 0u);
+  const uint8_t pkt[] = {0, 0, 200, 255, 0, 0};
+  rx.publish(pkt, sizeof(pkt));
+  EXPECT_EQ(rx.generation(), 1u);
+  rx.publish(pkt, sizeof(pkt));
+  EXPECT_EQ(rx.generation(), 2u);
+}
+
+TEST(WledReceiverTest, ReadIfNewerCopiesOncePerGeneration) {
+  WledReceiver rx;
+  const uint8_t pkt[] = {0, 0, 200, 255, 0, 128};
+  rx.publish(pkt, sizeof(pkt));
+
+  uint32_t last_gen = 0;
+  WledPacket out;
+  ASSERT_TRUE(rx.read_if_newer(last_gen, out));
+  EXPECT_EQ(last_gen, 1u);
+  ASSERT_EQ(out.len, sizeof(pkt));
+  EXPECT_EQ(memcmp(out.data, pkt, sizeof(pkt)), 0);
+
+  EXPECT_FALSE(rx.read_if_newer(last_gen, out));
+}
+
+TEST(WledReceiverTest, ReaderSkipsToLatest) {
+  WledReceiver rx;
+  const uint8_t a[] = {0, 0, 1, 1, 1, 1};
+  const uint8_t b[] = {0, 0, 2, 2, 2, 2};
+  rx.publish(a, sizeof(a));
+  rx.publish(b, sizeof(b));
+
+  uint32_t last_gen = 0;
+  WledPacket out;
+  ASSERT_TRUE(rx.read_if_newer(last_gen, out));
+  EXPECT_EQ(last_gen, 2u);
+  EXPECT_EQ(out.data[2], 2);
+}
+
+TEST(WledReceiverTest, IndependentReadersEachSeePacket) {
+  WledReceiver rx;
+  const uint8_t pkt[] = {0, 0, 9, 9, 9, 9};
+  rx.publish(pkt, sizeof(pkt));
+
+  uint32_t gen_a = 0, gen_b = 0;
+  WledPacket out;
+  EXPECT_TRUE(rx.read_if_newer(gen_a, out));
+  EXPECT_TRUE(rx.read_if_newer(gen_b, out));
+  EXPECT_FALSE(rx.read_if_newer(gen_a, out));
+}
+
+TEST(WledReceiverTest, TruncatesOversizedPacket) {
+  WledReceiver rx;
+  std::vector<uint8_t> big(WLED_PACKET_MAX + 10, 7);
+  rx.publish(big.data(), big.size());
+
+  uint32_t last_gen = 0;
+  WledPacket out;
+  ASSERT_TRUE(rx.read_if_newer(last_gen, out));
+  EXPECT_EQ(out.len, WLED_PACKET_MAX);
+}
+
+TEST(WledReceiverTest, TaskRequestIsSticky) {
+  WledReceiver rx;
+  EXPECT_FALSE(rx.is_task_requested());
+  rx.request_task();
+  EXPECT_TRUE(rx.is_task_requested());
+}
+
+TEST(WledReceiverTest, VisitReadsInPlaceOnce) {
+  WledReceiver rx;
+  const uint8_t pkt[] = {2, 1, 10, 20, 30};
+  rx.publish(pkt, sizeof(pkt));
+
+  uint32_t gen = 0;
+  const uint8_t *seen = nullptr;
+  size_t seen_len = 0;
+  auto fn = [&](const uint8_t *data, size_t len) {
+    seen = data;
+    seen_len = len;
+  };
+  ASSERT_TRUE(rx.visit_if_newer(gen, fn));
+  EXPECT_EQ(seen_len, sizeof(pkt));
+  EXPECT_EQ(seen[4], 30);
+  EXPECT_EQ(gen, 1u);
+
+  seen = nullptr;
+  EXPECT_FALSE(rx.visit_if_newer(gen, fn));
+  EXPECT_EQ(seen, nullptr);
+}
+
+static uint32_t addr(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  const uint8_t octets[4] = {a, b, c, d};
+  uint32_t out;
+  memcpy(&out, octets, sizeof(out));
+  return out;
+}
+
+TEST(WledReceiverTest, AcceptsAnySourceByDefault) {
+  WledReceiver rx;
+  EXPECT_TRUE(rx.is_source_allowed(addr(10, 0, 0, 7)));
+}
+
+TEST(WledReceiverTest, AllowedSourcesFilterSenders) {
+  WledReceiver rx;
+  EXPECT_TRUE(rx.add_allowed_source(192, 168, 1, 20));
+  EXPECT_TRUE(rx.add_allowed_source(192, 168, 1, 21));
+  EXPECT_TRUE(rx.is_source_allowed(addr(192, 168, 1, 20)));
+  EXPECT_TRUE(rx.is_source_allowed(addr(192, 168, 1, 21)));
+  EXPECT_FALSE(rx.is_source_allowed(addr(192, 168, 1, 22)));
+}
+
+TEST(WledReceiverTest, AllowedSourcesAreBoundedAndDeduplicated) {
+  WledReceiver rx;
+  for (uint8_t i = 0; i < WLED_MAX_SOURCES; i++)
+    EXPECT_TRUE(rx.add_allowed_source(10, 0, 0, i));
+  // Already listed — still fine when full
+  EXPECT_TRUE(rx.add_allowed_source(10, 0, 0, 0));
+  EXPECT_FALSE(rx.add_allowed_source(10, 0, 0, 99));
+  EXPECT_FALSE(rx.is_source_allowed(addr(10, 0, 0, 99)));
+}
+
+TEST(WledReceiverTest, FirstConfiguredPortWins) {
+  WledReceiver rx;
+  EXPECT_EQ(rx.port(), WLED_DEFAULT_PORT);
+  rx.set_port(4048);
+  rx.set_port(5000);
+  EXPECT_EQ(rx.port(), 4048);
+}
+
+TEST(WledReceiverTest, MulticastGroupInNetworkOrder) {
+  WledReceiver rx;
+  EXPECT_EQ(rx.multicast_group(), 0u);
+  rx.set_multicast_group(239, 0, 0, 1);
+  EXPECT_EQ(rx.multicast_group(), addr(239, 0, 0, 1));
+}
+
+// ── Socket drain ────────────────────────────────────────────────────────────
+
+TEST(WledReceiverTest, PollWithoutSocketDoesNothing) {
+  WledReceiver rx;
+  rx.poll();
+  EXPECT_EQ(rx.generation(), 0u);
+}
+
+TEST(WledReceiverTest, OpensSocketWithPortAndGroupOnce) {
+  WledReceiver rx;
+  MockWledSocket sock;
+  rx.set_port(4048);
+  rx.set_multicast_group(239, 0, 0, 1);
+  rx.set_socket(&sock);
+  rx.poll();
+  rx.poll();
+  EXPECT_EQ(sock.open_calls(), 1u);
+  EXPECT_EQ(sock.port(), 4048);
+  EXPECT_EQ(sock.multicast_group(), addr(239, 0, 0, 1));
+}
+
+TEST(WledReceiverTest, RetriesOpenUntilItSucceeds) {
+  WledReceiver rx;
+  MockWledSocket sock;
+  sock.set_openable(false);
+  rx.set_socket(&sock);
+  const uint8_t pkt[] = {0x00, 0x00, 128};
+  sock.inject(pkt, sizeof(pkt));
+  rx.poll();
+  rx.poll();
+  EXPECT_EQ(rx.generation(), 0u);
+  EXPECT_EQ(sock.recv_calls(), 0u);
+
+  sock.set_openable(true);
+  rx.poll();
+  EXPECT_EQ(sock.open_calls(), 3u);
+  EXPECT_EQ(rx.generation(), 1u);
+}
+
+TEST(WledReceiverTest, DrainPublishesOnlyTheLatestOfABurst) {
+  WledReceiver rx;
+  MockWledSocket sock;
+  rx.set_socket(&sock);
+  Instrumentation::instance().reset();
+  for (uint8_t i = 1; i <= 5; i++) {
+    const uint8_t pkt[] = {0x00, 0x00, i};
+    sock.inject(pkt, sizeof(pkt));
+  }
+  rx.poll();
+  EXPECT_EQ(sock.pending(), 0u);
+  EXPECT_EQ(rx.generation(), 1u);
+
+  uint32_t gen = 0;
+  WledPacket out;
+  ASSERT_TRUE(rx.read_if_newer(gen, out));
+  EXPECT_EQ(out.len, 3);
+  EXPECT_EQ(out.data[2], 5);
+  EXPECT_EQ(Instrumentation::instance().received(), 5u);
+  EXPECT_EQ(Instrumentation::instance().superseded(), 4u);
+
+  // Nothing waiting: no new generation
+  rx.poll();
+  EXPECT_EQ(rx.generation(), 1u);
+}
+
+TEST(WledReceiverTest, DrainDropsRuntsAndDisallowedSenders) {
+  WledReceiver rx;
+  MockWledSocket sock;
+  rx.add_allowed_source(192, 168, 1, 20);
+  rx.set_socket(&sock);
+  const uint8_t good[] = {0x00, 0x00, 7};
+  const uint8_t runt[] = {0x00};
+  const uint8_t other[] = {0x00, 0x00, 9};
+  sock.inject(good, sizeof(good), addr(192, 168, 1, 20));
+  sock.inject(runt, sizeof(runt), addr(192, 168, 1, 20));
+  sock.inject(other, sizeof(other), addr(192, 168, 1, 99));
+  rx.poll();
+  EXPECT_EQ(rx.rejected_count(), 1u);
+
+  uint32_t gen = 0;
+  WledPacket out;
+  ASSERT_TRUE(rx.read_if_newer(gen, out));
+  EXPECT_EQ(out.data[2], 7);
+
+  // Only disallowed traffic: nothing published
+  sock.inject(other, sizeof(other), addr(192, 168, 1, 99));
+  rx.poll();
+  EXPECT_EQ(rx.generation(), 1u);
+  EXPECT_EQ(rx.rejected_count(), 2u);
+}
+
+TEST(WledReceiverTest, ReplacingTheSocketOpensTheNewOne) {
+  WledReceiver rx;
+  MockWledSocket first, second;
+  rx.set_socket(&first);
+  rx.poll();
+  rx.set_socket(&second);
+  rx.poll();
+  EXPECT_EQ(first.open_calls(), 1u);
+  EXPECT_EQ(second.open_calls(), 1u);
+}
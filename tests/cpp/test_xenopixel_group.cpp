@@ -0,0 +1,309 @@
+// C++ unit tests for XenopixelGroup
+// (esphome/components/xenopixel_group/xenopixel_group.h)
+// Mock header MUST be included first to define all types before the real header.
+#include "esphome_mock.h"
+
+#include "xenopixel_group/xenopixel_group.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::xenopixel_light;
+using esphome::xenopixel_group::XenopixelGroup;
+
+namespace {
+
+// Characteristic handle 42 + index tells the sabers' writes apart
+struct GroupSaber {
+  explicit GroupSaber(uint8_t index) {
+    chr.handle = 42 + index;
+    client.set_mock_characteristic(&chr);
+    client.set_gattc_if(1);
+    client.set_conn_id(2 + index);
+    const uint8_t bda[6] = {0xB0, 0xCB, 0xD8, 0xDB, 0xE1, index};
+    client.set_remote_bda(bda);
+    light.set_ble_client(&client);
+    light.set_authorized_global(&authorized);
+    light.set_syncing_global(&syncing);
+    light.set_keepalive_interval(0);
+    light.setup_state(&state);
+    esp_ble_gattc_cb_param_t mtu{};
+    mtu.cfg_mtu.status = ESP_GATT_OK;
+    mtu.cfg_mtu.conn_id = 2 + index;
+    mtu.cfg_mtu.mtu = 247;
+    client.dispatch_gattc_event(ESP_GATTC_CFG_MTU_EVT, &mtu);
+  }
+
+  XenopixelLight light;
+  ble_client::BLEClient client;
+  ble_client::BLECharacteristic chr;
+  globals::GlobalsComponent<bool> authorized{true};
+  globals::GlobalsComponent<bool> syncing{false};
+  light::LightState state;
+};
+
+// Every accepted write takes the BLE stack 150us, as seen from micros()
+struct TimedLink : MockBleLink {
+  esp_err_t write(uint16_t, uint16_t, uint16_t, const uint8_t *) override {
+    mock_micros_value() += 150;
+    return ESP_OK;
+  }
+};
+
+class XenopixelGroupTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_ble_writes().clear();
+    mock_ble_write_status() = ESP_OK;
+    mock_millis_value() = 1000;
+    mock_micros_value() = 0;
+    SaberGattProfile::instance().clear();
+    WledHub::instance().reset();
+    BleWriteScheduler::instance().reset();
+    mock_ble_link() = &link_;
+  }
+
+  void TearDown() override { mock_ble_link() = nullptr; }
+
+  void add_sabers(size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      sabers_.emplace_back(new GroupSaber((uint8_t)i));
+      group_.add_member(&sabers_.back()->state);
+    }
+  }
+
+  // One pass of the main loop: the members, then the group
+  void tick(uint32_t ms = 16) {
+    mock_millis_value() += ms;
+    for (auto &s : sabers_) s->light.loop();
+    group_.loop();
+  }
+
+  void turn_on(float brightness, float r, float g, float b) {
+    state_.current_values.set_state(true);
+    state_.current_values.set_brightness(brightness);
+    state_.current_values.set_rgb(r, g, b);
+    state_.remote_values = state_.current_values;
+    group_.write_state(&state_);
+  }
+
+  std::vector<std::string> writes_to(size_t index) {
+    std::vector<std::string> out;
+    for (const auto &w : g_ble_writes())
+      if (w.handle == 42 + index) out.push_back(w.data);
+    return out;
+  }
+
+  TimedLink link_;
+  std::vector<std::unique_ptr<GroupSaber>> sabers_;
+  XenopixelGroup group_;
+  light::LightState state_;
+};
+
+}  // namespace
+
+TEST_F(XenopixelGroupTest, TraitsAreRgb) {
+  auto modes = group_.get_traits().get_supported_color_modes();
+  EXPECT_EQ(modes.size(), 1u);
+  EXPECT_EQ(modes.count(light::ColorMode::RGB), 1u);
+}
+
+TEST_F(XenopixelGroupTest, EveryMemberGetsTheCommand) {
+  add_sabers(4);
+  turn_on(0.5f, 1.0f, 0.0f, 0.0f);
+  tick();
+  tick();
+  for (size_t i = 0; i < 4; i++) {
+    auto w = writes_to(i);
+    ASSERT_EQ(w.size(), 1u) << i;
+    EXPECT_EQ(w[0],
+              "[2,{\"PowerOn\":true,\"Brightness\":50,"
+              "\"BackgroundColor\":[255,0,0]}]");
+  }
+}
+
+TEST_F(XenopixelGroupTest, MemberEntitiesReflectTheGroupCommand) {
+  add_sabers(2);
+  turn_on(0.5f, 1.0f, 0.0f, 0.0f);
+  tick();
+  tick();
+  for (auto &s : sabers_) {
+    EXPECT_TRUE(s->state.current_values.is_on());
+    EXPECT_FLOAT_EQ(s->state.current_values.get_brightness(), 0.5f);
+    EXPECT_FLOAT_EQ(s->state.current_values.get_red(), 1.0f);
+    EXPECT_FLOAT_EQ(s->state.current_values.get_green(), 0.0f);
+    EXPECT_TRUE(s->state.remote_values == s->state.current_values);
+    EXPECT_EQ(s->state.publishes, 1);
+  }
+
+  // The member's own next write_state() agrees with the group's command
+  g_ble_writes().clear();
+  sabers_[0]->light.write_state(&sabers_[0]->state);
+  tick();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelGroupTest, MembersPublishOnceTheGroupTransitionEnds) {
+  add_sabers(2);
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.2f);
+  state_.remote_values.set_state(true);
+  state_.remote_values.set_brightness(0.8f);
+  group_.write_state(&state_);
+  EXPECT_FLOAT_EQ(sabers_[0]->state.current_values.get_brightness(), 0.2f);
+  EXPECT_EQ(sabers_[0]->state.publishes, 0);
+
+  state_.current_values.set_brightness(0.8f);
+  group_.write_state(&state_);
+  EXPECT_EQ(sabers_[0]->state.publishes, 1);
+  EXPECT_EQ(sabers_[1]->state.publishes, 1);
+}
+
+TEST_F(XenopixelGroupTest, NothingLeavesBeforeTheRelease) {
+  add_sabers(2);
+  turn_on(1.0f, 1.0f, 1.0f, 1.0f);
+  // Members flush into their queues but stay held
+  mock_millis_value() += 16;
+  for (auto &s : sabers_) s->light.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+  EXPECT_TRUE(group_.is_staging());
+  group_.loop();
+  EXPECT_FALSE(group_.is_staging());
+  EXPECT_TRUE(g_ble_writes().empty());
+  tick();
+  EXPECT_EQ(g_ble_writes().size(), 2u);
+}
+
+TEST_F(XenopixelGroupTest, AllMembersWriteInOneInterval) {
+  add_sabers(4);
+  turn_on(1.0f, 0.0f, 0.0f, 1.0f);
+  tick();
+  // Whichever member's loop() opens the next interval writes for all
+  mock_millis_value() += BleWriteScheduler::INTERVAL_MS;
+  sabers_[2]->light.loop();
+  EXPECT_EQ(g_ble_writes().size(), 4u);
+  EXPECT_EQ(BleWriteScheduler::instance().get_stats().writes, 4u);
+}
+
+TEST_F(XenopixelGroupTest, ReportsTheSkew) {
+  add_sabers(4);
+  turn_on(1.0f, 1.0f, 1.0f, 1.0f);
+  tick();
+  tick();
+  EXPECT_EQ(group_.get_stats().releases, 1u);
+  EXPECT_EQ(group_.get_stats().last_members, 4u);
+  // Three writes of 150us between the first and the last saber
+  EXPECT_EQ(group_.get_stats().last_skew_us, 450u);
+  EXPECT_EQ(group_.get_stats().max_skew_us, 450u);
+  EXPECT_FLOAT_EQ(group_.get_last_skew_ms(), 0.45f);
+}
+
+TEST_F(XenopixelGroupTest, UnchangedMembersAreLeftOutOfTheSkew) {
+  add_sabers(3);
+  sabers_[1]->light.update_cached_power(true);
+  sabers_[1]->light.update_cached_brightness(100);
+  sabers_[1]->light.update_cached_color(255, 255, 255);
+  turn_on(1.0f, 1.0f, 1.0f, 1.0f);
+  tick();
+  tick();
+  EXPECT_TRUE(writes_to(1).empty());
+  EXPECT_EQ(group_.get_stats().last_members, 2u);
+  EXPECT_EQ(group_.get_stats().last_skew_us, 150u);
+}
+
+TEST_F(XenopixelGroupTest, SkewIsUnknownUntilMeasured) {
+  add_sabers(2);
+  EXPECT_TRUE(std::isnan(group_.get_last_skew_ms()));
+
+  // Only one member has anything to write
+  sabers_[1]->light.update_cached_power(true);
+  sabers_[1]->light.update_cached_brightness(100);
+  sabers_[1]->light.update_cached_color(255, 255, 255);
+  turn_on(1.0f, 1.0f, 1.0f, 1.0f);
+  tick();
+  tick();
+  EXPECT_EQ(group_.get_stats().last_members, 1u);
+  EXPECT_TRUE(std::isnan(group_.get_last_skew_ms()));
+}
+
+TEST_F(XenopixelGroupTest, WaitsForAHeldColor) {
+  add_sabers(2);
+  for (auto &s : sabers_) s->light.set_color_interval_bounds(50, 50);
+  turn_on(1.0f, 1.0f, 0.0f, 0.0f);
+  tick();
+  tick();
+  g_ble_writes().clear();
+
+  // The color limiters are still closed; the group waits for the colors
+  turn_on(1.0f, 0.0f, 1.0f, 0.0f);
+  tick(1);
+  EXPECT_TRUE(group_.is_staging());
+  EXPECT_TRUE(g_ble_writes().empty());
+  tick(50);
+  EXPECT_FALSE(group_.is_staging());
+  tick();
+  ASSERT_EQ(writes_to(0).size(), 1u);
+  ASSERT_EQ(writes_to(1).size(), 1u);
+  EXPECT_EQ(group_.get_stats().stage_timeouts, 0u);
+}
+
+TEST_F(XenopixelGroupTest, ReleasesAfterTheStageTimeout) {
+  add_sabers(2);
+  sabers_[1]->light.set_color_interval_bounds(1000, 1000);
+  turn_on(1.0f, 1.0f, 0.0f, 0.0f);
+  tick();
+  tick();
+  g_ble_writes().clear();
+
+  turn_on(1.0f, 0.0f, 1.0f, 0.0f);
+  tick(XenopixelGroup::STAGE_TIMEOUT_MS / 2);
+  EXPECT_TRUE(group_.is_staging());
+  tick(XenopixelGroup::STAGE_TIMEOUT_MS / 2);
+  EXPECT_FALSE(group_.is_staging());
+  EXPECT_EQ(group_.get_stats().stage_timeouts, 1u);
+  tick();
+  EXPECT_EQ(writes_to(0).size(), 1u);
+}
+
+TEST_F(XenopixelGroupTest, UnauthorizedMemberDoesNotBlock) {
+  add_sabers(2);
+  sabers_[1]->authorized.value() = false;
+  turn_on(1.0f, 1.0f, 1.0f, 1.0f);
+  tick();
+  tick();
+  EXPECT_EQ(writes_to(0).size(), 1u);
+  EXPECT_TRUE(writes_to(1).empty());
+  EXPECT_EQ(group_.get_stats().stage_timeouts, 0u);
+  EXPECT_EQ(group_.get_stats().last_members, 1u);
+}
+
+TEST_F(XenopixelGroupTest, MembersResolvedAfterSetup) {
+  light::LightState late;
+  group_.add_member(&late);
+  turn_on(1.0f, 1.0f, 1.0f, 1.0f);
+  tick();
+  EXPECT_EQ(group_.get_stats().releases, 1u);
+
+  GroupSaber saber(0);
+  saber.light.setup_state(&late);
+  state_.current_values.set_brightness(0.5f);
+  state_.remote_values = state_.current_values;
+  group_.write_state(&state_);
+  mock_millis_value() += 16;
+  saber.light.loop();
+  group_.loop();
+  mock_millis_value() += 16;
+  saber.light.loop();
+  EXPECT_EQ(g_ble_writes().size(), 1u);
+}
+
+TEST_F(XenopixelGroupTest, RegistryIsBounded) {
+  light::LightState states[XenopixelGroup::MAX_MEMBERS + 1];
+  for (auto &s : states) group_.add_member(&s);
+  EXPECT_EQ(group_.member_count(), XenopixelGroup::MAX_MEMBERS);
+}
@@ -2,10 +2,14 @@
 // Mock header MUST be included first to define all types before the real header.
 #include "esphome_mock.h"
 
+#include "wled_socket_mock.h"
+#include "xenopixel_light/xenopixel_effect.h"
 #include "xenopixel_light/xenopixel_light.h"
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+
 using namespace esphome;
 using namespace esphome::xenopixel_light;
 
@@ -15,7 +19,23 @@ class XenopixelLightTest : public ::testing::Test {
  protected:
   void SetUp() override {
     g_ble_writes().clear();
+    g_conn_param_requests().clear();
+    g_descr_writes().clear();
+    g_notify_registrations().clear();
+    mock_gatt_db().clear();
+    mock_gatt_lookups() = 0;
+    SaberGattProfile::instance().clear();
+    mock_ble_write_status() = ESP_OK;
     mock_millis_value() = 1000;  // Start well past debounce window
+    mock_micros_value() = 0;
+    Instrumentation::instance().reset();
+
+    // Supersede any packet an earlier test left in the shared receiver with
+    // one too short to apply
+    const uint8_t stale[] = {0x00};
+    WledReceiver::instance().publish(stale, sizeof(stale));
+    WledHub::instance().reset();
+    BleWriteScheduler::instance().reset();
 
     authorized_.value() = true;
     syncing_.value() = false;
@@ -24,10 +44,14 @@ class XenopixelLightTest : public ::testing::Test {
     client_.set_mock_characteristic(&chr_);
     client_.set_gattc_if(1);
     client_.set_conn_id(2);
+    client_.set_remote_bda(kBda);
 
     light_.set_ble_client(&client_);
     light_.set_authorized_global(&authorized_);
     light_.set_syncing_global(&syncing_);
+    // Single-key mode keeps per-command assertions exact; combined frames
+    // are covered by the Batch_ tests below.
+    light_.set_combine_commands(false);
 
     // Default state: off, full brightness, white
     state_.current_values.set_state(false);
@@ -35,6 +59,40 @@ class XenopixelLightTest : public ::testing::Test {
     state_.current_values.set_rgb(1.0f, 1.0f, 1.0f);
   }
 
+  // Commands are flushed on the next loop() tick. Outside a transition
+  // ESPHome's target is the current value.
+  void write_state() {
+    state_.remote_values = state_.current_values;
+    light_.write_state(&state_);
+    light_.loop();
+  }
+
+  void apply_packet(const std::vector<uint8_t> &pkt) {
+    light_.apply_wled_packet(pkt);
+    light_.loop();
+  }
+
+  void exchange_mtu(uint16_t mtu, esp_gatt_status_t status = ESP_GATT_OK) {
+    esp_ble_gattc_cb_param_t param{};
+    param.cfg_mtu.status = status;
+    param.cfg_mtu.conn_id = 2;
+    param.cfg_mtu.mtu = mtu;
+    client_.dispatch_gattc_event(ESP_GATTC_CFG_MTU_EVT, &param);
+  }
+
+  // The GAP update event for this saber's connection
+  static esp_ble_gap_cb_param_t conn_update(uint16_t conn_int,
+                                            const uint8_t (&bda)[6] = kBda) {
+    esp_ble_gap_cb_param_t p{};
+    p.update_conn_params.status = ESP_BT_STATUS_SUCCESS;
+    memcpy(p.update_conn_params.bda, bda, 6);
+    p.update_conn_params.conn_int = conn_int;
+    p.update_conn_params.timeout = 200;
+    return p;
+  }
+
+  static constexpr uint8_t kBda[6] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+
   XenopixelLight light_;
   ble_client::BLEClient client_;
   ble_client::BLECharacteristic chr_;
@@ -57,21 +115,21 @@ TEST_F(XenopixelLightTest, GetTraits_ReturnsRGB) {
 TEST_F(XenopixelLightTest, WriteState_SkipsWhenSyncing) {
   syncing_.value() = true;
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
 TEST_F(XenopixelLightTest, WriteState_SkipsWhenNotAuthorized) {
   authorized_.value() = false;
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
 TEST_F(XenopixelLightTest, WriteState_SkipsWhenAuthorizedNull) {
   light_.set_authorized_global(nullptr);
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
@@ -79,7 +137,7 @@ TEST_F(XenopixelLightTest, WriteState_SkipsWhenAuthorizedNull) {
 
 TEST_F(XenopixelLightTest, WriteState_SendsPowerOn) {
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   ASSERT_FALSE(g_ble_writes().empty());
   EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
 }
@@ -87,22 +145,22 @@ TEST_F(XenopixelLightTest, WriteState_SendsPowerOn) {
 TEST_F(XenopixelLightTest, WriteState_SendsPowerOff) {
   // First turn on so that turning off is a change
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   g_ble_writes().clear();
 
   state_.current_values.set_state(false);
-  light_.write_state(&state_);
+  write_state();
   ASSERT_FALSE(g_ble_writes().empty());
   EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":false}]");
 }
 
 TEST_F(XenopixelLightTest, WriteState_SkipsRedundantPower) {
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   g_ble_writes().clear();
 
   // Same state again — no power command expected
-  light_.write_state(&state_);
+  write_state();
   // Brightness/color may still be sent on second call (first time cached),
   // but no PowerOn command should appear
   for (const auto &w : g_ble_writes()) {
@@ -116,7 +174,7 @@ TEST_F(XenopixelLightTest, WriteState_SkipsRedundantPower) {
 TEST_F(XenopixelLightTest, WriteState_SendsBrightness) {
   state_.current_values.set_state(true);
   state_.current_values.set_brightness(0.75f);
-  light_.write_state(&state_);
+  write_state();
 
   bool found = false;
   for (const auto &w : g_ble_writes()) {
@@ -131,12 +189,12 @@ TEST_F(XenopixelLightTest, WriteState_SendsBrightness) {
 TEST_F(XenopixelLightTest, WriteState_SkipsRedundantBrightness) {
   state_.current_values.set_state(true);
   state_.current_values.set_brightness(0.50f);
-  light_.write_state(&state_);
+  write_state();
   g_ble_writes().clear();
 
   // Same brightness again
   mock_millis_value() = 2000;  // avoid color debounce
-  light_.write_state(&state_);
+  write_state();
   for (const auto &w : g_ble_writes()) {
     EXPECT_EQ(w.data.find("Brightness"), std::string::npos)
         << "Unexpected Brightness in: " << w.data;
@@ -149,7 +207,7 @@ TEST_F(XenopixelLightTest, WriteState_SendsColor) {
   state_.current_values.set_state(true);
   state_.current_values.set_brightness(1.0f);
   state_.current_values.set_rgb(1.0f, 0.0f, 0.5f);
-  light_.write_state(&state_);
+  write_state();
 
   bool found = false;
   for (const auto &w : g_ble_writes()) {
@@ -165,12 +223,12 @@ TEST_F(XenopixelLightTest, WriteState_SendsColor) {
 TEST_F(XenopixelLightTest, WriteState_SkipsRedundantColor) {
   state_.current_values.set_state(true);
   state_.current_values.set_rgb(0.5f, 0.5f, 0.5f);
-  light_.write_state(&state_);
+  write_state();
   g_ble_writes().clear();
 
   // Same color, enough time passed to avoid debounce
   mock_millis_value() = 2000;
-  light_.write_state(&state_);
+  write_state();
   for (const auto &w : g_ble_writes()) {
     EXPECT_EQ(w.data.find("BackgroundColor"), std::string::npos)
         << "Unexpected BackgroundColor in: " << w.data;
@@ -180,13 +238,13 @@ TEST_F(XenopixelLightTest, WriteState_SkipsRedundantColor) {
 TEST_F(XenopixelLightTest, WriteState_DebouncesColor) {
   state_.current_values.set_state(true);
   state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
-  light_.write_state(&state_);
+  write_state();
   g_ble_writes().clear();
 
   // Change color but only 50ms later — should be suppressed
   state_.current_values.set_rgb(0.0f, 1.0f, 0.0f);
   mock_millis_value() = 1050;
-  light_.write_state(&state_);
+  write_state();
   for (const auto &w : g_ble_writes()) {
     EXPECT_EQ(w.data.find("BackgroundColor"), std::string::npos)
         << "Color should be debounced: " << w.data;
@@ -199,7 +257,7 @@ TEST_F(XenopixelLightTest, WriteState_SkipsCommandsWhenOff) {
   state_.current_values.set_state(false);
   state_.current_values.set_brightness(0.5f);
   state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
-  light_.write_state(&state_);
+  write_state();
 
   for (const auto &w : g_ble_writes()) {
     EXPECT_EQ(w.data.find("Brightness"), std::string::npos);
@@ -214,7 +272,7 @@ TEST_F(XenopixelLightTest, WriteState_RecoverRGBFromBrightness) {
   state_.current_values.set_brightness(0.5f);
   state_.current_values.set_rgb(1.0f, 0.5f, 0.0f);
   // as_rgb will return (0.5, 0.25, 0.0) — dividing by 0.5 recovers (1.0, 0.5, 0.0)
-  light_.write_state(&state_);
+  write_state();
 
   bool found = false;
   for (const auto &w : g_ble_writes()) {
@@ -233,7 +291,7 @@ TEST_F(XenopixelLightTest, WriteState_ClampsRGBOvershoot) {
   // as_rgb returns (r*br, g*br, b*br) = (0.6, 0.5, 0.5)
   // dividing by 0.5 gives (1.2, 1.0, 1.0) — 1.2 should clamp to 1.0
   state_.current_values.set_rgb(1.2f, 1.0f, 1.0f);
-  light_.write_state(&state_);
+  write_state();
 
   bool found = false;
   for (const auto &w : g_ble_writes()) {
@@ -249,7 +307,7 @@ TEST_F(XenopixelLightTest, WriteState_ClampsRGBOvershoot) {
 
 TEST_F(XenopixelLightTest, ResetHandle_ClearsCache) {
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   ASSERT_FALSE(g_ble_writes().empty());
   // Handle was cached; now reset it
   light_.reset_handle();
@@ -258,7 +316,7 @@ TEST_F(XenopixelLightTest, ResetHandle_ClearsCache) {
   // Make the client return nullptr — simulates disconnected
   client_.set_mock_characteristic(nullptr);
   state_.current_values.set_state(false);
-  light_.write_state(&state_);
+  write_state();
   // Power change attempted, but characteristic lookup fails → no writes
   EXPECT_TRUE(g_ble_writes().empty());
 }
@@ -268,7 +326,7 @@ TEST_F(XenopixelLightTest, ResetHandle_ClearsCache) {
 TEST_F(XenopixelLightTest, SendCommand_HandlesNullClient) {
   light_.set_ble_client(nullptr);
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   // Should not crash; no writes
   EXPECT_TRUE(g_ble_writes().empty());
 }
@@ -276,7 +334,7 @@ TEST_F(XenopixelLightTest, SendCommand_HandlesNullClient) {
 TEST_F(XenopixelLightTest, SendCommand_HandlesNullCharacteristic) {
   client_.set_mock_characteristic(nullptr);
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   // Characteristic lookup fails → no writes
   EXPECT_TRUE(g_ble_writes().empty());
 }
@@ -285,20 +343,20 @@ TEST_F(XenopixelLightTest, SendCommand_HandlesNullCharacteristic) {
 
 TEST_F(XenopixelLightTest, WLED_IgnoresShortPacket) {
   std::vector<uint8_t> pkt = {0x00, 0x00, 0xFF, 0xFF, 0x00};  // only 5 bytes
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
-TEST_F(XenopixelLightTest, WLED_IgnoresNonNotifierProtocol) {
-  std::vector<uint8_t> pkt = {0x01, 0x00, 0xFF, 0xFF, 0x00, 0x00};
-  light_.apply_wled_packet(pkt);
+TEST_F(XenopixelLightTest, WLED_IgnoresUnknownProtocol) {
+  std::vector<uint8_t> pkt = {0x05, 0x00, 0xFF, 0xFF, 0x00, 0x00};
+  apply_packet(pkt);
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
 TEST_F(XenopixelLightTest, WLED_SendsColorAndBrightness) {
   // brightness=200, R=255, G=0, B=128
   std::vector<uint8_t> pkt = {0x00, 0x00, 200, 255, 0, 128};
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
 
   ASSERT_GE(g_ble_writes().size(), 3u);
   EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
@@ -310,11 +368,11 @@ TEST_F(XenopixelLightTest, WLED_SendsColorAndBrightness) {
 TEST_F(XenopixelLightTest, WLED_BrightnessZeroTurnsOff) {
   // First turn on so off is a change
   std::vector<uint8_t> pkt_on = {0x00, 0x00, 128, 255, 0, 0};
-  light_.apply_wled_packet(pkt_on);
+  apply_packet(pkt_on);
   g_ble_writes().clear();
 
   std::vector<uint8_t> pkt_off = {0x00, 0x00, 0, 0, 0, 0};
-  light_.apply_wled_packet(pkt_off);
+  apply_packet(pkt_off);
 
   ASSERT_FALSE(g_ble_writes().empty());
   EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":false}]");
@@ -330,7 +388,7 @@ TEST_F(XenopixelLightTest, WLED_WorksWhileSyncing) {
   // (only authorization matters for WLED)
   syncing_.value() = true;
   std::vector<uint8_t> pkt = {0x00, 0x00, 200, 255, 0, 0};
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   ASSERT_GE(g_ble_writes().size(), 3u);
   EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
   EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":78}]");
@@ -340,21 +398,21 @@ TEST_F(XenopixelLightTest, WLED_WorksWhileSyncing) {
 TEST_F(XenopixelLightTest, WLED_SkipsWhenNotAuthorized) {
   authorized_.value() = false;
   std::vector<uint8_t> pkt = {0x00, 0x00, 200, 255, 0, 0};
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
 TEST_F(XenopixelLightTest, WLED_BlocksWriteState) {
   light_.set_wled_active(true);
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
 TEST_F(XenopixelLightTest, WLED_BrightnessMapping) {
   // Test boundary values: 1 → 0, 128 → 50, 255 → 100
   std::vector<uint8_t> pkt = {0x00, 0x00, 1, 255, 255, 255};
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   bool found = false;
   for (const auto &w : g_ble_writes()) {
     if (w.data.find("Brightness") != std::string::npos) {
@@ -367,7 +425,7 @@ TEST_F(XenopixelLightTest, WLED_BrightnessMapping) {
   g_ble_writes().clear();
   mock_millis_value() = 1200;  // advance past color debounce
   pkt[2] = 128;
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   for (const auto &w : g_ble_writes()) {
     if (w.data.find("Brightness") != std::string::npos) {
       EXPECT_EQ(w.data, "[2,{\"Brightness\":50}]");  // 128*100/255 = 50
@@ -377,7 +435,7 @@ TEST_F(XenopixelLightTest, WLED_BrightnessMapping) {
   g_ble_writes().clear();
   mock_millis_value() = 1400;  // advance past color debounce
   pkt[2] = 255;
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   for (const auto &w : g_ble_writes()) {
     if (w.data.find("Brightness") != std::string::npos) {
       EXPECT_EQ(w.data, "[2,{\"Brightness\":100}]");  // 255*100/255 = 100
@@ -388,26 +446,26 @@ TEST_F(XenopixelLightTest, WLED_BrightnessMapping) {
 TEST_F(XenopixelLightTest, WLED_SkipsWhenAuthorizedNull) {
   light_.set_authorized_global(nullptr);
   std::vector<uint8_t> pkt = {0x00, 0x00, 200, 255, 0, 0};
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
 TEST_F(XenopixelLightTest, WLED_IgnoresEmptyPacket) {
   std::vector<uint8_t> pkt = {};
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
 TEST_F(XenopixelLightTest, WLED_SkipsRedundantValues) {
   // First packet: power on, brightness 78, color [255,0,0]
   std::vector<uint8_t> pkt = {0x00, 0x00, 200, 255, 0, 0};
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   ASSERT_EQ(g_ble_writes().size(), 3u);
   g_ble_writes().clear();
 
   // Same packet again — power, brightness, and color are all unchanged
   mock_millis_value() = 1200;  // advance past color debounce
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
   EXPECT_TRUE(g_ble_writes().empty());
 }
 
@@ -416,13 +474,13 @@ TEST_F(XenopixelLightTest, WLED_SharesStateWithWriteState) {
   state_.current_values.set_state(true);
   state_.current_values.set_brightness(1.0f);
   state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
-  light_.write_state(&state_);
+  write_state();
   g_ble_writes().clear();
 
   // WLED packet with same power state (on) — no PowerOn command expected
   mock_millis_value() = 1200;  // advance past color debounce
   std::vector<uint8_t> pkt = {0x00, 0x00, 200, 0, 255, 0};
-  light_.apply_wled_packet(pkt);
+  apply_packet(pkt);
 
   for (const auto &w : g_ble_writes()) {
     EXPECT_EQ(w.data.find("PowerOn"), std::string::npos)
@@ -436,12 +494,12 @@ TEST_F(XenopixelLightTest, WLED_WriteStateWorksAfterDisable) {
   // Enable WLED — write_state should be blocked
   light_.set_wled_active(true);
   state_.current_values.set_state(true);
-  light_.write_state(&state_);
+  write_state();
   EXPECT_TRUE(g_ble_writes().empty());
 
   // Disable WLED — write_state should work again
   light_.set_wled_active(false);
-  light_.write_state(&state_);
+  write_state();
   EXPECT_FALSE(g_ble_writes().empty());
 }
 
@@ -452,3 +510,1908 @@ TEST_F(XenopixelLightTest, WLED_IsWledActiveGetter) {
   light_.set_wled_active(false);
   EXPECT_FALSE(light_.is_wled_active());
 }
+
+// ── Command batching ────────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, Batch_NothingSentBeforeLoop) {
+  state_.current_values.set_state(true);
+  state_.remote_values = state_.current_values;
+  light_.write_state(&state_);
+  EXPECT_TRUE(g_ble_writes().empty());
+  light_.loop();
+  EXPECT_FALSE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, Batch_CombinesFieldsIntoOneWrite) {
+  light_.set_combine_commands(true);
+  exchange_mtu(247);
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.5f);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data,
+            "[2,{\"PowerOn\":true,\"Brightness\":50,"
+            "\"BackgroundColor\":[255,0,0]}]");
+  EXPECT_EQ(g_ble_writes()[0].handle, 42);
+}
+
+TEST_F(XenopixelLightTest, Batch_SingleFieldUsesPlainFrame) {
+  light_.set_combine_commands(true);
+  state_.current_values.set_state(true);
+  write_state();
+  g_ble_writes().clear();
+
+  state_.current_values.set_brightness(0.3f);
+  mock_millis_value() = 2000;
+  write_state();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":30}]");
+}
+
+TEST_F(XenopixelLightTest, Batch_CoalescesWithinOneTick) {
+  light_.set_combine_commands(true);
+  exchange_mtu(247);
+  std::vector<uint8_t> pkt1 = {0x00, 0x00, 200, 255, 0, 0};
+  std::vector<uint8_t> pkt2 = {0x00, 0x00, 100, 255, 0, 0};
+  light_.apply_wled_packet(pkt1);
+  light_.apply_wled_packet(pkt2);
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  // Latest brightness wins: 100*100/255 = 39
+  EXPECT_EQ(g_ble_writes()[0].data,
+            "[2,{\"PowerOn\":true,\"Brightness\":39,"
+            "\"BackgroundColor\":[255,0,0]}]");
+}
+
+TEST_F(XenopixelLightTest, Batch_ConfirmedProbeKeepsCombining) {
+  light_.set_combine_commands(true);
+  exchange_mtu(247);
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.5f);
+  write_state();
+  light_.confirm_brightness(50);
+
+  g_ble_writes().clear();
+  mock_millis_value() = 5000;  // well past the probe timeout
+  state_.current_values.set_brightness(0.6f);
+  state_.current_values.set_rgb(0.0f, 0.0f, 1.0f);
+  write_state();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data,
+            "[2,{\"Brightness\":60,\"BackgroundColor\":[0,0,255]}]");
+  EXPECT_TRUE(light_.is_combining_commands());
+}
+
+TEST_F(XenopixelLightTest, Batch_FallsBackWhenProbeUnconfirmed) {
+  light_.set_combine_commands(true);
+  exchange_mtu(247);
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.5f);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  g_ble_writes().clear();
+
+  // No confirmation — after the timeout the probed fields are resent singly
+  mock_millis_value() = 1000 + 1500;
+  light_.loop();
+  EXPECT_FALSE(light_.is_combining_commands());
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":50}]");
+  EXPECT_EQ(g_ble_writes()[2].data, "[2,{\"BackgroundColor\":[255,0,0]}]");
+}
+
+TEST_F(XenopixelLightTest, Batch_UnverifiedWithoutBrightnessSendsSingly) {
+  // Cache brightness 100 in single-key mode, then turn off
+  state_.current_values.set_state(true);
+  write_state();
+  state_.current_values.set_state(false);
+  write_state();
+  g_ble_writes().clear();
+
+  // Brightness is the key the saber confirms, so a power + color frame
+  // cannot serve as a probe and goes out as single-key writes
+  light_.set_combine_commands(true);
+  mock_millis_value() = 2000;
+  state_.current_values.set_state(true);
+  state_.current_values.set_rgb(0.0f, 1.0f, 0.0f);
+  write_state();
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"BackgroundColor\":[0,255,0]}]");
+}
+
+TEST_F(XenopixelLightTest, Batch_DisconnectCancelsProbe) {
+  light_.set_combine_commands(true);
+  state_.current_values.set_state(true);
+  write_state();          // power + brightness + color → probe
+  light_.reset_handle();  // disconnect mid-probe
+  g_ble_writes().clear();
+
+  mock_millis_value() = 5000;
+  light_.loop();
+  EXPECT_TRUE(light_.is_combining_commands());
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, Batch_PackedToTheMtu) {
+  light_.set_combine_commands(true);
+  exchange_mtu(50);
+  state_.current_values.set_state(true);
+  write_state();
+  // 70 bytes do not fit a 47-byte write: color goes in a second frame
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+  EXPECT_EQ(g_ble_writes()[0].data,
+            "[2,{\"PowerOn\":true,\"Brightness\":100}]");
+  EXPECT_EQ(g_ble_writes()[1].data,
+            "[2,{\"BackgroundColor\":[255,255,255]}]");
+  EXPECT_EQ(light_.get_tx_stats().split, 1u);
+
+  // The frame carrying brightness is still the probe
+  light_.confirm_brightness(100);
+  mock_millis_value() = 5000;
+  light_.loop();
+  EXPECT_TRUE(light_.is_combining_commands());
+}
+
+TEST_F(XenopixelLightTest, Batch_DefaultMtuWritesKeysSingly) {
+  light_.set_combine_commands(true);
+  exchange_mtu(ATT_MTU_DEFAULT);
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.5f);
+  write_state();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":50}]");
+
+  // Nothing combined, so nothing to probe
+  mock_millis_value() = 5000;
+  light_.loop();
+  EXPECT_TRUE(light_.is_combining_commands());
+  EXPECT_EQ(g_ble_writes().size(), 3u);
+}
+
+// Before the exchange completes the link is still at the default MTU
+TEST_F(XenopixelLightTest, Batch_FreshConnectionSplitsAtDefaultMtu) {
+  light_.set_combine_commands(true);
+  ASSERT_EQ(light_.get_att_mtu(), 0);
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.5f);
+  write_state();
+  // One key per write, as at an exchanged MTU of 23
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":50}]");
+  EXPECT_EQ(light_.get_tx_stats().split, 2u);
+}
+
+TEST_F(XenopixelLightTest, Batch_FailedExchangeSplitsAtDefaultMtu) {
+  light_.set_combine_commands(true);
+  exchange_mtu(247, ESP_GATT_ERROR);
+  EXPECT_EQ(light_.get_att_mtu(), ATT_MTU_DEFAULT);
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.5f);
+  write_state();
+  // One key per write, as at an exchanged MTU of 23
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":50}]");
+}
+
+TEST_F(XenopixelLightTest, Batch_LargeMtuKeepsOneFrame) {
+  light_.set_combine_commands(true);
+  exchange_mtu(ESP_GATT_MAX_MTU_SIZE);
+  state_.current_values.set_state(true);
+  write_state();
+  EXPECT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(light_.get_tx_stats().split, 0u);
+}
+
+// ── TX queue ────────────────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, TxQueue_CountsEnqueued) {
+  state_.current_values.set_state(true);
+  write_state();
+  EXPECT_EQ(light_.get_tx_stats().enqueued, 3u);
+  EXPECT_EQ(light_.get_tx_stats().dropped, 0u);
+}
+
+TEST_F(XenopixelLightTest, TxQueue_PausesWhileCongested) {
+  esp_ble_gattc_cb_param_t param{};
+  param.congest.conn_id = 2;
+  param.congest.congested = true;
+  client_.dispatch_gattc_event(ESP_GATTC_CONGEST_EVT, &param);
+  EXPECT_TRUE(light_.is_tx_congested());
+
+  state_.current_values.set_state(true);
+  write_state();
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  param.congest.congested = false;
+  client_.dispatch_gattc_event(ESP_GATTC_CONGEST_EVT, &param);
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+}
+
+TEST_F(XenopixelLightTest, TxQueue_IgnoresOtherConnectionCongestion) {
+  esp_ble_gattc_cb_param_t param{};
+  param.congest.conn_id = 7;
+  param.congest.congested = true;
+  client_.dispatch_gattc_event(ESP_GATTC_CONGEST_EVT, &param);
+  EXPECT_FALSE(light_.is_tx_congested());
+}
+
+TEST_F(XenopixelLightTest, TxQueue_CoalescesWhileCongested) {
+  esp_ble_gattc_cb_param_t param{};
+  param.congest.conn_id = 2;
+  param.congest.congested = true;
+  client_.dispatch_gattc_event(ESP_GATTC_CONGEST_EVT, &param);
+
+  std::vector<uint8_t> pkt = {0x00, 0x00, 200, 255, 0, 0};
+  for (int i = 0; i < 10; i++) {
+    pkt[2] = (uint8_t)(100 + i * 10);
+    apply_packet(pkt);
+  }
+  // PowerOn, Brightness and BackgroundColor each hold one slot; the later
+  // brightness changes queue once behind the color and coalesce there
+  EXPECT_EQ(light_.get_tx_stats().enqueued, 4u);
+  EXPECT_EQ(light_.get_tx_stats().coalesced, 8u);
+
+  param.congest.congested = false;
+  client_.dispatch_gattc_event(ESP_GATTC_CONGEST_EVT, &param);
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 4u);
+  EXPECT_EQ(g_ble_writes()[3].data, "[2,{\"Brightness\":74}]");  // 190
+}
+
+TEST_F(XenopixelLightTest, TxQueue_RetriesFailedWrite) {
+  mock_ble_write_status() = ESP_FAIL;
+  state_.current_values.set_state(true);
+  write_state();
+  EXPECT_TRUE(g_ble_writes().empty());
+  EXPECT_EQ(light_.get_tx_stats().retried, 1u);
+
+  // Nothing goes out until the backoff has passed
+  mock_ble_write_status() = ESP_OK;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+  mock_millis_value() += TX_RETRY_BASE_MS;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+}
+
+TEST_F(XenopixelLightTest, TxQueue_BackoffDoublesAndIsBounded) {
+  mock_ble_write_status() = ESP_FAIL;
+  state_.current_values.set_state(true);
+  write_state();
+  uint32_t expected[] = {20, 40, 80, 160, 320, 640, 1000, 1000};
+  for (uint32_t wait : expected) {
+    size_t failures = light_.get_link_health().failures();
+    mock_millis_value() += wait - 1;
+    light_.loop();
+    EXPECT_EQ(light_.get_link_health().failures(), failures);
+    mock_millis_value() += 1;
+    light_.loop();
+    EXPECT_EQ(light_.get_link_health().failures(), failures + 1);
+  }
+}
+
+TEST_F(XenopixelLightTest, TxQueue_RequeuesFieldsAfterMaxRetries) {
+  mock_ble_write_status() = ESP_FAIL;
+  state_.current_values.set_state(true);
+  write_state();
+  for (int i = 0; i < 3; i++) {
+    mock_millis_value() += TX_RETRY_MAX_MS;
+    light_.loop();
+  }
+  EXPECT_EQ(light_.get_tx_stats().retried, 3u);
+  EXPECT_EQ(light_.get_tx_stats().requeued, 1u);
+  EXPECT_EQ(light_.get_tx_stats().dropped, 0u);
+
+  // PowerOn gave way to brightness and color but is still sent
+  mock_ble_write_status() = ESP_OK;
+  mock_millis_value() += TX_RETRY_MAX_MS;
+  light_.loop();
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":100}]");
+  EXPECT_EQ(g_ble_writes()[2].data, "[2,{\"PowerOn\":true}]");
+}
+
+TEST_F(XenopixelLightTest, TxQueue_ReportedFieldIsNotRequeued) {
+  mock_ble_write_status() = ESP_FAIL;
+  light_.send_volume(40);
+  light_.loop();
+  // Changed on the saber meanwhile
+  light_.update_cached_volume(30);
+  for (int i = 0; i < 3; i++) {
+    mock_millis_value() += TX_RETRY_MAX_MS;
+    light_.loop();
+  }
+  mock_ble_write_status() = ESP_OK;
+  mock_millis_value() += TX_RETRY_MAX_MS;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, TxQueue_RequeuesSettings) {
+  mock_ble_write_status() = ESP_FAIL;
+  light_.send_volume(40);
+  light_.loop();
+  for (int i = 0; i < 3; i++) {
+    mock_millis_value() += TX_RETRY_MAX_MS;
+    light_.loop();
+  }
+  mock_ble_write_status() = ESP_OK;
+  mock_millis_value() += TX_RETRY_MAX_MS;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Volume\":40}]");
+}
+
+TEST_F(XenopixelLightTest, LinkHealth_TracksWriteOutcomes) {
+  EXPECT_TRUE(std::isnan(light_.get_link_health_percent()));
+  state_.current_values.set_state(true);
+  write_state();
+  EXPECT_FLOAT_EQ(light_.get_link_health_percent(), 100.0f);
+
+  mock_ble_write_status() = ESP_ERR_INVALID_STATE;
+  state_.current_values.set_brightness(0.5f);
+  write_state();
+  EXPECT_FLOAT_EQ(light_.get_link_health_percent(), 75.0f);
+  EXPECT_EQ(light_.get_link_health().error_count(ESP_ERR_INVALID_STATE), 1u);
+}
+
+TEST_F(XenopixelLightTest, LinkHealth_WindowResetOnDisconnect) {
+  state_.current_values.set_state(true);
+  write_state();
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+  EXPECT_TRUE(std::isnan(light_.get_link_health_percent()));
+  EXPECT_EQ(light_.get_link_health().successes(), 3u);
+}
+
+TEST_F(XenopixelLightTest, TxQueue_DisconnectClearsQueue) {
+  esp_ble_gattc_cb_param_t param{};
+  param.congest.conn_id = 2;
+  param.congest.congested = true;
+  client_.dispatch_gattc_event(ESP_GATTC_CONGEST_EVT, &param);
+  state_.current_values.set_state(true);
+  write_state();
+
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+  EXPECT_FALSE(light_.is_tx_congested());
+  EXPECT_EQ(light_.get_tx_stats().dropped, 3u);
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+// ── Color rate limiter ──────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, ColorRate_FlushesTrailingColor) {
+  state_.current_values.set_state(true);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  g_ble_writes().clear();
+
+  // Suppressed inside the interval, but not lost
+  state_.current_values.set_rgb(0.0f, 1.0f, 0.0f);
+  mock_millis_value() = 1050;
+  write_state();
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  // No new write_state — the next loop past the interval sends it
+  mock_millis_value() = 1100;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"BackgroundColor\":[0,255,0]}]");
+}
+
+TEST_F(XenopixelLightTest, ColorRate_SendsOnlyLatestTarget) {
+  state_.current_values.set_state(true);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  g_ble_writes().clear();
+
+  mock_millis_value() = 1020;
+  state_.current_values.set_rgb(0.0f, 1.0f, 0.0f);
+  write_state();
+  mock_millis_value() = 1040;
+  state_.current_values.set_rgb(0.0f, 0.0f, 1.0f);
+  write_state();
+  mock_millis_value() = 1100;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"BackgroundColor\":[0,0,255]}]");
+}
+
+TEST_F(XenopixelLightTest, ColorRate_RevertCancelsWaitingColor) {
+  state_.current_values.set_state(true);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  g_ble_writes().clear();
+
+  mock_millis_value() = 1020;
+  state_.current_values.set_rgb(0.0f, 1.0f, 0.0f);
+  write_state();
+  mock_millis_value() = 1040;
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);  // back to what was sent
+  write_state();
+  mock_millis_value() = 2000;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, ColorRate_PowerOffCancelsWaitingColor) {
+  state_.current_values.set_state(true);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  mock_millis_value() = 1020;
+  state_.current_values.set_rgb(0.0f, 1.0f, 0.0f);
+  write_state();
+  g_ble_writes().clear();
+
+  state_.current_values.set_state(false);
+  write_state();
+  mock_millis_value() = 2000;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":false}]");
+}
+
+TEST_F(XenopixelLightTest, ColorRate_SpeedsUpOnWriteCompletion) {
+  light_.set_color_interval_bounds(20, 400);
+  state_.current_values.set_state(true);
+  write_state();
+  uint32_t before = light_.get_color_interval_ms();
+
+  esp_ble_gattc_cb_param_t param{};
+  param.write.status = ESP_GATT_OK;
+  param.write.conn_id = 2;
+  param.write.handle = 42;
+  mock_millis_value() = 1005;
+  client_.dispatch_gattc_event(ESP_GATTC_WRITE_CHAR_EVT, &param);
+  EXPECT_LT(light_.get_color_interval_ms(), before);
+}
+
+TEST_F(XenopixelLightTest, ColorRate_BacksOffOnCongestion) {
+  uint32_t before = light_.get_color_interval_ms();
+  esp_ble_gattc_cb_param_t param{};
+  param.congest.conn_id = 2;
+  param.congest.congested = true;
+  client_.dispatch_gattc_event(ESP_GATTC_CONGEST_EVT, &param);
+  EXPECT_GT(light_.get_color_interval_ms(), before);
+}
+
+TEST_F(XenopixelLightTest, ColorRate_BacksOffOnFailedColorWrite) {
+  state_.current_values.set_state(true);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  uint32_t before = light_.get_color_interval_ms();
+
+  mock_ble_write_status() = ESP_FAIL;
+  mock_millis_value() = 2000;
+  state_.current_values.set_rgb(0.0f, 0.0f, 1.0f);
+  write_state();
+  EXPECT_GT(light_.get_color_interval_ms(), before);
+}
+
+// ── Zero-allocation WLED path ───────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, WLED_PointerOverloadMatchesVector) {
+  const uint8_t pkt[] = {0x00, 0x00, 200, 255, 0, 128};
+  light_.apply_wled_packet(pkt, sizeof(pkt));
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":78}]");
+  EXPECT_EQ(g_ble_writes()[2].data, "[2,{\"BackgroundColor\":[255,0,128]}]");
+}
+
+TEST_F(XenopixelLightTest, WLED_PointerOverloadRejectsShortLength) {
+  // Buffer is long enough, but only 5 bytes are valid
+  const uint8_t pkt[] = {0x00, 0x00, 200, 255, 0, 128};
+  light_.apply_wled_packet(pkt, 5);
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, WLED_AppliesPacketSnapshot) {
+  WledPacket latest;
+  const uint8_t bytes[] = {0x00, 0x00, 255, 0, 0, 255};
+  memcpy(latest.data, bytes, sizeof(bytes));
+  latest.len = sizeof(bytes);
+
+  WledPacket snapshot = latest;  // plain copy, no allocation
+  latest.data[5] = 0;
+  light_.apply_wled_packet(snapshot.data, snapshot.len);
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[2].data, "[2,{\"BackgroundColor\":[0,0,255]}]");
+}
+
+// ── Shared WLED receiver ────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, WLED_LoopAppliesPublishedPacketOnce) {
+  light_.set_wled_active(true);
+  const uint8_t pkt[] = {0x00, 0x00, 200, 255, 0, 0};
+  WledReceiver::instance().publish(pkt, sizeof(pkt));
+
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+
+  // Same generation — nothing re-applied
+  g_ble_writes().clear();
+  mock_millis_value() = 2000;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, WLED_LoopIgnoresPacketsWhenInactive) {
+  const uint8_t pkt[] = {0x00, 0x00, 200, 255, 0, 0};
+  WledReceiver::instance().publish(pkt, sizeof(pkt));
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, WLED_EachInstanceConsumesPacket) {
+  XenopixelLight other;
+  ble_client::BLEClient other_client;
+  ble_client::BLECharacteristic other_chr;
+  other_chr.handle = 43;
+  other_client.set_mock_characteristic(&other_chr);
+  other.set_ble_client(&other_client);
+  other.set_authorized_global(&authorized_);
+  other.set_syncing_global(&syncing_);
+  other.set_combine_commands(false);
+
+  light_.set_wled_active(true);
+  other.set_wled_active(true);
+  light_.loop();  // consume the fixture's stale packet
+  uint32_t decoded = WledHub::instance().packets_decoded();
+  const uint8_t pkt[] = {0x00, 0x00, 200, 255, 0, 0};
+  WledReceiver::instance().publish(pkt, sizeof(pkt));
+
+  // Decoded once and delivered to both; the scheduler writes for both
+  light_.loop();
+  other.loop();
+  ASSERT_EQ(g_ble_writes().size(), 6u);
+  int first = 0, second = 0;
+  for (const auto &w : g_ble_writes()) {
+    first += w.handle == 42;
+    second += w.handle == 43;
+  }
+  EXPECT_EQ(first, 3);
+  EXPECT_EQ(second, 3);
+  EXPECT_EQ(WledHub::instance().packets_decoded(), decoded + 1);
+}
+
+TEST_F(XenopixelLightTest, WLED_LoopDrainsSharedSocket) {
+  MockWledSocket sock;
+  WledReceiver::instance().set_socket(&sock);
+  light_.set_wled_active(true);
+  light_.loop();  // consume the fixture's stale packet
+  const uint8_t old_pkt[] = {0x00, 0x00, 200, 0, 255, 0};
+  const uint8_t pkt[] = {0x00, 0x00, 200, 255, 0, 0};
+  sock.inject(old_pkt, sizeof(old_pkt));
+  sock.inject(pkt, sizeof(pkt));
+
+  light_.loop();
+  EXPECT_EQ(sock.pending(), 0u);
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[2].data, "[2,{\"BackgroundColor\":[255,0,0]}]");
+
+  g_ble_writes().clear();
+  mock_millis_value() = 2000;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+  WledReceiver::instance().set_socket(nullptr);
+}
+
+TEST_F(XenopixelLightTest, Sched_LightsShareWriteScheduler) {
+  EXPECT_EQ(BleWriteScheduler::instance().client_count(), 1u);
+  {
+    XenopixelLight other;
+    ble_client::BLEClient other_client;
+    other.set_ble_client(&other_client);
+    EXPECT_EQ(BleWriteScheduler::instance().client_count(), 2u);
+  }
+  EXPECT_EQ(BleWriteScheduler::instance().client_count(), 1u);
+}
+
+TEST_F(XenopixelLightTest, WLED_DisableLeavesHub) {
+  light_.set_wled_active(true);
+  EXPECT_EQ(WledHub::instance().subscriber_count(), 1u);
+  light_.set_wled_active(false);
+  EXPECT_EQ(WledHub::instance().subscriber_count(), 0u);
+}
+
+// ── WLED realtime frames ────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, WLED_RealtimeDrgbDrivesBlade) {
+  // DRGB, 2s timeout, pixel 0 = half-bright red
+  std::vector<uint8_t> pkt = {0x02, 2, 128, 0, 0};
+  apply_packet(pkt);
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":50}]");
+  EXPECT_EQ(g_ble_writes()[2].data, "[2,{\"BackgroundColor\":[255,0,0]}]");
+  EXPECT_TRUE(light_.is_wled_realtime());
+}
+
+TEST_F(XenopixelLightTest, WLED_RealtimeUsesPixelWindow) {
+  light_.set_wled_pixel_window(1, 2);
+  // Pixel 0 (red) is outside the window; pixels 1-2 are both blue
+  std::vector<uint8_t> pkt = {0x02, 2, 255, 0, 0, 0, 0, 255, 0, 0, 255};
+  apply_packet(pkt);
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[2].data, "[2,{\"BackgroundColor\":[0,0,255]}]");
+}
+
+TEST_F(XenopixelLightTest, WLED_RealtimeBlackFrameKeepsBladeOn) {
+  apply_packet({0x02, 2, 255, 0, 0});
+  g_ble_writes().clear();
+
+  apply_packet({0x02, 2, 0, 0, 0});
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":0}]");
+}
+
+TEST_F(XenopixelLightTest, WLED_RealtimeBlackFrameDoesNotIgnite) {
+  apply_packet({0x02, 2, 0, 0, 0});
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, WLED_RealtimeSuppressesNotifierUntilTimeout) {
+  apply_packet({0x02, 2, 255, 0, 0});
+  g_ble_writes().clear();
+
+  // Within the 2s timeout, a notifier packet must not fight the stream
+  mock_millis_value() = 2500;
+  apply_packet({0x00, 0x00, 255, 0, 255, 0});
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  mock_millis_value() = 3000;
+  EXPECT_FALSE(light_.is_wled_realtime());
+  apply_packet({0x00, 0x00, 255, 0, 255, 0});
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"BackgroundColor\":[0,255,0]}]");
+}
+
+TEST_F(XenopixelLightTest, WLED_RealtimeTimeout255NeverExpires) {
+  apply_packet({0x02, WLED_TIMEOUT_FOREVER, 255, 0, 0});
+  mock_millis_value() = 1000000;
+  EXPECT_TRUE(light_.is_wled_realtime());
+}
+
+TEST_F(XenopixelLightTest, WLED_LoopDecodesRealtimeInPlace) {
+  light_.set_wled_active(true);
+  light_.set_wled_pixel_window(300, 1);
+  // DNRGB starting at LED 299: pixel 300 is the second record
+  const uint8_t pkt[] = {0x04, 1, 0x01, 0x2B, 255, 0, 0, 0, 0, 255};
+  WledReceiver::instance().publish(pkt, sizeof(pkt));
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[2].data, "[2,{\"BackgroundColor\":[0,0,255]}]");
+}
+
+// ── WLED smoothing ──────────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, WLED_SmoothingPowersOnImmediately) {
+  light_.set_wled_smoothing(100);
+  apply_packet({0x00, 0x00, 255, 255, 0, 0});
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":100}]");
+}
+
+TEST_F(XenopixelLightTest, WLED_SmoothingFadesBetweenPackets) {
+  light_.set_wled_smoothing(100);
+  light_.set_color_interval_bounds(25, 25);
+  apply_packet({0x02, 2, 255, 0, 0});
+  mock_millis_value() = 1100;
+  apply_packet({0x02, 2, 55, 0, 0});
+  g_ble_writes().clear();
+
+  // Render time 1050: halfway, not the raw packet value
+  mock_millis_value() = 1150;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":60}]");
+
+  mock_millis_value() = 1200;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":21}]");
+
+  // Settled: nothing more to send
+  mock_millis_value() = 1300;
+  light_.loop();
+  EXPECT_EQ(g_ble_writes().size(), 2u);
+}
+
+TEST_F(XenopixelLightTest, WLED_SmoothingSkipsWhileCongested) {
+  light_.set_wled_smoothing(100);
+  apply_packet({0x02, 2, 255, 0, 0});
+  mock_millis_value() = 1100;
+  apply_packet({0x02, 2, 55, 0, 0});
+  g_ble_writes().clear();
+
+  esp_ble_gattc_cb_param_t param{};
+  param.congest.conn_id = 2;
+  param.congest.congested = true;
+  light_.gattc_event_handler(ESP_GATTC_CONGEST_EVT, &param);
+  mock_millis_value() = 1300;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  param.congest.congested = false;
+  light_.gattc_event_handler(ESP_GATTC_CONGEST_EVT, &param);
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":21}]");
+}
+
+TEST_F(XenopixelLightTest, WLED_SmoothingStopsOnPowerOff) {
+  light_.set_wled_smoothing(100);
+  apply_packet({0x00, 0x00, 255, 255, 0, 0});
+  mock_millis_value() = 1050;
+  apply_packet({0x00, 0x00, 0, 255, 0, 0});
+  g_ble_writes().clear();
+
+  mock_millis_value() = 1200;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+// ── Light effects ───────────────────────────────────────────────────────────
+
+namespace {
+
+bool starts_with(const std::string &s, const char *prefix) {
+  return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+}  // namespace
+
+class XenopixelEffectTest : public XenopixelLightTest {
+ protected:
+  void SetUp() override {
+    XenopixelLightTest::SetUp();
+    light_.setup_state(&state_);
+    light_.set_color_interval_bounds(100, 100);
+    state_.current_values.set_state(true);
+    state_.current_values.set_brightness(0.8f);
+    state_.current_values.set_rgb(0.0f, 0.0f, 1.0f);
+    write_state();
+    g_ble_writes().clear();
+  }
+
+  void start(XenopixelEffect &effect) {
+    effect.init_internal(&state_);
+    effect.start();
+  }
+
+  // Runs loop() every 10ms for ms milliseconds
+  void run_ms(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += 10) {
+      mock_millis_value() += 10;
+      light_.loop();
+    }
+  }
+};
+
+TEST_F(XenopixelEffectTest, FindsTheLightBehindItsState) {
+  EXPECT_EQ(XenopixelLight::for_state(&state_), &light_);
+  light::LightState other;
+  EXPECT_EQ(XenopixelLight::for_state(&other), nullptr);
+  EXPECT_EQ(XenopixelLight::for_state(nullptr), nullptr);
+}
+
+TEST_F(XenopixelEffectTest, ParamsFromConfig) {
+  XenopixelEffect breathe("Breathe", EffectKind::BREATHE);
+  breathe.set_period(2500);
+  breathe.set_depth(0.5f);
+  EXPECT_EQ(breathe.get_params().kind, EffectKind::BREATHE);
+  EXPECT_EQ(breathe.get_params().period_ms, 2500u);
+  EXPECT_EQ(breathe.get_params().depth, 128);
+  breathe.set_depth(2.0f);
+  EXPECT_EQ(breathe.get_params().depth, 255);
+}
+
+TEST_F(XenopixelEffectTest, BreatheSendsBrightnessOnly) {
+  XenopixelEffect breathe("Breathe", EffectKind::BREATHE);
+  breathe.set_period(1000);
+  breathe.set_depth(1.0f);
+  start(breathe);
+  EXPECT_TRUE(light_.is_effect_running());
+
+  // Phase 0 is the base: nothing to send
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  run_ms(250);
+  ASSERT_FALSE(g_ble_writes().empty());
+  for (const auto &w : g_ble_writes())
+    EXPECT_TRUE(starts_with(w.data, "[2,{\"Brightness\":")) << w.data;
+  EXPECT_NE(g_ble_writes().back().data, "[2,{\"Brightness\":80}]");
+}
+
+TEST_F(XenopixelEffectTest, PacedByTheColorInterval) {
+  XenopixelEffect rainbow("Rainbow", EffectKind::RAINBOW);
+  rainbow.set_period(1000);
+  start(rainbow);
+  run_ms(1000);
+  // One color a tick would be 100; the limiter allows one per 100ms
+  size_t colors = 0;
+  for (const auto &w : g_ble_writes())
+    if (starts_with(w.data, "[2,{\"BackgroundColor\":")) colors++;
+  EXPECT_GE(colors, 9u);
+  EXPECT_LE(colors, 11u);
+}
+
+TEST_F(XenopixelEffectTest, SkipsWhileCongested) {
+  XenopixelEffect rainbow("Rainbow", EffectKind::RAINBOW);
+  start(rainbow);
+  esp_ble_gattc_cb_param_t param{};
+  param.congest.conn_id = 2;
+  param.congest.congested = true;
+  light_.gattc_event_handler(ESP_GATTC_CONGEST_EVT, &param);
+  run_ms(500);
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelEffectTest, WriteStateMovesTheBase) {
+  XenopixelEffect pulse("Pulse", EffectKind::PULSE);
+  start(pulse);
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  // Red from HA only reaches the saber through the effect
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  state_.remote_values = state_.current_values;
+  light_.write_state(&state_);
+  EXPECT_TRUE(g_ble_writes().empty());
+  run_ms(100);
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"BackgroundColor\":[255,0,0]}]");
+}
+
+TEST_F(XenopixelEffectTest, PulseFlashesOnClash) {
+  XenopixelEffect pulse("Pulse", EffectKind::PULSE);
+  pulse.set_period(600);
+  start(pulse);
+  run_ms(200);
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  light_.pulse_effect();
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":100}]");
+  EXPECT_EQ(g_ble_writes()[1].data,
+            "[2,{\"BackgroundColor\":[255,255,255]}]");
+
+  // Decays back to the base
+  run_ms(800);
+  EXPECT_EQ(g_ble_writes().back().data, "[2,{\"BackgroundColor\":[0,0,255]}]");
+}
+
+TEST_F(XenopixelEffectTest, TriggeredClashPulses) {
+  XenopixelEffect pulse("Pulse", EffectKind::PULSE);
+  start(pulse);
+  run_ms(200);
+  light_.trigger_effect(CombatEffect::CLASH);
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Clash\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":100}]");
+}
+
+TEST_F(XenopixelEffectTest, PulseEffectIgnoredWithoutPulse) {
+  light_.pulse_effect();
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelEffectTest, StopRestoresTheBase) {
+  XenopixelEffect breathe("Breathe", EffectKind::BREATHE);
+  breathe.set_period(1000);
+  breathe.set_depth(1.0f);
+  start(breathe);
+  run_ms(400);
+  ASSERT_FALSE(g_ble_writes().empty());
+  g_ble_writes().clear();
+
+  breathe.stop();
+  EXPECT_FALSE(light_.is_effect_running());
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":80}]");
+
+  // write_state() sends directly again
+  state_.current_values.set_brightness(0.5f);
+  write_state();
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":50}]");
+}
+
+TEST_F(XenopixelEffectTest, WledSyncTakesPrecedence) {
+  XenopixelEffect rainbow("Rainbow", EffectKind::RAINBOW);
+  start(rainbow);
+  light_.set_wled_active(true);
+  run_ms(500);
+  for (const auto &w : g_ble_writes())
+    EXPECT_FALSE(starts_with(w.data, "[2,{\"BackgroundColor\":")) << w.data;
+}
+
+TEST_F(XenopixelEffectTest, NothingWhileOff) {
+  XenopixelEffect rainbow("Rainbow", EffectKind::RAINBOW);
+  start(rainbow);
+  state_.current_values.set_state(false);
+  write_state();
+  g_ble_writes().clear();
+  run_ms(500);
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelEffectTest, IdleOnOtherLights) {
+  light::LightState other;
+  XenopixelEffect rainbow("Rainbow", EffectKind::RAINBOW);
+  rainbow.init_internal(&other);
+  rainbow.start();
+  rainbow.stop();
+  EXPECT_FALSE(light_.is_effect_running());
+}
+
+// ── Transitions ─────────────────────────────────────────────────────────────
+
+class TransitionTest : public XenopixelLightTest {
+ protected:
+  struct Values {
+    bool on;
+    float brightness;
+    float r, g, b;
+  };
+
+  void SetUp() override {
+    XenopixelLightTest::SetUp();
+    set(state_.current_values, {true, 0.2f, 1.0f, 0.0f, 0.0f});
+    write_state();
+    g_ble_writes().clear();
+  }
+
+  static void set(light::LightColorValues &v, const Values &x) {
+    v.set_state(x.on);
+    v.set_brightness(x.brightness);
+    v.set_rgb(x.r, x.g, x.b);
+  }
+
+  // An ESPHome transition: steps write_state() calls 16ms apart with
+  // current_values interpolated towards remote_values, the last one at the
+  // target
+  void fade(const Values &from, const Values &to, int steps) {
+    set(state_.remote_values, to);
+    for (int i = 1; i < steps; i++) {
+      float k = (float)i / steps;
+      set(state_.current_values,
+          {from.on || to.on, from.brightness + (to.brightness - from.brightness) * k,
+           from.r + (to.r - from.r) * k, from.g + (to.g - from.g) * k,
+           from.b + (to.b - from.b) * k});
+      step();
+    }
+    state_.current_values = state_.remote_values;
+    step();
+  }
+
+  void step() {
+    light_.write_state(&state_);
+    mock_millis_value() += 16;
+    light_.loop();
+  }
+
+  std::vector<std::string> writes_of(const char *key) {
+    std::vector<std::string> out;
+    for (const auto &w : g_ble_writes())
+      if (w.data.find(key) != std::string::npos) out.push_back(w.data);
+    return out;
+  }
+};
+
+TEST_F(TransitionTest, KeyframesCapBrightnessWrites) {
+  fade({true, 0.2f, 1.0f, 0.0f, 0.0f}, {true, 1.0f, 1.0f, 0.0f, 0.0f}, 125);
+  auto writes = writes_of("Brightness");
+  ASSERT_EQ(writes.size(), 4u);
+  EXPECT_EQ(writes[0], "[2,{\"Brightness\":40}]");
+  EXPECT_EQ(writes[1], "[2,{\"Brightness\":60}]");
+  EXPECT_EQ(writes[2], "[2,{\"Brightness\":80}]");
+  EXPECT_EQ(writes[3], "[2,{\"Brightness\":100}]");
+}
+
+TEST_F(TransitionTest, KeyframesCapColorWrites) {
+  fade({true, 0.2f, 1.0f, 0.0f, 0.0f}, {true, 0.2f, 0.0f, 0.0f, 1.0f}, 125);
+  auto writes = writes_of("BackgroundColor");
+  ASSERT_EQ(writes.size(), 4u);
+  EXPECT_EQ(writes[3], "[2,{\"BackgroundColor\":[0,0,255]}]");
+  EXPECT_TRUE(writes_of("Brightness").empty());
+}
+
+TEST_F(TransitionTest, KeyframeCountIsConfigurable) {
+  light_.set_transition_keyframes(2);
+  fade({true, 0.2f, 1.0f, 0.0f, 0.0f}, {true, 1.0f, 1.0f, 0.0f, 0.0f}, 125);
+  auto writes = writes_of("Brightness");
+  ASSERT_EQ(writes.size(), 2u);
+  EXPECT_EQ(writes[0], "[2,{\"Brightness\":60}]");
+  EXPECT_EQ(writes[1], "[2,{\"Brightness\":100}]");
+}
+
+TEST_F(TransitionTest, TargetModeJumpsAtTheStart) {
+  light_.set_brightness_transition(TransitionMode::TARGET);
+  set(state_.remote_values, {true, 1.0f, 1.0f, 0.0f, 0.0f});
+  set(state_.current_values, {true, 0.21f, 1.0f, 0.0f, 0.0f});
+  step();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":100}]");
+
+  fade({true, 0.21f, 1.0f, 0.0f, 0.0f}, {true, 1.0f, 1.0f, 0.0f, 0.0f}, 60);
+  EXPECT_EQ(g_ble_writes().size(), 1u);
+}
+
+TEST_F(TransitionTest, AllModeSendsEveryStep) {
+  light_.set_brightness_transition(TransitionMode::ALL);
+  fade({true, 0.2f, 1.0f, 0.0f, 0.0f}, {true, 1.0f, 1.0f, 0.0f, 0.0f}, 125);
+  EXPECT_GT(writes_of("Brightness").size(), 40u);
+}
+
+TEST_F(TransitionTest, FadeToOffNeverSendsZero) {
+  fade({true, 0.2f, 1.0f, 0.0f, 0.0f}, {false, 0.0f, 1.0f, 0.0f, 0.0f}, 125);
+  auto writes = writes_of("Brightness");
+  ASSERT_EQ(writes.size(), 3u);
+  EXPECT_EQ(writes[2], "[2,{\"Brightness\":5}]");
+  ASSERT_FALSE(g_ble_writes().empty());
+  EXPECT_EQ(g_ble_writes().back().data, "[2,{\"PowerOn\":false}]");
+}
+
+TEST_F(TransitionTest, FadeToOffInTargetModeSwitchesOffAtOnce) {
+  light_.set_brightness_transition(TransitionMode::TARGET);
+  fade({true, 0.2f, 1.0f, 0.0f, 0.0f}, {false, 0.0f, 1.0f, 0.0f, 0.0f}, 60);
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":false}]");
+}
+
+TEST_F(TransitionTest, NewTargetRestartsTheFade) {
+  // Halfway to 100%, HA asks for 40% instead
+  set(state_.remote_values, {true, 1.0f, 1.0f, 0.0f, 0.0f});
+  for (int i = 1; i <= 50; i++) {
+    set(state_.current_values, {true, 0.2f + 0.8f * i / 100, 1.0f, 0.0f, 0.0f});
+    step();
+  }
+  ASSERT_EQ(writes_of("Brightness").size(), 2u);
+  g_ble_writes().clear();
+  fade({true, 0.6f, 1.0f, 0.0f, 0.0f}, {true, 0.4f, 1.0f, 0.0f, 0.0f}, 40);
+  auto writes = writes_of("Brightness");
+  ASSERT_EQ(writes.size(), 4u);
+  EXPECT_EQ(writes[0], "[2,{\"Brightness\":55}]");
+  EXPECT_EQ(writes[3], "[2,{\"Brightness\":40}]");
+}
+
+// ── Dead-band ───────────────────────────────────────────────────────────────
+
+class LightDeadBandTest : public XenopixelLightTest {
+ protected:
+  void SetUp() override {
+    XenopixelLightTest::SetUp();
+    light_.set_brightness_dead_band(1);
+    light_.set_color_dead_band(3);
+    set_level(0.5f, 0.5f, 0.5f, 0.5f);
+    g_ble_writes().clear();
+  }
+
+  void set_level(float brightness, float r, float g, float b) {
+    state_.current_values.set_state(true);
+    state_.current_values.set_brightness(brightness);
+    state_.current_values.set_rgb(r, g, b);
+    write_state();
+  }
+
+  void advance(uint32_t ms) {
+    mock_millis_value() += ms;
+    light_.loop();
+  }
+};
+
+TEST_F(LightDeadBandTest, RoundingFlipsAreHeld) {
+  // 127 of 255 flipping to 128 and back, and 50% to 51%
+  set_level(0.5f, 0.503f, 0.5f, 0.5f);
+  set_level(0.51f, 0.5f, 0.503f, 0.503f);
+  set_level(0.5f, 0.5f, 0.5f, 0.5f);
+  advance(DeadBand::SETTLE_MS);
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(LightDeadBandTest, OutsideTheBandIsSentAtOnce) {
+  set_level(0.6f, 0.5f, 0.5f, 0.5f);
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":60}]");
+  g_ble_writes().clear();
+  set_level(0.6f, 0.5f, 0.6f, 0.5f);
+  advance(100);
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"BackgroundColor\":[127,153,127]}]");
+}
+
+TEST_F(LightDeadBandTest, SettledValueIsSentExactly) {
+  // The end of a slow fade: 60%, then 61% within the band of 60%
+  set_level(0.6f, 0.5f, 0.5f, 0.5f);
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  g_ble_writes().clear();
+  set_level(0.61f, 0.5f, 0.5f, 0.5f);
+  EXPECT_TRUE(g_ble_writes().empty());
+  advance(DeadBand::SETTLE_MS - 1);
+  EXPECT_TRUE(g_ble_writes().empty());
+  advance(1);
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":61}]");
+}
+
+TEST_F(LightDeadBandTest, HoveringNeverWrites) {
+  for (int i = 0; i < 50; i++) {
+    set_level(i % 2 ? 0.51f : 0.49f, 0.5f, 0.5f, 0.5f);
+    advance(50);
+  }
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(LightDeadBandTest, HeldValueDroppedOnPowerOff) {
+  set_level(0.51f, 0.5f, 0.5f, 0.5f);
+  state_.current_values.set_state(false);
+  write_state();
+  g_ble_writes().clear();
+  advance(DeadBand::SETTLE_MS);
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(LightDeadBandTest, AppliesToWled) {
+  light_.set_wled_active(true);
+  g_ble_writes().clear();
+  // 128/255 of full brightness is 50%; 129 is still 50%, 131 is 51%
+  apply_packet({0x00, 0x00, 128, 127, 127, 127});
+  g_ble_writes().clear();
+  apply_packet({0x00, 0x00, 131, 128, 127, 127});
+  EXPECT_TRUE(g_ble_writes().empty());
+  advance(DeadBand::SETTLE_MS);
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":51}]");
+}
+
+// ── Combat effects ──────────────────────────────────────────────────────────
+
+namespace {
+
+void set_congested(ble_client::BLEClient &client, bool congested) {
+  esp_ble_gattc_cb_param_t param{};
+  param.congest.conn_id = 2;
+  param.congest.congested = congested;
+  client.dispatch_gattc_event(ESP_GATTC_CONGEST_EVT, &param);
+}
+
+}  // namespace
+
+TEST_F(XenopixelLightTest, Combat_WrittenAtOnce) {
+  EXPECT_TRUE(light_.trigger_effect(CombatEffect::CLASH));
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Clash\":true}]");
+}
+
+TEST_F(XenopixelLightTest, Combat_Frames) {
+  light_.trigger_effect(CombatEffect::BLASTER);
+  light_.trigger_effect(CombatEffect::FORCE, false);  // one-shots ignore on
+  light_.trigger_effect(CombatEffect::LOCKUP);
+  light_.trigger_effect(CombatEffect::DRAG, false);
+  ASSERT_EQ(g_ble_writes().size(), 4u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Blaster\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Force\":true}]");
+  EXPECT_EQ(g_ble_writes()[2].data, "[2,{\"Lockup\":true}]");
+  EXPECT_EQ(g_ble_writes()[3].data, "[2,{\"Drag\":false}]");
+}
+
+TEST_F(XenopixelLightTest, Combat_SkipsWhenNotAuthorized) {
+  authorized_.value() = false;
+  EXPECT_FALSE(light_.trigger_effect(CombatEffect::CLASH));
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, Combat_OvertakesQueuedCommands) {
+  set_congested(client_, true);
+  state_.current_values.set_state(true);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  EXPECT_TRUE(light_.trigger_effect(CombatEffect::CLASH));
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  set_congested(client_, false);
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 4u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Clash\":true}]");
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"PowerOn\":true}]");
+}
+
+TEST_F(XenopixelLightTest, Combat_ToggleCoalesces) {
+  set_congested(client_, true);
+  light_.trigger_effect(CombatEffect::LOCKUP, true);
+  light_.trigger_effect(CombatEffect::LOCKUP, false);
+  set_congested(client_, false);
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Lockup\":false}]");
+}
+
+TEST_F(XenopixelLightTest, Combat_RecordsLatency) {
+  light_.trigger_effect(CombatEffect::BLASTER);
+  EXPECT_EQ(light_.get_effect_latency().count(), 1u);
+
+  set_congested(client_, true);
+  light_.trigger_effect(CombatEffect::CLASH);
+  mock_micros_value() += 5000;
+  set_congested(client_, false);
+  light_.loop();
+  EXPECT_EQ(light_.get_effect_latency().count(), 2u);
+  EXPECT_EQ(light_.get_effect_latency().max_us(), 5000u);
+  EXPECT_FLOAT_EQ(light_.get_effect_latency_ms(), 5.0f);
+}
+
+TEST_F(XenopixelLightTest, Combat_DroppedAfterMaxRetries) {
+  mock_ble_write_status() = ESP_FAIL;
+  light_.trigger_effect(CombatEffect::CLASH);
+  EXPECT_EQ(light_.get_tx_stats().retried, 1u);
+  for (int i = 0; i < 8; i++) {
+    mock_millis_value() += TX_RETRY_MAX_MS;
+    light_.loop();
+  }
+  EXPECT_EQ(light_.get_tx_stats().retried, 3u);
+  EXPECT_EQ(light_.get_tx_stats().dropped, 1u);
+  EXPECT_EQ(light_.get_link_health().failures(), 4u);
+
+  // A late clash is worse than none: nothing is resent
+  mock_ble_write_status() = ESP_OK;
+  mock_millis_value() += TX_RETRY_MAX_MS;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+  EXPECT_EQ(light_.get_effect_latency().count(), 0u);
+}
+
+TEST_F(XenopixelLightTest, Combat_DisconnectClearsTheLane) {
+  set_congested(client_, true);
+  light_.trigger_effect(CombatEffect::FORCE);
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+  EXPECT_EQ(light_.get_tx_stats().dropped, 1u);
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+// ── Connection parameters ───────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, ConnParams_IdleRequestedOnceAuthorized) {
+  authorized_.value() = false;
+  light_.loop();
+  EXPECT_TRUE(g_conn_param_requests().empty());
+
+  authorized_.value() = true;
+  light_.loop();
+  light_.loop();
+  ASSERT_EQ(g_conn_param_requests().size(), 1u);
+  const auto &req = g_conn_param_requests()[0];
+  EXPECT_EQ(req.min_int, CONN_PARAMS_IDLE.min_int);
+  EXPECT_EQ(req.latency, CONN_PARAMS_IDLE.latency);
+  EXPECT_EQ(memcmp(req.bda, kBda, 6), 0);
+}
+
+TEST_F(XenopixelLightTest, ConnParams_WledRequestsRealtimeAtOnce) {
+  light_.loop();
+  light_.set_wled_active(true);
+  ASSERT_EQ(g_conn_param_requests().size(), 2u);
+  EXPECT_EQ(g_conn_param_requests()[1].max_int, CONN_PARAMS_REALTIME.max_int);
+  EXPECT_EQ(g_conn_param_requests()[1].latency, 0);
+}
+
+TEST_F(XenopixelLightTest, ConnParams_SlowerModeWaitsToSettle) {
+  state_.current_values.set_state(true);
+  write_state();
+  light_.set_wled_active(true);
+  ASSERT_EQ(g_conn_param_requests().size(), 2u);
+
+  light_.set_wled_active(false);
+  mock_millis_value() += 1999;
+  light_.loop();
+  EXPECT_EQ(g_conn_param_requests().size(), 2u);
+
+  mock_millis_value() += 1;
+  light_.loop();
+  ASSERT_EQ(g_conn_param_requests().size(), 3u);
+  EXPECT_EQ(g_conn_param_requests()[2].min_int, CONN_PARAMS_ACTIVE.min_int);
+}
+
+TEST_F(XenopixelLightTest, ConnParams_QuickToggleBackCostsNothing) {
+  light_.set_wled_active(true);
+  light_.set_wled_active(false);
+  mock_millis_value() += 500;
+  light_.set_wled_active(true);
+  light_.loop();
+  EXPECT_EQ(g_conn_param_requests().size(), 1u);
+}
+
+TEST_F(XenopixelLightTest, ConnParams_ReportsAcceptedInterval) {
+  EXPECT_TRUE(std::isnan(light_.get_conn_interval_ms()));
+  auto p = conn_update(12);
+  light_.gap_event_handler(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &p);
+  EXPECT_FLOAT_EQ(light_.get_conn_interval_ms(), 15.0f);
+  EXPECT_EQ(light_.get_conn_report().events_per_second(), 66u);
+}
+
+TEST_F(XenopixelLightTest, ConnParams_IgnoresOtherPeersAndFailures) {
+  const uint8_t other[6] = {9, 9, 9, 9, 9, 9};
+  auto p = conn_update(12, other);
+  light_.gap_event_handler(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &p);
+  EXPECT_FALSE(light_.get_conn_report().valid);
+
+  p = conn_update(12);
+  p.update_conn_params.status = 0x13;
+  light_.gap_event_handler(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &p);
+  EXPECT_FALSE(light_.get_conn_report().valid);
+}
+
+TEST_F(XenopixelLightTest, ConnParams_DisconnectRequestsAgain) {
+  light_.loop();
+  auto p = conn_update(80);
+  light_.gap_event_handler(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &p);
+
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+  EXPECT_FALSE(light_.get_conn_report().valid);
+  EXPECT_FALSE(authorized_.value());
+  light_.loop();
+  EXPECT_EQ(g_conn_param_requests().size(), 1u);
+
+  light_.confirm_authorized();  // reconnected
+  light_.loop();
+  EXPECT_EQ(g_conn_param_requests().size(), 2u);
+}
+
+TEST_F(XenopixelLightTest, ConnParams_SetupRegistersGapHandler) {
+  esp32_ble::ESP32BLE ble;
+  esp32_ble::global_ble = &ble;
+  light_.setup();
+  esp32_ble::global_ble = nullptr;
+  ASSERT_EQ(ble.gap_handlers.size(), 1u);
+  EXPECT_EQ(ble.gap_handlers[0], &light_);
+}
+
+TEST_F(XenopixelLightTest, Mtu_ReadFromTheClient) {
+  EXPECT_EQ(light_.get_att_mtu(), 0);
+  exchange_mtu(185);
+  EXPECT_EQ(client_.get_mtu(), 185);
+  EXPECT_EQ(light_.get_att_mtu(), 185);
+
+  esp_ble_gattc_cb_param_t other{};
+  other.cfg_mtu.conn_id = 7;
+  other.cfg_mtu.mtu = 247;
+  client_.dispatch_gattc_event(ESP_GATTC_CFG_MTU_EVT, &other);
+  EXPECT_EQ(light_.get_att_mtu(), 185);
+
+  exchange_mtu(0, ESP_GATT_ERROR);
+  EXPECT_EQ(light_.get_att_mtu(), 185);
+
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+  EXPECT_EQ(light_.get_att_mtu(), 0);
+}
+
+// ── GATT handle cache ───────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, Gatt_EnablesServiceChangedIndications) {
+  mock_install_xenopixel_gatt_db();
+  ASSERT_TRUE(light_.enable_service_changed_indications());
+  ASSERT_EQ(g_descr_writes().size(), 1u);
+  EXPECT_EQ(g_descr_writes()[0].handle, 9);
+  EXPECT_EQ(g_descr_writes()[0].value, (std::vector<uint8_t>{0x02, 0x00}));
+  ASSERT_EQ(g_notify_registrations().size(), 1u);
+  EXPECT_EQ(g_notify_registrations()[0], 8);
+  EXPECT_TRUE(light_.has_gatt_profile());
+}
+
+TEST_F(XenopixelLightTest, Gatt_FailsWithoutServiceChanged) {
+  EXPECT_FALSE(light_.enable_service_changed_indications());
+  EXPECT_TRUE(g_descr_writes().empty());
+  EXPECT_FALSE(light_.has_gatt_profile());
+}
+
+TEST_F(XenopixelLightTest, Gatt_ReconnectVerifiesCachedHandles) {
+  mock_install_xenopixel_gatt_db();
+  light_.enable_service_changed_indications();
+  int first = mock_gatt_lookups();
+
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+  mock_gatt_lookups() = 0;
+  ASSERT_TRUE(light_.enable_service_changed_indications());
+  EXPECT_EQ(mock_gatt_lookups(), 1);
+  EXPECT_LT(mock_gatt_lookups(), first);
+  EXPECT_EQ(SaberGattProfile::instance().discoveries(), 1u);
+}
+
+TEST_F(XenopixelLightTest, Gatt_StaleCacheIsRediscovered) {
+  mock_install_xenopixel_gatt_db();
+  light_.enable_service_changed_indications();
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+
+  // Firmware update moved everything up by 4 handles
+  for (auto &a : mock_gatt_db()) {
+    a.handle += 4;
+    if (a.end) a.end += 4;
+    if (a.owner) a.owner += 4;
+  }
+  ASSERT_TRUE(light_.enable_service_changed_indications());
+  EXPECT_EQ(g_descr_writes().back().handle, 13);
+  EXPECT_EQ(SaberGattProfile::instance().discoveries(), 2u);
+}
+
+TEST_F(XenopixelLightTest, Gatt_CommandsUseCached3ab1Handle) {
+  mock_install_xenopixel_gatt_db();
+  light_.enable_service_changed_indications();
+  state_.current_values.set_state(true);
+  write_state();
+  ASSERT_FALSE(g_ble_writes().empty());
+  EXPECT_EQ(g_ble_writes()[0].handle, 16);
+}
+
+TEST_F(XenopixelLightTest, Gatt_ServiceChangedDropsCache) {
+  mock_install_xenopixel_gatt_db();
+  light_.enable_service_changed_indications();
+
+  esp_ble_gattc_cb_param_t param{};
+  const uint8_t other[6] = {9, 9, 9, 9, 9, 9};
+  memcpy(param.srvc_chg.remote_bda, other, 6);
+  client_.dispatch_gattc_event(ESP_GATTC_SRVC_CHG_EVT, &param);
+  EXPECT_TRUE(light_.has_gatt_profile());
+
+  memcpy(param.srvc_chg.remote_bda, kBda, 6);
+  client_.dispatch_gattc_event(ESP_GATTC_SRVC_CHG_EVT, &param);
+  EXPECT_FALSE(light_.has_gatt_profile());
+}
+
+TEST_F(XenopixelLightTest, Gatt_InvalidHandleWriteDropsCache) {
+  mock_install_xenopixel_gatt_db();
+  light_.enable_service_changed_indications();
+  state_.current_values.set_state(true);
+  write_state();
+
+  esp_ble_gattc_cb_param_t param{};
+  param.write.conn_id = 2;
+  param.write.handle = 16;
+  param.write.status = ESP_GATT_INVALID_HANDLE;
+  client_.dispatch_gattc_event(ESP_GATTC_WRITE_CHAR_EVT, &param);
+  EXPECT_FALSE(light_.has_gatt_profile());
+}
+
+// ── Handshake session ───────────────────────────────────────────────────────
+
+namespace {
+
+esp_ble_gattc_cb_param_t write_evt(uint16_t handle,
+                                   esp_gatt_status_t status = ESP_GATT_OK) {
+  esp_ble_gattc_cb_param_t param{};
+  param.write.conn_id = 2;
+  param.write.handle = handle;
+  param.write.status = status;
+  return param;
+}
+
+}  // namespace
+
+class SessionTest : public XenopixelLightTest {
+ protected:
+  void SetUp() override {
+    XenopixelLightTest::SetUp();
+    authorized_.value() = false;
+    mock_install_xenopixel_gatt_db();
+  }
+
+  void connect() {
+    esp_ble_gattc_cb_param_t param{};
+    param.open.status = ESP_GATT_OK;
+    param.open.conn_id = 2;
+    memcpy(param.open.remote_bda, kBda, 6);
+    client_.dispatch_gattc_event(ESP_GATTC_OPEN_EVT, &param);
+  }
+
+  void services_ready() {
+    esp_ble_gattc_cb_param_t param{};
+    param.search_cmpl.conn_id = 2;
+    client_.dispatch_gattc_event(ESP_GATTC_SEARCH_CMPL_EVT, &param);
+  }
+
+  void ack_cccd(esp_gatt_status_t status = ESP_GATT_OK) {
+    auto param = write_evt(9, status);
+    client_.dispatch_gattc_event(ESP_GATTC_WRITE_DESCR_EVT, &param);
+  }
+
+  void ack_handshake(esp_gatt_status_t status = ESP_GATT_OK) {
+    auto param = write_evt(12, status);
+    client_.dispatch_gattc_event(ESP_GATTC_WRITE_CHAR_EVT, &param);
+  }
+};
+
+TEST_F(SessionTest, AdvancesOnGattEvents) {
+  connect();
+  mock_millis_value() += 150;
+  services_ready();
+  ASSERT_EQ(g_descr_writes().size(), 1u);
+  EXPECT_EQ(g_descr_writes()[0].handle, 9);
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  mock_millis_value() += 20;
+  ack_cccd();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].handle, 12);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"HandShake\":\"HelloDamien\"}]");
+
+  mock_millis_value() += 20;
+  ack_handshake();
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+  EXPECT_EQ(g_ble_writes()[1].handle, 16);
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Authorize\":\"SaberOfDamien\"}]");
+  EXPECT_FALSE(authorized_.value());
+
+  mock_millis_value() += 300;
+  light_.confirm_authorized();
+  EXPECT_TRUE(authorized_.value());
+  EXPECT_TRUE(light_.get_session().is_authorized());
+  EXPECT_FLOAT_EQ(light_.get_time_to_authorized_ms(), 490.0f);
+}
+
+TEST_F(SessionTest, TimeToAuthorizedUnknownUntilAuthorized) {
+  EXPECT_TRUE(std::isnan(light_.get_time_to_authorized_ms()));
+}
+
+TEST_F(SessionTest, IgnoresOtherDescriptorWrites) {
+  connect();
+  services_ready();
+  auto param = write_evt(13);  // DAE1 notification CCCD
+  client_.dispatch_gattc_event(ESP_GATTC_WRITE_DESCR_EVT, &param);
+  EXPECT_TRUE(g_ble_writes().empty());
+  EXPECT_EQ(light_.get_session().state(), SessionState::ENABLING_INDICATIONS);
+}
+
+TEST_F(SessionTest, UnansweredAuthorizeIsResent) {
+  connect();
+  services_ready();
+  ack_cccd();
+  ack_handshake();
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+
+  mock_millis_value() += SaberSession::AUTHORIZE_TIMEOUT_MS - 1;
+  light_.loop();
+  EXPECT_EQ(g_ble_writes().size(), 2u);
+  mock_millis_value() += 1;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  EXPECT_EQ(g_ble_writes()[2].handle, 16);
+}
+
+TEST_F(SessionTest, RejectedCccdWriteIsRetriedAfterDelay) {
+  connect();
+  services_ready();
+  ack_cccd(ESP_GATT_ERROR);
+  EXPECT_EQ(g_descr_writes().size(), 1u);
+
+  mock_millis_value() += SaberSession::RETRY_DELAY_MS;
+  light_.loop();
+  EXPECT_EQ(g_descr_writes().size(), 2u);
+  ack_cccd();
+  EXPECT_EQ(g_ble_writes().size(), 1u);
+}
+
+TEST_F(SessionTest, GivesUpAndDisconnects) {
+  connect();
+  services_ready();
+  ack_cccd();
+  for (uint8_t i = 0; i <= SaberSession::MAX_RETRIES; i++) {
+    mock_millis_value() += SaberSession::HANDSHAKE_TIMEOUT_MS;
+    light_.loop();
+  }
+  EXPECT_EQ(g_ble_writes().size(), 1u + SaberSession::MAX_RETRIES);
+  EXPECT_EQ(light_.get_session().state(), SessionState::FAILED);
+  EXPECT_EQ(client_.disconnect_count(), 1);
+}
+
+TEST_F(SessionTest, DisconnectEndsSession) {
+  connect();
+  services_ready();
+  ack_cccd();
+  ack_handshake();
+  light_.confirm_authorized();
+
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+  EXPECT_FALSE(authorized_.value());
+  EXPECT_EQ(light_.get_session().state(), SessionState::DISCONNECTED);
+
+  // Nothing is resent while disconnected
+  mock_millis_value() += 10000;
+  light_.loop();
+  EXPECT_EQ(g_ble_writes().size(), 2u);
+}
+
+TEST_F(SessionTest, ReconnectWithCachedHandlesSkipsDiscovery) {
+  connect();
+  services_ready();
+  ack_cccd();
+  ack_handshake();
+  light_.confirm_authorized();
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+
+  mock_gatt_lookups() = 0;
+  connect();
+  services_ready();
+  EXPECT_EQ(mock_gatt_lookups(), 1);
+  EXPECT_EQ(SaberGattProfile::instance().discoveries(), 1u);
+  EXPECT_EQ(g_descr_writes().size(), 2u);
+}
+
+// ── Keepalive ───────────────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, Keepalive_SentOnlyAfterIdleInterval) {
+  light_.set_keepalive_interval(30000);
+  light_.update_cached_brightness(50);
+  light_.confirm_authorized();
+  mock_millis_value() += 29999;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  mock_millis_value() += 1;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":50}]");
+  EXPECT_EQ(light_.get_tx_stats().keepalives, 1u);
+
+  // The next one waits a full interval again
+  mock_millis_value() += 1000;
+  light_.loop();
+  EXPECT_EQ(g_ble_writes().size(), 1u);
+}
+
+TEST_F(XenopixelLightTest, Keepalive_RealWritesResetIdleTimer) {
+  light_.set_keepalive_interval(30000);
+  light_.confirm_authorized();
+  mock_millis_value() += 20000;
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.8f);
+  write_state();
+  size_t writes = g_ble_writes().size();
+  ASSERT_GT(writes, 0u);
+
+  mock_millis_value() += 20000;
+  light_.loop();
+  EXPECT_EQ(g_ble_writes().size(), writes);
+  EXPECT_EQ(light_.get_tx_stats().keepalives, 0u);
+}
+
+TEST_F(XenopixelLightTest, Keepalive_OtherWritesOnConnectionCount) {
+  light_.set_keepalive_interval(30000);
+  light_.update_cached_brightness(50);
+  light_.confirm_authorized();
+  mock_millis_value() += 25000;
+  // e.g. a Volume write from a number entity
+  esp_ble_gattc_cb_param_t param{};
+  param.write.conn_id = 2;
+  param.write.handle = 42;
+  param.write.status = ESP_GATT_OK;
+  client_.dispatch_gattc_event(ESP_GATTC_WRITE_CHAR_EVT, &param);
+
+  mock_millis_value() += 25000;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, Keepalive_PicksShortestNoOpFrame) {
+  light_.set_keepalive_interval(1000);
+  light_.update_cached_power(false);
+  light_.update_cached_brightness(100);
+  light_.confirm_authorized();
+  mock_millis_value() += 1000;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"PowerOn\":false}]");
+
+  // A lit blade only ever gets its brightness back, never PowerOn:true
+  light_.update_cached_power(true);
+  mock_millis_value() += 1000;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"Brightness\":100}]");
+}
+
+TEST_F(XenopixelLightTest, Keepalive_NothingKnownNothingSent) {
+  light_.set_keepalive_interval(1000);
+  light_.update_cached_power(true);
+  light_.confirm_authorized();
+  mock_millis_value() += 5000;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, Keepalive_DisabledOrUnauthorized) {
+  light_.update_cached_brightness(50);
+  light_.set_keepalive_interval(0);
+  mock_millis_value() += 100000;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+
+  light_.set_keepalive_interval(1000);
+  authorized_.value() = false;
+  light_.loop();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+// ── Shadow state ────────────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, Shadow_NotificationEchoSendsNothing) {
+  EXPECT_TRUE(light_.update_cached_power(true));
+  EXPECT_TRUE(light_.update_cached_brightness(60));
+  EXPECT_TRUE(light_.update_cached_color(255, 0, 0));
+
+  // The entity follows the notification and calls write_state()
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.6f);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  EXPECT_TRUE(g_ble_writes().empty());
+}
+
+TEST_F(XenopixelLightTest, Shadow_OnlyChangedFieldIsSent) {
+  light_.update_cached_power(true);
+  light_.update_cached_brightness(60);
+  light_.update_cached_color(255, 0, 0);
+  state_.current_values.set_state(true);
+  state_.current_values.set_brightness(0.8f);
+  state_.current_values.set_rgb(1.0f, 0.0f, 0.0f);
+  write_state();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Brightness\":80}]");
+}
+
+TEST_F(XenopixelLightTest, Shadow_RepeatedReportIsNotAChange) {
+  EXPECT_TRUE(light_.update_cached_volume(40));
+  EXPECT_FALSE(light_.update_cached_volume(40));
+  EXPECT_TRUE(light_.update_cached_volume(41));
+}
+
+TEST_F(XenopixelLightTest, Shadow_SettingsSentAsDeltas) {
+  EXPECT_TRUE(light_.send_volume(40));
+  EXPECT_FALSE(light_.send_volume(40));
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Volume\":40}]");
+
+  // Saber reports the value a number entity is then set to
+  light_.update_cached_sound_font(7);
+  EXPECT_FALSE(light_.send_sound_font(7));
+  EXPECT_TRUE(light_.send_sound_font(8));
+  light_.update_cached_light_effect(2);
+  EXPECT_FALSE(light_.send_light_effect(2));
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 2u);
+  EXPECT_EQ(g_ble_writes()[1].data, "[2,{\"CurrentSoundPackageNo\":8}]");
+}
+
+TEST_F(XenopixelLightTest, Shadow_SettingsNeedAuthorization) {
+  authorized_.value() = false;
+  EXPECT_FALSE(light_.send_volume(40));
+  authorized_.value() = true;
+  EXPECT_TRUE(light_.send_volume(40));
+}
+
+TEST_F(XenopixelLightTest, Shadow_SettingOverridesQueuedValue) {
+  light_.send_volume(40);
+  light_.send_volume(50);
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 1u);
+  EXPECT_EQ(g_ble_writes()[0].data, "[2,{\"Volume\":50}]");
+}
+
+TEST_F(XenopixelLightTest, Shadow_ReportWinsOverPendingRequest) {
+  light_.send_volume(40);
+  EXPECT_TRUE(light_.get_shadow().pending(ShadowKey::VOLUME));
+  light_.update_cached_volume(30);  // changed on the saber
+  EXPECT_FALSE(light_.get_shadow().pending(ShadowKey::VOLUME));
+  EXPECT_TRUE(light_.send_volume(40));
+}
+
+TEST_F(XenopixelLightTest, Shadow_ClearedOnDisconnect) {
+  light_.update_cached_volume(30);
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+  EXPECT_FALSE(light_.get_shadow().known(ShadowKey::VOLUME));
+}
+
+TEST_F(XenopixelLightTest, Notify_StreamsResetOnDisconnect) {
+  XenopixelNotificationHandler h;
+  const char head[] = "[3,{\"Volume\":1";
+  light_.get_status_stream().feed(head, sizeof(head) - 1, h);
+  light_.get_reply_stream().feed(head, sizeof(head) - 1, h);
+  EXPECT_FALSE(light_.get_status_stream().idle());
+  esp_ble_gattc_cb_param_t param{};
+  client_.dispatch_gattc_event(ESP_GATTC_DISCONNECT_EVT, &param);
+  EXPECT_TRUE(light_.get_status_stream().idle());
+  EXPECT_TRUE(light_.get_reply_stream().idle());
+}
+
+// ── Instrumentation ─────────────────────────────────────────────────────────
+
+TEST_F(XenopixelLightTest, Instr_TracesHubPacketToWrite) {
+  light_.set_wled_active(true);
+  mock_micros_value() = 1000;
+  const uint8_t pkt[] = {0x00, 0x00, 200, 255, 0, 0};
+  WledReceiver::instance().publish(pkt, sizeof(pkt));
+
+  mock_micros_value() = 1400;
+  light_.loop();
+  ASSERT_EQ(g_ble_writes().size(), 3u);
+  const auto &instr = Instrumentation::instance();
+  EXPECT_EQ(instr.histogram(LatencyStage::RX_TO_DECODE).max_us(), 400u);
+  // One sample per frame built from the packet
+  EXPECT_EQ(instr.histogram(LatencyStage::DECODE_TO_ENQUEUE).count(), 3u);
+  EXPECT_EQ(instr.histogram(LatencyStage::RX_TO_TX).count(), 3u);
+  EXPECT_EQ(instr.histogram(LatencyStage::RX_TO_TX).max_us(), 400u);
+}
+
+TEST_F(XenopixelLightTest, Instr_HomeAssistantWritesAreNotTraced) {
+  state_.current_values.set_state(true);
+  write_state();
+  ASSERT_FALSE(g_ble_writes().empty());
+  EXPECT_EQ(Instrumentation::instance()
+                .histogram(LatencyStage::RX_TO_TX)
+                .count(),
+            0u);
+}
+
+TEST_F(XenopixelLightTest, Instr_HeldColorKeepsItsTrace) {
+  apply_packet({0x00, 0x00, 255, 255, 0, 0});
+  const auto &rx_tx =
+      Instrumentation::instance().histogram(LatencyStage::RX_TO_TX);
+  uint32_t before = rx_tx.count();
+
+  // Inside the color interval: the color waits for the limiter
+  mock_micros_value() = 5000;
+  mock_millis_value() += 1;
+  apply_packet({0x00, 0x00, 255, 0, 255, 0});
+  EXPECT_EQ(rx_tx.count(), before);
+
+  mock_micros_value() = 600000;
+  mock_millis_value() += 1000;
+  light_.loop();
+  EXPECT_EQ(rx_tx.count(), before + 1);
+  EXPECT_EQ(rx_tx.max_us(), 595000u);
+}
+
+TEST_F(XenopixelLightTest, Instr_CountsDebouncedColors) {
+  apply_packet({0x00, 0x00, 255, 255, 0, 0});
+  mock_millis_value() += 1;
+  apply_packet({0x00, 0x00, 255, 0, 255, 0});
+  apply_packet({0x00, 0x00, 255, 0, 0, 255});
+  EXPECT_EQ(Instrumentation::instance().debounced(), 1u);
+}
+
+TEST_F(XenopixelLightTest, Instr_CountsFailedWrites) {
+  mock_ble_write_status() = ESP_FAIL;
+  state_.current_values.set_state(true);
+  write_state();
+  EXPECT_GE(Instrumentation::instance().failed(), 1u);
+}